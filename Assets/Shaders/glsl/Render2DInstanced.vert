@@ -0,0 +1,44 @@
+#version 450
+
+layout(location = 0) in vec4  inBasis;
+layout(location = 1) in vec3  inTranslation;
+layout(location = 2) in vec4  inColor;
+layout(location = 3) in vec4  inUVRect;
+layout(location = 4) in uint  inTexIndex;
+layout(location = 5) in float inTilingFactor;
+layout(location = 6) in int   inObjectID;
+
+layout (binding = 0) uniform UBO
+{
+	mat4 viewProjection;
+} ubo;
+
+layout(location = 0) out vec4       outColor;
+layout(location = 1) out vec2       outTexCoord;
+layout(location = 2) out flat float outTexIndex;
+layout(location = 3) out float      outTilingFactor;
+layout(location = 4) out flat int   outObjectID;
+
+const int indices[6] = int[](0, 1, 2, 2, 3, 0);
+
+const vec2 corners[4] = vec2[](
+	vec2(-0.5, -0.5),
+	vec2( 0.5, -0.5),
+	vec2( 0.5,  0.5),
+	vec2(-0.5,  0.5)
+);
+
+void main()
+{
+	vec2 corner = corners[indices[gl_VertexIndex]];
+	vec3 position = inTranslation + vec3(inBasis.xy * corner.x + inBasis.zw * corner.y, 0.0);
+
+	outColor        = inColor;
+	outTexCoord     = mix(inUVRect.xy, inUVRect.zw, corner + 0.5);
+	outTexIndex     = float(inTexIndex);
+	outTilingFactor = inTilingFactor;
+	outObjectID     = inObjectID;
+
+	gl_Position = ubo.viewProjection * vec4(position, 1.0);
+	gl_Position.y = -gl_Position.y;
+}
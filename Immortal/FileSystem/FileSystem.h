@@ -4,6 +4,7 @@
 
 #include "Core.h"
 #include "Stream.h"
+#include "MappedFile.h"
 #include "String/IString.h"
 #include "Shared/Log.h"
 
@@ -252,21 +253,16 @@ static inline std::vector<uint8_t> ReadBinary(const std::string &filename, uint3
     return buffer;
 }
 
+/** Copied straight out of a mapping of the file, without staging it through a read buffer */
 static inline std::string ReadString(const std::string &filename)
 {
-    std::string buffer{};
-    Stream stream{ filename, Stream::Mode::Read };
-    if (!stream.Readable())
+    MappedFile file{ filename };
+    if (!file)
     {
-        LOG::WARN("Unable to open {0}", filename);
-        return buffer;
+        return std::string{};
     }
 
-    buffer.resize(stream.Size());
-
-    stream.Read(buffer.data(), buffer.size());
-
-    return buffer;
+    return std::string{ (const char *)file.Data(), file.Size() };
 }
 
 static std::string ExtractFileName(const std::string &path)
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "Core.h"
+#include "Shared/Log.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Immortal
+{
+namespace FileSystem
+{
+
+/**
+ * @brief A read-only view of a whole file mapped into the address space.
+ *  The pages are loaded on demand by the system instead of being copied
+ *  into a buffer, so large files could be decoded straight from the
+ *  mapping. The view stays valid until the file is closed or destroyed.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+
+    MappedFile(const std::string &path);
+
+    MappedFile(MappedFile &&other);
+
+    MappedFile &operator=(MappedFile &&other);
+
+    MappedFile(const MappedFile &other) = delete;
+
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    ~MappedFile();
+
+    bool Open(const std::string &path);
+
+    void Close();
+
+    void Swap(MappedFile &other);
+
+    const uint8_t *Data() const
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+
+    bool IsOpened() const
+    {
+        return !!data;
+    }
+
+    operator bool() const
+    {
+        return IsOpened();
+    }
+
+protected:
+    const uint8_t *data;
+
+    size_t size;
+
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+inline MappedFile::MappedFile() :
+    data{},
+    size{}
+#ifdef _WIN32
+    , mapping{}
+#endif
+{
+
+}
+
+inline MappedFile::MappedFile(const std::string &path) :
+    MappedFile{}
+{
+    Open(path);
+}
+
+inline MappedFile::MappedFile(MappedFile &&other) :
+    MappedFile{}
+{
+    other.Swap(*this);
+}
+
+inline MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+    MappedFile{ std::move(other) }.Swap(*this);
+    return *this;
+}
+
+inline MappedFile::~MappedFile()
+{
+    Close();
+}
+
+inline void MappedFile::Swap(MappedFile &other)
+{
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+#ifdef _WIN32
+    std::swap(mapping, other.mapping);
+#endif
+}
+
+#ifdef _WIN32
+inline bool MappedFile::Open(const std::string &path)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        LOG::WARN("Unable to open {0}", path);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize) || !fileSize.QuadPart)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        LOG::WARN("Unable to map {0}", path);
+        return false;
+    }
+
+    data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        LOG::WARN("Unable to map {0}", path);
+        return false;
+    }
+    size = size_t(fileSize.QuadPart);
+
+    return true;
+}
+
+inline void MappedFile::Close()
+{
+    if (data)
+    {
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+    }
+    data    = nullptr;
+    size    = 0;
+    mapping = nullptr;
+}
+#else
+inline bool MappedFile::Open(const std::string &path)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG::WARN("Unable to open {0}", path);
+        return false;
+    }
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || status.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    /** The mapping holds its own reference to the file, so the descriptor is not needed after */
+    void *ptr = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        LOG::WARN("Unable to map {0}", path);
+        return false;
+    }
+    madvise(ptr, size_t(status.st_size), MADV_SEQUENTIAL);
+
+    data = (const uint8_t *)ptr;
+    size = size_t(status.st_size);
+
+    return true;
+}
+
+inline void MappedFile::Close()
+{
+    if (data)
+    {
+        munmap((void *)data, size);
+    }
+    data = nullptr;
+    size = 0;
+}
+#endif
+
+}
+}
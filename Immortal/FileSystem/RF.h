@@ -6,6 +6,7 @@
 #include <map>
 
 #include "Stream.h"
+#include "MappedFile.h"
 
 namespace Immortal
 {
@@ -112,9 +113,14 @@ public:
 
     const std::vector<Chunk> & Parse(const std::vector<uint8_t> &buf)
     {
-        auto start = buf.data();
-        auto ptr   = buf.data();
-        auto end = ptr + buf.size();
+        return Parse(buf.data(), buf.size());
+    }
+
+    const std::vector<Chunk> & Parse(const uint8_t *data, size_t size)
+    {
+        auto start = data;
+        auto ptr   = data;
+        auto end = ptr + size;
 
         while (ptr < end)
         {
@@ -137,18 +143,18 @@ public:
         return chunks;
     }
 
+    /** The chunks point into the file mapped, which lives as long as the RF */
     const std::vector<Chunk> &Read()
     {
-        buffer.resize(stream.Size());
-        stream.Read(buffer.data(), buffer.size());
+        mappedFile.Open(output);
 
-        return Parse(buffer);
+        return Parse(mappedFile.Data(), mappedFile.Size());
     }
 
 private:
     std::string output;
 
-    std::vector<uint8_t> buffer;
+    FileSystem::MappedFile mappedFile;
 
     Stream stream;
 
@@ -2,6 +2,7 @@
 
 #include "Log.h"
 #include "Async.h"
+#include "Instrumentor.h"
 #include "Render/Graphics.h"
 #include "Script/ScriptEngine.h"
 #include "Graphics/AsyncCompute.h"
@@ -94,33 +95,45 @@ Layer *Application::PushOverlay(Layer *overlay)
 
 void Application::OnRender()
 {
+    SL_PROFILE_FUNCTION();
     Time::DeltaTime = timer.tick<Timer::Seconds>();
 
-	Graphics::Execute<AsyncTask>(AsyncTaskType::BeginRecording);
-    for (Layer *layer : layerStack)
     {
-        layer->OnUpdate();
+        SL_PROFILE_SCOPE("Layers");
+	    Graphics::Execute<AsyncTask>(AsyncTaskType::BeginRecording);
+        for (Layer *layer : layerStack)
+        {
+            layer->OnUpdate();
+        }
+	    Graphics::Execute<AsyncTask>(AsyncTaskType::EndRecording);
+	    Graphics::Execute<AsyncTask>(AsyncTaskType::Submiting);
     }
-	Graphics::Execute<AsyncTask>(AsyncTaskType::EndRecording);
-	Graphics::Execute<AsyncTask>(AsyncTaskType::Submiting);
 
     if (!runtime.minimized)
     {
-        gui->Begin();
-        gui->Render();
-        gui->End();
+        {
+            SL_PROFILE_SCOPE("Gui");
+            gui->Begin();
+            gui->Render();
+            gui->End();
+        }
 
-        swapchain->PrepareNextFrame();
-        gpuEvent->Wait(syncValues[syncPoint], 0xffffffffff);
+        {
+            SL_PROFILE_SCOPE("WaitForSwapchain");
+            swapchain->PrepareNextFrame();
+            gpuEvent->Wait(syncValues[syncPoint], 0xffffffffff);
+        }
 	    Graphics::SetRenderIndex(syncValues[syncPoint]);
 
+        SL_PROFILE_SCOPE("Present");
+
         CommandBuffer *commandBuffer = commandBuffers[syncPoint];
 
         const float clearColor[4] = { 0, 0, 0, 0 };
 	    commandBuffer->Begin();
         RenderTarget *renderTarget = swapchain->GetCurrentRenderTarget();
 	    commandBuffer->BeginRenderTarget(renderTarget, clearColor);
-        gui->SubmitRenderDrawCommands(commandBuffer);
+        gui->SubmitRenderDrawCommands(commandBuffer, gpuEvent);
 	    commandBuffer->EndRenderTarget();
 	    commandBuffer->End();
 
@@ -146,6 +159,7 @@ void Application::Run()
     while (runtime.running)
     {
         OnRender();
+        Instrumentor::EndFrame();
     }
 }
 
@@ -1,4 +1,5 @@
 #include "AsyncCompute.h"
+#include "Shared/Instrumentor.h"
 
 namespace Immortal
 {
@@ -9,136 +10,202 @@ AsyncComputeThread::AsyncComputeThread(Device *device) :
 {
     gpuEvent = device->CreateGPUEvent();
     thread = std::move(Thread{[=, this] {
+        Instrumentor::SetThreadName("AsyncComputeThread");
+
         uint64_t recording = 0;
         uint64_t nextSyncValue = 1;
+        bool begun = false;
+        bool terminated = false;
         Queue *queue = nullptr;
         CommandBuffer *commandBuffer = nullptr;
 
-        std::unordered_map<uint64_t, CommandBuffer *> commandBuffers;
+        /** The submitted command buffers in the order of their completion values */
+        std::deque<std::pair<uint64_t, CommandBuffer *>> commandBuffers;
 
-        while (true)
-        {
-            URef<AsyncTask> task;
-            {
-                std::unique_lock lock{mutex};
-                condition.wait(lock, [=, this] {
-                    return !tasks.empty();
-                });
+        /** The recordings pushed after the command buffer ended but before it was submitted, which go into the next one */
+        std::deque<AsyncTask> heldRecordings;
 
-                task = std::move(tasks.front());
-                tasks.pop();
+        auto acquireCommandBuffer = [&] () -> CommandBuffer * {
+            if (!commandBuffers.empty())
+            {
+                auto [value, pCommandBuffer] = commandBuffers.front();
+                if (gpuEvent->GetCompletionValue() >= value || commandBuffers.size() >= MaxCommandBuffersInFlight)
+                {
+                    if (gpuEvent->GetCompletionValue() < value)
+                    {
+                        gpuEvent->Wait(value, 0xffffffff);
+                    }
+                    commandBuffers.pop_front();
+                    return pCommandBuffer;
+                }
             }
 
-            while (!executionCompletedTasks.empty())
+            return device->CreateCommandBuffer();
+        };
+
+        auto beginRecording = [&] {
+            if (begun)
+            {
+                return;
+            }
+            if (!commandBuffer)
             {
-				auto &front = executionCompletedTasks.front();
-				auto &[sync, executionCompleted] = front;
+                commandBuffer = acquireCommandBuffer();
+            }
 
-                if (!IsExecutionCompleted(sync))
+            commandBuffer->Begin();
+            begun = true;
+        };
+
+        auto endRecording = [&] {
+            SLASSERT(commandBuffer && "CommandBuffer isn't begined!");
+            commandBuffer->End();
+            begun = false;
+        };
+
+        auto submit = [&] {
+            if (!recording)
+            {
+                return;
+            }
+            recording = 0;
+            SL_PROFILE_SCOPE("Submit");
+            SLASSERT(commandBuffer && "CommandBuffer is not able to submit!");
+            queue->Submit(commandBuffer, gpuEvent);
+            commandBuffers.emplace_back(gpuEvent->GetSyncPoint(), commandBuffer);
+            nextSyncValue = gpuEvent->GetSyncPoint() + 1;
+            commandBuffer = nullptr;
+
+            if (!heldRecordings.empty())
+            {
+                beginRecording();
+                for (auto &task : heldRecordings)
                 {
-					break;
+                    recording++;
+                    task.Invoke(nextSyncValue, commandBuffer);
                 }
-
-                executionCompleted.InterpretAs<ExecutionCompletedTask>()->Invoke();
-				executionCompletedTasks.pop();
+                heldRecordings.clear();
             }
+        };
 
-            switch (task->GetType())
+        auto process = [&] (AsyncTask &task) {
+            switch (task.GetType())
             {
                 case AsyncTaskType::SetQueue:
                 {
-                    SetQueueTask *setQueueTask = task.InterpretAs<SetQueueTask>();
-                    queue = setQueueTask->GetQueue();
+                    task.Invoke(0, &queue);
                     break;
                 }
 
                 case AsyncTaskType::QueueOperation:
                 {
-                    QueueTask *queueTask = task.InterpretAs<QueueTask>();
-                    queueTask->QueueOperation(queue);
+                    task.Invoke(0, queue);
                     break;
                 }
 
                 case AsyncTaskType::Recording:
                 {
+                    /** The command buffer recorded has ended and waits for its submission, beginning it again would drop what it holds */
+                    if (!begun && recording)
+                    {
+                        heldRecordings.emplace_back(std::move(task));
+                        break;
+                    }
+
+                    /** Consecutive recordings share the command buffer begun, or open one if there is none */
+                    SL_PROFILE_SCOPE("Recording");
+                    beginRecording();
                     recording++;
-                    RecordingTask *recordingTask = task.InterpretAs<RecordingTask>();
-                    recordingTask->Recording(nextSyncValue, commandBuffer);
+                    task.Invoke(nextSyncValue, commandBuffer);
                     break;
                 }
 
                 case AsyncTaskType::BeginRecording:
                 {
-                    if (!commandBuffer)
-                    {
-                        if (!commandBuffers.empty())
-                        {
-                            auto &[value, pCommandBuffer] = *commandBuffers.begin();
-                            if (gpuEvent->GetCompletionValue() >= value)
-                            {
-                                commandBuffer = pCommandBuffer;
-                                commandBuffers.erase(value);
-                            }
-                        }
-
-                        if (!commandBuffer)
-                        {
-                            commandBuffer = device->CreateCommandBuffer();
-                        }
-                    }
-
-                    commandBuffer->Begin();
+                    beginRecording();
                     break;
                 }
 
                 case AsyncTaskType::EndRecording:
                 {
-                    SLASSERT(commandBuffer && "CommandBuffer isn't begined!");
-                    commandBuffer->End();
+                    endRecording();
                     break;
                 }
 
                 case AsyncTaskType::Submiting:
                 {
+                    submit();
+                    break;
+                }
+
+                case AsyncTaskType::Flush:
+                {
+                    /** Submit what has been recorded so far without waiting for the end of the frame */
                     if (!recording)
                     {
                         break;
                     }
-                    recording = 0;
-                    SLASSERT(commandBuffer && "CommandBuffer is not able to submit!");
-                    queue->Submit(commandBuffer, gpuEvent);
-                    commandBuffers[gpuEvent->GetSyncPoint()] = commandBuffer;
-                    nextSyncValue = gpuEvent->GetSyncPoint() + 1;
-                    commandBuffer = nullptr;
+                    if (!begun)
+                    {
+                        /** Ended already, the submission of the frame finds nothing left */
+                        submit();
+                        break;
+                    }
+                    endRecording();
+                    submit();
+                    beginRecording();
                     break;
                 }
 
                 case AsyncTaskType::ExecutionCompleted:
                 {
-					executionCompletedTasks.push(std::pair{nextSyncValue, std::move(task)});
+                    /** After the recordings held, which complete with the command buffer following the one ended */
+                    executionCompletedTasks.emplace(heldRecordings.empty() ? nextSyncValue : nextSyncValue + 1, std::move(task));
                     break;
                 }
 
                 case AsyncTaskType::Terminate:
                 {
-                    if (commandBuffer)
-                    {
-                        delete commandBuffer;
-                    }
-                    for (auto &[value, commandBuffer] : commandBuffers)
-                    {
-                        delete commandBuffer;
-                    }
-                    std::unique_lock lock{ mutex };
-                    tasks = {};
-                    return;
+                    terminated = true;
+                    break;
                 }
 
                 default:
                     break;
             }
-            task.Reset();
+        };
+
+        while (!terminated)
+        {
+            if (!tasks.Pop(process))
+            {
+                tasks.Wait();
+                continue;
+            }
+
+            while (!executionCompletedTasks.empty())
+            {
+                auto &[sync, executionCompleted] = executionCompletedTasks.front();
+                if (!IsExecutionCompleted(sync))
+                {
+                    break;
+                }
+
+                SL_PROFILE_SCOPE("ExecutionCompleted");
+                executionCompleted.Invoke(0, nullptr);
+                executionCompletedTasks.pop();
+            }
+        }
+
+        if (commandBuffer)
+        {
+            delete commandBuffer;
+        }
+        for (auto &[value, commandBuffer] : commandBuffers)
+        {
+            delete commandBuffer;
         }
+        tasks.Clear();
     }});
     thread.SetDescription("AsyncComputeThread");
     thread.Start();
@@ -150,6 +217,20 @@ bool AsyncComputeThread::IsExecutionCompleted(uint64_t value)
     return completion >= value;
 }
 
+bool AsyncComputeThread::Wait(uint64_t value)
+{
+    if (gpuEvent->GetSyncPoint() < value)
+    {
+        return false;
+    }
+    if (!IsExecutionCompleted(value))
+    {
+        gpuEvent->Wait(value, 0xffffffff);
+    }
+
+    return true;
+}
+
 void AsyncComputeThread::WaitIdle()
 {
 	uint64_t completion = gpuEvent->GetCompletionValue();
@@ -4,6 +4,13 @@
 #include "Queue.h"
 #include "LightGraphics.h"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <new>
+#include <thread>
+
 namespace Immortal
 {
 
@@ -15,22 +22,65 @@ enum class AsyncTaskType
     QueueOperation,
     BeginRecording,
     EndRecording,
+    Flush,
     ExecutionCompleted,
     Terminate,
 };
 
+/**
+ * @brief A task record of fixed size with the callback stored inline, so it
+ *  could be placed into the task ring without allocation. A callback larger
+ *  than the inline storage is kept on the heap instead. The derived tasks
+ *  only differ in how they are constructed, they never add any member.
+ */
 class AsyncTask
 {
+public:
+    static constexpr size_t InlineSize = 96;
+
+    using Invoker = void (*)(void *storage, uint64_t sync, void *argument);
+
+    using Destroyer = void (*)(void *storage);
+
+    using Relocator = void (*)(void *dst, void *src);
+
 public:
 	AsyncTask(AsyncTaskType type) :
-        type{ type }
+        type{ type },
+        invoker{},
+        destroyer{},
+        relocator{}
     {
 
     }
 
-    virtual ~AsyncTask()
+    AsyncTask(AsyncTask &&other) noexcept :
+        type{ other.type },
+        invoker{ other.invoker },
+        destroyer{ other.destroyer },
+        relocator{ other.relocator }
     {
+        if (relocator)
+        {
+            relocator(storage, other.storage);
+        }
+        other.invoker   = nullptr;
+        other.destroyer = nullptr;
+        other.relocator = nullptr;
+    }
+
+    AsyncTask(const AsyncTask &other) = delete;
+
+    AsyncTask &operator=(const AsyncTask &other) = delete;
 
+    AsyncTask &operator=(AsyncTask &&other) = delete;
+
+    ~AsyncTask()
+    {
+        if (destroyer)
+        {
+            destroyer(storage);
+        }
     }
 
     void SetType(AsyncTaskType value)
@@ -43,84 +93,98 @@ public:
         return type;
     }
 
+    void Invoke(uint64_t sync, void *argument)
+    {
+        if (invoker)
+        {
+            invoker(storage, sync, argument);
+        }
+    }
+
+protected:
+    /** The invoker receives the callback, the sync value and the argument of the task type */
+    template <class T, class F>
+    void Store(T &&callback, F)
+    {
+        using Callback = std::decay_t<T>;
+        if constexpr (sizeof(Callback) <= InlineSize && alignof(Callback) <= alignof(std::max_align_t))
+        {
+            new (storage) Callback{ std::forward<T>(callback) };
+            invoker = [] (void *storage, uint64_t sync, void *argument) {
+                F{}(*(Callback *)storage, sync, argument);
+            };
+            destroyer = [] (void *storage) {
+                ((Callback *)storage)->~Callback();
+            };
+            relocator = [] (void *dst, void *src) {
+                new (dst) Callback{ std::move(*(Callback *)src) };
+                ((Callback *)src)->~Callback();
+            };
+        }
+        else
+        {
+            *(Callback **)storage = new Callback{ std::forward<T>(callback) };
+            invoker = [] (void *storage, uint64_t sync, void *argument) {
+                F{}(**(Callback **)storage, sync, argument);
+            };
+            destroyer = [] (void *storage) {
+                delete *(Callback **)storage;
+            };
+            relocator = [] (void *dst, void *src) {
+                *(Callback **)dst = *(Callback **)src;
+                *(Callback **)src = nullptr;
+            };
+        }
+    }
+
 protected:
 	AsyncTaskType type;
+
+    Invoker invoker;
+
+    Destroyer destroyer;
+
+    Relocator relocator;
+
+    alignas(std::max_align_t) uint8_t storage[InlineSize];
 };
 
 class SetQueueTask : public AsyncTask
 {
 public:
     SetQueueTask(Queue *queue = nullptr) :
-	    AsyncTask{ AsyncTaskType::SetQueue },
-        queue{queue}
-    {
-
-    }
-
-    virtual ~SetQueueTask() override
+	    AsyncTask{ AsyncTaskType::SetQueue }
     {
-		queue = nullptr;
+        Store([queue] { return queue; }, [] (auto &callback, uint64_t sync, void *argument) {
+            *(Queue **)argument = callback();
+        });
     }
-
-    Queue *GetQueue() const
-    {
-        return queue;
-    }
-
-protected:
-    Queue *queue;
 };
 
 class RecordingTask : public AsyncTask
 {
 public:
     template <class T>
-    RecordingTask(T callback) :
+    RecordingTask(T &&callback) :
 	    AsyncTask{ AsyncTaskType::Recording }
     {
-		callbackWarpper = [=](uint64_t sync, CommandBuffer *commandBuffer) -> void {
-			callback(sync, commandBuffer);
-		};
+        Store(std::forward<T>(callback), [] (auto &callback, uint64_t sync, void *argument) {
+            callback(sync, (CommandBuffer *)argument);
+        });
     }
-
-    virtual ~RecordingTask() override
-    {
-
-    }
-
-    void Recording(uint64_t sync, CommandBuffer *commandBuffer)
-    {
-		callbackWarpper(sync, commandBuffer);
-    }
-
-protected:
-    std::function<void(uint64_t, CommandBuffer *)> callbackWarpper;
 };
 
 class QueueTask : public AsyncTask
 {
 public:
     template <class T>
-	QueueTask(T callback) :
-	    AsyncTask{AsyncTaskType::QueueOperation}
+	QueueTask(T &&callback) :
+	    AsyncTask{ AsyncTaskType::QueueOperation }
 	{
-		callbackWarpper = [=](Queue *queue) -> void {
-			callback(queue);
-		};
+        Store(std::forward<T>(callback), [] (auto &callback, uint64_t sync, void *argument) {
+            callback((Queue *)argument);
+        });
 	}
-
-    virtual ~QueueTask() override
-    {
-
-    }
-
-	void QueueOperation(Queue *queue)
-	{
-		callbackWarpper(queue);
-	}
-
-protected:
-	std::function<void(Queue *)> callbackWarpper;
 };
 
 class ExecutionCompletedTask : public AsyncTask
@@ -130,32 +194,154 @@ public:
     ExecutionCompletedTask(T &&callback) :
         AsyncTask{ AsyncTaskType::ExecutionCompleted }
     {
-        callbackWarpper = [=]() -> void {
+        Store(std::forward<T>(callback), [] (auto &callback, uint64_t sync, void *argument) {
             callback();
-        };
+        });
     }
+};
+
+/**
+ * @brief A bounded multiple producer single consumer ring of the tasks. The
+ *  producers claim a slot with a compare and swap, and publish it with the
+ *  sequence of the slot, so neither side takes a lock. The producers block
+ *  only when the ring is full, and the consumer sleeps on an atomic when
+ *  it is empty.
+ */
+class AsyncTaskQueue
+{
+public:
+    static constexpr size_t Capacity = 1024;
 
-    virtual ~ExecutionCompletedTask() override
+    struct Slot
     {
+        std::atomic<uint64_t> sequence;
 
+        alignas(AsyncTask) uint8_t task[sizeof(AsyncTask)];
+    };
+
+public:
+    AsyncTaskQueue()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~AsyncTaskQueue()
+    {
+        Clear();
     }
 
-    void Invoke()
+    template <class T, class ... Args>
+    void Push(Args &&...args)
     {
-        callbackWarpper();
+        static_assert(std::is_base_of_v<AsyncTask, T> && sizeof(T) == sizeof(AsyncTask), "Tasks should be stored in place of AsyncTask");
+
+        Slot *slot = nullptr;
+        uint64_t position = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot = &slots[position & (Capacity - 1)];
+            int64_t difference = int64_t(slot->sequence.load(std::memory_order_acquire) - position);
+            if (difference == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                std::this_thread::yield();
+                position = head.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (slot->task) T{ std::forward<Args>(args)... };
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed))
+        {
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        }
+    }
+
+    /** Only called by the consumer, the task is processed in place and destroyed after */
+    template <class T>
+    bool Pop(T &&process)
+    {
+        Slot &slot = slots[tail & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+        {
+            return false;
+        }
+
+        AsyncTask *task = std::launder((AsyncTask *)slot.task);
+        process(*task);
+        task->~AsyncTask();
+
+        slot.sequence.store(tail + Capacity, std::memory_order_release);
+        tail++;
+
+        return true;
+    }
+
+    /** Only called by the consumer */
+    void Wait()
+    {
+        uint32_t value = signal.load(std::memory_order_acquire);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (slots[tail & (Capacity - 1)].sequence.load(std::memory_order_acquire) != tail + 1)
+        {
+            signal.wait(value, std::memory_order_acquire);
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    /** Only called by the consumer */
+    void Clear()
+    {
+        while (Pop([] (AsyncTask &) {}))
+        {
+
+        }
     }
 
 protected:
-	std::function<void()> callbackWarpper;
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+
+    alignas(64) uint64_t tail{ 0 };
+
+    alignas(64) std::atomic<uint32_t> signal{ 0 };
+
+    std::atomic<bool> sleeping{ false };
+
+    std::array<Slot, Capacity> slots;
 };
 
 class AsyncComputeThread
 {
+public:
+    /** The command buffers submitted but not completed are bounded, beyond that the thread waits for the oldest */
+    static constexpr size_t MaxCommandBuffersInFlight = 8;
+
 public:
     AsyncComputeThread(Device *device);
 
     bool IsExecutionCompleted(uint64_t value);
 
+    /** Wait for the GPU to pass the value, or return false at once if it is not submitted yet */
+    bool Wait(uint64_t value);
+
     void WaitIdle();
 
     void Join();
@@ -164,22 +350,15 @@ public:
     template <class T, class ... Args>
 	void Execute(Args &&...args)
     {
-		URef<AsyncTask> task = new T{std::forward<Args>(args)...};
-        std::unique_lock lock{ mutex };
-        tasks.push(std::move(task));
-        condition.notify_one();
+        tasks.Push<T>(std::forward<Args>(args)...);
     }
 
 protected:
     Thread thread;
 
-    std::condition_variable condition;
-
-    std::mutex mutex;
-
-    std::queue<URef<AsyncTask>> tasks;
+    AsyncTaskQueue tasks;
 
-    std::queue<std::pair<uint64_t, URef<AsyncTask>>> executionCompletedTasks;
+    std::queue<std::pair<uint64_t, AsyncTask>> executionCompletedTasks;
 
     URef<GPUEvent> gpuEvent;
 };
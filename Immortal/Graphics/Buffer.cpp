@@ -17,6 +17,12 @@ Buffer::Buffer(BufferType type, size_t size) :
 
 }
 
+void Buffer::Flush(size_t size, uint64_t offset)
+{
+    (void)size;
+    (void)offset;
+}
+
 const size_t &Buffer::GetSize() const
 {
 	return _size;
@@ -34,6 +34,9 @@ public:
 
     virtual void Unmap() = 0;
 
+    /** Make the writes to a range of the memory kept mapped visible to the device, only needed when it is not coherent */
+    virtual void Flush(size_t size, uint64_t offset);
+
     const size_t &GetSize() const;
 
 	const Type &GetType() const;
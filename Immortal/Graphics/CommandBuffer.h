@@ -75,6 +75,12 @@ public:
 
 	virtual void CopyBufferToImage(Texture *texture, uint32_t subresource, Buffer *buffer, size_t bufferRowLength, uint32_t offset = 0) = 0;
 
+	/**
+	 * @brief Copy a subresource of the texture into a buffer of BufferType::TransferDestination,
+	 *  whose content can be mapped once the GPU completed this command buffer
+	 */
+	virtual void CopyImageToBuffer(Buffer *buffer, size_t bufferRowLength, Texture *texture, uint32_t subresource, uint32_t offset = 0) = 0;
+
 	virtual void CopyPlatformSpecificSubresource(Texture *dst, uint32_t dstSubresource, void *src, uint32_t srcSubresource) {}
 
 	virtual void MemoryCopy(Buffer *buffer, uint32_t size, const void *data, uint32_t offset) = 0;
@@ -247,6 +247,11 @@ void CommandBuffer::CopyBufferToImage(SuperTexture *_texture, uint32_t subresour
 	});
 }
 
+void CommandBuffer::CopyImageToBuffer(SuperBuffer *_buffer, size_t bufferRowLength, SuperTexture *_texture, uint32_t subresource, uint32_t offset)
+{
+	SLASSERT(false && "D3D11 can only read textures back through staging textures!");
+}
+
 void CommandBuffer::MemoryCopy(SuperBuffer *_buffer, uint32_t size, const void *data, uint32_t offset)
 {
 	Buffer *buffer = InterpretAs<Buffer>(_buffer);
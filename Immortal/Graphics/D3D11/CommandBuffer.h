@@ -60,6 +60,8 @@ public:
 
 	virtual void CopyBufferToImage(SuperTexture *texture, uint32_t subresource, SuperBuffer *buffer, size_t bufferRowLength, uint32_t offset = 0) override;
 
+	virtual void CopyImageToBuffer(SuperBuffer *buffer, size_t bufferRowLength, SuperTexture *texture, uint32_t subresource, uint32_t offset = 0) override;
+
 	virtual void MemoryCopy(SuperBuffer *buffer, uint32_t size, const void *data, uint32_t offset) override;
 
 	virtual void MemoryCopy(SuperTexture *texture, const void *data, uint32_t width, uint32_t height, uint32_t rowPitch) override;
@@ -134,6 +134,7 @@ void GraphicsPipeline::ConstructInputLayout(const InputElementDescription &descr
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementDesc;
 	inputElementDesc.reserve(description.Size());
 
+	bool isInstanced = description.GetInputRate() == InputRate::Instance;
 	for (size_t i = 0; i < description.Size(); i++)
 	{
 		inputElementDesc.emplace_back(D3D11_INPUT_ELEMENT_DESC{
@@ -142,8 +143,8 @@ void GraphicsPipeline::ConstructInputLayout(const InputElementDescription &descr
 			.Format               = description[i].GetFormat(),
 			.InputSlot            = 0,
 		    .AlignedByteOffset    = description[i].GetOffset(),
-			.InputSlotClass       = D3D11_INPUT_PER_VERTEX_DATA,
-			.InstanceDataStepRate = 0,
+			.InputSlotClass       = isInstanced ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA,
+			.InstanceDataStepRate = isInstanced ? 1U : 0U,
 		});
 	}
 	stride = description.GetStride();
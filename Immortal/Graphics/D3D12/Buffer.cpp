@@ -65,6 +65,12 @@ void Buffer::Construct()
         desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
     }
 
+    if (type & Type::TransferDestination)
+    {
+        heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+        state = D3D12_RESOURCE_STATE_COPY_DEST;
+    }
+
     if (type & Type::AccelerationStructure)
     {
         heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
@@ -334,6 +334,56 @@ void CommandBuffer::CopyBufferToImage(SuperTexture *_texture, uint32_t subresour
 	texture->SetState(D3D12_RESOURCE_STATE_COMMON);
 }
 
+void CommandBuffer::CopyImageToBuffer(SuperBuffer *_buffer, size_t bufferRowLength, SuperTexture *_texture, uint32_t subresource, uint32_t offset)
+{
+	Texture *texture = InterpretAs<Texture>(_texture);
+	Buffer *buffer   = InterpretAs<Buffer>(_buffer);
+
+	uint32_t mipLevel = subresource % texture->GetMipLevels();
+	D3D12_TEXTURE_COPY_LOCATION dstLocation = {
+		.pResource = *buffer,
+		.Type      = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+		.PlacedFootprint = {
+	        .Offset = offset,
+			.Footprint = {
+	            .Format   = texture->GetFormat(),
+	            .Width    = std::max(texture->GetWidth()  >> mipLevel, 1U),
+	            .Height   = std::max(texture->GetHeight() >> mipLevel, 1U),
+	            .Depth    = 1,
+	            .RowPitch = (UINT)bufferRowLength
+			}
+		}
+	};
+
+	D3D12_TEXTURE_COPY_LOCATION srcLocation = {
+		.pResource        = *texture,
+		.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+	    .SubresourceIndex = subresource
+	};
+
+	auto state = texture->GetState();
+
+	Barrier<BarrierType::Transition> barrier{
+        *texture,
+        state,
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+        subresource,
+    };
+
+	if (!(state & D3D12_RESOURCE_STATE_COPY_SOURCE))
+	{
+		commandList.ResourceBarrier(&barrier, 1);
+	}
+
+	commandList.CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+
+	if (!(state & D3D12_RESOURCE_STATE_COPY_SOURCE))
+	{
+		barrier.Swap();
+		commandList.ResourceBarrier(&barrier, 1);
+	}
+}
+
 void CommandBuffer::CopyPlatformSpecificSubresource(SuperTexture *dst, uint32_t dstSubresource, void *src, uint32_t srcSubresource)
 {
 	Texture *texture = InterpretAs<Texture>(dst);
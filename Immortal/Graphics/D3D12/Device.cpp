@@ -12,9 +12,8 @@
 #include "Shader.h"
 #include "Pipeline.h"
 #include "Instance.h"
-#include <filesystem>
+#include "FileSystem/FileSystem.h"
 #include <dxgidebug.h>
-#include <fstream>
 
 namespace Immortal
 {
@@ -248,19 +247,12 @@ Pipeline *Device::GetPipeline(const std::string &name)
 
 	const auto &[shaderName, pipelineCreateInfo] = *pipelineCreateInfoIt;
 
-	std::ifstream stream;
-	stream.open(pipelineCreateInfo.path, std::ios::binary);
-	if (!stream.is_open())
+	std::string shaderSource = FileSystem::ReadString(pipelineCreateInfo.path);
+	if (shaderSource.empty())
 	{
 		return nullptr;
 	}
 
-	size_t size = std::filesystem::file_size(pipelineCreateInfo.path);
-	std::string shaderSource;
-	shaderSource.resize(size);
-
-	stream.read(shaderSource.data(), size);
-
 	Shader shader{ shaderName, pipelineCreateInfo.stage, shaderSource, pipelineCreateInfo.enryPoint };
 	URef<Pipeline> pipeline = new ComputePipeline{ this, &shader };
 
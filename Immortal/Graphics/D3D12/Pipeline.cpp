@@ -192,6 +192,7 @@ void GraphicsPipeline::Construct(SuperShader **ppShader, size_t shaderCount, con
 void GraphicsPipeline::SetInputElementDescription(std::vector<D3D12_INPUT_ELEMENT_DESC> &inputElementDescriptions, const InputElementDescription &description)
 {
     inputElementDescriptions.resize(description.Size());
+    bool isInstanced = description.GetInputRate() == InputRate::Instance;
     for (size_t i = 0; i < description.Size(); i++)
     {
         inputElementDescriptions[i].SemanticName         = description[i].GetSemanticsName().c_str();
@@ -199,8 +200,8 @@ void GraphicsPipeline::SetInputElementDescription(std::vector<D3D12_INPUT_ELEMEN
         inputElementDescriptions[i].Format               = description[i].GetFormat();
         inputElementDescriptions[i].InputSlot            = 0;
         inputElementDescriptions[i].AlignedByteOffset    = description[i].GetOffset();
-        inputElementDescriptions[i].InputSlotClass       = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
-        inputElementDescriptions[i].InstanceDataStepRate = 0;
+        inputElementDescriptions[i].InputSlotClass       = isInstanced ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+        inputElementDescriptions[i].InstanceDataStepRate = isInstanced ? 1 : 0;
     }
     vertexEntryStride = description.GetStride();
 }
@@ -7,6 +7,12 @@
 namespace Immortal
 {
 
+enum class InputRate
+{
+    Vertex,
+    Instance
+};
+
 struct InputElement
 {
     InputElement()
@@ -109,6 +115,7 @@ struct InputElementDescription
 
     InputElementDescription(const InputElementDescription &other) :
         stride{ other.stride },
+        inputRate{ other.inputRate },
         elements{ other.elements.begin(), other.elements.end() }
     {
 
@@ -116,6 +123,7 @@ struct InputElementDescription
 
     InputElementDescription(InputElementDescription &&other) :
         stride{ other.stride },
+        inputRate{ other.inputRate },
         elements{ std::move(other.elements) }
     {
 
@@ -123,7 +131,8 @@ struct InputElementDescription
 
     InputElementDescription &operator=(const InputElementDescription &other)
     {
-        stride = other.stride;
+        stride    = other.stride;
+        inputRate = other.inputRate;
         elements.resize(other.elements.size());
         std::copy(other.elements.begin(), other.elements.end(), elements.begin());
         return *this;
@@ -131,7 +140,8 @@ struct InputElementDescription
 
     InputElementDescription operator=(InputElementDescription &&other)
     {
-		stride = other.stride;
+		stride    = other.stride;
+        inputRate = other.inputRate;
         elements.swap(other.elements);
         return *this;
     }
@@ -148,6 +158,13 @@ struct InputElementDescription
         Setup();
     }
 
+    InputElementDescription(InputRate inputRate, std::initializer_list<InputElement> &&list) :
+        elements{ std::move(list) },
+        inputRate{ inputRate }
+    {
+        Setup();
+    }
+
     auto begin()
     {
         return elements.begin();
@@ -193,6 +210,17 @@ struct InputElementDescription
 		stride = value;
     }
 
+    /** Whether the elements advance per vertex or per instance */
+    InputRate GetInputRate() const
+    {
+        return inputRate;
+    }
+
+    void SetInputRate(InputRate value)
+    {
+        inputRate = value;
+    }
+
 protected:
     void Setup()
     {
@@ -209,6 +237,8 @@ protected:
 
 protected:
     uint32_t stride{ 0 };
+
+    InputRate inputRate{ InputRate::Vertex };
 };
 
 }
@@ -69,7 +69,7 @@ Instance *Instance::CreateInstance(BackendAPI apiType, Window::Type windowType)
                 break;
 
             case Window::Type::Headless:
-				instanceExtensions.insert({ "VK_EXT_headless_surface", false });
+				instanceExtensions.insert({ "VK_EXT_headless_surface", true });
                 break;
 
 #if defined(__APPLE__)
@@ -90,7 +90,7 @@ Instance *Instance::CreateInstance(BackendAPI apiType, Window::Type windowType)
 #	endif
 			};
 
-			return new Vulkan::Instance{ "ImmortalGraphics", instanceExtensions, validationLayers };
+			return new Vulkan::Instance{ "ImmortalGraphics", instanceExtensions, validationLayers, windowType == Window::Type::Headless };
         }
 #endif
 #ifdef IMMORTAL_ENABLE_OPENGL
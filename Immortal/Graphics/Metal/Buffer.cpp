@@ -58,5 +58,10 @@ void Buffer::Unmap()
     handle->didModifyRange(NS::Range{ 0, mappedSize });
 }
 
+void Buffer::Flush(size_t size, uint64_t offset)
+{
+    handle->didModifyRange(NS::Range{ offset, size });
+}
+
 }
 }
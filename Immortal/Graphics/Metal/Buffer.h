@@ -30,6 +30,8 @@ public:
 
 	virtual void Unmap() override;
 
+    virtual void Flush(size_t size, uint64_t offset) override;
+
 public:
     void Swap(Buffer &other)
     {
@@ -283,6 +283,18 @@ void CommandBuffer::CopyBufferToImage(SuperTexture *_texture, uint32_t subresour
     blitCommandEncoder->copyFromBuffer(*buffer, offset, bufferRowLength, 0, size, *texture, 0, subresource, origin);
 }
 
+void CommandBuffer::CopyImageToBuffer(SuperBuffer *_buffer, size_t bufferRowLength, SuperTexture *_texture, uint32_t subresource, uint32_t offset)
+{
+	RetriveCommandEncoder<MTL::BlitCommandEncoder>();
+	Texture *texture = InterpretAs<Texture>(_texture);
+	Buffer  *buffer  = InterpretAs<Buffer>(_buffer);
+
+	uint32_t mipLevel = subresource % texture->GetMipLevels();
+	MTL::Size   size   = { std::max(texture->GetWidth() >> mipLevel, 1U), std::max(texture->GetHeight() >> mipLevel, 1U), 1 };
+	MTL::Origin origin = { 0, 0, 0 };
+	blitCommandEncoder->copyFromTexture(*texture, subresource / texture->GetMipLevels(), mipLevel, origin, size, *buffer, offset, bufferRowLength, 0);
+}
+
 void CommandBuffer::CopyPlatformSpecificSubresource(SuperTexture *dst, uint32_t dstSubresource, void *src, uint32_t srcSubresource)
 {
 
@@ -65,6 +65,8 @@ public:
 
 	virtual void CopyBufferToImage(SuperTexture *texture, uint32_t subresource, SuperBuffer *buffer, size_t bufferRowLength, uint32_t offset = 0) override;
 
+	virtual void CopyImageToBuffer(SuperBuffer *buffer, size_t bufferRowLength, SuperTexture *texture, uint32_t subresource, uint32_t offset = 0) override;
+
 	virtual void CopyPlatformSpecificSubresource(SuperTexture *dst, uint32_t dstSubresource, void *src, uint32_t srcSubresource) override;
 
 	virtual void MemoryCopy(SuperBuffer *_buffer, uint32_t size, const void *data, uint32_t offset) override;
@@ -9,7 +9,8 @@ namespace OpenGL
 
 static Buffer::BindPointType SelectBindPoint(BufferType type)
 {
-	switch (type)
+    /** The placement hint doesn't affect the binding */
+	switch (BufferType(int(type) & ~int(BufferType::Static)))
 	{
 		case BufferType::Index:
 			return GL_ELEMENT_ARRAY_BUFFER;
@@ -42,7 +43,7 @@ Buffer::Buffer(uint64_t size, Type type) :
 
     glCreateBuffers(1, &handle);
     glBindBuffer(bindPoint, handle);
-    glBufferData(bindPoint, size, nullptr, GL_STREAM_DRAW);
+    glBufferData(bindPoint, size, nullptr, (type & BufferType::Static) ? GL_STATIC_DRAW : GL_STREAM_DRAW);
     glBindBuffer(bindPoint, 0);
 }
 
@@ -184,6 +184,58 @@ void CommandBuffer::CopyBufferToImage(SuperTexture *_texture, uint32_t subresour
 	});
 }
 
+/** The size of a pixel read back follows the client type, which is wider than the internal format of the half floats */
+static uint32_t GetPackedTexelSize(GL_FORMAT baseFormat, GL_FORMAT binaryType)
+{
+	uint32_t components = 4;
+	switch (baseFormat)
+	{
+		case GL_FORMAT_RED:
+		case GL_FORMAT_RED_INTEGER:
+			components = 1;
+			break;
+
+		case GL_FORMAT_RG:
+			components = 2;
+			break;
+
+		case GL_FORMAT_RGB:
+			components = 3;
+			break;
+
+		default:
+			break;
+	}
+
+	switch (binaryType)
+	{
+		case GL_FORMAT_UNSIGNED_BYTE:
+			return components;
+
+		case GL_FORMAT_UNSIGNED_SHORT:
+			return components * 2;
+
+		default:
+			return components * 4;
+	}
+}
+
+void CommandBuffer::CopyImageToBuffer(SuperBuffer *_buffer, size_t bufferRowLength, SuperTexture *_texture, uint32_t subresource, uint32_t offset)
+{
+	Buffer  *buffer  = InterpretAs<Buffer>(_buffer);
+	Texture *texture = InterpretAs<Texture>(_texture);
+	Submit([=] {
+		/** The transfer buffers live in the system memory, so the copy is done by the time the submission returns */
+		uint32_t width  = std::max(texture->GetWidth()  >> subresource, 1U);
+		uint32_t height = std::max(texture->GetHeight() >> subresource, 1U);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_PACK_ROW_LENGTH, GLint(bufferRowLength / GetPackedTexelSize(texture->GetBaseFormat(), texture->GetBinaryFormat())));
+		glGetTextureSubImage(*texture, GLint(subresource), 0, 0, 0, width, height, 1, texture->GetBaseFormat(), texture->GetBinaryFormat(), GLsizei(buffer->GetSize() - offset), (uint8_t *)buffer->GetMemory() + offset);
+		glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	});
+}
+
 void CommandBuffer::MemoryCopy(SuperBuffer *_buffer, uint32_t size, const void *data, uint32_t offset)
 {
 	Buffer *buffer = InterpretAs<Buffer>(_buffer);
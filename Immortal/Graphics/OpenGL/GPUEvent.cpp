@@ -18,7 +18,7 @@ GPUEvent::~GPUEvent()
 
 void GPUEvent::Signal(uint64_t value)
 {
-
+	this->value = value;
 }
 
 void GPUEvent::Wait(uint64_t value, uint64_t timeout)
@@ -31,9 +31,10 @@ void GPUEvent::Wait(uint64_t timeout)
 
 }
 
+/** The commands are executed on the submitting thread, so the last value signaled is completed */
 uint64_t GPUEvent::GetCompletionValue()
 {
-	return 0;
+	return value;
 }
 
 uint64_t GPUEvent::GetSyncPoint()
@@ -27,7 +27,7 @@ void Queue::Wait(SuperGPUEvent *pEvent)
 
 void Queue::Signal(SuperGPUEvent *pEvent)
 {
-
+	pEvent->Signal(pEvent->GetSyncPoint() + 1);
 }
 
 void Queue::Submit(SuperCommandBuffer **_ppCommandBuffer, size_t count, SuperGPUEvent **_ppSignalEvents, uint32_t eventCount, SuperSwapchain * /*swapchain*/)
@@ -41,7 +41,7 @@ void Queue::Submit(SuperCommandBuffer **_ppCommandBuffer, size_t count, SuperGPU
     GPUEvent **ppSignalEvents = (GPUEvent **)_ppSignalEvents;
     for (uint32_t i = 0; i < eventCount; i++)
     {
-		ppSignalEvents[i]->Signal(1);
+		ppSignalEvents[i]->Signal(ppSignalEvents[i]->GetSyncPoint() + 1);
     }
 }
 
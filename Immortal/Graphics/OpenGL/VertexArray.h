@@ -107,6 +107,10 @@ public:
                     inputElementDescription.GetStride(),
                     (const void *)((intptr_t)inputElement.GetOffset()));
             }
+            if (inputElementDescription.GetInputRate() == InputRate::Instance)
+            {
+                glVertexAttribDivisor(attributeIndex, 1);
+            }
             glEnableVertexAttribArray(attributeIndex++);
         }
 		vertexBuffer->Unbind();
@@ -7,6 +7,8 @@ namespace Immortal
 
 static constexpr uint32_t TextureAlignment = 256;
 
+static constexpr uint32_t TexturePlacementAlignment = 512;
+
 enum class BackendAPI
 {
     None,
@@ -77,6 +79,7 @@ enum class BufferType
     ASVertex                      = AccelerationStructureSource | Vertex,
     ASIndex                       = AccelerationStructureSource | Index,
     Instance                      = BIT(11),
+    Static                        = BIT(12),
 };
 SL_ENABLE_BITWISE_OPERATOR(BufferType)
 
@@ -1,5 +1,6 @@
 #include "Buffer.h"
 #include "Device.h"
+#include "TransferQueue.h"
 
 namespace Immortal
 {
@@ -53,7 +54,8 @@ Buffer::Buffer(Device *device) :
     descriptor{},
     usage{},
     mappedData{},
-    persistent{}
+    persistent{},
+    deviceLocal{}
 {
 
 }
@@ -65,7 +67,8 @@ Buffer::Buffer(Device *device, Type type, size_t size, const void *data) :
     descriptor{},
     usage{},
     mappedData{},
-    persistent{ false }
+    persistent{ false },
+    deviceLocal{ false }
 {
     ASSERT_ZERO_SIZE_BUFFER(size);
 
@@ -83,22 +86,7 @@ Buffer::~Buffer()
 {
     if (descriptor.buffer != VK_NULL_HANDLE && memory != VK_NULL_HANDLE)
     {
-        struct {
-            Device *device = nullptr;
-            VmaAllocation memory = nullptr;
-            VkBuffer buffer = VK_NULL_HANDLE;
-        } dpack{
-            device,
-            memory,
-            handle
-        };
-
-        device->DestroyAsync([dpack]() {
-            dpack.device->Destroy(
-                dpack.buffer,
-                dpack.memory
-                );
-            });
+        device->DestroyAsync(handle, memory);
 
         handle = VK_NULL_HANDLE;
 		memory = VK_NULL_HANDLE;
@@ -126,8 +114,49 @@ void Buffer::Construct()
 
     VmaAllocationInfo allocInfo{};
     VmaAllocationCreateInfo allocCreateInfo{};
-    allocCreateInfo.usage          = VMA_MEMORY_USAGE_CPU_ONLY;
-    allocCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    /** The static buffers are written once through the transfer queue and
+     *  then only read by the GPU, so they live in the device local memory.
+     *  Being used by the transfer queue and the rendering concurrently saves
+     *  the ownership transfer when the families are different.
+     */
+    TransferQueue *transferQueue = (GetType() & Type::Static) && !persistent ? device->GetTransferQueue() : nullptr;
+    uint32_t queueFamilyIndices[2] = {};
+    if (transferQueue)
+    {
+        deviceLocal = true;
+        createInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        queueFamilyIndices[0] = device->GetQueueFailyIndex(VK_QUEUE_GRAPHICS_BIT);
+        queueFamilyIndices[1] = transferQueue->GetFamilyIndex();
+        if (queueFamilyIndices[0] != queueFamilyIndices[1])
+        {
+            createInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = SL_ARRAY_LENGTH(queueFamilyIndices);
+            createInfo.pQueueFamilyIndices   = queueFamilyIndices;
+        }
+
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    }
+    else if (GetType() & (Type::Vertex | Type::Index | Type::ConstantBuffer))
+    {
+        /** Dynamic data written by the CPU every frame, preferably into the device local memory visible to the host */
+        allocCreateInfo.usage          = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocCreateInfo.requiredFlags  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+    else if (GetType() == Type::TransferDestination)
+    {
+        /** Read back by the CPU, which reads the cached memory many times faster */
+        allocCreateInfo.usage          = VMA_MEMORY_USAGE_GPU_TO_CPU;
+        allocCreateInfo.requiredFlags  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        allocCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
+    else
+    {
+        allocCreateInfo.usage          = VMA_MEMORY_USAGE_CPU_ONLY;
+        allocCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+
     if (persistent)
     {
         allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
@@ -144,16 +173,24 @@ void Buffer::Construct()
 
 void Buffer::Map(void **ppData, size_t size, uint64_t offset)
 {
-	if (!mappedData && !persistent)
-	{
-		vmaMapMemory(device->MemoryAllocator(), memory, (void **) &mappedData);
-	}
+    Map();
 	*ppData = (uint8_t *)mappedData + offset;
 }
 
 void Buffer::Map()
 {
-    if (!mappedData && !persistent)
+    if (mappedData || persistent)
+    {
+        return;
+    }
+
+    if (deviceLocal)
+    {
+        /** The writes go to a staging buffer, which is uploaded on unmapping */
+        staging = new Buffer{ device, Type::TransferSource, GetSize() };
+        staging->Map(&mappedData);
+    }
+    else
     {
         device->MapMemory(memory, (void **)&mappedData);
     }
@@ -161,16 +198,38 @@ void Buffer::Map()
 
 void Buffer::Unmap()
 {
-    if (mappedData && !persistent)
+    if (!mappedData || persistent)
+    {
+        return;
+    }
+
+    if (deviceLocal)
+    {
+        staging->Unmap();
+        device->GetTransferQueue()->Upload(this, staging, GetSize());
+        staging.Reset();
+    }
+    else
     {
 		device->UnmapMemory(memory);
-        mappedData = nullptr;
     }
+    mappedData = nullptr;
 }
 
 void Buffer::Flush()
 {
-    vmaFlushAllocation(device->MemoryAllocator(), memory, 0, GetSize());
+    if (!deviceLocal)
+    {
+        vmaFlushAllocation(device->MemoryAllocator(), memory, 0, GetSize());
+    }
+}
+
+void Buffer::Flush(size_t size, uint64_t offset)
+{
+    if (!deviceLocal)
+    {
+        vmaFlushAllocation(device->MemoryAllocator(), memory, offset, size);
+    }
 }
 
 VkDeviceAddress Buffer::GetDeviceAddress() const
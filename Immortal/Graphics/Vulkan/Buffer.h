@@ -31,6 +31,8 @@ public:
 
     virtual void Unmap() override;
 
+    virtual void Flush(size_t size, uint64_t offset) override;
+
 public:
     VkDeviceAddress GetDeviceAddress() const;
 
@@ -90,6 +92,13 @@ public:
 		std::swap(descriptor, other.descriptor);
 		std::swap(mappedData, other.mappedData);
 		std::swap(persistent, other.persistent);
+		std::swap(deviceLocal, other.deviceLocal);
+		staging.Swap(other.staging);
+    }
+
+    bool IsDeviceLocal() const
+    {
+        return deviceLocal;
     }
 
 private:
@@ -104,6 +113,11 @@ private:
     uint8_t *mappedData;
 
     bool persistent;
+
+    bool deviceLocal;
+
+    /** Where the device local buffer is written to while it is mapped */
+    URef<Buffer> staging;
 };
 
 }
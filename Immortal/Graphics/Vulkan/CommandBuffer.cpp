@@ -24,6 +24,8 @@ CommandBuffer::CommandBuffer(CommandPool *commandPool, VkCommandBufferLevel leve
 
 CommandBuffer::~CommandBuffer()
 {
+    ReleaseTimestampPool();
+    CloseRecording();
 	Destroy(commandPool);
 }
 
@@ -55,11 +57,33 @@ VkResult CommandBuffer::Begin(VkCommandBufferUsageFlags flags, CommandBuffer *pr
     beginInfo.flags            = flags;
     beginInfo.pInheritanceInfo = pInheritanceInfo;
 
-    return vkBeginCommandBuffer(handle, &beginInfo);
+    VkResult result = vkBeginCommandBuffer(handle, &beginInfo);
+    if (result == VK_SUCCESS && level == VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+    {
+        /** Begun again without being submitted, the objects released meanwhile are not used anymore, nor are the queries */
+        CloseRecording();
+        ReleaseTimestampPool();
+        ticket = commandPool->GetAddress<Device>()->OpenRecording();
+    }
+
+    if (result == VK_SUCCESS && level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && Instrumentor::IsEnabled())
+    {
+        if (auto *timestampQueryPool = commandPool->GetAddress<Device>()->GetTimestampQueryPool())
+        {
+            timestampPool = timestampQueryPool->Acquire(this, commandPool->GetQueueFamilyIndex());
+        }
+    }
+
+    return result;
 }
 
 void CommandBuffer::End()
 {
+    if (timestampPool)
+    {
+        commandPool->GetAddress<Device>()->GetTimestampQueryPool()->End(this, timestampPool);
+    }
+
     state = State::Executable;
     Check(EndCommandBuffer());;
 }
@@ -71,6 +95,8 @@ bool CommandBuffer::IsActive()
 
 void CommandBuffer::Reset()
 {
+    ReleaseTimestampPool();
+    CloseRecording();
 	count = 0;
 	state = State::Initial;
 
@@ -90,12 +116,64 @@ void CommandBuffer::Close()
 
 void CommandBuffer::BeginEvent(const char *pData, size_t size)
 {
+    std::string_view name{ pData, size };
+    if (vkCmdBeginDebugUtilsLabelEXT)
+    {
+        std::string label{ name };
+        VkDebugUtilsLabelEXT labelInfo{
+            .sType      = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+            .pNext      = nullptr,
+            .pLabelName = label.c_str(),
+            .color      = {},
+        };
+        BeginDebugUtilsLabelEXT(&labelInfo);
+    }
 
+    if (timestampPool)
+    {
+        commandPool->GetAddress<Device>()->GetTimestampQueryPool()->BeginEvent(this, timestampPool, name);
+    }
 }
 
 void CommandBuffer::EndEvent()
 {
+    if (timestampPool)
+    {
+        commandPool->GetAddress<Device>()->GetTimestampQueryPool()->EndEvent(this, timestampPool);
+    }
+
+    if (vkCmdEndDebugUtilsLabelEXT)
+    {
+        EndDebugUtilsLabelEXT();
+    }
+}
+
+void CommandBuffer::ReleaseTimestampPool()
+{
+    if (timestampPool)
+    {
+        commandPool->GetAddress<Device>()->GetTimestampQueryPool()->Release(timestampPool);
+        timestampPool = nullptr;
+    }
+}
+
+void CommandBuffer::OnSubmit()
+{
+    if (timestampPool)
+    {
+        commandPool->GetAddress<Device>()->GetTimestampQueryPool()->Submit(timestampPool);
+        timestampPool = nullptr;
+    }
+    CloseRecording();
+}
 
+void CommandBuffer::CloseRecording()
+{
+    if (ticket)
+    {
+        commandPool->GetAddress<Device>()->CloseRecording(ticket);
+        ticket = 0;
+    }
 }
 
 void CommandBuffer::SetPipeline(SuperPipeline *_pipeline)
@@ -108,7 +186,7 @@ void CommandBuffer::SetDescriptorSet(SuperDescriptorSet *_descriptorSet)
 {
 	DescriptorSet *descriptorSet = InterpretAs<DescriptorSet>(_descriptorSet);
 
-    VkDescriptorSet descriptorSets[] = { *descriptorSet };
+    VkDescriptorSet descriptorSets[] = { descriptorSet->Resolve() };
 	BindDescriptorSets(pipeline->GetBindPoint(), pipeline->GetPipelineLayout(), 0, 1, descriptorSets, 0, nullptr);
 }
 
@@ -271,6 +349,16 @@ void CommandBuffer::BeginRenderTarget(SuperRenderTarget *_renderTarget, const fl
         {
 			dynamicRenderingBarriers[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         }
+        else
+        {
+            /** Offscreen targets are sampled or read back afterwards, which needs a layout keeping their content */
+            for (size_t i = 0; i < colorAttachments.size(); i++)
+            {
+                dynamicRenderingBarriers[i].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                dynamicRenderingBarriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+                InterpretAs<Texture>(renderTarget->GetColorAttachment(uint32_t(i)))->SetLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+        }
 
 	    VkRenderingInfo renderingInfo = {
             .sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
@@ -331,9 +419,16 @@ void CommandBuffer::EndRenderTarget()
 	if (true /*dynamic rendering*/)
     {
 		vkCmdEndRenderingKHR(handle);
+
+        /** Presenting waits on a semaphore, while the offscreen targets are consumed by the later commands */
+        VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        if (!dynamicRenderingBarriers.empty() && dynamicRenderingBarriers[0].newLayout != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+        {
+			dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
         PipelineImageBarrier(
 		    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		    dstStageMask,
 		    dynamicRenderingBarriers.data(),
 		    uint32_t(dynamicRenderingBarriers.size())
         );
@@ -551,6 +646,85 @@ void CommandBuffer::CopyBufferToImage(SuperTexture *_texture, uint32_t subresour
         );
 }
 
+void CommandBuffer::CopyImageToBuffer(SuperBuffer *_buffer, size_t bufferRowLength, SuperTexture *_texture, uint32_t subresource, uint32_t offset)
+{
+	Texture *texture = InterpretAs<Texture>(_texture);
+	Buffer  *buffer  = InterpretAs<Buffer>(_buffer);
+
+	uint32_t mipLevels  = texture->GetMipLevels();
+	uint32_t mipLevel   = subresource % mipLevels;
+	uint32_t arrayLayer = subresource / mipLevels;
+
+	Format format = texture->GetFormat();
+	auto &[width, height, depth] = texture->GetExtent();
+	VkBufferImageCopy region{
+	    .bufferOffset      = offset,
+	    .bufferRowLength   = uint32_t(bufferRowLength / format.GetTexelSize()),
+	    .bufferImageHeight = 0,
+	    .imageSubresource  = {
+	        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+	        .mipLevel       = mipLevel,
+	        .baseArrayLayer = arrayLayer,
+	        .layerCount     = 1,
+	    },
+	    .imageOffset       = { 0, 0, 0 },
+	    .imageExtent       = { std::max(width >> mipLevel, 1U), std::max(height >> mipLevel, 1U), 1 }
+	};
+
+	VkImageSubresourceRange subresourceRange{
+	    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+	    .baseMipLevel   = mipLevel,
+	    .levelCount     = 1,
+	    .baseArrayLayer = arrayLayer,
+	    .layerCount     = 1,
+	};
+
+	/** The texture was written last by either rendering or a transfer */
+	ImageBarrier barrier{
+	    *texture,
+	    subresourceRange,
+	    texture->GetLayout(),
+	    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+	    VK_ACCESS_TRANSFER_READ_BIT
+	};
+
+	PipelineImageBarrier(
+	    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	    VK_PIPELINE_STAGE_TRANSFER_BIT,
+	    &barrier
+	    );
+
+	CopyImageToBuffer(
+	    *texture,
+	    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	    *buffer,
+	    1,
+	    &region
+	    );
+
+	/** The subresource goes back to the layout tracked for the whole texture, unless that is undefined */
+	if (texture->GetLayout() != VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+	    barrier.Swap();
+	    barrier.To(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	    PipelineImageBarrier(
+	        VK_PIPELINE_STAGE_TRANSFER_BIT,
+	        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+	        &barrier
+	        );
+	}
+
+	/** Waiting for the sync point on the host doesn't make the copy visible to the host by itself */
+	VkMemoryBarrier memoryBarrier{
+	    .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+	    .pNext         = nullptr,
+	    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+	    .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+	};
+	PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
 void CommandBuffer::MemoryCopy(SuperBuffer *_buffer, uint32_t size, const void *data, uint32_t offset)
 {
 	SLASSERT(false && "Don't call this function for Vulkan backend!");
@@ -5,6 +5,7 @@
 #include "Buffer.h"
 #include "Shader.h"
 #include "Barrier.h"
+#include "TimestampQueryPool.h"
 #include "Shared/IObject.h"
 #include "Graphics/LightGraphics.h"
 #include "Algorithm/LightArray.h"
@@ -1207,6 +1208,8 @@ public:
 
 	virtual void CopyBufferToImage(SuperTexture *texture, uint32_t subresource, SuperBuffer *buffer, size_t bufferRowLength, uint32_t offset = 0) override;
 
+	virtual void CopyImageToBuffer(SuperBuffer *buffer, size_t bufferRowLength, SuperTexture *texture, uint32_t subresource, uint32_t offset = 0) override;
+
     virtual void MemoryCopy(SuperBuffer *buffer, uint32_t size, const void *data, uint32_t offset) override;
 
     virtual void MemoryCopy(SuperTexture *texture, const void *data, uint32_t width, uint32_t height, uint32_t rowPitch) override;
@@ -1226,6 +1229,15 @@ public:
 public:
     void Destroy(CommandPool *commandPool);
 
+    /** Give the queries back if the recording is dropped before it is submitted */
+    void ReleaseTimestampPool();
+
+    /** Called by the queue under its lock, once the sync point of the submission is reserved */
+    void OnSubmit();
+
+    /** The objects released while recording are kept until the ticket is closed */
+    void CloseRecording();
+
     VkResult Begin(VkCommandBufferUsageFlags flags, CommandBuffer *primaryCommandBuffer = nullptr, const VkCommandBufferInheritanceInfo *pInheritanceInfo = nullptr);
 
     void SetState(State _state)
@@ -1318,6 +1330,8 @@ protected:
         std::swap(count, other.count);
         std::swap(state, other.state);
         std::swap(level, other.level);
+        std::swap(timestampPool, other.timestampPool);
+        std::swap(ticket,        other.ticket       );
     }
 
 protected:
@@ -1332,6 +1346,12 @@ protected:
     Pipeline *pipeline;
 
     LightArray<ImageBarrier> dynamicRenderingBarriers;
+
+    /** The queries of the recording, null if not timed */
+    TimestampQueryPool::Pool *timestampPool = nullptr;
+
+    /** The recording ticket taken from the device, 0 if not recording */
+    uint64_t ticket = 0;
 };
 
 }
@@ -10,8 +10,9 @@ namespace Vulkan
 CommandPool::CommandPool(Device *device, uint32_t threadId, uint32_t queueFamilyIndex, VkCommandPoolResetFlags flags) :
     Handle{},
     device{ device },
+    flags{ flags },
     threadId{ threadId },
-    flags{ flags }
+    queueFamilyIndex{ queueFamilyIndex }
 {
     VkCommandPoolCreateInfo createInfo = {
         .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
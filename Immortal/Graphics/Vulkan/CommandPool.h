@@ -40,6 +40,11 @@ public:
         }
     }
 
+    uint32_t GetQueueFamilyIndex() const
+    {
+        return queueFamilyIndex;
+    }
+
     void Swap(CommandPool &other)
     {
         Handle::Swap((Handle &) other);
@@ -6,17 +6,21 @@ namespace Immortal
 namespace Vulkan
 {
 
-DescriptorPool::DescriptorPool(Device *device, const DescriptorSetLayout &layout, uint32_t poolSize) :
-    device{ device }
+static inline bool IsRetired(Device *device, uint64_t syncPoint)
 {
+    return syncPoint <= device->GetLastRetiredSyncPoint() || syncPoint <= device->GetRetiredSyncPoint();
+}
 
+static inline bool IsExhausted(VkResult result)
+{
+    return result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
 }
 
 DescriptorPool::DescriptorPool(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize) :
     device{ device },
     poolSize{ poolSize }
 {
-    handles.push_back(Create());
+    handles.push_back(Create(device, poolSize));
 }
 
 DescriptorPool::~DescriptorPool()
@@ -26,99 +30,281 @@ DescriptorPool::~DescriptorPool()
 
 void DescriptorPool::Destroy()
 {
+    std::lock_guard lock{ mutex };
     for (auto &handle : handles)
     {
         device->DestroyAsync(handle);
     }
     handles.clear();
+    freeLists.clear();
+    owners.clear();
+}
 
-    while (!cache.empty())
+VkResult DescriptorPool::Allocate(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSet, uint32_t count)
+{
+    std::lock_guard lock{ mutex };
+    for (uint32_t i = 0; i < count; i++)
     {
-        cache.pop();
+        auto it = freeLists.find(pDescriptorSetLayout[i]);
+        if (it != freeLists.end() && !it->second.empty() && IsRetired(device, it->second.front().syncPoint))
+        {
+            pDescriptorSet[i] = it->second.front().descriptorSet;
+            it->second.pop_front();
+            continue;
+        }
+
+        VkResult result = AllocateInternal(pDescriptorSetLayout[i], &pDescriptorSet[i]);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
     }
+
+    return VK_SUCCESS;
 }
 
-VkResult DescriptorPool::Allocate(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSet, uint32_t count)
+void DescriptorPool::Free(VkDescriptorSetLayout descriptorSetLayout, const VkDescriptorSet *pDescriptorSet, uint32_t size, uint64_t syncPoint)
 {
-    VkResult result = VK_SUCCESS;
-
-    uint32_t free = MaxSetsPerPool - allocatedCount;
-    if (count <= free)
+    if (!syncPoint)
     {
-        allocatedCount += count;
-        return AllocateInternal(pDescriptorSetLayout, pDescriptorSet, count);
+        syncPoint = device->GetSyncPoint() + 1;
     }
 
-    if (free > 0)
+    std::lock_guard lock{ mutex };
+    if (handles.empty())
     {
-        result = AllocateInternal(pDescriptorSetLayout, pDescriptorSet, free);
+        return;
     }
-    if (result != VK_SUCCESS)
+
+    for (uint32_t i = 0; i < size; i++)
     {
-        return result;
+        /** The layout was destroyed, the handle may already be another layout's */
+        auto owner = owners.find(pDescriptorSet[i]);
+        if (owner != owners.end() && owner->second.descriptorSetLayout != descriptorSetLayout)
+        {
+            Check(device->FreeDescriptorSets(owner->second.pool, 1, &pDescriptorSet[i]));
+            owners.erase(owner);
+            continue;
+        }
+        freeLists[descriptorSetLayout].push_back({ syncPoint, pDescriptorSet[i] });
     }
-    handles.push_back(Create());
-    allocatedCount = count - free;
-
-    return AllocateInternal(pDescriptorSetLayout, pDescriptorSet, allocatedCount);
 }
 
-void DescriptorPool::Free(VkDescriptorSet *pDescriptorSet, uint32_t size)
+void DescriptorPool::Release(VkDescriptorSetLayout descriptorSetLayout)
 {
-    if (!handles.empty())
+    std::lock_guard lock{ mutex };
+    auto it = freeLists.find(descriptorSetLayout);
+    if (it != freeLists.end())
+    {
+        for (auto &[syncPoint, descriptorSet] : it->second)
+        {
+            auto owner = owners.find(descriptorSet);
+            if (owner != owners.end())
+            {
+                Check(device->FreeDescriptorSets(owner->second.pool, 1, &descriptorSet));
+                owners.erase(owner);
+            }
+        }
+        freeLists.erase(it);
+    }
+
+    /** The sets still held are orphaned, so Free doesn't park them under a layout reusing the handle */
+    for (auto &[descriptorSet, owner] : owners)
     {
-        for (size_t i = 0; i < size; i++)
+        if (owner.descriptorSetLayout == descriptorSetLayout)
         {
-            cache.push(pDescriptorSet[i]);
+            owner.descriptorSetLayout = VK_NULL_HANDLE;
         }
     }
 }
 
 void DescriptorPool::Reset()
 {
+    std::lock_guard lock{ mutex };
+    for (auto &handle : handles)
+    {
+        Check(device->ResetDescriptorPool(handle, 0));
+    }
+    freeLists.clear();
+    owners.clear();
+}
 
+void DescriptorPool::GetStatistics(DescriptorStatistics *pStatistics)
+{
+    std::lock_guard lock{ mutex };
+    pStatistics->Allocations += allocations;
+    pStatistics->Pools       += handles.size();
 }
 
-VkDescriptorPool DescriptorPool::Create()
+VkDescriptorPool DescriptorPool::Create(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize, VkDescriptorPoolCreateFlags flags)
 {
     VkDescriptorPool handle;
 
     VkDescriptorPoolCreateInfo createInfo = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext         = nullptr,
-        .flags         = 0,
+        .flags         = flags,
 	    .maxSets       = uint32_t(poolSize.size() * MaxSetsPerPool),
 	    .poolSizeCount = uint32_t(poolSize.size()),
         .pPoolSizes    = poolSize.data(),
     };
 
-    Check(vkCreateDescriptorPool(*device, &createInfo, nullptr, &handle));
+    Check(device->Create(&createInfo, &handle));
 
     return handle;
 }
 
-VkResult DescriptorPool::AllocateInternal(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSet, uint32_t count)
+VkResult DescriptorPool::AllocateInternal(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet)
 {
-    if (count < cache.size())
+    VkDescriptorSetAllocateInfo allocateInfo = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext              = nullptr,
+        .descriptorPool     = handles.back(),
+        .descriptorSetCount = 1,
+        .pSetLayouts        = &descriptorSetLayout,
+    };
+
+    VkResult result = device->AllocateDescriptorSets(&allocateInfo, pDescriptorSet);
+    if (IsExhausted(result))
     {
-        for (uint32_t i = 0; i < count; i++)
-        {
-            pDescriptorSet[i] = cache.front();
-            cache.pop();
-        }
+        handles.push_back(Create(device, poolSize));
+        LOG::DEBUG("Descriptor pool exhausted, grow to {} pools", handles.size());
+
+        allocateInfo.descriptorPool = handles.back();
+        result = device->AllocateDescriptorSets(&allocateInfo, pDescriptorSet);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        owners[*pDescriptorSet] = Owner{ allocateInfo.descriptorPool, descriptorSetLayout };
+        allocations++;
+    }
+
+    return result;
+}
+
+TransientDescriptorPool::TransientDescriptorPool(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize) :
+    device{ device },
+    poolSize{ poolSize }
+{
+
+}
+
+TransientDescriptorPool::~TransientDescriptorPool()
+{
+    Destroy();
+}
+
+void TransientDescriptorPool::Destroy()
+{
+    std::lock_guard lock{ mutex };
+    for (auto &handle : frame)
+    {
+        device->DestroyAsync(handle);
+    }
+    for (auto &[syncPoint, ticket, handle] : retired)
+    {
+        device->DestroyAsync(handle);
+    }
+    for (auto &handle : available)
+    {
+        device->DestroyAsync(handle);
+    }
+    frame.clear();
+    retired.clear();
+    available.clear();
+}
 
-        return VK_SUCCESS;
+VkResult TransientDescriptorPool::Allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet)
+{
+    std::lock_guard lock{ mutex };
+    if (frame.empty())
+    {
+        frame.push_back(Acquire());
     }
 
-    VkDescriptorSetAllocateInfo createInfo = {
+    VkDescriptorSetAllocateInfo allocateInfo = {
         .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         .pNext              = nullptr,
-        .descriptorPool     = handles.back(),
-        .descriptorSetCount = count,
-        .pSetLayouts        = pDescriptorSetLayout,
+        .descriptorPool     = frame.back(),
+        .descriptorSetCount = 1,
+        .pSetLayouts        = &descriptorSetLayout,
     };
 
-    return vkAllocateDescriptorSets(*device, &createInfo, pDescriptorSet);
+    VkResult result = device->AllocateDescriptorSets(&allocateInfo, pDescriptorSet);
+    if (IsExhausted(result))
+    {
+        frame.push_back(Acquire());
+        allocateInfo.descriptorPool = frame.back();
+        result = device->AllocateDescriptorSets(&allocateInfo, pDescriptorSet);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        statistics.TransientAllocations++;
+    }
+
+    return result;
+}
+
+void TransientDescriptorPool::Retire(uint64_t ticket)
+{
+    std::lock_guard lock{ mutex };
+    for (auto &handle : frame)
+    {
+        retired.push_back({ 0, ticket, handle });
+    }
+    frame.clear();
+}
+
+void TransientDescriptorPool::GetStatistics(DescriptorStatistics *pStatistics)
+{
+    std::lock_guard lock{ mutex };
+    pStatistics->TransientAllocations += statistics.TransientAllocations;
+    pStatistics->Pools                += statistics.Pools;
+    pStatistics->Resets               += statistics.Resets;
+}
+
+VkDescriptorPool TransientDescriptorPool::Acquire()
+{
+    /** The same order as the destruction queue, the sync point is read after the tickets closed */
+    if (!retired.empty())
+    {
+        uint64_t closed    = device->GetClosedRecording();
+        uint64_t syncPoint = device->GetSyncPoint();
+        for (auto &pool : retired)
+        {
+            if (pool.syncPoint)
+            {
+                continue;
+            }
+            if (pool.ticket > closed)
+            {
+                break;
+            }
+            pool.syncPoint = syncPoint;
+        }
+    }
+
+    /** The completion of the timelines is only queried when the cached value falls behind */
+    while (!retired.empty() && retired.front().syncPoint && IsRetired(device, retired.front().syncPoint))
+    {
+        Check(device->ResetDescriptorPool(retired.front().handle, 0));
+        available.push_back(retired.front().handle);
+        retired.pop_front();
+        statistics.Resets++;
+    }
+
+    if (available.empty())
+    {
+        statistics.Pools++;
+        return DescriptorPool::Create(device, poolSize, 0);
+    }
+
+    VkDescriptorPool handle = available.back();
+    available.pop_back();
+
+    return handle;
 }
 
 }
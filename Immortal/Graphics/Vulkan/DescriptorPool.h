@@ -2,7 +2,10 @@
 
 #include "Common.h"
 
-#include <queue>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace Immortal
 {
@@ -10,8 +13,30 @@ namespace Vulkan
 {
 
 class Device;
-class DescriptorSetLayout;
 
+/** The counters of the descriptor allocations, which stay still once the sets are recycled */
+struct DescriptorStatistics
+{
+    /** The sets allocated from the long-lived pools, which neither a free list nor the cache provided */
+    uint64_t Allocations = 0;
+
+    /** The sets allocated linearly from the pools of the frames */
+    uint64_t TransientAllocations = 0;
+
+    /** The descriptor pools created, long-lived or for the frames */
+    uint64_t Pools = 0;
+
+    /** The pools of the frames reset in bulk */
+    uint64_t Resets = 0;
+};
+
+/**
+ * @brief Allocator for the long-lived descriptor sets. Freed sets go into a
+ *  free list keyed by their layout, and are handed out again for the same
+ *  layout once the GPU has passed the sync point they were freed at. The
+ *  pools are grown when exhausted instead of counting the allocations.
+ *  When a layout is destroyed, its free sets are returned to their pools.
+ */
 class DescriptorPool
 {
 public:
@@ -19,21 +44,42 @@ public:
 
     using Primitive = VkDescriptorPool;
 
-public:
-    DescriptorPool(Device *device, const DescriptorSetLayout &layout, uint32_t poolSize = MaxSetsPerPool);
+    struct FreeDescriptorSet
+    {
+        uint64_t        syncPoint;
+        VkDescriptorSet descriptorSet;
+    };
 
+    /** The layout is null once destroyed, the set is then freed as soon as given back */
+    struct Owner
+    {
+        VkDescriptorPool      pool;
+        VkDescriptorSetLayout descriptorSetLayout;
+    };
+
+public:
     DescriptorPool(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize);
 
     ~DescriptorPool();
 
     VkResult Allocate(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSet, uint32_t count = 1);
 
-    void Free(VkDescriptorSet *pDescriptorSet, uint32_t size = 1);
+    /** The sets are reusable after the sync point, which is the next submission by default */
+    void Free(VkDescriptorSetLayout descriptorSetLayout, const VkDescriptorSet *pDescriptorSet, uint32_t size = 1, uint64_t syncPoint = 0);
 
+    /** Return the free sets of a layout being destroyed to the pools they were allocated from,
+     *  and those still in use once they are freed.
+     */
+    void Release(VkDescriptorSetLayout descriptorSetLayout);
+
+    /** Reset every pool in bulk, which invalidates all the sets allocated */
     void Reset();
 
     void Destroy();
 
+    /** Fill the allocations and pools of the long-lived sets */
+    void GetStatistics(DescriptorStatistics *pStatistics);
+
     Primitive Handle() const
     {
         return handles.back();
@@ -44,10 +90,12 @@ public:
         return Handle();
     }
 
-private:
-    VkDescriptorPool Create();
+public:
+    /** The sets of the linear pools are never freed one by one, which lets the driver skip the bookkeeping */
+    static VkDescriptorPool Create(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize, VkDescriptorPoolCreateFlags flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 
-    VkResult AllocateInternal(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSet, uint32_t count);
+private:
+    VkResult AllocateInternal(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet);
 
 protected:
     Device *device{ nullptr };
@@ -56,9 +104,66 @@ protected:
 
     std::vector<VkDescriptorPoolSize> poolSize;
 
-    std::queue<VkDescriptorSet> cache;
+    std::unordered_map<VkDescriptorSetLayout, std::deque<FreeDescriptorSet>> freeLists;
+
+    /** The pool and layout of each set, needed to free it */
+    std::unordered_map<VkDescriptorSet, Owner> owners;
+
+    uint64_t allocations{ 0 };
+
+    std::mutex mutex;
+};
+
+/**
+ * @brief Linear allocator for the descriptor sets only used within a frame.
+ *  The sets are never freed one by one, instead the pools of a frame are
+ *  retired together at each submission, and reset in bulk once every command
+ *  buffer recording by then has been submitted and the GPU has completed the
+ *  sync point of that submission.
+ */
+class TransientDescriptorPool
+{
+public:
+    struct RetiredPool
+    {
+        /** 0 until the command buffers recording with the ticket have been submitted */
+        uint64_t         syncPoint;
+        uint64_t         ticket;
+        VkDescriptorPool handle;
+    };
+
+public:
+    TransientDescriptorPool(Device *device, const std::vector<VkDescriptorPoolSize> &poolSize);
+
+    ~TransientDescriptorPool();
+
+    VkResult Allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet);
+
+    /** End the frame, its pools are reset after the recordings open by now have completed */
+    void Retire(uint64_t ticket);
+
+    void Destroy();
+
+    /** Fill the allocations, pools and resets of the frames */
+    void GetStatistics(DescriptorStatistics *pStatistics);
+
+private:
+    VkDescriptorPool Acquire();
+
+protected:
+    Device *device{ nullptr };
+
+    std::vector<VkDescriptorPoolSize> poolSize;
+
+    std::vector<VkDescriptorPool> frame;
+
+    std::deque<RetiredPool> retired;
+
+    std::vector<VkDescriptorPool> available;
+
+    DescriptorStatistics statistics;
 
-    uint32_t allocatedCount = 0;
+    std::mutex mutex;
 };
 
 }
@@ -5,6 +5,8 @@
 #include "Texture.h"
 #include "Sampler.h"
 
+#include <algorithm>
+
 namespace Immortal
 {
 namespace Vulkan
@@ -13,10 +15,9 @@ namespace Vulkan
 
 DescriptorSet::DescriptorSet(Device *device, Pipeline *pipeline) :
     device{ device },
-    descriptorUpdateTemplate{ VK_NULL_HANDLE}
+    descriptorSetLayout{ pipeline->GetDescriptorSetLayout() }
 {
-	VkDescriptorSetLayout descriptorSetLayout = pipeline->GetDescriptorSetLayout();
-    Check(device->AllocateDescriptorSet(&descriptorSetLayout, &handle));
+
 }
 
 DescriptorSet::~DescriptorSet()
@@ -27,86 +28,98 @@ DescriptorSet::~DescriptorSet()
 void DescriptorSet::Set(uint32_t slot, SuperBuffer *_buffer)
 {
 	Buffer *buffer = InterpretAs<Buffer>(_buffer);
-    VkDescriptorBufferInfo descriptorBufferInfo = {
-        .buffer = *buffer,
-	    .offset = buffer->GetOffset(),
-        .range  = buffer->GetSize()
-    };
 
     VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     if (buffer->GetUsage() & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
     {
 		descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     }
-    VkWriteDescriptorSet writeDescriptorSet{
-        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext            = nullptr,
-        .dstSet           = handle,
-        .dstBinding       = slot,
-        .dstArrayElement  = 0,
-        .descriptorCount  = 1,
-        .descriptorType   = descriptorType,
-        .pImageInfo       = nullptr,
-        .pBufferInfo      = &descriptorBufferInfo,
-        .pTexelBufferView = nullptr,
-    };
-
-    device->UpdateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
+
+    Bind(DescriptorBinding{
+        .slot     = slot,
+        .type     = descriptorType,
+        .resource = (uint64_t)(VkBuffer)*buffer,
+        .offset   = buffer->GetOffset(),
+        .range    = buffer->GetSize(),
+    });
 }
 
 void DescriptorSet::Set(uint32_t slot, SuperTexture *_texture)
 {
 	Texture *texture = InterpretAs<Texture>(_texture);
-    VkDescriptorImageInfo descriptorImageInfo = {
-        .sampler     = VK_NULL_HANDLE,
-		.imageView   = texture->GetImageView(),
-		.imageLayout = texture->GetLayout()
-    };
 
     VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
     if (texture->GetUsage() & VK_IMAGE_USAGE_STORAGE_BIT)
     {
 		descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     }
-    VkWriteDescriptorSet writeDescriptorSet{
-        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext            = nullptr,
-        .dstSet           = handle,
-        .dstBinding       = slot,
-        .dstArrayElement  = 0,
-        .descriptorCount  = 1,
-        .descriptorType   = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-        .pImageInfo       = &descriptorImageInfo,
-        .pBufferInfo      = nullptr,
-        .pTexelBufferView = nullptr,
-    };
-
-    device->UpdateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
+
+    Bind(DescriptorBinding{
+        .slot        = slot,
+        .type        = descriptorType,
+        .resource    = (uint64_t)(VkImageView)texture->GetImageView(),
+        .imageLayout = texture->GetLayout(),
+    });
 }
 
 void DescriptorSet::Set(uint32_t slot, SuperSampler *_sampler)
 {
 	Sampler *sampler = InterpretAs<Sampler>(_sampler);
-    VkDescriptorImageInfo descriptorImageInfo = {
-        .sampler     = *sampler,
-		.imageView   = VK_NULL_HANDLE,
-	    .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED
-    };
-
-    VkWriteDescriptorSet writeDescriptorSet{
-        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext            = nullptr,
-        .dstSet           = handle,
-        .dstBinding       = slot,
-        .dstArrayElement  = 0,
-        .descriptorCount  = 1,
-        .descriptorType   = VK_DESCRIPTOR_TYPE_SAMPLER,
-        .pImageInfo       = &descriptorImageInfo,
-        .pBufferInfo      = nullptr,
-        .pTexelBufferView = nullptr,
-    };
-
-    device->UpdateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
+
+    Bind(DescriptorBinding{
+        .slot     = slot,
+        .type     = VK_DESCRIPTOR_TYPE_SAMPLER,
+        .resource = (uint64_t)(VkSampler)*sampler,
+    });
+}
+
+void DescriptorSet::Bind(const DescriptorBinding &binding)
+{
+    auto it = std::lower_bound(bindings.begin(), bindings.end(), binding.slot, [](const DescriptorBinding &binding, uint32_t slot) {
+        return binding.slot < slot;
+    });
+
+    if (it != bindings.end() && it->slot == binding.slot)
+    {
+        if (*it == binding)
+        {
+            return;
+        }
+        *it = binding;
+    }
+    else
+    {
+        bindings.insert(it, binding);
+    }
+
+    /** Rebound before the frame it was resolved in is submitted, so its bindings vary per draw */
+    if (!dirty && syncPoint == device->GetSyncPoint() + 1)
+    {
+        transient = true;
+    }
+    dirty = true;
+}
+
+VkDescriptorSet DescriptorSet::Resolve()
+{
+    uint64_t nextSyncPoint = device->GetSyncPoint() + 1;
+    if (transient)
+    {
+        /** The transient set is only valid in the frame it was allocated in */
+        if (dirty || syncPoint != nextSyncPoint)
+        {
+            handle = device->GetDescriptorSetCache()->AcquireTransient(descriptorSetLayout, bindings.data(), uint32_t(bindings.size()));
+        }
+    }
+    else
+    {
+        /** Look up on every bind, which also keeps the cached set alive while in flight */
+        handle = device->GetDescriptorSetCache()->Acquire(descriptorSetLayout, bindings.data(), uint32_t(bindings.size()));
+    }
+    syncPoint = nextSyncPoint;
+    dirty = false;
+
+    return handle;
 }
 
 }
@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "Core.h"
 #include "Handle.h"
+#include "DescriptorSetCache.h"
 #include "Algorithm/LightArray.h"
 #include "Graphics/DescriptorSet.h"
 #include "Graphics/Buffer.h"
@@ -36,18 +37,41 @@ public:
 
 	virtual void Set(uint32_t slot, SuperSampler *sampler) override;
 
+    /** The bindings are resolved to a cached set when bound to a command
+     *  buffer, so a set in flight is never updated, and the identical
+     *  bindings share one set. A set rebound after being resolved within the
+     *  same frame is treated as per-frame from then on, and its sets are
+     *  allocated linearly from the pools of the frame instead of the cache.
+     */
+    VkDescriptorSet Resolve();
+
     void Swap(DescriptorSet &other)
     {
 		Handle::Swap(other);
-        std::swap(device, other.device);
+        std::swap(device,              other.device             );
+        std::swap(descriptorSetLayout, other.descriptorSetLayout);
+        std::swap(bindings,            other.bindings           );
+        std::swap(syncPoint,           other.syncPoint          );
+        std::swap(dirty,               other.dirty              );
+        std::swap(transient,           other.transient          );
     }
 
+protected:
+    void Bind(const DescriptorBinding &binding);
+
 protected:
     Device *device{ nullptr };
 
-    LightArray<VkWriteDescriptorSet> writeDescriptorSets;
+    VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+
+    std::vector<DescriptorBinding> bindings;
+
+    /** The sync point of the submission after the last resolve */
+    uint64_t syncPoint{ 0 };
+
+    bool dirty{ true };
 
-    VkDescriptorUpdateTemplate descriptorUpdateTemplate;
+    bool transient{ false };
 };
 
 }
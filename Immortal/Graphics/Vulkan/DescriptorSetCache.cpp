@@ -0,0 +1,237 @@
+#include "DescriptorSetCache.h"
+#include "DescriptorPool.h"
+#include "Device.h"
+
+#include <algorithm>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+static inline void HashCombine(uint64_t &hash, uint64_t value)
+{
+    hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+}
+
+static uint64_t Hash(VkDescriptorSetLayout descriptorSetLayout, const DescriptorBinding *pBindings, uint32_t count)
+{
+    uint64_t hash = 0;
+    HashCombine(hash, (uint64_t)descriptorSetLayout);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto &binding = pBindings[i];
+        HashCombine(hash, (uint64_t(binding.type) << 32) | binding.slot);
+        HashCombine(hash, binding.resource);
+        HashCombine(hash, binding.offset);
+        HashCombine(hash, binding.range);
+        HashCombine(hash, binding.imageLayout);
+    }
+
+    return hash;
+}
+
+DescriptorSetCache::DescriptorSetCache(Device *device, DescriptorPool *descriptorPool) :
+    device{ device },
+    descriptorPool{ descriptorPool }
+{
+
+}
+
+DescriptorSetCache::~DescriptorSetCache()
+{
+    Clear();
+}
+
+VkDescriptorSet DescriptorSetCache::Acquire(VkDescriptorSetLayout descriptorSetLayout, const DescriptorBinding *pBindings, uint32_t count)
+{
+    uint64_t hash = Hash(descriptorSetLayout, pBindings, count);
+    uint64_t syncPoint = device->GetSyncPoint() + 1;
+
+    std::lock_guard lock{ mutex };
+    auto [begin, end] = entries.equal_range(hash);
+    for (auto it = begin; it != end; it++)
+    {
+        auto &entry = it->second;
+        if (entry.descriptorSetLayout == descriptorSetLayout && entry.bindings.size() == count &&
+            std::equal(entry.bindings.begin(), entry.bindings.end(), pBindings))
+        {
+            entry.syncPoint = syncPoint;
+            return entry.descriptorSet;
+        }
+    }
+
+    if (entries.size() >= Capacity)
+    {
+        Evict();
+    }
+
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    Check(descriptorPool->Allocate(&descriptorSetLayout, &descriptorSet));
+    Write(descriptorSet, pBindings, count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        references[pBindings[i].resource]++;
+    }
+    entries.emplace(hash, Entry{
+        .descriptorSetLayout = descriptorSetLayout,
+        .bindings            = { pBindings, pBindings + count },
+        .descriptorSet       = descriptorSet,
+        .syncPoint           = syncPoint,
+    });
+
+    return descriptorSet;
+}
+
+VkDescriptorSet DescriptorSetCache::AcquireTransient(VkDescriptorSetLayout descriptorSetLayout, const DescriptorBinding *pBindings, uint32_t count)
+{
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    Check(device->AllocateTransientDescriptorSet(descriptorSetLayout, &descriptorSet));
+    Write(descriptorSet, pBindings, count);
+
+    return descriptorSet;
+}
+
+void DescriptorSetCache::Invalidate(uint64_t resource)
+{
+    std::lock_guard lock{ mutex };
+    if (references.find(resource) == references.end())
+    {
+        return;
+    }
+
+    for (auto it = entries.begin(); it != entries.end(); )
+    {
+        auto &bindings = it->second.bindings;
+        if (std::any_of(bindings.begin(), bindings.end(), [=](const DescriptorBinding &binding) { return binding.resource == resource; }))
+        {
+            Release(it->second);
+            it = entries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void DescriptorSetCache::InvalidateLayout(VkDescriptorSetLayout descriptorSetLayout)
+{
+    std::lock_guard lock{ mutex };
+    for (auto it = entries.begin(); it != entries.end(); )
+    {
+        if (it->second.descriptorSetLayout == descriptorSetLayout)
+        {
+            Release(it->second);
+            it = entries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void DescriptorSetCache::Clear()
+{
+    std::lock_guard lock{ mutex };
+    for (auto &[hash, entry] : entries)
+    {
+        Release(entry);
+    }
+    entries.clear();
+    references.clear();
+}
+
+void DescriptorSetCache::Write(VkDescriptorSet descriptorSet, const DescriptorBinding *pBindings, uint32_t count)
+{
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    writeDescriptorSets.reserve(count);
+    bufferInfos.reserve(count);
+    imageInfos.reserve(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto &binding = pBindings[i];
+        VkWriteDescriptorSet writeDescriptorSet{
+            .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext            = nullptr,
+            .dstSet           = descriptorSet,
+            .dstBinding       = binding.slot,
+            .dstArrayElement  = 0,
+            .descriptorCount  = 1,
+            .descriptorType   = binding.type,
+            .pImageInfo       = nullptr,
+            .pBufferInfo      = nullptr,
+            .pTexelBufferView = nullptr,
+        };
+
+        switch (binding.type)
+        {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            writeDescriptorSet.pBufferInfo = &bufferInfos.emplace_back(VkDescriptorBufferInfo{
+                .buffer = (VkBuffer)binding.resource,
+                .offset = binding.offset,
+                .range  = binding.range,
+            });
+            break;
+
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            writeDescriptorSet.pImageInfo = &imageInfos.emplace_back(VkDescriptorImageInfo{
+                .sampler     = (VkSampler)binding.resource,
+                .imageView   = VK_NULL_HANDLE,
+                .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            });
+            break;
+
+        default:
+            writeDescriptorSet.pImageInfo = &imageInfos.emplace_back(VkDescriptorImageInfo{
+                .sampler     = VK_NULL_HANDLE,
+                .imageView   = (VkImageView)binding.resource,
+                .imageLayout = binding.imageLayout,
+            });
+            break;
+        }
+        writeDescriptorSets.emplace_back(writeDescriptorSet);
+    }
+
+    device->UpdateDescriptorSets(uint32_t(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+}
+
+void DescriptorSetCache::Release(Entry &entry)
+{
+    descriptorPool->Free(entry.descriptorSetLayout, &entry.descriptorSet, 1, entry.syncPoint);
+    for (auto &binding : entry.bindings)
+    {
+        auto it = references.find(binding.resource);
+        if (it != references.end() && --it->second == 0)
+        {
+            references.erase(it);
+        }
+    }
+}
+
+void DescriptorSetCache::Evict()
+{
+    /** Only the sets not in flight are recycled, the hot ones stay */
+    uint64_t retired = device->GetRetiredSyncPoint();
+    for (auto it = entries.begin(); it != entries.end(); )
+    {
+        if (it->second.syncPoint <= retired)
+        {
+            Release(it->second);
+            it = entries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Common.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+class Device;
+class DescriptorPool;
+
+/**
+ * @brief One resource bound to a slot. Resource is the VkBuffer, VkImageView
+ *  or VkSampler, which is also what the cache entries are invalidated by.
+ */
+struct DescriptorBinding
+{
+    uint32_t         slot        = 0;
+    VkDescriptorType type        = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    uint64_t         resource    = 0;
+    VkDeviceSize     offset      = 0;
+    VkDeviceSize     range       = 0;
+    VkImageLayout    imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    bool operator==(const DescriptorBinding &other) const
+    {
+        return slot == other.slot && type == other.type && resource == other.resource &&
+            offset == other.offset && range == other.range && imageLayout == other.imageLayout;
+    }
+};
+
+/**
+ * @brief Descriptor sets keyed by the layout and the resources bound, so the
+ *  identical bindings share one set which is written only once. The sets are
+ *  never updated after being cached, so sharing them across frames is safe.
+ *  Entries referencing a resource or using a layout are dropped when it is
+ *  destroyed, and the least recently used ones are recycled once the cache
+ *  is full.
+ */
+class DescriptorSetCache
+{
+public:
+    static constexpr size_t Capacity = 4096;
+
+    struct Entry
+    {
+        VkDescriptorSetLayout          descriptorSetLayout;
+        std::vector<DescriptorBinding> bindings;
+        VkDescriptorSet                descriptorSet;
+        uint64_t                       syncPoint;
+    };
+
+public:
+    DescriptorSetCache(Device *device, DescriptorPool *descriptorPool);
+
+    ~DescriptorSetCache();
+
+    /** @ret A set with exactly the bindings, which are sorted by slot */
+    VkDescriptorSet Acquire(VkDescriptorSetLayout descriptorSetLayout, const DescriptorBinding *pBindings, uint32_t count);
+
+    /** @ret A set written with the bindings from the pools of the frame, which is not cached */
+    VkDescriptorSet AcquireTransient(VkDescriptorSetLayout descriptorSetLayout, const DescriptorBinding *pBindings, uint32_t count);
+
+    void Invalidate(uint64_t resource);
+
+    void InvalidateLayout(VkDescriptorSetLayout descriptorSetLayout);
+
+    void Clear();
+
+    size_t Size() const
+    {
+        return entries.size();
+    }
+
+protected:
+    void Write(VkDescriptorSet descriptorSet, const DescriptorBinding *pBindings, uint32_t count);
+
+    void Release(Entry &entry);
+
+    void Evict();
+
+protected:
+    Device *device{ nullptr };
+
+    DescriptorPool *descriptorPool{ nullptr };
+
+    std::unordered_multimap<uint64_t, Entry> entries;
+
+    /** The count of entries referencing each resource, to skip the invalidation quickly */
+    std::unordered_map<uint64_t, uint32_t> references;
+
+    std::mutex mutex;
+};
+
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Common.h"
+
+#include <array>
+#include <atomic>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+/**
+ * @brief A single producer single consumer ring of objects pending for
+ *  destruction. Each thread that destroys objects owns one of them, so the
+ *  producer side is lock-free and never allocates. An object is pushed with
+ *  the recording ticket of the device at that time, and gets its sync point
+ *  once every command buffer recording by then has been submitted. The
+ *  tickets and sync points of one thread are non-decreasing, so the consumer
+ *  can stop at the first object which may still be used by the GPU.
+ */
+class DestructionQueue
+{
+public:
+    static constexpr size_t Capacity = 1024;
+
+    struct Object
+    {
+        /** 0 until the command buffers recording with the ticket have been submitted */
+        uint64_t      syncPoint;
+        uint64_t      ticket;
+        uint64_t      handle;
+        VmaAllocation allocation;
+        VkObjectType  type;
+    };
+
+public:
+    bool Push(const Object &object)
+    {
+        uint64_t head = this->head.load(std::memory_order_relaxed);
+        if (head - tail.load(std::memory_order_acquire) >= Capacity)
+        {
+            return false;
+        }
+
+        objects[head & (Capacity - 1)] = object;
+        this->head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * @brief Consume the objects whose sync point has been retired
+     * @param closed All the command buffers with a ticket up to this one have been submitted
+     * @param syncPoint The sync point of the last submission, which is given to the objects closed
+     */
+    template <class T>
+    void Release(uint64_t closed, uint64_t syncPoint, uint64_t retired, T &&destroy)
+    {
+        uint64_t tail = this->tail.load(std::memory_order_relaxed);
+        uint64_t head = this->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            Object &object = objects[tail & (Capacity - 1)];
+            if (!object.syncPoint)
+            {
+                if (object.ticket > closed)
+                {
+                    break;
+                }
+                object.syncPoint = syncPoint;
+            }
+            if (object.syncPoint > retired)
+            {
+                break;
+            }
+            destroy(object);
+        }
+        this->tail.store(tail, std::memory_order_release);
+    }
+
+    bool Empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+protected:
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+
+    std::array<Object, Capacity> objects;
+};
+
+}
+}
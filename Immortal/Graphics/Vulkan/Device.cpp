@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "PhysicalDevice.h"
 #include "DescriptorPool.h"
+#include "DescriptorSetCache.h"
 #include "Shared/Async.h"
 
 #include "Buffer.h"
@@ -13,6 +14,8 @@
 #include "Surface.h"
 #include "Swapchain.h"
 #include "Sampler.h"
+#include "TransferQueue.h"
+#include "TimestampQueryPool.h"
 
 #include "Shared/Async.h"
 
@@ -107,6 +110,12 @@ Device::Device(PhysicalDevice *physicalDevice, std::unordered_map<const char*, b
         }
     }
 
+    /** Lines the GPU timestamps up with the CPU zones of the profiler */
+    if (IsExtensionSupported(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) && !IsEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+    {
+        enabledExtensions.emplace_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+
     if (IsEnabled("VK_KHR_performance_query") && IsEnabled("VK_EXT_host_query_reset"))
     {
         physicalDevice->RequestExtensionFeatures<VkPhysicalDevicePerformanceQueryFeaturesKHR>(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR);
@@ -184,6 +193,15 @@ Device::Device(PhysicalDevice *physicalDevice, std::unordered_map<const char*, b
 
     descriptorPool = new DescriptorPool{ this, Limit::PoolSize };
 
+    transientDescriptorPool = new TransientDescriptorPool{ this, Limit::PoolSize };
+
+    descriptorSetCache = new DescriptorSetCache{ this, descriptorPool };
+
+    timestampQueryPool = new TimestampQueryPool{ this };
+
+    static std::atomic<uint64_t> serials{ 0 };
+    serial = ++serials;
+
     EnableGlobal();
 }
 
@@ -218,21 +236,29 @@ uint32_t Device::GetQueueFailyIndex(VkQueueFlagBits requestFlags)
 
 Device::~Device()
 {
-    Wait();
+    WaitIdle();
+
+    timestampQueryPool.Reset();
+    transfer.queue.Reset();
 
     commandPools.clear();
+    descriptorSetCache.Reset();
+    transientDescriptorPool.Reset();
     descriptorPool->Destroy();
-    semaphorePool.Reset();
 
-    for (auto &queue : destroyCoroutine.queues)
+    for (auto &family : queues)
     {
-        while (!queue.empty())
+        for (auto &queue : family)
         {
-            std::function<void()> func = queue.front();
-            queue.pop();
-            func();
+            if (queue.GetTimeline())
+            {
+                Release(std::move(queue.GetTimeline()));
+            }
         }
     }
+    semaphorePool.Reset();
+
+    DestroyObjects(true);
 
     descriptorPool.Reset();
 
@@ -402,20 +428,225 @@ uint32_t Device::GetMemoryType(uint32_t bits, VkMemoryPropertyFlags properties,
     }
 }
 
-void Device::DestroyObjects()
+void Device::DestroyObjects(bool wait)
+{
+    std::unique_lock lock{ destruction.mutex, std::defer_lock };
+    if (wait)
+    {
+        lock.lock();
+        Check(WaitIdle());
+    }
+    else if (!lock.try_lock())
+    {
+        /** Someone else is collecting, which will catch up with us */
+        return;
+    }
+
+    /** The sync point is read after the tickets closed, so it covers their submissions */
+    uint64_t closed    = wait ? std::numeric_limits<uint64_t>::max() : GetClosedRecording();
+    uint64_t syncPoint = GetSyncPoint();
+    uint64_t retired   = wait ? std::numeric_limits<uint64_t>::max() : GetRetiredSyncPoint();
+    for (auto &queue : destruction.queues)
+    {
+        queue->Release(closed, syncPoint, retired, [this](const DestructionQueue::Object &object) {
+            Destroy(object);
+        });
+    }
+}
+
+VkResult Device::WaitIdle()
+{
+    /** Always locked in the same order, vkDeviceWaitIdle requires the queues to be externally synchronized */
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto &family : queues)
+    {
+        for (auto &queue : family)
+        {
+            locks.emplace_back(queue.GetMutex());
+        }
+    }
+
+    return Wait();
+}
+
+uint64_t Device::AcquireSyncPoint(DeviceQueue *queue)
+{
+    std::lock_guard lock{ timeline.mutex };
+
+    auto &semaphore = queue->GetTimeline();
+    if (!semaphore)
+    {
+        Check(AllocateSemaphore(&semaphore));
+    }
+    semaphore.value = timeline.syncPoint.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    return semaphore.value;
+}
+
+uint64_t Device::OpenRecording()
+{
+    std::lock_guard lock{ recording.mutex };
+
+    uint64_t ticket = recording.ticket.load(std::memory_order_relaxed) + 1;
+    recording.open.emplace(ticket, GetSyncPoint());
+    recording.ticket.store(ticket, std::memory_order_release);
+
+    return ticket;
+}
+
+void Device::CloseRecording(uint64_t ticket)
+{
+    std::lock_guard lock{ recording.mutex };
+    recording.open.erase(ticket);
+}
+
+uint64_t Device::GetClosedRecording()
+{
+    std::lock_guard lock{ recording.mutex };
+
+    /** A command buffer begun and never submitted, reset or destroyed would hold back the destruction forever */
+    uint64_t syncPoint = GetSyncPoint();
+    while (!recording.open.empty() && syncPoint - recording.open.begin()->second > MaxRecordingSyncPoints)
+    {
+        LOG::WARN("Command buffer recording {} has been open for more than {} submissions, which is taken as abandoned", recording.open.begin()->first, MaxRecordingSyncPoints);
+        recording.open.erase(recording.open.begin());
+    }
+
+    return recording.open.empty() ? recording.ticket.load(std::memory_order_relaxed) : recording.open.begin()->first - 1;
+}
+
+uint64_t Device::GetRetiredSyncPoint()
+{
+    std::lock_guard lock{ timeline.mutex };
+
+    /** A queue without pending submissions doesn't hold back anything */
+    uint64_t retired = timeline.syncPoint.load(std::memory_order_relaxed);
+    for (auto &family : queues)
+    {
+        for (auto &queue : family)
+        {
+            auto &semaphore = queue.GetTimeline();
+            if (!semaphore)
+            {
+                continue;
+            }
+
+            uint64_t completed = 0;
+            Check(GetCompletion(semaphore, &completed));
+            if (completed < semaphore.value)
+            {
+                retired = std::min(retired, completed);
+            }
+        }
+    }
+    timeline.retired.store(retired, std::memory_order_release);
+
+    return retired;
+}
+
+DestructionQueue *Device::GetDestructionQueue()
+{
+    /** Keyed by the serial rather than the address, which a later device may reuse */
+    thread_local std::unordered_map<uint64_t, DestructionQueue *> cache;
+
+    auto &queue = cache[serial];
+    if (!queue)
+    {
+        std::lock_guard lock{ destruction.mutex };
+        queue = destruction.queues.emplace_back(new DestructionQueue);
+    }
+
+    return queue;
+}
+
+void Device::DestroyAsync(VkObjectType type, uint64_t object, VmaAllocation allocation)
 {
-    auto &queue = destroyCoroutine.queues[destroyCoroutine.freeing];
-    auto &mutex = destroyCoroutine.mutex;
+    DestructionQueue::Object pending{
+        .syncPoint  = 0,
+        .ticket     = recording.ticket.load(std::memory_order_acquire),
+        .handle     = object,
+        .allocation = allocation,
+        .type       = type,
+    };
 
-    SLROTATE(destroyCoroutine.working, destroyCoroutine.queues.size());
-    SLROTATE(destroyCoroutine.freeing, destroyCoroutine.queues.size());
+    auto queue = GetDestructionQueue();
+    if (!queue->Push(pending))
+    {
+        LOG::WARN("Destruction queue of the thread is full, wait for the device to be idle");
+        DestroyObjects(true);
+        queue->Push(pending);
+    }
+}
+
+void Device::Destroy(const DestructionQueue::Object &object)
+{
+    if (descriptorSetCache && (object.type == VK_OBJECT_TYPE_BUFFER || object.type == VK_OBJECT_TYPE_IMAGE_VIEW || object.type == VK_OBJECT_TYPE_SAMPLER))
+    {
+        descriptorSetCache->Invalidate(object.handle);
+    }
+
+    /** The layout handle may be reused right after, so its sets must not outlive it */
+    if (object.type == VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT)
+    {
+        if (descriptorSetCache)
+        {
+            descriptorSetCache->InvalidateLayout((VkDescriptorSetLayout)object.handle);
+        }
+        if (descriptorPool)
+        {
+            descriptorPool->Release((VkDescriptorSetLayout)object.handle);
+        }
+    }
 
-    while (!queue.empty())
+    switch (object.type)
     {
-        std::function<void()> func;
-        func = queue.front();
-        queue.pop();
-        func();
+#define DESTROY_VK_OBJECT(T, E) \
+    case VK_OBJECT_TYPE_##E: \
+        vkDestroy##T(handle, (Vk##T)object.handle, nullptr); \
+        break;
+
+        DESTROY_VK_OBJECT(AccelerationStructureKHR, ACCELERATION_STRUCTURE_KHR)
+        DESTROY_VK_OBJECT(CommandPool,              COMMAND_POOL              )
+        DESTROY_VK_OBJECT(DescriptorPool,           DESCRIPTOR_POOL           )
+        DESTROY_VK_OBJECT(DescriptorSetLayout,      DESCRIPTOR_SET_LAYOUT     )
+        DESTROY_VK_OBJECT(Fence,                    FENCE                     )
+        DESTROY_VK_OBJECT(Framebuffer,              FRAMEBUFFER               )
+        DESTROY_VK_OBJECT(ImageView,                IMAGE_VIEW                )
+        DESTROY_VK_OBJECT(Pipeline,                 PIPELINE                  )
+        DESTROY_VK_OBJECT(PipelineLayout,           PIPELINE_LAYOUT           )
+        DESTROY_VK_OBJECT(RenderPass,               RENDER_PASS               )
+        DESTROY_VK_OBJECT(Sampler,                  SAMPLER                   )
+        DESTROY_VK_OBJECT(Semaphore,                SEMAPHORE                 )
+        DESTROY_VK_OBJECT(ShaderModule,             SHADER_MODULE             )
+        DESTROY_VK_OBJECT(SwapchainKHR,             SWAPCHAIN_KHR             )
+        DESTROY_VK_OBJECT(PipelineCache,            PIPELINE_CACHE            )
+#undef DESTROY_VK_OBJECT
+
+    case VK_OBJECT_TYPE_BUFFER:
+        if (object.allocation)
+        {
+            vmaDestroyBuffer(memoryAllocator, (VkBuffer)object.handle, object.allocation);
+        }
+        else
+        {
+            vkDestroyBuffer(handle, (VkBuffer)object.handle, nullptr);
+        }
+        break;
+
+    case VK_OBJECT_TYPE_IMAGE:
+        if (object.allocation)
+        {
+            vmaDestroyImage(memoryAllocator, (VkImage)object.handle, object.allocation);
+        }
+        else
+        {
+            vkDestroyImage(handle, (VkImage)object.handle, nullptr);
+        }
+        break;
+
+    default:
+        SLASSERT(false && "Unsupported object type for deferred destruction");
+        break;
     }
 }
 
@@ -424,9 +655,80 @@ VkResult Device::AllocateDescriptorSet(const VkDescriptorSetLayout *pDescriptorS
     return descriptorPool->Allocate(pDescriptorSetLayout, pDescriptorSets);
 }
 
-void Device::FreeDescriptorSet(VkDescriptorSet *pDescriptorSets, uint32_t size)
+void Device::FreeDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, const VkDescriptorSet *pDescriptorSets, uint32_t size)
 {
-    descriptorPool->Free(pDescriptorSets, size);
+    descriptorPool->Free(descriptorSetLayout, pDescriptorSets, size);
+}
+
+VkResult Device::AllocateTransientDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet)
+{
+    return transientDescriptorPool->Allocate(descriptorSetLayout, pDescriptorSet);
+}
+
+void Device::RetireFrame()
+{
+    transientDescriptorPool->Retire(recording.ticket.load(std::memory_order_acquire));
+}
+
+DescriptorStatistics Device::GetDescriptorStatistics()
+{
+    DescriptorStatistics statistics{};
+    descriptorPool->GetStatistics(&statistics);
+    transientDescriptorPool->GetStatistics(&statistics);
+
+    return statistics;
+}
+
+TransferQueue *Device::GetTransferQueue()
+{
+    std::lock_guard lock{ transfer.mutex };
+    if (transfer.resolved)
+    {
+        return transfer.queue;
+    }
+    transfer.resolved = true;
+
+    /** Prefer the dedicated transfer family, otherwise a spare queue of any
+     *  family able to transfer. The first queue of a family is left for the
+     *  rendering, since CreateQueue falls back to it.
+     */
+    DeviceQueue *selected = nullptr;
+    for (auto &family : queues)
+    {
+        for (size_t i = 1; i <= family.size() && !selected; i++)
+        {
+            auto &queue = family[i % family.size()];
+            VkQueueFlags flags = queue.Properties().queueFlags;
+            bool dedicated = (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+            if (dedicated && !queue.IsOccupied())
+            {
+                selected = &queue;
+            }
+        }
+    }
+
+    for (auto &family : queues)
+    {
+        for (size_t i = 1; i < family.size() && !selected; i++)
+        {
+            auto &queue = family[i];
+            if ((queue.Properties().queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && !queue.IsOccupied())
+            {
+                selected = &queue;
+            }
+        }
+    }
+
+    if (!selected)
+    {
+        LOG::WARN("No spare queue for the transfer, static buffers are kept in host visible memory");
+        return nullptr;
+    }
+
+    selected->Occupy();
+    transfer.queue = new TransferQueue{ this, selected };
+
+    return transfer.queue;
 }
 
 }
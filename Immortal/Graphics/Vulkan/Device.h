@@ -4,6 +4,8 @@
 #include "Graphics/LightGraphics.h"
 
 #include "Common.h"
+#include "DescriptorPool.h"
+#include "DestructionQueue.h"
 #include "Instance.h"
 #include "PhysicalDevice.h"
 #include "Queue.h"
@@ -16,6 +18,7 @@
 
 #include <queue>
 #include <future>
+#include <map>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -26,7 +29,11 @@ namespace Vulkan
 {
 
 class DescriptorPool;
+class DescriptorSetCache;
+class TransientDescriptorPool;
+class TransferQueue;
 class Swapchain;
+class TimestampQueryPool;
 class IMMORTAL_API Device : public SuperDevice
 {
 public:
@@ -56,10 +63,8 @@ public:
         vkGetDeviceQueue(handle, queueFamilyIndex, queueIndex, pQueue);
     }
 
-    VkResult WaitIdle()
-    {
-        return vkDeviceWaitIdle(handle);
-    }
+    /** Wait for the device to be idle, holding every queue so nothing is submitted meanwhile */
+    VkResult WaitIdle();
 
     VkResult AllocateMemory(VkMemoryAllocateInfo const *pAllocateInfo, VkDeviceMemory *pMemory, VkAllocationCallbacks const *pAllocator = nullptr)
     {
@@ -1193,21 +1198,67 @@ public:
 
     uint32_t GetMemoryType(uint32_t bits, VkMemoryPropertyFlags properties, VkBool32 *memoryTypeFound = nullptr);
 
-    void DestroyObjects();
+    /** Destroy the objects whose sync point has been retired by the GPU,
+     *  or every pending object after waiting for the device to be idle.
+     */
+    void DestroyObjects(bool wait = false);
 
-public:
-    template <class T>
-    void DestroyAsync(T task)
+    /** Reserve the sync point signaled on the timeline of the queue by the
+     *  next submission to it.
+     */
+    uint64_t AcquireSyncPoint(DeviceQueue *queue);
+
+    /** @ret The sync point that all submissions up to have completed on every queue */
+    uint64_t GetRetiredSyncPoint();
+
+    /** @ret The retired sync point when it was queried last time, without querying the GPU */
+    uint64_t GetLastRetiredSyncPoint() const
     {
-        auto wrapper = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
-        {
-            std::unique_lock<std::mutex> lock{ destroyCoroutine.mutex };
-            destroyCoroutine.queues[destroyCoroutine.working].push([=, this]() -> void {
-                (*wrapper)();
-                });
-        }
+        return timeline.retired.load(std::memory_order_acquire);
     }
 
+    /** @ret The sync point of the last submission */
+    uint64_t GetSyncPoint() const
+    {
+        return timeline.syncPoint.load(std::memory_order_acquire);
+    }
+
+    /** A recording left open for more submissions than this is taken as abandoned,
+     *  and stops holding back the destruction of the objects released since
+     */
+    static constexpr uint64_t MaxRecordingSyncPoints = 1024;
+
+    /** @ret The ticket of a primary command buffer beginning to record */
+    uint64_t OpenRecording();
+
+    /** The command buffer with the ticket was submitted, reset or destroyed */
+    void CloseRecording(uint64_t ticket);
+
+    /** @ret The last ticket up to which all the command buffers have been submitted */
+    uint64_t GetClosedRecording();
+
+    /** End the frame at a submission, which retires the transient descriptor sets allocated in it */
+    void RetireFrame();
+
+    /** @ret The queue for uploading the device local buffers, or null if
+     *  every queue is taken, in which case buffers stay host visible.
+     */
+    TransferQueue *GetTransferQueue();
+
+    /** @ret The transfer queue if any upload has been made, without creating one */
+    TransferQueue *GetCreatedTransferQueue() const
+    {
+        return transfer.queue;
+    }
+
+public:
+    /** Defer the destruction until the command buffers recording at this time,
+     *  on any thread, have been submitted and completed on the GPU. They are the
+     *  last ones that could reference the object. The object is recorded into a
+     *  buffer owned by the calling thread, without locking or allocation.
+     */
+    void DestroyAsync(VkObjectType type, uint64_t object, VmaAllocation allocation = VK_NULL_HANDLE);
+
     VkFormat DepthFormat(bool depthOnly = false)
     {
         return physicalDevice->GetSuitableDepthFormat(depthOnly);
@@ -1239,7 +1290,7 @@ public:
         return vkCreate##T##KHR(handle, pCreateInfo, pAllocator, pObject); \
     }
 
-#define DEFINE_DESTORY_VK_OBJECT(T) \
+#define DEFINE_DESTORY_VK_OBJECT(T, E) \
     void Destroy(Vk##T object, const VkAllocationCallbacks *pAllocator = nullptr) \
     { \
         if (object != VK_NULL_HANDLE) \
@@ -1248,11 +1299,11 @@ public:
             vkDestroy##T(handle, object, pAllocator); \
         } \
     } \
-    void DestroyAsync(Vk##T object, const VkAllocationCallbacks *pAllocator = nullptr) \
+    void DestroyAsync(Vk##T object) \
     { \
         if (object != VK_NULL_HANDLE) \
         { \
-            vkDestroy##T(handle, object, pAllocator); \
+            DestroyAsync(VK_OBJECT_TYPE_##E, (uint64_t)object); \
         } \
     }
 
@@ -1303,23 +1354,23 @@ public:
     DEFINE_CREATE_VK_KHR_OBJECT(VideoSession)
     DEFINE_CREATE_VK_KHR_OBJECT(AccelerationStructure)
 
-    DEFINE_DESTORY_VK_OBJECT(AccelerationStructureKHR)
-    DEFINE_DESTORY_VK_OBJECT(Buffer)
-    DEFINE_DESTORY_VK_OBJECT(CommandPool)
-    DEFINE_DESTORY_VK_OBJECT(DescriptorPool)
-    DEFINE_DESTORY_VK_OBJECT(DescriptorSetLayout)
-    DEFINE_DESTORY_VK_OBJECT(Fence)
-    DEFINE_DESTORY_VK_OBJECT(Framebuffer)
-    DEFINE_DESTORY_VK_OBJECT(Image)
-    DEFINE_DESTORY_VK_OBJECT(ImageView)
-    DEFINE_DESTORY_VK_OBJECT(Pipeline)
-    DEFINE_DESTORY_VK_OBJECT(PipelineLayout)
-    DEFINE_DESTORY_VK_OBJECT(RenderPass)
-    DEFINE_DESTORY_VK_OBJECT(Sampler)
-    DEFINE_DESTORY_VK_OBJECT(Semaphore)
-    DEFINE_DESTORY_VK_OBJECT(ShaderModule)
-    DEFINE_DESTORY_VK_OBJECT(SwapchainKHR)
-    DEFINE_DESTORY_VK_OBJECT(PipelineCache)
+    DEFINE_DESTORY_VK_OBJECT(AccelerationStructureKHR, ACCELERATION_STRUCTURE_KHR)
+    DEFINE_DESTORY_VK_OBJECT(Buffer,                   BUFFER                    )
+    DEFINE_DESTORY_VK_OBJECT(CommandPool,              COMMAND_POOL              )
+    DEFINE_DESTORY_VK_OBJECT(DescriptorPool,           DESCRIPTOR_POOL           )
+    DEFINE_DESTORY_VK_OBJECT(DescriptorSetLayout,      DESCRIPTOR_SET_LAYOUT     )
+    DEFINE_DESTORY_VK_OBJECT(Fence,                    FENCE                     )
+    DEFINE_DESTORY_VK_OBJECT(Framebuffer,              FRAMEBUFFER               )
+    DEFINE_DESTORY_VK_OBJECT(Image,                    IMAGE                     )
+    DEFINE_DESTORY_VK_OBJECT(ImageView,                IMAGE_VIEW                )
+    DEFINE_DESTORY_VK_OBJECT(Pipeline,                 PIPELINE                  )
+    DEFINE_DESTORY_VK_OBJECT(PipelineLayout,           PIPELINE_LAYOUT           )
+    DEFINE_DESTORY_VK_OBJECT(RenderPass,               RENDER_PASS               )
+    DEFINE_DESTORY_VK_OBJECT(Sampler,                  SAMPLER                   )
+    DEFINE_DESTORY_VK_OBJECT(Semaphore,                SEMAPHORE                 )
+    DEFINE_DESTORY_VK_OBJECT(ShaderModule,             SHADER_MODULE             )
+    DEFINE_DESTORY_VK_OBJECT(SwapchainKHR,             SWAPCHAIN_KHR             )
+    DEFINE_DESTORY_VK_OBJECT(PipelineCache,            PIPELINE_CACHE            )
 
     DEFINE_RESET_OBJECT(CommandPool)
     DEFINE_RESET_OBJECT(DescriptorPool)
@@ -1333,7 +1384,7 @@ public:
     DEFINE_BIND_MEMORY(Buffer)
     DEFINE_BIND_MEMORY(Image)
 
-#define DEFINE_VMA_CREATE_DESTROY_OBJECT(T) \
+#define DEFINE_VMA_CREATE_DESTROY_OBJECT(T, E) \
     VkResult Create##T(const Vk##T##CreateInfo *pCreateInfo, const VmaAllocationCreateInfo *pAllocationCreateInfo, Vk##T *pObject,VmaAllocation *pAllocation, VmaAllocationInfo *pAllocationInfo = nullptr) \
     { \
         return vmaCreate##T(memoryAllocator, pCreateInfo, pAllocationCreateInfo, pObject, pAllocation, pAllocationInfo); \
@@ -1349,10 +1400,17 @@ public:
     void Destroy(Vk##T object, VmaAllocation allocation) \
     { \
         vmaDestroy##T(memoryAllocator, object, allocation); \
+    } \
+    void DestroyAsync(Vk##T object, VmaAllocation allocation) \
+    { \
+        if (object != VK_NULL_HANDLE) \
+        { \
+            DestroyAsync(VK_OBJECT_TYPE_##E, (uint64_t)object, allocation); \
+        } \
     }
 
-    DEFINE_VMA_CREATE_DESTROY_OBJECT(Buffer)
-    DEFINE_VMA_CREATE_DESTROY_OBJECT(Image)
+    DEFINE_VMA_CREATE_DESTROY_OBJECT(Buffer, BUFFER)
+    DEFINE_VMA_CREATE_DESTROY_OBJECT(Image,  IMAGE )
 
 public:
     template <class T>
@@ -1370,11 +1428,27 @@ public:
 
     VkResult AllocateDescriptorSet(const VkDescriptorSetLayout *pDescriptorSetLayout, VkDescriptorSet *pDescriptorSets);
 
-    void FreeDescriptorSet(VkDescriptorSet *pDescriptorSets, uint32_t size = 1);
+    void FreeDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, const VkDescriptorSet *pDescriptorSets, uint32_t size = 1);
+
+    void FreeDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet descriptorSet)
+    {
+        FreeDescriptorSet(descriptorSetLayout, &descriptorSet, 1);
+    }
+
+    /** Allocate a set only valid in the current frame, which is never freed explicitly */
+    VkResult AllocateTransientDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet *pDescriptorSet);
+
+    /** @ret The counters of the descriptor sets allocated, to check the churn once the frames are recycled */
+    DescriptorStatistics GetDescriptorStatistics();
 
-    void FreeDescriptorSet(VkDescriptorSet descriptorSet)
+    DescriptorSetCache *GetDescriptorSetCache() const
     {
-        FreeDescriptorSet(&descriptorSet, 1);
+        return descriptorSetCache;
+    }
+
+    TimestampQueryPool *GetTimestampQueryPool() const
+    {
+        return timestampQueryPool;
     }
 
     VkResult Wait()
@@ -1503,17 +1577,50 @@ protected:
 
     URef<DescriptorPool> descriptorPool;
 
+    URef<TransientDescriptorPool> transientDescriptorPool;
+
+    URef<DescriptorSetCache> descriptorSetCache;
+
+    URef<TimestampQueryPool> timestampQueryPool;
+
     std::mutex mutex;
     std::unordered_map<uint32_t, URef<CommandPool>> commandPools;
 
     bool isSubmitted = false;
 
     struct {
-        std::array<std::queue<std::function<void()>>, 6> queues;
         std::mutex mutex;
-        uint32_t working = 0;
-        uint32_t freeing = 1;
-    } destroyCoroutine;
+        std::atomic<uint64_t> syncPoint{ 0 };
+        std::atomic<uint64_t> retired{ 0 };
+    } timeline;
+
+    struct {
+        std::mutex mutex;
+        std::vector<URef<DestructionQueue>> queues;
+    } destruction;
+
+    /** The tickets of the primary command buffers between beginning and submission,
+     *  with the sync point when they began
+     */
+    struct {
+        std::mutex mutex;
+        std::map<uint64_t, uint64_t> open;
+        std::atomic<uint64_t> ticket{ 0 };
+    } recording;
+
+    struct {
+        std::mutex mutex;
+        URef<TransferQueue> queue;
+        bool resolved = false;
+    } transfer;
+
+    /** Distinguish the devices for the destruction queues cached per thread */
+    uint64_t serial = 0;
+
+protected:
+    DestructionQueue *GetDestructionQueue();
+
+    void Destroy(const DestructionQueue::Object &object);
 };
 }
 }
@@ -132,22 +132,7 @@ void Image::Release()
 {
     if (handle != VK_NULL_HANDLE && memory != VK_NULL_HANDLE && device != nullptr)
     {
-        struct {
-            Device *device = nullptr;
-            VmaAllocation memory = nullptr;
-            VkImage image = VK_NULL_HANDLE;
-        } dpack{
-            device,
-            memory,
-            handle
-        };
-
-        device->DestroyAsync([dpack]() {
-            dpack.device->Destroy(
-                dpack.image,
-                dpack.memory
-            );
-            });
+        device->DestroyAsync(handle, memory);
 
         handle = VK_NULL_HANDLE;
 		device = nullptr;
@@ -102,8 +102,8 @@ enum class InternalExtension : uint64_t
 {
     None = 0,
     DebugUtils = BIT(0),
-    HeadlessSurface = BIT(1),
-    GetPhysicalDeviceProperties2 = BIT(2)
+    GetPhysicalDeviceProperties2 = BIT(1),
+    HeadlessSurface = BIT(2)
 };
 
 SL_ENABLE_BITWISE_OPERATOR(InternalExtension)
@@ -150,6 +150,13 @@ Instance::Instance(const char                                   *applicationName
         }
     }
 
+    if (headless && std::find_if(availableExtension.begin(), availableExtension.end(), [] (VkExtensionProperties &availableExtension) {
+            return Equals(availableExtension.extensionName, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        }) != availableExtension.end())
+    {
+        extensionsFlags |= InternalExtension::HeadlessSurface;
+    }
+
     if (headless && !(extensionsFlags & InternalExtension::HeadlessSurface))
     {
         LOG::WARN("{} is not available. Disabling swapchain creation", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
@@ -292,7 +299,8 @@ SuperDevice *Instance::CreateDevice(int deviceId)
 	physicalDevice->Activate(Vulkan::PhysicalDevice::Feature::IndependentBlend);
 
 	const std::unordered_map<const char *, bool> deviceExtensions{
-	    { VK_KHR_SWAPCHAIN_EXTENSION_NAME,                       false },
+	    /** Optional without surfaces, so that offscreen rendering runs on drivers with no presentation support */
+	    { VK_KHR_SWAPCHAIN_EXTENSION_NAME,                       !IsEnabled(VK_KHR_SURFACE_EXTENSION_NAME) },
 	    { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,              false },
 #ifdef __APPLE__                                                 
 	    {VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME,               false },
@@ -42,7 +42,7 @@ void Pipeline::Destroy()
 {
     if (device)
     {
-	    device->Destroy(descriptorSetLayout);
+	    device->DestroyAsync(descriptorSetLayout);
         device->Destroy((VkPipelineLayout)pipelineLayout);
         device->DestroyAsync(handle);
         handle = VK_NULL_HANDLE;
@@ -145,7 +145,7 @@ void GraphicsPipeline::Construct(SuperShader **_ppShader, size_t shaderCount, co
     VkVertexInputBindingDescription vertexInputBindingDescription = {
         .binding   = 0,
 		.stride    = description.GetStride(),
-		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+		.inputRate = description.GetInputRate() == InputRate::Instance ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX,
     };
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {
@@ -4,6 +4,7 @@
 #include "GPUEvent.h"
 #include "RenderTarget.h"
 #include "Swapchain.h"
+#include "TransferQueue.h"
 
 namespace Immortal
 {
@@ -38,7 +39,8 @@ DeviceQueue::~DeviceQueue()
 
 Queue::Queue(DeviceQueue *queue) :
     queue{ queue },
-    executionCompleteSemaphores{}
+    executionCompleteSemaphores{},
+    transferSyncPoint{}
 {
 
 }
@@ -61,6 +63,7 @@ Queue::~Queue()
 void Queue::WaitIdle(uint32_t timeout)
 {
 	(void)timeout;
+    std::lock_guard lock{ queue->GetMutex() };
 	Check(queue->WaitIdle());
 }
 
@@ -69,6 +72,7 @@ void Queue::Wait(SuperGPUEvent *_pEvent)
 	GPUEvent *pEvent = InterpretAs<GPUEvent>(_pEvent);
     if (!pEvent->IsTimeline())
     {
+        std::lock_guard lock{ queue->GetMutex() };
 		waitSemaphores.emplace_back(pEvent->GetSemaphore());
 		waitPipelineStageFlags.emplace_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
     }
@@ -90,35 +94,60 @@ void Queue::Submit(SuperCommandBuffer **_ppCommandBuffer, size_t count, SuperGPU
 		commandBuffers[i] = *ppCommandBuffer[i];
     }
 
+    /** The last one signals the timeline of the queue for deferred destruction */
+    Device *device = queue->GetDevice();
+    uint32_t signalCount = eventCount + 1;
+
     LightArray<VkSemaphore> signalSemaphores;
-	signalSemaphores.resize(eventCount);
+	signalSemaphores.resize(signalCount);
 
     LightArray<uint64_t> signalValues;
-	signalValues.resize(eventCount);
+	signalValues.resize(signalCount);
     GPUEvent **ppSignalEvents = (GPUEvent **)_ppSignalEvents;
     for (size_t i = 0; i < eventCount; i++)
     {
 		signalSemaphores[i] = *ppSignalEvents[i];
 		signalValues[i] = ppSignalEvents[i]->GetIncrement();
     }
+    /** The waits and the transfer sync point are shared with the other threads submitting to the queue */
+    std::unique_lock lock{ queue->GetMutex() };
+    signalValues[eventCount]     = device->AcquireSyncPoint(queue);
+    signalSemaphores[eventCount] = queue->GetTimeline();
+
+    if (_swapchain)
+    {
+		Swapchain *swapchain = InterpretAs<Swapchain>(_swapchain);
+		waitSemaphores.emplace_back(swapchain->GetAcquiredImageReadySemaphore());
+		waitPipelineStageFlags.emplace_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
 
+    /** The values of the binary semaphores are ignored */
     LightArray<uint64_t> waitSemaphoreValues{};
+	waitSemaphoreValues.resize(waitSemaphores.size());
+    for (auto &value : waitSemaphoreValues)
+    {
+        value = 0;
+    }
+
+    /** Wait for the buffers uploaded since the last submission */
+    TransferQueue *transferQueue = device->GetCreatedTransferQueue();
+    if (transferQueue && transferQueue->GetSyncPoint() > transferSyncPoint)
+    {
+		transferSyncPoint = transferQueue->GetSyncPoint();
+		waitSemaphores.emplace_back(transferQueue->GetTimeline());
+		waitPipelineStageFlags.emplace_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		waitSemaphoreValues.emplace_back(transferSyncPoint);
+    }
+
 	VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{
         .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
         .pNext                     = nullptr,
-        .waitSemaphoreValueCount   = uint32_t(waitSemaphores.size()),
+        .waitSemaphoreValueCount   = uint32_t(waitSemaphoreValues.size()),
 	    .pWaitSemaphoreValues      = waitSemaphoreValues.data(),
-        .signalSemaphoreValueCount = eventCount,
+        .signalSemaphoreValueCount = signalCount,
         .pSignalSemaphoreValues    = signalValues.data()
     };
 
-    if (_swapchain)
-    {
-		Swapchain *swapchain = InterpretAs<Swapchain>(_swapchain);
-		waitSemaphores.emplace_back(swapchain->GetAcquiredImageReadySemaphore());
-		waitPipelineStageFlags.emplace_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    }
-
 	VkSubmitInfo submitInfo{
         .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
         .pNext                = &timelineSemaphoreSubmitInfo,
@@ -127,14 +156,24 @@ void Queue::Submit(SuperCommandBuffer **_ppCommandBuffer, size_t count, SuperGPU
         .pWaitDstStageMask    = waitPipelineStageFlags.data(),
         .commandBufferCount   = uint32_t(count),
         .pCommandBuffers      = commandBuffers.data(),
-        .signalSemaphoreCount = eventCount,
+        .signalSemaphoreCount = signalCount,
         .pSignalSemaphores    = signalSemaphores.data()
     };
 
     Check(queue->Submit(1, &submitInfo, VK_NULL_HANDLE));
 
+    for (size_t i = 0; i < count; i++)
+    {
+        ppCommandBuffer[i]->OnSubmit();
+    }
+
     waitSemaphores.resize(0);
 	waitPipelineStageFlags.resize(0);
+    lock.unlock();
+
+    device->RetireFrame();
+    device->DestroyObjects();
+    device->GetTimestampQueryPool()->Resolve();
 }
 
 void Queue::Present(SuperSwapchain *_swapchain, SuperGPUEvent **_ppSignalEvents, uint32_t eventCount)
@@ -162,7 +201,11 @@ void Queue::Present(SuperSwapchain *_swapchain, SuperGPUEvent **_ppSignalEvents,
         .pResults           = nullptr,
     };
 
-    VkResult result = queue->Present(&presentInfo);
+    VkResult result = VK_SUCCESS;
+    {
+        std::lock_guard lock{ queue->GetMutex() };
+        result = queue->Present(&presentInfo);
+    }
     if (result != VK_ERROR_OUT_OF_DATE_KHR)
     {
 		Check(result);
@@ -9,6 +9,8 @@
 #include "Graphics/GPUEvent.h"
 #include "Graphics/Swapchain.h"
 
+#include <mutex>
+
 namespace Immortal
 {
 namespace Vulkan
@@ -134,6 +136,23 @@ public:
 		return used;
     }
 
+    /** The timeline semaphore signaled by every submission to this queue,
+     *  with the device sync point of the submission.
+     */
+    TimelineSemaphore &GetTimeline()
+    {
+        return timeline;
+    }
+
+    /** Held from reserving the sync point of a submission until it is submitted,
+     *  so the values reach the timeline in the order reserved. It also guards the
+     *  VkQueue, which Vulkan requires to be externally synchronized.
+     */
+    std::mutex &GetMutex()
+    {
+        return mutex;
+    }
+
     void Swap(DeviceQueue &other)
     {
 		Handle::Swap(other);
@@ -142,6 +161,7 @@ public:
 		std::swap(index,       other.index      );
 		std::swap(presented,   other.presented  );
         std::swap(properties,  other.properties );
+        timeline.Swap(other.timeline);
     }
 
 protected:
@@ -156,6 +176,10 @@ protected:
     VkQueueFamilyProperties properties{};
 
     std::atomic<bool> used;
+
+    TimelineSemaphore timeline;
+
+    std::mutex mutex;
 };
 
 class IMMORTAL_API Queue : public SuperQueue
@@ -191,6 +215,7 @@ public:
 		std::swap(executionCompleteSemaphores, other.executionCompleteSemaphores);
 		std::swap(waitSemaphores,              other.waitSemaphores             );
 		std::swap(waitPipelineStageFlags,      other.waitPipelineStageFlags     );
+		std::swap(transferSyncPoint,           other.transferSyncPoint          );
     }
 
 protected:
@@ -198,9 +223,13 @@ protected:
 
     std::vector<Semaphore> executionCompleteSemaphores;
 
+    /** The waits of the next submission, guarded by the lock of the device queue */
     LightArray<VkSemaphore> waitSemaphores;
 
     LightArray<VkPipelineStageFlags> waitPipelineStageFlags;
+
+    /** The last upload on the transfer queue waited by this queue, guarded by the lock of the device queue */
+    uint64_t transferSyncPoint;
 };
 
 }
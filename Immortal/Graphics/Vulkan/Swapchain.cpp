@@ -282,7 +282,8 @@ void Swapchain::Destroy()
 	if (device)
     {
 		renderTargets.clear();
-        device->DestroyAsync(handle);
+        /** The swapchain must be gone before the surface */
+        device->Destroy(handle);
 		surface.Release(device->Get<PhysicalDevice>().Get<Instance>());
         handle = VK_NULL_HANDLE;
 
@@ -0,0 +1,274 @@
+#include "TimestampQueryPool.h"
+
+#include "Device.h"
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+/** The zone of a whole command buffer, the events recorded are nested in it */
+static const char CommandBufferZone[] = "GPU";
+
+static constexpr uint32_t InvalidEvent = ~0U;
+
+TimestampQueryPool::TimestampQueryPool(Device *device) :
+    device{ device },
+    pools(PoolCount),
+    next{ 0 },
+    masks{},
+    period{ device->Get<PhysicalDevice>().Properties.limits.timestampPeriod },
+    track{ Instrumentor::CreateTrack("GPU") },
+    offset{ INT64_MIN },
+    calibrated{ device->IsEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) }
+{
+    VkQueryPoolCreateInfo createInfo{
+        .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext              = nullptr,
+        .flags              = 0,
+        .queryType          = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount         = QueryCount,
+        .pipelineStatistics = 0,
+    };
+
+    for (auto &properties : device->Get<PhysicalDevice>().QueueFamilyProperties)
+    {
+        uint32_t validBits = properties.timestampValidBits;
+        masks.emplace_back(validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1);
+    }
+
+    for (auto &pool : pools)
+    {
+        Check(device->CreateQueryPool(&createInfo, &pool.handle));
+        pool.state = State::Free;
+        pool.used  = 0;
+        pool.mask  = 0;
+        pool.ended = 0;
+    }
+    pending.reserve(PoolCount);
+}
+
+TimestampQueryPool::~TimestampQueryPool()
+{
+    for (auto &pool : pools)
+    {
+        device->DestroyQueryPool(pool.handle, nullptr);
+    }
+}
+
+TimestampQueryPool::Pool *TimestampQueryPool::Acquire(CommandBuffer *commandBuffer, uint32_t queueFamilyIndex)
+{
+    if (queueFamilyIndex >= masks.size() || !masks[queueFamilyIndex])
+    {
+        return nullptr;
+    }
+
+    Pool *pool = nullptr;
+    {
+        std::lock_guard lock{ mutex };
+        for (uint32_t i = 0; i < PoolCount; i++)
+        {
+            auto &candidate = pools[(next + i) % PoolCount];
+            if (candidate.state == State::Free)
+            {
+                next = (next + i + 1) % PoolCount;
+                candidate.state = State::Recording;
+                pool = &candidate;
+                break;
+            }
+        }
+    }
+
+    /** All pools are still on the GPU, this command buffer goes without timing rather than waiting */
+    if (!pool)
+    {
+        return nullptr;
+    }
+
+    /** The first two queries are the begin and the end of the command buffer */
+    pool->used = 2;
+    pool->mask = masks[queueFamilyIndex];
+    pool->events.clear();
+    pool->stack.clear();
+
+    commandBuffer->ResetQueryPool(pool->handle, 0, QueryCount);
+    commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool->handle, 0);
+
+    return pool;
+}
+
+void TimestampQueryPool::End(CommandBuffer *commandBuffer, Pool *pool)
+{
+    /** Every query used must be written, or the results of the pool would never be available */
+    for (auto it = pool->stack.rbegin(); it != pool->stack.rend(); ++it)
+    {
+        if (*it != InvalidEvent)
+        {
+            commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool->handle, pool->events[*it].begin + 1);
+        }
+    }
+    pool->stack.clear();
+
+    commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool->handle, 1);
+}
+
+void TimestampQueryPool::Submit(Pool *pool)
+{
+    pool->ended = Instrumentor::Now();
+
+    std::lock_guard lock{ mutex };
+    pool->state = State::Pending;
+    pending.emplace_back(pool);
+}
+
+void TimestampQueryPool::Release(Pool *pool)
+{
+    std::lock_guard lock{ mutex };
+    if (pool->state == State::Recording)
+    {
+        pool->state = State::Free;
+    }
+}
+
+void TimestampQueryPool::BeginEvent(CommandBuffer *commandBuffer, Pool *pool, std::string_view name)
+{
+    if (pool->used + 2 > QueryCount)
+    {
+        pool->stack.emplace_back(InvalidEvent);
+        return;
+    }
+
+    pool->stack.emplace_back(uint32_t(pool->events.size()));
+    auto &event = pool->events.emplace_back(Event{
+        .name  = Instrumentor::Intern(name),
+        .begin = pool->used,
+        .depth = uint32_t(pool->stack.size()),
+    });
+    pool->used += 2;
+
+    commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool->handle, event.begin);
+}
+
+void TimestampQueryPool::EndEvent(CommandBuffer *commandBuffer, Pool *pool)
+{
+    if (pool->stack.empty())
+    {
+        LOG::WARN("EndEvent called without a matching BeginEvent");
+        return;
+    }
+
+    uint32_t index = pool->stack.back();
+    pool->stack.pop_back();
+    if (index != InvalidEvent)
+    {
+        commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool->handle, pool->events[index].begin + 1);
+    }
+}
+
+bool TimestampQueryPool::Calibrate()
+{
+    VkCalibratedTimestampInfoEXT timestampInfo{
+        .sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+        .pNext      = nullptr,
+        .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT,
+    };
+
+    /** Only the device domain is read, the clock of Now() is sampled around it instead of mapping the host domains of each platform */
+    uint64_t timestamp = 0;
+    uint64_t deviation = 0;
+    uint64_t before = Instrumentor::Now();
+    if (device->GetCalibratedTimestampsEXT(1, &timestampInfo, &timestamp, &deviation) != VK_SUCCESS)
+    {
+        return false;
+    }
+    uint64_t after = Instrumentor::Now();
+
+    offset = int64_t(before + (after - before) / 2) - int64_t(Convert(timestamp, ~0ULL));
+
+    return true;
+}
+
+void TimestampQueryPool::Resolve()
+{
+    std::lock_guard lock{ mutex };
+    if (pending.empty())
+    {
+        return;
+    }
+
+    uint64_t now = Instrumentor::Now();
+    bool recalibrated = false;
+
+    std::erase_if(pending, [&] (Pool *pool) {
+        timestamps.resize(pool->used);
+        VkResult result = device->GetQueryPoolResults(pool->handle, 0, pool->used, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_NOT_READY)
+        {
+            return false;
+        }
+
+        pool->state = State::Free;
+        if (result != VK_SUCCESS)
+        {
+            return true;
+        }
+
+        uint64_t begin = Convert(timestamps[0], pool->mask);
+        uint64_t end   = Convert(timestamps[1], pool->mask);
+        if (calibrated && !recalibrated)
+        {
+            recalibrated = true;
+            calibrated = Calibrate();
+        }
+        if (!calibrated)
+        {
+            /**
+             * Without calibrated timestamps, the GPU began after the recording
+             * ended and is done by now. The offset is the tightest lower bound
+             * seen so far, kept below the upper bound of this command buffer.
+             */
+            offset = std::max(offset, int64_t(pool->ended) - int64_t(begin));
+            offset = std::min(offset, int64_t(now) - int64_t(end));
+        }
+
+        uint64_t root = Instrumentor::Path(0, CommandBufferZone);
+        zones.clear();
+        zones.emplace_back(ProfileZone{
+            .Name   = CommandBufferZone,
+            .Begin  = uint64_t(begin + offset),
+            .End    = uint64_t(end + offset),
+            .Path   = root,
+            .Parent = 0,
+            .Depth  = 0,
+            .Thread = track,
+        });
+
+        /** The events are in the order begun, so the parent of an event is the last one less deep before it */
+        uint64_t paths[64] = { root };
+        for (auto &event : pool->events)
+        {
+            uint32_t depth  = std::min<uint32_t>(event.depth, 63);
+            uint64_t parent = paths[depth - 1];
+            paths[depth] = Instrumentor::Path(parent, event.name);
+
+            zones.emplace_back(ProfileZone{
+                .Name   = event.name,
+                .Begin  = uint64_t(Convert(timestamps[event.begin], pool->mask) + offset),
+                .End    = uint64_t(Convert(timestamps[event.begin + 1], pool->mask) + offset),
+                .Path   = paths[depth],
+                .Parent = parent,
+                .Depth  = depth,
+                .Thread = track,
+            });
+        }
+        Instrumentor::Submit(zones.data(), zones.size());
+
+        return true;
+    });
+}
+
+}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common.h"
+#include "Shared/Instrumentor.h"
+
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+class Device;
+class CommandBuffer;
+
+/**
+ * @brief A ring of timestamp query pools. A command buffer takes a pool while
+ *  recording and writes a pair of timestamps around itself and each of its
+ *  events. The pools submitted are read back without waiting once the GPU is
+ *  done, then the timestamps go to the Instrumentor under the GPU track.
+ */
+class TimestampQueryPool
+{
+public:
+    static constexpr uint32_t PoolCount = 32;
+
+    static constexpr uint32_t QueryCount = 512;
+
+    enum class State
+    {
+        Free,
+        Recording,
+        Pending,
+    };
+
+    /** The end of an event is the query right after its begin */
+    struct Event
+    {
+        const char *name;
+        uint32_t    begin;
+        uint32_t    depth;
+    };
+
+    struct Pool
+    {
+        VkQueryPool handle;
+
+        State state;
+
+        uint32_t used;
+
+        /** The valid bits of the timestamps of the queue family recording */
+        uint64_t mask;
+
+        /** The time of Now() when the command buffer was submitted, before the GPU could have begun */
+        uint64_t ended;
+
+        std::vector<Event> events;
+
+        /** The events open, all of which are closed when the recording ends */
+        std::vector<uint32_t> stack;
+    };
+
+public:
+    TimestampQueryPool(Device *device);
+
+    ~TimestampQueryPool();
+
+    /** @ret A pool for the command buffer recording, or null if all are in flight or the queue family has no timestamps */
+    Pool *Acquire(CommandBuffer *commandBuffer, uint32_t queueFamilyIndex);
+
+    /** The command buffer ended, the pool stays with it until submitted */
+    void End(CommandBuffer *commandBuffer, Pool *pool);
+
+    /** The command buffer was submitted, the pool is resolved after it is executed */
+    void Submit(Pool *pool);
+
+    /** The command buffer was reset, begun again or destroyed without being submitted */
+    void Release(Pool *pool);
+
+    void BeginEvent(CommandBuffer *commandBuffer, Pool *pool, std::string_view name);
+
+    void EndEvent(CommandBuffer *commandBuffer, Pool *pool);
+
+    /** Read back the pools executed, never waits for the GPU */
+    void Resolve();
+
+protected:
+    uint64_t Convert(uint64_t timestamp, uint64_t mask) const
+    {
+        return uint64_t(double(timestamp & mask) * period);
+    }
+
+    bool Calibrate();
+
+protected:
+    Device *device;
+
+    std::mutex mutex;
+
+    std::vector<Pool> pools;
+
+    /** The pools in the order submitted */
+    std::vector<Pool *> pending;
+
+    uint32_t next;
+
+    /** Indexed by the queue family, 0 for those not supporting timestamps */
+    std::vector<uint64_t> masks;
+
+    /** Nanoseconds per tick */
+    double period;
+
+    uint32_t track;
+
+    /** Added to the GPU time in nanoseconds to get the time of Now() */
+    int64_t offset;
+
+    bool calibrated;
+
+    std::vector<uint64_t> timestamps;
+
+    std::vector<ProfileZone> zones;
+};
+
+}
+}
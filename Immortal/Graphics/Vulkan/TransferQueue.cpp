@@ -0,0 +1,120 @@
+#include "TransferQueue.h"
+#include "Buffer.h"
+#include "Device.h"
+#include "Queue.h"
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+TransferQueue::TransferQueue(Device *device, DeviceQueue *queue) :
+    device{ device },
+    queue{ queue },
+    syncPoint{ 0 }
+{
+    commandPool = new CommandPool{ device, 0, queue->GetFamilyIndex(), VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT };
+}
+
+TransferQueue::~TransferQueue()
+{
+    for (auto &[syncPoint, commandBuffer] : inFlightCommandBuffers)
+    {
+        commandPool->Release(&commandBuffer, 1);
+    }
+    inFlightCommandBuffers.clear();
+    commandPool.Reset();
+
+    queue->DeOccupy();
+}
+
+uint64_t TransferQueue::Upload(Buffer *dst, Buffer *src, VkDeviceSize size)
+{
+    std::lock_guard lock{ mutex };
+
+    VkCommandBuffer commandBuffer = AcquireCommandBuffer();
+
+    VkCommandBufferBeginInfo beginInfo{
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+    Check(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    VkBufferCopy region{
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size      = size,
+    };
+    vkCmdCopyBuffer(commandBuffer, *src, *dst, 1, &region);
+    Check(vkEndCommandBuffer(commandBuffer));
+
+    /** Held under the lock of the queue, so the values signaled on the timeline keep increasing */
+    std::lock_guard queueLock{ queue->GetMutex() };
+    uint64_t value = device->AcquireSyncPoint(queue);
+    VkSemaphore timeline = queue->GetTimeline();
+
+    VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext                     = nullptr,
+        .waitSemaphoreValueCount   = 0,
+        .pWaitSemaphoreValues      = nullptr,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues    = &value,
+    };
+
+    VkSubmitInfo submitInfo{
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = &timelineSemaphoreSubmitInfo,
+        .waitSemaphoreCount   = 0,
+        .pWaitSemaphores      = nullptr,
+        .pWaitDstStageMask    = nullptr,
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores    = &timeline,
+    };
+    Check(queue->Submit(1, &submitInfo, VK_NULL_HANDLE));
+
+    inFlightCommandBuffers.push_back({ value, commandBuffer });
+    syncPoint.store(value, std::memory_order_release);
+
+    return value;
+}
+
+uint32_t TransferQueue::GetFamilyIndex() const
+{
+    return queue->GetFamilyIndex();
+}
+
+VkSemaphore TransferQueue::GetTimeline() const
+{
+    return queue->GetTimeline();
+}
+
+VkCommandBuffer TransferQueue::AcquireCommandBuffer()
+{
+    if (!inFlightCommandBuffers.empty())
+    {
+        uint64_t completed = 0;
+        Check(device->GetCompletion(queue->GetTimeline(), &completed));
+
+        auto &front = inFlightCommandBuffers.front();
+        if (front.syncPoint <= completed)
+        {
+            VkCommandBuffer commandBuffer = front.commandBuffer;
+            inFlightCommandBuffers.pop_front();
+            Check(vkResetCommandBuffer(commandBuffer, 0));
+            return commandBuffer;
+        }
+    }
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    Check(commandPool->Allocate(&commandBuffer, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY));
+
+    return commandBuffer;
+}
+
+}
+}
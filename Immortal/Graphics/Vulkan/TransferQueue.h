@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Common.h"
+#include "CommandPool.h"
+#include "Shared/IObject.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace Immortal
+{
+namespace Vulkan
+{
+
+class Device;
+class DeviceQueue;
+class Buffer;
+
+/**
+ * @brief Uploads the initial data of the device local resources on a queue
+ *  not used for rendering. Each upload signals the timeline of the queue,
+ *  and the queues submitting the work afterwards wait for the last value,
+ *  so the draws never read a buffer before its copy has completed.
+ */
+class TransferQueue
+{
+public:
+    struct InFlightCommandBuffer
+    {
+        uint64_t        syncPoint;
+        VkCommandBuffer commandBuffer;
+    };
+
+public:
+    TransferQueue(Device *device, DeviceQueue *queue);
+
+    ~TransferQueue();
+
+    /** @ret The sync point signaled when the copy has completed */
+    uint64_t Upload(Buffer *dst, Buffer *src, VkDeviceSize size);
+
+    uint32_t GetFamilyIndex() const;
+
+    VkSemaphore GetTimeline() const;
+
+    /** @ret The sync point of the last upload submitted */
+    uint64_t GetSyncPoint() const
+    {
+        return syncPoint.load(std::memory_order_acquire);
+    }
+
+protected:
+    VkCommandBuffer AcquireCommandBuffer();
+
+protected:
+    Device *device;
+
+    DeviceQueue *queue;
+
+    URef<CommandPool> commandPool;
+
+    std::deque<InFlightCommandBuffer> inFlightCommandBuffers;
+
+    std::atomic<uint64_t> syncPoint;
+
+    std::mutex mutex;
+};
+
+}
+}
@@ -44,7 +44,8 @@ GuiLayer::GuiLayer(Device *device, Queue *queue, Window *window, Swapchain *swap
     queue{ queue },
     swapchain{ swapchain },
     window{ window },
-    platformSpecficWindow{}
+    platformSpecficWindow{},
+    profilerPanel{ new ProfilerPanel }
 {
     This = this;
 
@@ -249,6 +250,15 @@ void GuiLayer::OnEvent(Event &e)
         e.Handled |= e.IsInCategory(Event::Category::Keyboard) & io.WantCaptureKeyboard;
     }
 
+    if (e.GetType() == Event::Type::KeyPressed)
+    {
+        auto &keyEvent = (KeyPressedEvent &)e;
+        if (keyEvent.GetKeyCode() == KeyCode::F11 && !keyEvent.RepeatCount())
+        {
+            profilerPanel->Toggle();
+        }
+    }
+
     if (e.GetType() == Event::Type::WindowDragDrop)
     {
 		WindowDragDropEvent &dragDrapEvent = (WindowDragDropEvent &)e;
@@ -347,6 +357,7 @@ void GuiLayer::Render()
 {
     ImGui::PushFont(NotoSans.Light);
     dockspace->Render();
+    profilerPanel->Render();
     ImGui::PopFont();
 
     static char title[128] = { 0 };
@@ -391,7 +402,7 @@ void GuiLayer::Render()
     Application::SetTitle(title);
 }
 
-void GuiLayer::SubmitRenderDrawCommands(CommandBuffer *commandBuffer)
+void GuiLayer::SubmitRenderDrawCommands(CommandBuffer *commandBuffer, GPUEvent *gpuEvent)
 {
     auto &io = ImGui::GetIO();
 
@@ -399,7 +410,7 @@ void GuiLayer::SubmitRenderDrawCommands(CommandBuffer *commandBuffer)
     auto height = window->GetHeight();
     io.DisplaySize = { (float)width, (float)height };
 
-    ImGui_ImplImmortal_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    ImGui_ImplImmortal_RenderDrawData(ImGui::GetDrawData(), commandBuffer, gpuEvent);
 
     // Update and Render additional Platform Windows
     if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
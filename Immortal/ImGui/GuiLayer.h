@@ -10,6 +10,7 @@
 #include "Event/KeyEvent.h"
 #include "Event/MouseEvent.h"
 #include "Graphics/LightGraphics.h"
+#include "ProfilerPanel.h"
 
 #define DEFINE_CPP_STRING_API(FN_NAME, ...) \
     template <class...  Args> \
@@ -122,7 +123,7 @@ public:
 
     virtual void End();
 
-    void SubmitRenderDrawCommands(CommandBuffer *commandBuffer);
+    void SubmitRenderDrawCommands(CommandBuffer *commandBuffer, GPUEvent *gpuEvent = nullptr);
 
     void Render();
 
@@ -201,6 +202,9 @@ protected:
     static GuiLayer *This;
 
     URef<WWindow> themeEditor;
+
+    /** Toggled by F11 */
+    URef<ProfilerPanel> profilerPanel;
 };
 
 using SuperGuiLayer = GuiLayer;
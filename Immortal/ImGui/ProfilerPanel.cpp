@@ -0,0 +1,166 @@
+#include "ProfilerPanel.h"
+
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <algorithm>
+
+namespace Immortal
+{
+
+ProfilerPanel::ProfilerPanel(const std::string &capturePath) :
+    capturePath{ capturePath },
+    frame{},
+    frameTimes{}
+{
+
+}
+
+void ProfilerPanel::Render()
+{
+    if (!visible)
+    {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2{ 480.0f, 520.0f }, ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", &visible))
+    {
+        ImGui::End();
+        return;
+    }
+
+    bool enabled = Instrumentor::IsEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+    {
+        Instrumentor::SetEnabled(enabled);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    if (!Instrumentor::IsCapturing())
+    {
+        if (ImGui::Button("Capture"))
+        {
+            Instrumentor::BeginCapture();
+        }
+    }
+    else if (ImGui::Button("Stop Capture"))
+    {
+        Instrumentor::EndCapture(capturePath);
+    }
+
+    const auto &frames = Instrumentor::GetFrames();
+    if (frames.empty())
+    {
+        ImGui::TextUnformatted("No frame profiled yet");
+        ImGui::End();
+        return;
+    }
+
+    if (!paused)
+    {
+        frame = frames.back();
+    }
+
+    float maxFrameTime = 0.0f;
+    frameTimes.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        frameTimes[i] = float(frames[i].Milliseconds());
+        maxFrameTime = std::max(maxFrameTime, frameTimes[i]);
+    }
+
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%.3f ms (max %.3f ms)", frameTimes.back(), maxFrameTime);
+    ImGui::PlotHistogram("##FrameTimes", frameTimes.data(), int(frameTimes.size()), 0, overlay, 0.0f, maxFrameTime * 1.2f, ImVec2{ -1.0f, 64.0f });
+    if (ImGui::IsItemClicked())
+    {
+        ImVec2 min = ImGui::GetItemRectMin();
+        float width = std::max(ImGui::GetItemRectSize().x, 1.0f);
+        size_t index = size_t((ImGui::GetIO().MousePos.x - min.x) / width * frames.size());
+        frame  = frames[std::min(index, frames.size() - 1)];
+        paused = true;
+    }
+
+    ImGui::Text("Frame %llu: %.3f ms", (unsigned long long)frame.Index, frame.Milliseconds());
+    RenderTree(frame);
+
+    ImGui::End();
+}
+
+void ProfilerPanel::RenderTree(const ProfileFrame &frame)
+{
+    constexpr ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+    if (!ImGui::BeginTable("##Zones", 5, flags))
+    {
+        return;
+    }
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Zone",       ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Calls",      ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Total (ms)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Self (ms)",  ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Max (ms)",   ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+
+    /** The nodes are depth first, so the children of a collapsed node are the nodes deeper right after it */
+    const auto &nodes = frame.Nodes;
+    uint32_t opened = 0;
+    uint32_t collapsedDepth = UINT32_MAX;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const auto &node = nodes[i];
+        if (node.Depth > collapsedDepth)
+        {
+            continue;
+        }
+        collapsedDepth = UINT32_MAX;
+
+        for (; opened > node.Depth; opened--)
+        {
+            ImGui::TreePop();
+        }
+
+        bool leaf = i + 1 == nodes.size() || nodes[i + 1].Depth <= node.Depth;
+        ImGuiTreeNodeFlags treeFlags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+        if (leaf)
+        {
+            treeFlags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+        }
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        bool open = ImGui::TreeNodeEx((void *)(uintptr_t)node.Path, treeFlags, "%s", node.Name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", node.Calls);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", node.Total);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", node.Self);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", node.Max);
+
+        if (!leaf)
+        {
+            if (open)
+            {
+                opened++;
+            }
+            else
+            {
+                collapsedDepth = node.Depth;
+            }
+        }
+    }
+
+    for (; opened > 0; opened--)
+    {
+        ImGui::TreePop();
+    }
+
+    ImGui::EndTable();
+}
+
+}
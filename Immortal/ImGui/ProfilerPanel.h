@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core.h"
+#include "Shared/Instrumentor.h"
+
+#include <string>
+#include <vector>
+
+namespace Immortal
+{
+
+/**
+ * @brief An overlay of the CPU zones: the frame times of the history and the
+ *  zones of a frame as a tree. A frame is selected by clicking on the graph.
+ */
+class IMMORTAL_API ProfilerPanel
+{
+public:
+    ProfilerPanel(const std::string &capturePath = "logs/Immortal.trace.json");
+
+    void Render();
+
+    void Toggle()
+    {
+        visible = !visible;
+    }
+
+    bool IsVisible() const
+    {
+        return visible;
+    }
+
+protected:
+    void RenderTree(const ProfileFrame &frame);
+
+protected:
+    std::string capturePath;
+
+    /** The frame shown while paused, the history keeps going */
+    ProfileFrame frame;
+
+    std::vector<float> frameTimes;
+
+    bool visible = false;
+
+    bool paused = false;
+};
+
+}
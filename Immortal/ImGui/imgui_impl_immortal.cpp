@@ -8,10 +8,12 @@
 
 #include "imgui_impl_immortal.h"
 
+#include <deque>
+
 using namespace Immortal;
 
-#define DEFAULT_VERTEX_SIZE  5000
-#define DEFAULT_INDEX_SIZE   10000
+#define DEFAULT_VERTEX_COUNT 8192
+#define DEFAULT_INDEX_COUNT  16384
 #define MAX_FRAMES_IN_FLIGHT 6
 
 #ifdef _WIN32
@@ -44,8 +46,6 @@ class ImGui_ImplImmortal_FrameContext
 {
 public:
     ImGui_ImplImmortal_FrameContext() :
-        indexBuffer{},
-        vertexBuffer{},
         descriptorSets{}
     {
 
@@ -64,9 +64,6 @@ public:
 		descriptorSets.clear();
     }
 
-    URef<Buffer> indexBuffer;
-    URef<Buffer> vertexBuffer;
-
     void RefreshDescriptorSet()
     {
         uint32_t rest = freeDescriptorSets.size() - allocated;
@@ -100,6 +97,285 @@ public:
     std::unordered_map<Texture *, DescriptorSet*> descriptorSets;
 };
 
+/**
+ * A ring of vertices or indices. Its offsets are counted in elements, so a
+ * range of it is drawn through the first index and the base vertex.
+ */
+struct ImGui_ImplImmortal_Ring
+{
+    struct Range
+    {
+        size_t end;
+
+        /** The elements of the range, and those skipped at the end of the ring when it wrapped */
+        size_t used;
+
+        uint32_t generation;
+    };
+
+    ImGui_ImplImmortal_Ring(BufferType type, uint32_t stride) :
+        buffer{},
+        mapped{},
+        type{ type },
+        stride{ stride },
+        capacity{},
+        head{},
+        tail{},
+        used{},
+        generation{}
+    {
+
+    }
+
+    bool Allocate(size_t count, size_t *offset, Range *range)
+    {
+        if (used == 0)
+        {
+            head = 0;
+            tail = 0;
+        }
+
+        size_t consumed = count;
+        if (used == capacity && count > 0)
+        {
+            return false;
+        }
+        else if (head >= tail)
+        {
+            if (capacity - head >= count)
+            {
+                *offset = head;
+            }
+            else if (tail >= count)
+            {
+                *offset  = 0;
+                consumed = capacity - head + count;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (tail - head >= count)
+        {
+            *offset = head;
+        }
+        else
+        {
+            return false;
+        }
+
+        head  = *offset + count;
+        used += consumed;
+        *range = Range{
+            .end        = head,
+            .used       = consumed,
+            .generation = generation,
+        };
+
+        return true;
+    }
+
+    void Retire(const Range &range)
+    {
+        /** The ranges of a buffer replaced by growing are gone with it */
+        if (range.generation == generation)
+        {
+            tail  = range.end;
+            used -= range.used;
+        }
+    }
+
+    URef<Buffer> buffer;
+
+    uint8_t *mapped;
+
+    BufferType type;
+
+    uint32_t stride;
+
+    size_t capacity;
+
+    size_t head;
+
+    size_t tail;
+
+    size_t used;
+
+    uint32_t generation;
+};
+
+/**
+ * @brief The vertices and indices of a viewport streamed through two rings
+ *  mapped once when they are created. Each frame takes a contiguous range of
+ *  both, which is reused after the fence of the frame is signaled. A ring
+ *  filled by the frames in flight doubles, and the buffer it replaces is
+ *  released after the last frame using it.
+ */
+class ImGui_ImplImmortal_StreamBuffer
+{
+public:
+    struct Frame
+    {
+        uint64_t serial;
+
+        /** The value of the fence signaled by the frame, 0 until it is submitted */
+        uint64_t syncValue;
+
+        ImGui_ImplImmortal_Ring::Range vertex;
+
+        ImGui_ImplImmortal_Ring::Range index;
+
+        std::vector<URef<Buffer>> garbage;
+    };
+
+public:
+    ImGui_ImplImmortal_StreamBuffer(uint32_t framesInFlight) :
+        vertex{ BufferType::Vertex, sizeof(ImDrawVert) },
+        index{ BufferType::Index, sizeof(ImDrawIdx) },
+        framesInFlight{ framesInFlight },
+        serial{},
+        persistent{}
+    {
+
+    }
+
+    ~ImGui_ImplImmortal_StreamBuffer()
+    {
+        for (auto &frame : frames)
+        {
+            for (auto &buffer : frame.garbage)
+            {
+                Release(buffer);
+            }
+        }
+        Release(vertex.buffer);
+        Release(index.buffer);
+    }
+
+    /** Retire the frames done, either by their fence or by the frames in flight when there is no fence */
+    void BeginFrame(GPUEvent *gpuEvent)
+    {
+        serial++;
+        if (gpuEvent && !frames.empty() && frames.back().syncValue == 0)
+        {
+            frames.back().syncValue = gpuEvent->GetSyncPoint();
+        }
+
+        uint64_t completion = gpuEvent ? gpuEvent->GetCompletionValue() : 0;
+        while (!frames.empty())
+        {
+            auto &frame = frames.front();
+            bool done = gpuEvent ? frame.syncValue != 0 && frame.syncValue <= completion : frame.serial + framesInFlight <= serial;
+            if (!done)
+            {
+                break;
+            }
+
+            vertex.Retire(frame.vertex);
+            index.Retire(frame.index);
+            for (auto &buffer : frame.garbage)
+            {
+                Release(buffer);
+            }
+            frames.pop_front();
+        }
+    }
+
+    void Allocate(Device *device, size_t vertexCount, size_t indexCount, size_t *vertexOffset, size_t *indexOffset)
+    {
+        persistent = device->GetBackendAPI() != BackendAPI::OpenGL && device->GetBackendAPI() != BackendAPI::D3D11;
+
+        Frame frame{
+            .serial    = serial,
+            .syncValue = 0,
+            .vertex    = {},
+            .index     = {},
+            .garbage   = {},
+        };
+
+        while (!vertex.Allocate(vertexCount, vertexOffset, &frame.vertex))
+        {
+            Grow(device, vertex, vertexCount, DEFAULT_VERTEX_COUNT);
+        }
+        while (!index.Allocate(indexCount, indexOffset, &frame.index))
+        {
+            Grow(device, index, indexCount, DEFAULT_INDEX_COUNT);
+        }
+
+        frames.emplace_back(std::move(frame));
+    }
+
+    bool IsPersistent() const
+    {
+        return persistent;
+    }
+
+protected:
+    void Grow(Device *device, ImGui_ImplImmortal_Ring &ring, size_t count, size_t minimum)
+    {
+        size_t capacity = std::max(ring.capacity * 2, minimum);
+        while (capacity < count)
+        {
+            capacity *= 2;
+        }
+
+        /** The frames in flight may still read the old buffer */
+        if (ring.buffer)
+        {
+            if (!frames.empty())
+            {
+                frames.back().garbage.emplace_back(std::move(ring.buffer));
+            }
+            else
+            {
+                Release(ring.buffer);
+            }
+        }
+
+        ring.buffer     = device->CreateBuffer(capacity * ring.stride, ring.type);
+        ring.mapped     = nullptr;
+        ring.capacity   = capacity;
+        ring.head       = 0;
+        ring.tail       = 0;
+        ring.used       = 0;
+        ring.generation++;
+
+        if (persistent)
+        {
+            ring.buffer->Map((void **)&ring.mapped, capacity * ring.stride, 0);
+        }
+    }
+
+    void Release(URef<Buffer> &buffer)
+    {
+        if (buffer && persistent)
+        {
+            buffer->Unmap();
+        }
+        buffer.Reset();
+    }
+
+public:
+    ImGui_ImplImmortal_Ring vertex;
+
+    ImGui_ImplImmortal_Ring index;
+
+    /** The vertices and indices gathered for the backends without mapping, kept until they are copied */
+    std::vector<ImDrawVert> vertexStaging;
+
+    std::vector<ImDrawIdx> indexStaging;
+
+protected:
+    std::deque<Frame> frames;
+
+    uint32_t framesInFlight;
+
+    uint64_t serial;
+
+    bool persistent;
+};
+
 struct ImGui_ImplImmortal_ViewportData
 {
     ImGui_ImplImmortal_ViewportData(uint32_t bufferCount) :
@@ -111,7 +387,8 @@ struct ImGui_ImplImmortal_ViewportData
         syncPoint{},
         NumFramesInFlight{ bufferCount },
         FrameIndex{},
-	    frameCtx{}
+	    frameCtx{},
+        streamBuffer{ bufferCount }
     {
 		frameCtx = new ImGui_ImplImmortal_FrameContext[NumFramesInFlight];
     }
@@ -130,6 +407,7 @@ struct ImGui_ImplImmortal_ViewportData
     uint32_t                                              NumFramesInFlight;
     uint32_t                                              FrameIndex;
 	ImGui_ImplImmortal_FrameContext                      *frameCtx;
+    ImGui_ImplImmortal_StreamBuffer                       streamBuffer;
 };
 
 // Backend data stored in io.BackendRendererUserData to allow support for multiple Dear ImGui contexts
@@ -386,7 +664,7 @@ IMGUI_IMPL_API void ImGui_ImplImmortal_NewFrame()
     }
 }
 
-IMGUI_IMPL_API void ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, CommandBuffer *commandBuffer)
+IMGUI_IMPL_API void ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, CommandBuffer *commandBuffer, GPUEvent *gpuEvent)
 {
     int width = (int)(drawData->DisplaySize.x * drawData->FramebufferScale.x);
     int height = (int)(drawData->DisplaySize.y * drawData->FramebufferScale.y);
@@ -400,6 +678,9 @@ IMGUI_IMPL_API void ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, Comm
     vd->FrameIndex++;
     ImGui_ImplImmortal_FrameContext *fr = &vd->frameCtx[vd->FrameIndex % bd->swapchainBufferCount];
 
+    auto &stream = vd->streamBuffer;
+    stream.BeginFrame(gpuEvent);
+
     if (drawData->TotalIdxCount <= 0)
     {
         return;
@@ -407,61 +688,52 @@ IMGUI_IMPL_API void ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, Comm
 
     fr->RefreshDescriptorSet();
 
-    size_t totalVertexSize = drawData->TotalVtxCount * sizeof(ImDrawVert);
-    size_t totalIndexSize = drawData->TotalIdxCount * sizeof(ImDrawIdx);
+    size_t vertexBase = 0;
+    size_t indexBase  = 0;
+    stream.Allocate(bd->device, drawData->TotalVtxCount, drawData->TotalIdxCount, &vertexBase, &indexBase);
 
-    if (!fr->vertexBuffer || fr->vertexBuffer->GetSize() < totalVertexSize)
+    ImDrawVert *pVertex = nullptr;
+    ImDrawIdx  *pIndex  = nullptr;
+    if (stream.IsPersistent())
     {
-        fr->vertexBuffer = bd->device->CreateBuffer(totalVertexSize + DEFAULT_VERTEX_SIZE, BufferType::Vertex);
+        pVertex = (ImDrawVert *)stream.vertex.mapped + vertexBase;
+        pIndex  = (ImDrawIdx *)stream.index.mapped + indexBase;
     }
-
-    if (!fr->indexBuffer || fr->indexBuffer->GetSize() < totalIndexSize)
+    else
     {
-        fr->indexBuffer = bd->device->CreateBuffer(totalIndexSize + DEFAULT_INDEX_SIZE, BufferType::Index);
+        stream.vertexStaging.resize(drawData->TotalVtxCount);
+        stream.indexStaging.resize(drawData->TotalIdxCount);
+        pVertex = stream.vertexStaging.data();
+        pIndex  = stream.indexStaging.data();
     }
 
-    if (bd->device->GetBackendAPI() == BackendAPI::OpenGL || bd->device->GetBackendAPI() == BackendAPI::D3D11)
+    for (int i = 0; i < drawData->CmdListsCount; i++)
     {
-        for (int i = 0, vertexOffset = 0, indexOffset = 0; i < drawData->CmdListsCount; i++)
-        {
-            const ImDrawList *cmdList = drawData->CmdLists[i];
-            uint32_t vertexSize = cmdList->VtxBuffer.Size * sizeof(ImDrawVert);
-            uint32_t indexSize = cmdList->IdxBuffer.Size * sizeof(ImDrawIdx);
-
-            commandBuffer->MemoryCopy(fr->vertexBuffer, vertexSize, cmdList->VtxBuffer.Data, vertexOffset);
-            commandBuffer->MemoryCopy(fr->indexBuffer, indexSize, cmdList->IdxBuffer.Data, indexOffset);
+        const ImDrawList *cmdList = drawData->CmdLists[i];
+        memcpy(pVertex, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert));
+        memcpy(pIndex, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx));
+        pVertex += cmdList->VtxBuffer.Size;
+        pIndex  += cmdList->IdxBuffer.Size;
+    }
 
-            vertexOffset += vertexSize;
-            indexOffset += indexSize;
-        }
+    if (!stream.IsPersistent())
+    {
+        /** One copy for each buffer rather than each draw list */
+        commandBuffer->MemoryCopy(stream.vertex.buffer, drawData->TotalVtxCount * sizeof(ImDrawVert), stream.vertexStaging.data(), vertexBase * sizeof(ImDrawVert));
+        commandBuffer->MemoryCopy(stream.index.buffer, drawData->TotalIdxCount * sizeof(ImDrawIdx), stream.indexStaging.data(), indexBase * sizeof(ImDrawIdx));
     }
     else
     {
-        uint8_t *pVertex = nullptr;
-        uint8_t *pIndex  = nullptr;
-        fr->vertexBuffer->Map((void **) &pVertex, totalVertexSize, 0);
-        fr->indexBuffer->Map((void **) &pIndex, totalIndexSize, 0);
-        for (int i = 0, vertexOffset = 0, indexOffset = 0; i < drawData->CmdListsCount; i++)
-        {
-            const ImDrawList *cmdList = drawData->CmdLists[i];
-            uint32_t vertexSize = cmdList->VtxBuffer.Size * sizeof(ImDrawVert);
-            uint32_t indexSize = cmdList->IdxBuffer.Size * sizeof(ImDrawIdx);
-
-            memcpy(pVertex + vertexOffset, cmdList->VtxBuffer.Data, vertexSize);
-            memcpy(pIndex + indexOffset, cmdList->IdxBuffer.Data, indexSize);
-
-            vertexOffset += vertexSize;
-            indexOffset += indexSize;
-        }
-        fr->vertexBuffer->Unmap();
-        fr->indexBuffer->Unmap();
+        /** The buffers stay mapped, only the ranges of the frame are flushed for the memory not coherent, e.g. the managed storage of Metal */
+        stream.vertex.buffer->Flush(drawData->TotalVtxCount * sizeof(ImDrawVert), vertexBase * sizeof(ImDrawVert));
+        stream.index.buffer->Flush(drawData->TotalIdxCount * sizeof(ImDrawIdx), indexBase * sizeof(ImDrawIdx));
     }
 
     commandBuffer->SetPipeline(bd->pipeline);
 
-    Buffer *vertexBuffers[] = { fr->vertexBuffer };
+    Buffer *vertexBuffers[] = { stream.vertex.buffer };
     commandBuffer->SetVertexBuffers(0, 1, vertexBuffers, sizeof(ImDrawVert));
-    commandBuffer->SetIndexBuffer(fr->indexBuffer, sizeof(ImDrawIdx) == 2 ? Format::UINT16 : Format::UINT32);
+    commandBuffer->SetIndexBuffer(stream.index.buffer, sizeof(ImDrawIdx) == 2 ? Format::UINT16 : Format::UINT32);
 
     float L = drawData->DisplayPos.x;
     float R = drawData->DisplayPos.x + drawData->DisplaySize.x;
@@ -483,8 +755,8 @@ IMGUI_IMPL_API void ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, Comm
     Texture *lastTexture = nullptr;
     ImVec2 clipOff = drawData->DisplayPos;
     ImVec2 clipScale = drawData->FramebufferScale;
-    int globalVertexOffset = 0;
-    int globalIndexOffset = 0;
+    int globalVertexOffset = int(vertexBase);
+    int globalIndexOffset = int(indexBase);
     for (int i = 0; i < drawData->CmdListsCount; i++)
     {
         const ImDrawList *cmdList = drawData->CmdLists[i];
@@ -679,7 +951,7 @@ static void ImGui_ImplImmortal_RenderWindow(ImGuiViewport *viewport, void *rende
 
         commandBuffer->Begin();
         commandBuffer->BeginRenderTarget(renderTarget, clearColor);
-        ImGui_ImplImmortal_RenderDrawData(viewport->DrawData, commandBuffer);
+        ImGui_ImplImmortal_RenderDrawData(viewport->DrawData, commandBuffer, vd->gpuEvent);
         commandBuffer->EndRenderTarget();
         commandBuffer->End();
 
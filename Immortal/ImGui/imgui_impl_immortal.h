@@ -16,7 +16,9 @@
 IMGUI_IMPL_API bool         ImGui_ImplImmortal_Init(Immortal::Device *device, Immortal::Window *window, Immortal::Queue *queue, Immortal::Swapchain *swapchain, uint32_t swapchainBufferCount);
 IMGUI_IMPL_API void         ImGui_ImplImmortal_Shutdown();
 IMGUI_IMPL_API void         ImGui_ImplImmortal_NewFrame();
-IMGUI_IMPL_API void         ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, Immortal::CommandBuffer *commandBuffer);
+// The vertices and indices of a frame are reused once the GPU event signals the submission of the command buffer,
+// or after the frames in flight without one
+IMGUI_IMPL_API void         ImGui_ImplImmortal_RenderDrawData(ImDrawData *drawData, Immortal::CommandBuffer *commandBuffer, Immortal::GPUEvent *gpuEvent = nullptr);
 IMGUI_IMPL_API bool         ImGui_ImplImmortal_CreateFontsTexture();
 IMGUI_IMPL_API void         ImGui_ImplImmortal_InitPlatformInterface();
 IMGUI_IMPL_API void         ImGui_ImplImmortal_ShutdownPlatformInterface();
@@ -41,6 +41,7 @@
 #include "Render/OrthographicCamera.h"
 #include "Render/Render2D.h"
 #include "Render/Mesh.h"
+#include "Render/OffscreenRenderer.h"
 
 #include "Sync/Semaphore.h"
 
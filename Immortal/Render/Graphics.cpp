@@ -2,7 +2,8 @@
 #include "Render2D.h"
 #include "Vision/Image.h"
 #include "Framework/Timer.h"
-#include "FileSystem/Stream.h"
+#include "Shared/Instrumentor.h"
+#include "FileSystem/FileSystem.h"
 
 namespace Immortal
 {
@@ -15,6 +16,7 @@ Graphics::Graphics(Device *device) :
 {
 	This = this;
 	commandBuffer = device->CreateCommandBuffer(QueueType::Compute);
+	stagingRing = new StagingRing{ device, &thread };
 }
 
 void Graphics::SetDevice(Device *device)
@@ -58,7 +60,7 @@ Graphics::~Graphics()
     thread.Execute<AsyncTask>(AsyncTaskType::Terminate);
 	thread.Join();
     discardedTextures.clear();
-	stagingBuffers = {};
+	stagingRing.Reset();
     device = nullptr;
 }
 
@@ -92,8 +94,16 @@ Texture *Graphics::CreateTexture(const std::string &filepath)
     return CreateTexture(picture.GetFormat(), width, height, picture.GetData());
 }
 
+std::future<Ref<Texture>> Graphics::CreateTextureAsync(const std::string &filepath)
+{
+    return Async::Execute([=] {
+        return Ref<Texture>{ CreateTexture(filepath) };
+    });
+}
+
 Texture *Graphics::CreateTexture(Format format, uint32_t width, uint32_t height, const void *data)
 {
+    SL_PROFILE_FUNCTION();
 	uint32_t mipLevels = Texture::CalculateMipmapLevels(width, height);
 	Texture *texture = This->device->CreateTexture(format, width, height, mipLevels, 1, TextureType::TransferDestination);
 
@@ -105,20 +115,16 @@ Texture *Graphics::CreateTexture(Format format, uint32_t width, uint32_t height,
     uint32_t uploadPitch = SLALIGN(width * format.GetTexelSize(), TextureAlignment);
 	uint32_t uploadSize = height * uploadPitch;
 
-    Ref<Buffer> buffer = {};
+    auto allocation = This->stagingRing->Allocate(uploadSize, TexturePlacementAlignment);
+    if (allocation)
     {
-		std::lock_guard lock{ This->mutex };
-		if (!This->stagingBuffers.empty())
-		{
-			buffer = This->stagingBuffers.front();
-			This->stagingBuffers.pop();
-		}
+	    MemoryCopyImage(allocation.mapped, uploadPitch, (uint8_t *)data, width * format.GetTexelSize(), format, width, height);
+        This->stagingRing->Upload(texture, allocation, uploadPitch, mipLevels > 1);
+        return texture;
     }
 
-	if (!buffer || buffer->GetSize() < uploadSize)
-    {
-		buffer = This->device->CreateBuffer(uploadSize, BufferType::TransferSource);
-    }
+    /** Larger than the whole staging ring, so it goes with a dedicated buffer */
+    Ref<Buffer> buffer = This->device->CreateBuffer(uploadSize, BufferType::TransferSource);
 
     void *mapped = nullptr;
 	buffer->Map(&mapped, uploadSize, 0);
@@ -133,10 +139,7 @@ Texture *Graphics::CreateTexture(Format format, uint32_t width, uint32_t height,
         }
 	});
 
-    Execute<ExecutionCompletedTask>([=]() {
-		std::lock_guard lock{ This->mutex };
-		This->stagingBuffers.push(buffer);
-	});
+    Execute<ExecutionCompletedTask>([buffer] () {});
 
     return texture;
 }
@@ -197,11 +200,9 @@ Ref<Pipeline> Graphics::GetPipeline(const std::string &name)
 	if (shaderIt != pipelineShaders.end())
     {
 		auto &[first, createInfo] = *shaderIt;
-		Stream stream = { createInfo.path, Stream::Mode::Read };
-        if (stream.Readable())
+		std::string source = FileSystem::ReadString(createInfo.path);
+        if (!source.empty())
         {
-			std::string source;
-			stream.Read(source);
 			URef<Shader> shader    = This->device->CreateShader(name, createInfo.stage, source, createInfo.entryPoint);
 			Ref<Pipeline> pipeline = This->device->CreateComputePipeline(shader);
 			This->pipelines[name]  = pipeline;
@@ -2,6 +2,9 @@
 
 #include "Core.h"
 #include "Graphics/LightGraphics.h"
+#include "StagingRing.h"
+
+#include <future>
 
 namespace Immortal
 {
@@ -59,6 +62,9 @@ public:
 
     static Texture *CreateTexture(const std::string &filepath);
 
+    /** Decode the file on the thread pool, the upload is batched with the others */
+    static std::future<Ref<Texture>> CreateTextureAsync(const std::string &filepath);
+
     static Texture *CreateTexture(Format format, uint32_t width, uint32_t height, const void *data = nullptr);
 
     static void DiscardTexture(const Ref<Texture> &texture);
@@ -93,7 +99,7 @@ public:
     
     std::mutex mutex;
 
-    std::queue<Ref<Buffer>> stagingBuffers;
+    URef<StagingRing> stagingRing;
 
     uint32_t index = 0;
 
@@ -163,7 +163,7 @@ void Mesh::LoadPrimitives()
 
 }
 
-Mesh::Mesh(const std::string &filepath) :
+Mesh::Mesh(const std::string &filepath, MeshOptimization optimization) :
     path{ filepath }
 {
 #if !HAVE_ASSIMP
@@ -179,7 +179,7 @@ Mesh::Mesh(const std::string &filepath) :
     const aiScene *scene = importer->ReadFile(filepath, ImportFlags);
     SLASSERT(scene && scene->HasMeshes() && "Failed to load Mesh file: {0}" && filepath.c_str());
 
-    LoadModelData(scene);
+    LoadModelData(scene, optimization);
 
     if (scene->HasMaterials())
     {
@@ -201,8 +201,8 @@ Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<Index> &indici
 {
     Node head{ "Undefined" };
 
-    head.Vertex = Graphics::CreateBuffer(vertices.size(), Buffer::Type::Vertex, vertices.data());
-	head.Index  = Graphics::CreateBuffer(indicies.size(), Buffer::Type::Index, indicies.data());
+    head.Vertex = Graphics::CreateBuffer(vertices.size(), Buffer::Type::Vertex | Buffer::Type::Static, vertices.data());
+	head.Index  = Graphics::CreateBuffer(indicies.size(), Buffer::Type::Index | Buffer::Type::Static, indicies.data());
 
     nodes.emplace_back(head);
 }
@@ -259,7 +259,7 @@ void Mesh::CalculatedBoneTransform(const Matrix4 &parentTransform)
 }
 
 #if HAVE_ASSIMP
-void Mesh::LoadModelData(const aiScene *scene)
+void Mesh::LoadModelData(const aiScene *scene, MeshOptimization optimization)
 {
     std::vector<SkeletonVertex> vertices;
     std::vector<Face> faces;
@@ -268,9 +268,6 @@ void Mesh::LoadModelData(const aiScene *scene)
     uint32_t totalVertices = 0;
     uint32_t totalFaces = 0;
 
-    BufferBindInfo vertexBindInfo{Buffer::Type::Vertex, 0, 0};
-	BufferBindInfo faceBindInfo{Buffer::Type::Index, 0, 0};
-
     for (size_t i = 0; i < scene->mNumMeshes; i++)
     {
         totalVertices += scene->mMeshes[i]->mNumVertices;
@@ -280,9 +277,11 @@ void Mesh::LoadModelData(const aiScene *scene)
     vertices.reserve(totalVertices);
     faces.reserve(totalFaces);
 
-    faceBindInfo.offset = totalVertices * sizeof(SkeletonVertex);
-
-    buffer = Graphics::CreateBuffer(faceBindInfo.offset + totalFaces * sizeof(Face), Buffer::Type{Buffer::Type::Vertex | Buffer::Type::Index});
+    struct
+    {
+        float before = 0.0f;
+        float after  = 0.0f;
+    } cacheMisses;
 
     nodes.resize(scene->mNumMeshes);
     for (uint32_t i = 0; i < scene->mNumMeshes; i++)
@@ -294,6 +293,7 @@ void Mesh::LoadModelData(const aiScene *scene)
 
         THROWIF(!mesh->HasPositions() || !mesh->HasNormals(), "No Position or Normals in the mesh object");
 
+        uint32_t baseVertex = (uint32_t)vertices.size();
         for (size_t j = 0; j < mesh->mNumVertices; j++)
         {
             auto &vertex = vertices.emplace_back();
@@ -309,9 +309,7 @@ void Mesh::LoadModelData(const aiScene *scene)
                 vertex.Texcoord = { mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y };
             }
         }
-        vertexBindInfo.size = mesh->mNumVertices * sizeof(SkeletonVertex);
 
-        uint32_t baseVertex = vertexBindInfo.offset / sizeof(SkeletonVertex);
         bool hasBone = LoadBoneData(mesh, vertices, baseVertex, numBones);
 
         if (!hasBone && scene->HasAnimations())
@@ -330,10 +328,83 @@ void Mesh::LoadModelData(const aiScene *scene)
             face.v2 = mesh->mFaces[j].mIndices[1];
             face.v3 = mesh->mFaces[j].mIndices[2];
         }
-        faceBindInfo.size = mesh->mNumFaces * sizeof(Face);
 
-        //node.Vertex = buffer->Bind(vertexBindInfo);
-        //node.Index  = buffer->Bind(faceBindInfo);
+        if (!mesh->mNumFaces)
+        {
+            continue;
+        }
+
+        uint32_t *indices = &faces[faces.size() - mesh->mNumFaces].v1;
+        size_t indexCount = mesh->mNumFaces * 3;
+        if (optimization & MeshOptimization::VertexCache)
+        {
+            cacheMisses.before += MeshOptimizer::AnalyzeVertexCache(indices, indexCount, mesh->mNumVertices) * mesh->mNumFaces;
+            MeshOptimizer::OptimizeVertexCache(indices, indexCount, mesh->mNumVertices);
+            cacheMisses.after  += MeshOptimizer::AnalyzeVertexCache(indices, indexCount, mesh->mNumVertices) * mesh->mNumFaces;
+        }
+        if (optimization & MeshOptimization::VertexFetch)
+        {
+            MeshOptimizer::OptimizeVertexFetch(&vertices[baseVertex], indices, indexCount, mesh->mNumVertices);
+        }
+    }
+
+    if ((optimization & MeshOptimization::VertexCache) && totalFaces)
+    {
+        LOG::INFO("Mesh::LoadModelData::ACMR {:.3f} -> {:.3f}", cacheMisses.before / totalFaces, cacheMisses.after / totalFaces);
+    }
+
+    std::vector<QuantizedSkeletonVertex> quantizedVertices;
+    if (optimization & MeshOptimization::Quantize)
+    {
+        if (numBones > MeshOptimizer::MaxQuantizedBones)
+        {
+            LOG::WARN("Mesh::LoadModelData::{} bones could not fit in 8-bit bone indices, keep the full precision vertices", numBones);
+        }
+        else
+        {
+            quantizedVertices.resize(vertices.size());
+            MeshOptimizer::Quantize(quantizedVertices.data(), vertices.data(), vertices.size());
+
+            auto report = MeshOptimizer::Validate(vertices.data(), quantizedVertices.data(), vertices.size());
+            if (!report.Passed())
+            {
+                LOG::WARN("Mesh::LoadModelData::Quantization out of tolerance (normal {}, tangent {}, texcoord {}, weight {}), keep the full precision vertices",
+                    report.MaxNormalError, report.MaxTangentError, report.MaxTexcoordError, report.MaxWeightError);
+                quantizedVertices.clear();
+            }
+        }
+    }
+
+    const void *vertexData = vertices.data();
+    vertexStride = sizeof(SkeletonVertex);
+    if (!quantizedVertices.empty())
+    {
+        vertexData   = quantizedVertices.data();
+        vertexStride = sizeof(QuantizedSkeletonVertex);
+        LOG::INFO("Mesh::LoadModelData::Vertex memory {} -> {} bytes", vertices.size() * sizeof(SkeletonVertex), vertices.size() * vertexStride);
+    }
+
+    BufferBindInfo vertexBindInfo{Buffer::Type::Vertex, 0, 0};
+	BufferBindInfo faceBindInfo{Buffer::Type::Index, 0, 0};
+
+    faceBindInfo.offset = totalVertices * vertexStride;
+
+    size_t bufferSize = faceBindInfo.offset + totalFaces * sizeof(Face);
+    buffer = Graphics::CreateBuffer(bufferSize, Buffer::Type{Buffer::Type::Vertex | Buffer::Type::Index | Buffer::Type::Static});
+
+    uint8_t *mapped = nullptr;
+    buffer->Map((void **)&mapped, bufferSize, 0);
+    memcpy(mapped, vertexData, faceBindInfo.offset);
+    memcpy(mapped + faceBindInfo.offset, faces.data(), totalFaces * sizeof(Face));
+    buffer->Unmap();
+
+    for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        vertexBindInfo.size = scene->mMeshes[i]->mNumVertices * vertexStride;
+        faceBindInfo.size = scene->mMeshes[i]->mNumFaces * sizeof(Face);
+
+        //nodes[i].Vertex = buffer->Bind(vertexBindInfo);
+        //nodes[i].Index  = buffer->Bind(faceBindInfo);
 
         vertexBindInfo.offset += vertexBindInfo.size;
 		faceBindInfo.offset += faceBindInfo.size;
@@ -347,9 +418,6 @@ void Mesh::LoadModelData(const aiScene *scene)
     rootNode = new BoneNode{};
     ReadAssimpNode(rootNode, scene->mRootNode);
     globalInverseTransform = Vector::Inverse(rootNode->Transform);
-
-    //buffer->Update(vertices);
-    //buffer->Update(faces, vertices.size() * sizeof(SkeletonVertex));
 }
 
 bool Mesh::LoadBoneData(const aiMesh *mesh, std::vector<SkeletonVertex> &vertices, uint32_t baseVertex, uint32_t &numBones)
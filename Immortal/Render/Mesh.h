@@ -6,6 +6,7 @@
 #include "Buffer.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "MeshOptimizer.h"
 #include "Algorithm/LightVector.h"
 #include "Math/Vector.h"
 
@@ -273,7 +274,7 @@ public:
     using Index = Face;
 
 public:
-    Mesh(const std::string &filepath);
+    Mesh(const std::string &filepath, MeshOptimization optimization = MeshOptimization::None);
 
     Mesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indicies);
 
@@ -314,6 +315,16 @@ public:
         return !animations.empty();
     }
 
+    bool IsQuantized() const
+    {
+        return vertexStride == sizeof(QuantizedSkeletonVertex);
+    }
+
+    uint32_t GetVertexStride() const
+    {
+        return vertexStride;
+    }
+
     uint32_t GetAnimationState() const;
 
     void SwitchToAnimation(uint32_t index);
@@ -323,7 +334,7 @@ public:
     void CalculatedBoneTransform(const Matrix4 &parentTransform);
 
 private:
-    void LoadModelData(const aiScene *scene);
+    void LoadModelData(const aiScene *scene, MeshOptimization optimization);
 
     void LoadAnimationData(const aiScene *scene);
 
@@ -350,6 +361,8 @@ private:
 
     Matrix4 globalInverseTransform;
 
+    uint32_t vertexStride = sizeof(SkeletonVertex);
+
     struct
     {
         uint32_t currentAnimation = 0;
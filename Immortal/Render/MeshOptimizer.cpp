@@ -0,0 +1,445 @@
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace Immortal
+{
+
+namespace Forsyth
+{
+
+static constexpr float CacheDecayPower   = 1.5f;
+static constexpr float LastTriangleScore = 0.75f;
+static constexpr float ValenceBoostScale = 2.0f;
+static constexpr float ValenceBoostPower = 0.5f;
+
+static constexpr uint32_t MaxPrecomputedValence = 32;
+
+static constexpr size_t InvalidTriangle = ~size_t(0);
+
+struct ScoreTable
+{
+    ScoreTable()
+    {
+        for (uint32_t i = 0; i < MeshOptimizer::VertexCacheSize; i++)
+        {
+            if (i < 3)
+            {
+                cache[i] = LastTriangleScore;
+            }
+            else
+            {
+                float scaler = 1.0f / (MeshOptimizer::VertexCacheSize - 3);
+                cache[i] = powf(1.0f - (i - 3) * scaler, CacheDecayPower);
+            }
+        }
+
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i < MaxPrecomputedValence; i++)
+        {
+            valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+        }
+    }
+
+    float Score(int32_t cachePosition, uint32_t remainingTriangles) const
+    {
+        if (!remainingTriangles)
+        {
+            return -1.0f;
+        }
+
+        float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+        if (remainingTriangles < MaxPrecomputedValence)
+        {
+            return score + valence[remainingTriangles];
+        }
+
+        return score + ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+    }
+
+    float cache[MeshOptimizer::VertexCacheSize];
+
+    float valence[MaxPrecomputedValence];
+};
+
+}
+
+static inline float SignNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+static inline int16_t QuantizeSnorm16(float v)
+{
+    return (int16_t)std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static inline float DequantizeSnorm16(int16_t v)
+{
+    return std::max(v / 32767.0f, -1.0f);
+}
+
+static inline void OctahedralEncode(int16_t dst[2], const Vector3 &v)
+{
+    float sum = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (sum == 0.0f)
+    {
+        dst[0] = 0;
+        dst[1] = 0;
+        return;
+    }
+
+    float x = v.x / sum;
+    float y = v.y / sum;
+    if (v.z < 0.0f)
+    {
+        float fx = (1.0f - std::abs(y)) * SignNotZero(x);
+        float fy = (1.0f - std::abs(x)) * SignNotZero(y);
+        x = fx;
+        y = fy;
+    }
+
+    dst[0] = QuantizeSnorm16(x);
+    dst[1] = QuantizeSnorm16(y);
+}
+
+static inline Vector3 OctahedralDecode(const int16_t src[2])
+{
+    Vector3 v{ DequantizeSnorm16(src[0]), DequantizeSnorm16(src[1]), 0.0f };
+    v.z = 1.0f - std::abs(v.x) - std::abs(v.y);
+
+    float t = std::max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+
+    return v.Normalize();
+}
+
+static inline float Distance(const Vector3 &a, const Vector3 &b)
+{
+    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+}
+
+static inline float DirectionError(const Vector3 &original, const Vector3 &decoded)
+{
+    float length = std::sqrt(original.x * original.x + original.y * original.y + original.z * original.z);
+    if (length == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    return Distance(Vector3{ original.x / length, original.y / length, original.z / length }, decoded);
+}
+
+bool MeshOptimizer::ValidationReport::Passed() const
+{
+    constexpr float DirectionTolerance = 1e-3f;
+    constexpr float TexcoordTolerance  = 1e-3f;
+    constexpr float WeightTolerance    = 2.0f / 255.0f;
+
+    return BoneIdsMatch &&
+           MaxPositionError == 0.0f &&
+           MaxNormalError   <= DirectionTolerance &&
+           MaxTangentError  <= DirectionTolerance &&
+           MaxTexcoordError <= TexcoordTolerance &&
+           MaxWeightError   <= WeightTolerance;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+    static const Forsyth::ScoreTable table;
+
+    size_t triangleCount = indexCount / 3;
+    if (!triangleCount)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        offsets[i + 1] = offsets[i] + liveTriangles[i];
+    }
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursors{ offsets.begin(), offsets.end() - 1 };
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            adjacency[cursors[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        vertexScores[i] = table.Score(-1, liveTriangles[i]);
+    }
+
+    size_t bestTriangle = Forsyth::InvalidTriangle;
+    float bestScore = -1.0f;
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        const uint32_t *triangle = indices + i * 3;
+        triangleScores[i] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+        if (triangleScores[i] > bestScore)
+        {
+            bestScore    = triangleScores[i];
+            bestTriangle = i;
+        }
+    }
+
+    std::vector<uint32_t> source{ indices, indices + triangleCount * 3 };
+    std::vector<uint8_t> emitted(triangleCount, 0);
+
+    uint32_t cache[VertexCacheSize + 3];
+    uint32_t cacheCount = 0;
+    size_t cursor = 0;
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        if (bestTriangle == Forsyth::InvalidTriangle)
+        {
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            bestTriangle = cursor;
+        }
+
+        const uint32_t *triangle = &source[bestTriangle * 3];
+        memcpy(indices + i * 3, triangle, sizeof(uint32_t) * 3);
+        emitted[bestTriangle] = 1;
+
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t v = triangle[k];
+            uint32_t *begin = &adjacency[offsets[v]];
+            uint32_t &count = liveTriangles[v];
+            for (uint32_t j = 0; j < count; j++)
+            {
+                if (begin[j] == bestTriangle)
+                {
+                    begin[j] = begin[count - 1];
+                    break;
+                }
+            }
+            count--;
+        }
+
+        uint32_t newCache[VertexCacheSize + 3];
+        uint32_t newCount = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t v = triangle[k];
+            if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+            {
+                newCache[newCount++] = v;
+            }
+        }
+        for (uint32_t j = 0; j < cacheCount; j++)
+        {
+            uint32_t v = cache[j];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for (uint32_t j = 0; j < newCount; j++)
+        {
+            uint32_t v = newCache[j];
+            cachePositions[v] = j < VertexCacheSize ? (int32_t)j : -1;
+
+            float score = table.Score(cachePositions[v], liveTriangles[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+
+            const uint32_t *begin = &adjacency[offsets[v]];
+            for (uint32_t t = 0; t < liveTriangles[v]; t++)
+            {
+                triangleScores[begin[t]] += delta;
+            }
+        }
+
+        bestTriangle = Forsyth::InvalidTriangle;
+        bestScore = -1.0f;
+        cacheCount = std::min(newCount, VertexCacheSize);
+        for (uint32_t j = 0; j < cacheCount; j++)
+        {
+            uint32_t v = newCache[j];
+            cache[j] = v;
+
+            const uint32_t *begin = &adjacency[offsets[v]];
+            for (uint32_t t = 0; t < liveTriangles[v]; t++)
+            {
+                if (triangleScores[begin[t]] > bestScore)
+                {
+                    bestScore    = triangleScores[begin[t]];
+                    bestTriangle = begin[t];
+                }
+            }
+        }
+    }
+}
+
+size_t MeshOptimizer::GenerateVertexFetchRemap(std::vector<uint32_t> &remap, uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+    constexpr uint32_t Unused = ~uint32_t(0);
+
+    remap.assign(vertexCount, Unused);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        uint32_t &index = remap[indices[i]];
+        if (index == Unused)
+        {
+            index = next++;
+        }
+        indices[i] = index;
+    }
+
+    size_t referenced = next;
+    for (auto &index : remap)
+    {
+        if (index == Unused)
+        {
+            index = next++;
+        }
+    }
+
+    return referenced;
+}
+
+float MeshOptimizer::AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    size_t triangleCount = indexCount / 3;
+    if (!triangleCount)
+    {
+        return 0.0f;
+    }
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        uint32_t v = indices[i];
+        if (timestamp - timestamps[v] > cacheSize)
+        {
+            timestamps[v] = timestamp++;
+            misses++;
+        }
+    }
+
+    return (float)misses / (float)triangleCount;
+}
+
+void MeshOptimizer::Quantize(QuantizedSkeletonVertex *dst, const SkeletonVertex *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto &q = dst[i];
+        auto &v = src[i];
+
+        q.Position = v.Position;
+        OctahedralEncode(q.Normal,  v.Normal );
+        OctahedralEncode(q.Tangent, v.Tangent);
+        q.Texcoord[0] = glm::packHalf1x16(v.Texcoord.x);
+        q.Texcoord[1] = glm::packHalf1x16(v.Texcoord.y);
+
+        const float *weights = &v.Weights.x;
+
+        float sum = 0.0f;
+        int32_t quantizedSum = 0;
+        size_t heaviest = 0;
+        for (size_t j = 0; j < 4; j++)
+        {
+            q.BoneIds[j] = (uint8_t)v.BoneIds[j];
+            q.Weights[j] = (uint8_t)std::round(std::clamp(weights[j], 0.0f, 1.0f) * 255.0f);
+
+            sum += weights[j];
+            quantizedSum += q.Weights[j];
+            if (weights[j] > weights[heaviest])
+            {
+                heaviest = j;
+            }
+        }
+
+        /** Keep the weights of a normalized vertex summing up to one exactly */
+        if (std::abs(sum - 1.0f) < 1e-3f)
+        {
+            q.Weights[heaviest] = (uint8_t)std::clamp(q.Weights[heaviest] + 255 - quantizedSum, 0, 255);
+        }
+    }
+}
+
+void MeshOptimizer::Dequantize(SkeletonVertex *dst, const QuantizedSkeletonVertex *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto &v = dst[i];
+        auto &q = src[i];
+
+        v.Position = q.Position;
+        v.Normal   = OctahedralDecode(q.Normal );
+        v.Tangent  = OctahedralDecode(q.Tangent);
+        v.Texcoord = Vector2{ glm::unpackHalf1x16(q.Texcoord[0]), glm::unpackHalf1x16(q.Texcoord[1]) };
+
+        for (size_t j = 0; j < 4; j++)
+        {
+            v.BoneIds[j] = q.BoneIds[j];
+            v.Weights[j] = q.Weights[j] / 255.0f;
+        }
+    }
+}
+
+MeshOptimizer::ValidationReport MeshOptimizer::Validate(const SkeletonVertex *original, const QuantizedSkeletonVertex *quantized, size_t count)
+{
+    ValidationReport report{};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        SkeletonVertex decoded{};
+        Dequantize(&decoded, &quantized[i], 1);
+
+        auto &v = original[i];
+        report.MaxPositionError = std::max(report.MaxPositionError, Distance(v.Position, decoded.Position));
+        report.MaxNormalError   = std::max(report.MaxNormalError,   DirectionError(v.Normal,  decoded.Normal ));
+        report.MaxTangentError  = std::max(report.MaxTangentError,  DirectionError(v.Tangent, decoded.Tangent));
+
+        for (int j = 0; j < 2; j++)
+        {
+            float texcoord = j ? v.Texcoord.y : v.Texcoord.x;
+            float error = std::abs(texcoord - (j ? decoded.Texcoord.y : decoded.Texcoord.x)) / std::max(1.0f, std::abs(texcoord));
+            report.MaxTexcoordError = std::max(report.MaxTexcoordError, error);
+        }
+
+        const float *weights = &v.Weights.x;
+        const float *decodedWeights = &decoded.Weights.x;
+        for (size_t j = 0; j < 4; j++)
+        {
+            report.MaxWeightError = std::max(report.MaxWeightError, std::abs(weights[j] - decodedWeights[j]));
+            if (weights[j] > 0.0f && v.BoneIds[j] != decoded.BoneIds[j])
+            {
+                report.BoneIdsMatch = false;
+            }
+        }
+    }
+
+    return report;
+}
+
+}
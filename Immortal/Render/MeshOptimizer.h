@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Core.h"
+#include "Math/Vector.h"
+
+#include <vector>
+
+namespace Immortal
+{
+
+struct SkeletonVertex;
+
+/**
+ * @brief Compact layout of SkeletonVertex, 32 bytes instead of 76.
+ *
+ *  Normal and Tangent are octahedral encoded unit vectors in snorm16,
+ *  Texcoord is stored as two half floats, BoneIds are 8-bit indices
+ *  and Weights are unorm8 that always sum up to 255.
+ */
+struct QuantizedSkeletonVertex
+{
+    Vector3  Position;
+    int16_t  Normal[2];
+    int16_t  Tangent[2];
+    uint16_t Texcoord[2];
+    uint8_t  BoneIds[4];
+    uint8_t  Weights[4];
+};
+
+static_assert(sizeof(QuantizedSkeletonVertex) == 32, "QuantizedSkeletonVertex should be tightly packed");
+
+enum class MeshOptimization : uint32_t
+{
+    None        = 0,
+    VertexCache = BIT(0),
+    VertexFetch = BIT(1),
+    Quantize    = BIT(2),
+    All         = VertexCache | VertexFetch | Quantize,
+
+    /** The quantized layout is opt-in, it needs a pipeline decoding it in the vertex shader */
+    Default     = VertexCache | VertexFetch,
+};
+SL_ENABLE_BITWISE_OPERATOR(MeshOptimization)
+
+class IMMORTAL_API MeshOptimizer
+{
+public:
+    /** The post-transform cache size we are optimizing for, which is a
+     *  reasonable approximation of the modern hardware without knowing the
+     *  exact vendor.
+     */
+    static constexpr uint32_t VertexCacheSize = 32;
+
+    /** The maximum bone id which could be stored in a quantized vertex */
+    static constexpr uint32_t MaxQuantizedBones = 256;
+
+    struct ValidationReport
+    {
+        float MaxPositionError = 0.0f;
+        float MaxNormalError   = 0.0f;
+        float MaxTangentError  = 0.0f;
+        float MaxTexcoordError = 0.0f;
+        float MaxWeightError   = 0.0f;
+        bool  BoneIdsMatch     = true;
+
+        bool Passed() const;
+    };
+
+public:
+    /** Reorder the triangles to maximize the hit rate of the post-transform
+     *  vertex cache, following "Linear-Speed Vertex Cache Optimisation" by
+     *  Tom Forsyth. The winding of each triangle is kept.
+     */
+    static void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+    /** Reorder the vertices in the order they are first referenced by the
+     *  index buffer, and remap the indices accordingly. Unreferenced vertices
+     *  are moved to the tail in their original order.
+     *
+     *  @ret The number of vertices referenced by the index buffer
+     */
+    template <class T>
+    static size_t OptimizeVertexFetch(T *vertices, uint32_t *indices, size_t indexCount, size_t vertexCount)
+    {
+        std::vector<uint32_t> remap;
+        size_t referenced = GenerateVertexFetchRemap(remap, indices, indexCount, vertexCount);
+
+        std::vector<T> source{ vertices, vertices + vertexCount };
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            vertices[remap[i]] = source[i];
+        }
+
+        return referenced;
+    }
+
+    /** Simulate a FIFO post-transform cache
+     *
+     *  @ret The Average Cache Miss Ratio, the number of transformed vertices
+     *       per triangle. 3.0 is the worst case, 0.5 is the best possible.
+     */
+    static float AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = VertexCacheSize);
+
+    static void Quantize(QuantizedSkeletonVertex *dst, const SkeletonVertex *src, size_t count);
+
+    static void Dequantize(SkeletonVertex *dst, const QuantizedSkeletonVertex *src, size_t count);
+
+    /** Compare the quantized vertices against the originals */
+    static ValidationReport Validate(const SkeletonVertex *original, const QuantizedSkeletonVertex *quantized, size_t count);
+
+private:
+    static size_t GenerateVertexFetchRemap(std::vector<uint32_t> &remap, uint32_t *indices, size_t indexCount, size_t vertexCount);
+};
+
+}
@@ -0,0 +1,217 @@
+#include "OffscreenRenderer.h"
+#include "Shared/Instrumentor.h"
+
+#include <mutex>
+
+namespace Immortal
+{
+
+/**
+ * @brief The memory of the pictures read back. The pictures are released on
+ *  whatever thread consumes them, and hold the pool until the last one is gone.
+ */
+class ReadbackPicturePool : public IObject
+{
+public:
+    ReadbackPicturePool(size_t size) :
+        size{ size }
+    {
+
+    }
+
+    ~ReadbackPicturePool()
+    {
+        for (auto &ptr : freeList)
+        {
+            delete[] ptr;
+        }
+    }
+
+    uint8_t *Allocate()
+    {
+        {
+            std::lock_guard lock{ mutex };
+            if (!freeList.empty())
+            {
+                uint8_t *ptr = freeList.back();
+                freeList.pop_back();
+                return ptr;
+            }
+        }
+
+        return new uint8_t[size];
+    }
+
+    void Release(void *ptr)
+    {
+        std::lock_guard lock{ mutex };
+        freeList.emplace_back((uint8_t *)ptr);
+    }
+
+protected:
+    size_t size;
+
+    std::vector<uint8_t *> freeList;
+
+    std::mutex mutex;
+};
+
+OffscreenRenderer::OffscreenRenderer(Device *device, Queue *queue, uint32_t width, uint32_t height, Format format, uint32_t framesInFlight) :
+    queue{ queue },
+    gpuEvent{},
+    buffer{},
+    mapped{},
+    frames(std::max(framesInFlight, 1U)),
+    pictures{},
+    picturePool{},
+    width{ width },
+    height{ height },
+    format{ format },
+    rowPitch{ SLALIGN(uint32_t(width * format.GetTexelSize()), RowPitchAlignment) },
+    frameIndex{},
+    readIndex{}
+{
+    gpuEvent = device->CreateGPUEvent("OffscreenRenderer");
+    picturePool = new ReadbackPicturePool{ width * format.GetTexelSize() * height };
+
+    size_t slotSize = SLALIGN(size_t(rowPitch) * height, size_t(SlotAlignment));
+    buffer = device->CreateBuffer(slotSize * frames.size(), BufferType::TransferDestination);
+    buffer->Map((void **)&mapped, buffer->GetSize(), 0);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        auto &frame = frames[i];
+        frame.renderTarget  = device->CreateRenderTarget(width, height, &format, 1);
+        frame.commandBuffer = device->CreateCommandBuffer(QueueType::Graphics);
+        frame.syncValue     = 0;
+        frame.offset        = uint32_t(slotSize * i);
+        frame.timestamp     = 0;
+        frame.pending       = false;
+    }
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    queue->WaitIdle();
+    pictures.clear();
+    frames.clear();
+
+    if (buffer)
+    {
+        buffer->Unmap();
+        buffer.Reset();
+    }
+    gpuEvent.Reset();
+}
+
+CommandBuffer *OffscreenRenderer::BeginFrame()
+{
+    SL_PROFILE_FUNCTION();
+    auto &frame = frames[frameIndex];
+    if (frame.pending)
+    {
+        /** All the frames are in flight, and this one is the oldest */
+        gpuEvent->Wait(frame.syncValue, WaitTimeout);
+    }
+    Collect();
+
+    if (frame.pending)
+    {
+        /** Its slot is still to be read back, but the pictures are full since Readback is not called */
+        LOG::WARN("The frames read back are not taken, drop the oldest one");
+        pictures.pop_front();
+        Collect();
+    }
+
+    frame.commandBuffer->Begin();
+    return frame.commandBuffer;
+}
+
+void OffscreenRenderer::EndFrame(float timestamp)
+{
+    SL_PROFILE_FUNCTION();
+    auto &frame = frames[frameIndex];
+
+    CommandBuffer *commandBuffer = frame.commandBuffer;
+    commandBuffer->CopyImageToBuffer(buffer, rowPitch, frame.renderTarget->GetColorAttachment(0), 0, frame.offset);
+    commandBuffer->End();
+
+    queue->Submit(commandBuffer, gpuEvent);
+    frame.syncValue = gpuEvent->GetSyncPoint();
+    frame.timestamp = timestamp;
+    frame.pending   = true;
+
+    SLROTATE(frameIndex, uint32_t(frames.size()));
+}
+
+bool OffscreenRenderer::Readback(Picture *pPicture, bool wait)
+{
+    Collect();
+    if (pictures.empty() && wait && frames[readIndex].pending)
+    {
+        gpuEvent->Wait(frames[readIndex].syncValue, WaitTimeout);
+        Collect();
+    }
+
+    if (pictures.empty())
+    {
+        return false;
+    }
+
+    *pPicture = std::move(pictures.front());
+    pictures.pop_front();
+
+    return true;
+}
+
+void OffscreenRenderer::Flush()
+{
+    SL_PROFILE_FUNCTION();
+    uint32_t last = (frameIndex + uint32_t(frames.size()) - 1) % uint32_t(frames.size());
+    if (frames[last].pending)
+    {
+        gpuEvent->Wait(frames[last].syncValue, WaitTimeout);
+    }
+    Collect();
+}
+
+void OffscreenRenderer::Collect()
+{
+    SL_PROFILE_FUNCTION();
+    uint64_t completion = gpuEvent->GetCompletionValue();
+
+    size_t pitch = size_t(width) * format.GetTexelSize();
+    while (pictures.size() < frames.size() && frames[readIndex].pending && frames[readIndex].syncValue <= completion)
+    {
+        auto &frame = frames[readIndex];
+        frame.pending = false;
+        SLROTATE(readIndex, uint32_t(frames.size()));
+
+        uint8_t *data = picturePool->Allocate();
+        const uint8_t *src = mapped + frame.offset;
+        if (pitch == rowPitch)
+        {
+            memcpy(data, src, pitch * height);
+        }
+        else
+        {
+            for (uint32_t y = 0; y < height; y++)
+            {
+                memcpy(data + y * pitch, src + size_t(y) * rowPitch, pitch);
+            }
+        }
+
+        Picture picture{ width, height, format };
+        picture.SetData(data);
+        picture.SetStride(0, uint32_t(pitch));
+        picture.SetTimestamp(frame.timestamp);
+        picture.SetMemoryType(Vision::PictureMemoryType::System);
+        picture.SetRelease([pool = picturePool] (void *ptr) {
+            pool->Release(ptr);
+        });
+
+        pictures.emplace_back(std::move(picture));
+    }
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core.h"
+#include "Graphics/LightGraphics.h"
+#include "Vision/Picture.h"
+
+#include <deque>
+#include <vector>
+
+namespace Immortal
+{
+
+class ReadbackPicturePool;
+
+/**
+ * @brief Renders without a window and reads the frames back, for the batch
+ *  jobs like thumbnails, video frame export and regression tests.
+ *
+ *  Every frame in flight owns a render target, a command buffer and a slot of
+ *  one persistently mapped readback buffer. Ending a frame records the copy of
+ *  its color attachment and submits without waiting. A frame is copied into a
+ *  pooled picture only after the GPU passed its sync point, so the recording of
+ *  the next frames overlaps the rendering and the readback of the previous ones,
+ *  and the CPU only waits when all the frames are in flight.
+ */
+class IMMORTAL_API OffscreenRenderer
+{
+public:
+    static constexpr uint32_t DefaultFramesInFlight = 3;
+
+    /** The row pitch D3D12 requires for the copies, which every backend accepts */
+    static constexpr uint32_t RowPitchAlignment = 256;
+
+    static constexpr uint32_t SlotAlignment = 512;
+
+    static constexpr uint64_t WaitTimeout = 0xffffffff;
+
+    struct Frame
+    {
+        URef<RenderTarget>  renderTarget;
+        URef<CommandBuffer> commandBuffer;
+        uint64_t            syncValue;
+        uint32_t            offset;
+        float               timestamp;
+        bool                pending;
+    };
+
+public:
+    OffscreenRenderer(Device *device, Queue *queue, uint32_t width, uint32_t height, Format format = Format::RGBA8, uint32_t framesInFlight = DefaultFramesInFlight);
+
+    ~OffscreenRenderer();
+
+    /**
+     * @brief Begin recording the next frame. The oldest frame is waited for and
+     *  read back first if all of them are still in flight. The pictures not
+     *  taken are bounded by the frames in flight, beyond that the oldest one is
+     *  dropped to read back the frame.
+     */
+    CommandBuffer *BeginFrame();
+
+    /**
+     * @brief Record the readback of the frame and submit it
+     * @param timestamp Carried to the picture read back
+     */
+    void EndFrame(float timestamp = 0);
+
+    /**
+     * @brief Take the oldest frame read back. The frames come out in the order submitted.
+     * @param wait Wait for the oldest frame in flight if none is read back yet
+     * @ret false if there is no frame to take
+     */
+    bool Readback(Picture *pPicture, bool wait = false);
+
+    /** @brief Wait for all the frames in flight, which can be taken by Readback afterwards */
+    void Flush();
+
+    RenderTarget *GetRenderTarget() const
+    {
+        return frames[frameIndex].renderTarget;
+    }
+
+    uint32_t GetWidth() const
+    {
+        return width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return height;
+    }
+
+    uint32_t GetFramesInFlight() const
+    {
+        return uint32_t(frames.size());
+    }
+
+protected:
+    /** Move the frames the GPU completed into the pictures, in the order submitted, until there are as many pictures as frames */
+    void Collect();
+
+protected:
+    Queue *queue;
+
+    URef<GPUEvent> gpuEvent;
+
+    URef<Buffer> buffer;
+
+    uint8_t *mapped;
+
+    std::vector<Frame> frames;
+
+    std::deque<Picture> pictures;
+
+    Ref<ReadbackPicturePool> picturePool;
+
+    uint32_t width;
+
+    uint32_t height;
+
+    Format format;
+
+    uint32_t rowPitch;
+
+    /** The index of the frame to record next */
+    uint32_t frameIndex;
+
+    /** The index of the oldest frame in flight */
+    uint32_t readIndex;
+};
+
+}
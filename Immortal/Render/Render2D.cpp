@@ -2,7 +2,14 @@
 
 #include "Graphics.h"
 #include "FileSystem/FileSystem.h"
+#include "Shared/Async.h"
 #include <array>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+#ifdef SL_ARCH_X86
+#include <immintrin.h>
+#endif
 
 namespace Immortal
 {
@@ -13,11 +20,27 @@ Ref<GraphicsPipeline> Render2D::pipeline{ nullptr };
 
 Ref<Buffer> Render2D::uniform;
 
+InputElementDescription Render2D::RectInstance::Description()
+{
+    return {
+        InputRate::Instance,
+        {
+            { Format::VECTOR4,             "BASIS"         },
+            { Format::VECTOR3,             "TRANSLATION"   },
+            { Format::R8G8B8A8_UNORM,      "COLOR"         },
+            { Format::R16G16B16A16_SFLOAT, "UV_RECT"       },
+            { Format::R16_UINT,            "INDEX"         },
+            { Format::R16_SFLOAT,          "TILING_FACTOR" },
+            { Format::INT,                 "OBJECT_ID"     },
+        }
+    };
+}
+
 void Render2D::Setup()
 {
 	//data.textureDescriptorBuffer = Render::CreateDescriptor<Texture>(Data::MaxTextureSlots);
 
-    data.RectVertexBuffer.resize(data.MaxVertices);
+    SetupBatch();
 	//pipeline = Render::CreateGraphicsPipeline(Render::GetShader("Render2D"));
 	uniform = Graphics::CreateBuffer(sizeof(Matrix4), BufferType::ConstantBuffer);
 
@@ -32,6 +55,10 @@ void Render2D::Setup()
 
     //pipeline->Set(Render::CreateBuffer(data.MaxVertices * sizeof(RectVertex), Buffer::Type::Vertex));
 
+    /** The instanced path uses Render2DInstanced with RectInstance::Description()
+     *  and a MaxRects * sizeof(RectInstance) vertex buffer, without index buffer.
+     */
+
     {
         std::unique_ptr<uint32_t> rectIndices;
         rectIndices.reset(new uint32_t[data.MaxIndices]);
@@ -62,13 +89,22 @@ void Render2D::Setup()
         data.ActiveTextures[i] = data.WhiteTexture;
     }
     isTextureChanged = true;
+}
+
+void Render2D::SetupBatch()
+{
+    data.RectVertexBuffer.resize(data.MaxVertices);
+    data.RectInstanceBuffer.resize(data.MaxRects);
+    data.SpriteTextureIndices.resize(data.MaxRects);
 
     data.RectVertexPositions[0] = { -0.5f, -0.5f, 0.0f, 1.0f };
     data.RectVertexPositions[1] = {  0.5f, -0.5f, 0.0f, 1.0f };
     data.RectVertexPositions[2] = {  0.5f,  0.5f, 0.0f, 1.0f };
     data.RectVertexPositions[3] = { -0.5f,  0.5f, 0.0f, 1.0f };
 
-    data.pRectVertex = data.RectVertexBuffer.data();
+    data.pRectVertex   = data.RectVertexBuffer.data();
+    data.pRectInstance = data.RectInstanceBuffer.data();
+    data.TextureSlots.Clear();
 }
 
 void Render2D::Release()
@@ -77,6 +113,9 @@ void Render2D::Release()
     uniform.Reset();
     data.WhiteTexture.Reset();
     data.RectVertexBuffer.clear();
+    data.RectInstanceBuffer.clear();
+    data.SpriteTextureIndices.clear();
+    data.TextureSlots.Clear();
     pipeline.Reset();
 
     for (auto &t : data.ActiveTextures)
@@ -90,15 +129,36 @@ void Render2D::Shutdown()
 
 }
 
+void Render2D::SetMode(Mode value)
+{
+    if (mode == value)
+    {
+        return;
+    }
+
+    NextBatch();
+    mode = value;
+}
+
 void Render2D::Flush()
 {
-    if (!data.RectIndexCount)
+    if (!data.RectIndexCount && !data.RectInstanceCount)
     {
         return;
     }
 
-    uint32_t dataSize = data.pRectVertex - data.RectVertexBuffer.data();
-    //pipeline->Update(dataSize, data.RectVertexBuffer.data());
+    size_t dataSize = 0;
+    if (mode == Mode::Instanced)
+    {
+        dataSize = (data.pRectInstance - data.RectInstanceBuffer.data()) * sizeof(RectInstance);
+        //pipeline->Update(dataSize, data.RectInstanceBuffer.data());
+    }
+    else
+    {
+        dataSize = (data.pRectVertex - data.RectVertexBuffer.data()) * sizeof(RectVertex);
+        //pipeline->Update(dataSize, data.RectVertexBuffer.data());
+    }
+    data.Stats.UploadedBytes += dataSize;
 
     if (isTextureChanged)
     {
@@ -110,35 +170,105 @@ void Render2D::Flush()
 
     //pipeline->ElementCount = data.RectIndexCount;
     //Render::Draw(pipeline);
+    // or, for the instanced path, commandBuffer->DrawInstanced(6, data.RectInstanceCount, 0, 0);
 
-    data.RectIndexCount = 0;
-    data.pRectVertex = data.RectVertexBuffer.data();
+    data.RectIndexCount    = 0;
+    data.pRectVertex       = data.RectVertexBuffer.data();
+    data.RectInstanceCount = 0;
+    data.pRectInstance     = data.RectInstanceBuffer.data();
     data.Stats.DrawCalls++;
 }
 
 void Render2D::DrawRect(const Matrix4 &transform, const Vector4 &color, int object)
 {
-    constexpr size_t RectVertexCount  = 4;
-    constexpr float textureIndex      = 0.0f;
-    static Vector2 textureCoords[] = {
+    if (IsBatchFull())
+    {
+        NextBatch();
+    }
+
+    PushRect(transform, color, 0, 1.0f, object);
+}
+
+void Render2D::DrawRect(const Matrix4 &transform, const Ref<Texture> &texture, float tilingFactor, const Vector4 &tintColor, int object)
+{
+    if (IsBatchFull())
+    {
+        NextBatch();
+    }
+
+    int32_t textureIndex = AcquireTextureSlot(texture);
+    if (textureIndex == TextureSlotTable::Invalid)
+    {
+        NextBatch();
+        textureIndex = AcquireTextureSlot(texture);
+    }
+
+    PushRect(transform, tintColor, textureIndex, tilingFactor, object);
+}
+
+int32_t Render2D::AcquireTextureSlot(Texture *texture)
+{
+    if (!texture || texture == data.WhiteTexture)
+    {
+        return 0;
+    }
+
+    int32_t slot = data.TextureSlots.Find(texture);
+    if (slot != TextureSlotTable::Invalid)
+    {
+        return slot;
+    }
+
+    if (data.TextureSlotIndex >= Data::MaxTextureSlots)
+    {
+        return TextureSlotTable::Invalid;
+    }
+
+    slot = data.TextureSlotIndex++;
+    data.TextureSlots.Insert(texture, slot);
+    data.ActiveTextures[slot] = texture;
+	//texture->As(data.textureDescriptorBuffer, slot);
+    isTextureChanged = true;
+
+    return slot;
+}
+
+static inline void BuildRectInstance(Render2D::RectInstance *dst, const Matrix4 &transform, const Vector4 &color, const Vector4 &uvRect, float textureIndex, float tilingFactor, int object)
+{
+    uint64_t halfUVRect = glm::packHalf4x16(uvRect);
+
+    dst->Basis        = Vector4{ transform[0][0], transform[0][1], transform[1][0], transform[1][1] };
+    dst->Translation  = Vector3{ transform[3][0], transform[3][1], transform[3][2] };
+    dst->Color        = glm::packUnorm4x8(color);
+    memcpy(dst->UVRect, &halfUVRect, sizeof(dst->UVRect));
+    dst->TexIndex     = (uint16_t)textureIndex;
+    dst->TilingFactor = glm::packHalf1x16(tilingFactor);
+    dst->Object       = object;
+}
+
+void Render2D::PushRect(const Matrix4 &transform, const Vector4 &color, int32_t textureIndex, float tilingFactor, int object)
+{
+    if (mode == Mode::Instanced)
+    {
+        BuildRectInstance(data.pRectInstance++, transform, color, Vector4{ 0.0f, 0.0f, 1.0f, 1.0f }, (float)textureIndex, tilingFactor, object);
+        data.RectInstanceCount++;
+        data.Stats.RectCount++;
+        return;
+    }
+
+    static const Vector2 textureCoords[] = {
         { 0.0f, 0.0f },
         { 1.0f, 0.0f },
         { 1.0f, 1.0f },
         { 0.0f, 1.0f }
     };
-    constexpr float tilingFactor = 1.0f;
-
-    if (data.RectIndexCount >= Data::MaxIndices)
-    {
-        NextBatch();
-    }
 
-    for (size_t i = 0; i < RectVertexCount; i++, data.pRectVertex++)
+    for (size_t i = 0; i < 4; i++, data.pRectVertex++)
     {
         data.pRectVertex->Position     = Vector4{ transform * data.RectVertexPositions[i] };
         data.pRectVertex->Color        = color;
         data.pRectVertex->TexCoord     = textureCoords[i];
-        data.pRectVertex->TexIndex     = textureIndex;
+        data.pRectVertex->TexIndex     = (float)textureIndex;
         data.pRectVertex->TilingFactor = tilingFactor;
         data.pRectVertex->Object       = object;
     }
@@ -146,48 +276,153 @@ void Render2D::DrawRect(const Matrix4 &transform, const Vector4 &color, int obje
     data.Stats.RectCount++;
 }
 
-void Render2D::DrawRect(const Matrix4 &transform, const Ref<Texture> &texture, float tilingFactor, const Vector4 &tintColor, int object)
+static inline void BuildRectVertex(Render2D::RectVertex *dst, const Render2D::Sprite &sprite, float textureIndex)
 {
-    constexpr size_t RectVertexCount = 4;
-    static Vector2 textureCoords[] = {
-        { 0.0f, 0.0f },
-        { 1.0f, 0.0f },
-        { 1.0f, 1.0f },
-        { 0.0f, 1.0f }
+    const Vector2 textureCoords[] = {
+        { sprite.UVRect.x, sprite.UVRect.y },
+        { sprite.UVRect.z, sprite.UVRect.y },
+        { sprite.UVRect.z, sprite.UVRect.w },
+        { sprite.UVRect.x, sprite.UVRect.w }
+    };
+
+#ifdef SL_ARCH_X86
+    /** The rect corners are (+-0.5, +-0.5, 0, 1), so each position is
+     *  column3 +- 0.5 * column0 +- 0.5 * column1 of the transform
+     */
+    const float *m = &sprite.Transform[0][0];
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(m + 0), half);
+    __m128 y = _mm_mul_ps(_mm_loadu_ps(m + 4), half);
+    __m128 w = _mm_loadu_ps(m + 12);
+
+    __m128 bottom = _mm_sub_ps(w, y);
+    __m128 top    = _mm_add_ps(w, y);
+    __m128 positions[] = {
+        _mm_sub_ps(bottom, x),
+        _mm_add_ps(bottom, x),
+        _mm_add_ps(top,    x),
+        _mm_sub_ps(top,    x),
     };
 
-    if (data.RectIndexCount >= Data::MaxIndices || data.TextureSlotIndex >= Data::MaxTextureSlots)
+    __m128 color = _mm_loadu_ps(&sprite.Color.x);
+    for (size_t i = 0; i < 4; i++)
     {
-        NextBatch();
+        /** Position is 12 bytes, stored as x, y in 64 bits and z in 32 bits */
+        _mm_storel_pi((__m64 *)&dst[i].Position.x, positions[i]);
+        _mm_store_ss(&dst[i].Position.z, _mm_movehl_ps(positions[i], positions[i]));
+        _mm_storeu_ps(&dst[i].Color.x, color);
+        dst[i].TexCoord     = textureCoords[i];
+        dst[i].TexIndex     = textureIndex;
+        dst[i].TilingFactor = sprite.TilingFactor;
+        dst[i].Object       = sprite.Object;
+    }
+#else
+    for (size_t i = 0; i < 4; i++)
+    {
+        dst[i].Position     = Vector4{ sprite.Transform * Render2D::data.RectVertexPositions[i] };
+        dst[i].Color        = sprite.Color;
+        dst[i].TexCoord     = textureCoords[i];
+        dst[i].TexIndex     = textureIndex;
+        dst[i].TilingFactor = sprite.TilingFactor;
+        dst[i].Object       = sprite.Object;
     }
+#endif
+}
 
-    uint32_t textureIndex;
-    for (textureIndex = 0; textureIndex < SL_ARRAY_LENGTH(data.ActiveTextures); textureIndex++)
+/** Split [0, count) into contiguous ranges on the thread pool, the calling
+ *  thread builds the first range itself.
+ */
+template <class F>
+static void ParallelBuild(size_t count, F &&build)
+{
+    constexpr size_t SpritesPerTask = 2048;
+
+    size_t taskCount = std::min<size_t>(count / SpritesPerTask, std::thread::hardware_concurrency());
+    if (taskCount < 2 || !Async::threadPool)
     {
-        //if (*data.ActiveTextures[textureIndex] == *texture)
-        {
-            break;
-        }
+        build(0, count);
+        return;
     }
-    if (textureIndex == SL_ARRAY_LENGTH(data.ActiveTextures))
+
+    size_t stride = (count + taskCount - 1) / taskCount;
+    std::vector<std::future<void>> futures;
+    futures.reserve(taskCount - 1);
+    for (size_t begin = stride; begin < count; begin += stride)
     {
-        data.ActiveTextures[data.TextureSlotIndex] = texture;
-		//texture->As(data.textureDescriptorBuffer, data.TextureSlotIndex);
-        textureIndex = data.TextureSlotIndex++;
-        isTextureChanged = true;
+        futures.emplace_back(Async::Execute([=] { build(begin, std::min(begin + stride, count)); }));
     }
 
-    for (size_t i = 0; i < RectVertexCount; i++, data.pRectVertex++)
+    build(0, stride);
+    for (auto &future : futures)
     {
-        data.pRectVertex->Position     = Vector4{ transform * data.RectVertexPositions[i] };
-        data.pRectVertex->Color        = tintColor;
-        data.pRectVertex->TexCoord     = textureCoords[i];
-        data.pRectVertex->TexIndex     = textureIndex;
-        data.pRectVertex->TilingFactor = tilingFactor;
-        data.pRectVertex->Object       = object;
+        future.wait();
+    }
+}
+
+void Render2D::BuildRectVertices(RectVertex *dst, const Sprite *sprites, const float *textureIndices, size_t count)
+{
+    ParallelBuild(count, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            BuildRectVertex(dst + i * 4, sprites[i], textureIndices[i]);
+        }
+    });
+}
+
+void Render2D::BuildRectInstances(RectInstance *dst, const Sprite *sprites, const float *textureIndices, size_t count)
+{
+    ParallelBuild(count, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const auto &sprite = sprites[i];
+            BuildRectInstance(dst + i, sprite.Transform, sprite.Color, sprite.UVRect, textureIndices[i], sprite.TilingFactor, sprite.Object);
+        }
+    });
+}
+
+void Render2D::DrawSprites(std::span<const Sprite> sprites)
+{
+    size_t submitted = 0;
+    while (submitted < sprites.size())
+    {
+        if (IsBatchFull())
+        {
+            NextBatch();
+        }
+
+        size_t available = mode == Mode::Instanced ? Data::MaxRects - data.RectInstanceCount : (Data::MaxIndices - data.RectIndexCount) / 6;
+        size_t capacity  = std::min<size_t>(available, sprites.size() - submitted);
+        size_t count = 0;
+        for (; count < capacity; count++)
+        {
+            int32_t slot = AcquireTextureSlot(sprites[submitted + count].pTexture);
+            if (slot == TextureSlotTable::Invalid)
+            {
+                break;
+            }
+            data.SpriteTextureIndices[count] = (float)slot;
+        }
+
+        if (mode == Mode::Instanced)
+        {
+            BuildRectInstances(data.pRectInstance, &sprites[submitted], data.SpriteTextureIndices.data(), count);
+            data.pRectInstance     += count;
+            data.RectInstanceCount += count;
+        }
+        else
+        {
+            BuildRectVertices(data.pRectVertex, &sprites[submitted], data.SpriteTextureIndices.data(), count);
+            data.pRectVertex    += count * 4;
+            data.RectIndexCount += count * 6;
+        }
+        data.Stats.RectCount += count;
+        submitted += count;
+
+        if (submitted < sprites.size())
+        {
+            NextBatch();
+        }
     }
-    data.RectIndexCount += 6;
-    data.Stats.RectCount++;
 }
 
 Render2D::Statistics Render2D::Stats()
@@ -8,6 +8,7 @@
 #include "Graphics/LightGraphics.h"
 
 #include <array>
+#include <span>
 
 namespace Immortal
 {
@@ -15,6 +16,12 @@ namespace Immortal
 class IMMORTAL_API Render2D
 {
 public:
+    enum class Mode
+    {
+        Vertex,    /** Four RectVertex per rect, indexed */
+        Instanced  /** One RectInstance per rect, the quad is generated in the vertex shader */
+    };
+
     struct RectVertex
     {
         Vector3 Position;
@@ -25,6 +32,24 @@ public:
         int     Object;
     };
 
+    /**
+     * @brief Per-instance record of a rect, 48 bytes instead of 4 RectVertex
+     *  and 6 indices. Basis holds the x and y columns of the 2D part of the
+     *  transform, the UV rect and the tiling factor are half floats.
+     */
+    struct RectInstance
+    {
+        Vector4  Basis;
+        Vector3  Translation;
+        uint32_t Color;
+        uint16_t UVRect[4];
+        uint16_t TexIndex;
+        uint16_t TilingFactor;
+        int32_t  Object;
+
+        static InputElementDescription Description();
+    };
+
     struct LineVertex
     {
         Vector3 Position;
@@ -39,10 +64,71 @@ public:
         Vector4 Color;
     };
 
+    struct Sprite
+    {
+        Matrix4  Transform;
+        Vector4  Color        = Vector4{ 1.0f };
+        Vector4  UVRect       = Vector4{ 0.0f, 0.0f, 1.0f, 1.0f };
+        Texture *pTexture     = nullptr;
+        float    TilingFactor = 1.0f;
+        int      Object       = -1;
+    };
+
+    /** Open addressing hash table from texture to the slot in the batch,
+     *  which is cleared at the start of every batch.
+     */
+    class TextureSlotTable
+    {
+    public:
+        static constexpr uint32_t Capacity = 64;
+        static constexpr int32_t  Invalid  = -1;
+
+    public:
+        void Clear()
+        {
+            keys.fill(nullptr);
+        }
+
+        int32_t Find(const Texture *texture) const
+        {
+            for (uint32_t i = Hash(texture); keys[i]; i = (i + 1) & (Capacity - 1))
+            {
+                if (keys[i] == texture)
+                {
+                    return slots[i];
+                }
+            }
+            return Invalid;
+        }
+
+        void Insert(const Texture *texture, int32_t slot)
+        {
+            uint32_t i = Hash(texture);
+            while (keys[i])
+            {
+                i = (i + 1) & (Capacity - 1);
+            }
+            keys[i]  = texture;
+            slots[i] = slot;
+        }
+
+    protected:
+        static uint32_t Hash(const Texture *texture)
+        {
+            return (uint32_t)((((uint64_t)texture >> 4) * 0x9E3779B97F4A7C15ull) >> 58);
+        }
+
+    protected:
+        std::array<const Texture *, Capacity> keys{};
+
+        std::array<int32_t, Capacity> slots{};
+    };
+
     struct Statistics
     {
-        uint32_t DrawCalls = 0;
-        uint32_t RectCount = 0;
+        uint32_t DrawCalls     = 0;
+        uint32_t RectCount     = 0;
+        uint64_t UploadedBytes = 0;
 
         uint32_t TotalVertexCount() const
         {
@@ -72,30 +158,56 @@ public:
         uint32_t RectIndexCount = 0;
         std::vector<RectVertex> RectVertexBuffer;
 
+        uint32_t RectInstanceCount = 0;
+        std::vector<RectInstance> RectInstanceBuffer;
+
         std::array<Ref<Texture>, MaxTextureSlots> ActiveTextures;
         uint32_t TextureSlotIndex = 1; // 0 = white texture
+        TextureSlotTable TextureSlots;
+
+        std::vector<float> SpriteTextureIndices;
 
         Vector4 RectVertexPositions[4];
 
         Statistics Stats;
 
         RectVertex *pRectVertex = nullptr;
+
+        RectInstance *pRectInstance = nullptr;
     };
 
 public:
     static void Setup();
 
+    /** Prepare the CPU side of batching only, which is enough to build
+     *  batches without a device, e.g. for benchmarking.
+     */
+    static void SetupBatch();
+
     static void Release();
 
     static void Shutdown();
 
     static void Flush();
 
+    /** Switch between the vertex and the instanced path, which flushes the
+     *  pending batch first.
+     */
+    static void SetMode(Mode value);
+
+    static Mode GetMode()
+    {
+        return mode;
+    }
+
     static void StartBatch()
     {
-        data.RectIndexCount   = 0;
-        data.pRectVertex      = data.RectVertexBuffer.data(); // reset to start
-        data.TextureSlotIndex = 1;
+        data.RectIndexCount    = 0;
+        data.pRectVertex       = data.RectVertexBuffer.data(); // reset to start
+        data.RectInstanceCount = 0;
+        data.pRectInstance     = data.RectInstanceBuffer.data();
+        data.TextureSlotIndex  = 1;
+        data.TextureSlots.Clear();
     }
 
     static void NextBatch()
@@ -184,6 +296,26 @@ public:
         DrawRect(transform, src.Sprite, src.TilingFactor, src.Color, object);
     }
 
+    /** Submit a span of sprites. The textures are resolved in order on the
+     *  calling thread, and the vertices or instances of each batch are built
+     *  on the thread pool, each task owning a contiguous range of the buffer.
+     */
+    static void DrawSprites(std::span<const Sprite> sprites);
+
+    static void BuildRectVertices(RectVertex *dst, const Sprite *sprites, const float *textureIndices, size_t count);
+
+    static void BuildRectInstances(RectInstance *dst, const Sprite *sprites, const float *textureIndices, size_t count);
+
+protected:
+    static int32_t AcquireTextureSlot(Texture *texture);
+
+    static bool IsBatchFull()
+    {
+        return mode == Mode::Instanced ? data.RectInstanceCount >= Data::MaxRects : data.RectIndexCount >= Data::MaxIndices;
+    }
+
+    static void PushRect(const Matrix4 &transform, const Vector4 &color, int32_t textureIndex, float tilingFactor, int object);
+
 public:
     static Data data;
 
@@ -194,6 +326,10 @@ public:
     static Ref<Buffer> uniform;
 
     static inline bool isTextureChanged = false;
+
+    static inline Mode mode = Mode::Vertex;
 };
 
+static_assert(sizeof(Render2D::RectInstance) == 48, "RectInstance should be tightly packed");
+
 }
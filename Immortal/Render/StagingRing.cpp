@@ -0,0 +1,168 @@
+#include "StagingRing.h"
+#include "Shared/Instrumentor.h"
+
+#include <thread>
+
+namespace Immortal
+{
+
+StagingRing::StagingRing(Device *device, AsyncComputeThread *thread, size_t size) :
+    thread{ thread },
+    buffer{},
+    mapped{},
+    size{ size },
+    head{},
+    tail{},
+    recordingQueued{}
+{
+    buffer = device->CreateBuffer(size, BufferType::TransferSource);
+    buffer->Map((void **)&mapped, size, 0);
+}
+
+StagingRing::~StagingRing()
+{
+    if (buffer)
+    {
+        buffer->Unmap();
+        buffer.Reset();
+    }
+}
+
+StagingRing::Allocation StagingRing::Allocate(size_t size, size_t alignment)
+{
+    SL_PROFILE_FUNCTION();
+    Allocation allocation{};
+    if (size > this->size)
+    {
+        return allocation;
+    }
+
+    Region flushed{};
+    std::unique_lock lock{ mutex };
+    while (true)
+    {
+        Retire();
+        if (TryAllocate(size, alignment, &allocation))
+        {
+            return allocation;
+        }
+
+        Region front = regions.front();
+        lock.unlock();
+        if (front.end != flushed.end || front.syncPoint != flushed.syncPoint)
+        {
+            /**
+             * The region in the way might not be submitted yet if this is the thread
+             * ending the frame, so submit the copies recorded without waiting for it.
+             * Flush again once it is recorded, in case its recording came after.
+             */
+            thread->Execute<AsyncTask>(AsyncTaskType::Flush);
+            flushed = front;
+        }
+
+        /** Sleep on the timeline once submitted, otherwise the copy is about to be recorded */
+        if (front.syncPoint == PendingSyncPoint || !thread->Wait(front.syncPoint))
+        {
+            std::this_thread::yield();
+        }
+        lock.lock();
+    }
+}
+
+void StagingRing::Upload(Texture *texture, const Allocation &allocation, uint32_t pitch, bool mipmaps)
+{
+    std::lock_guard lock{ mutex };
+    copies.emplace_back(Copy{
+        .texture = texture,
+        .end     = allocation.end,
+        .offset  = allocation.offset,
+        .pitch   = pitch,
+        .mipmaps = mipmaps,
+    });
+
+    if (!recordingQueued)
+    {
+        recordingQueued = true;
+        thread->Execute<RecordingTask>([this] (uint64_t sync, CommandBuffer *commandBuffer) {
+            Record(sync, commandBuffer);
+        });
+    }
+}
+
+bool StagingRing::TryAllocate(size_t size, size_t alignment, Allocation *pAllocation)
+{
+    uint64_t offset = SLALIGN(head, alignment);
+    if ((offset % this->size) + size > this->size)
+    {
+        offset = (offset / this->size + 1) * this->size;
+    }
+
+    /** Nothing in flight, the end of the ring skipped by the wrap is free as well */
+    if (regions.empty())
+    {
+        tail = offset;
+    }
+
+    if (offset + size - tail > this->size)
+    {
+        return false;
+    }
+
+    head = offset + size;
+    regions.emplace_back(Region{ head, PendingSyncPoint });
+
+    pAllocation->mapped = mapped + offset % this->size;
+    pAllocation->offset = uint32_t(offset % this->size);
+    pAllocation->end    = head;
+
+    return true;
+}
+
+void StagingRing::Retire()
+{
+    /** A region whose copy is not recorded yet blocks all the later ones */
+    while (!regions.empty())
+    {
+        auto &region = regions.front();
+        if (region.syncPoint == PendingSyncPoint || !thread->IsExecutionCompleted(region.syncPoint))
+        {
+            break;
+        }
+        tail = region.end;
+        regions.pop_front();
+    }
+}
+
+void StagingRing::Record(uint64_t sync, CommandBuffer *commandBuffer)
+{
+    SL_PROFILE_FUNCTION();
+    std::vector<Copy> batch;
+    {
+        std::lock_guard lock{ mutex };
+        batch.swap(copies);
+        recordingQueued = false;
+
+        for (auto &copy : batch)
+        {
+            for (auto it = regions.rbegin(); it != regions.rend(); it++)
+            {
+                if (it->end == copy.end)
+                {
+                    it->syncPoint = sync;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto &copy : batch)
+    {
+        commandBuffer->CopyBufferToImage(copy.texture, 0, buffer, copy.pitch, copy.offset);
+        if (copy.mipmaps)
+        {
+            commandBuffer->GenerateMipMaps(copy.texture, Filter::Linear);
+        }
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Core.h"
+#include "Graphics/LightGraphics.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Immortal
+{
+
+/**
+ * @brief A persistently mapped upload buffer shared by all the uploads.
+ *
+ *  Uploads are sub-allocated linearly and wrap around, the copies queued in
+ *  between two recordings are recorded as one batch, and a region is only
+ *  reused after the GPU has passed the sync point it was recorded at. When
+ *  the ring is full, the allocating thread submits the copies recorded and
+ *  waits on the timeline for the oldest region, so the staging memory never
+ *  grows.
+ */
+class StagingRing
+{
+public:
+    static constexpr size_t DefaultSize = 64 * 1024 * 1024;
+
+    static constexpr uint64_t PendingSyncPoint = ~uint64_t(0);
+
+    struct Allocation
+    {
+        uint8_t *mapped = nullptr;
+        uint32_t offset = 0;
+        uint64_t end    = 0;
+
+        operator bool() const
+        {
+            return !!mapped;
+        }
+    };
+
+    struct Region
+    {
+        uint64_t end;
+        uint64_t syncPoint;
+    };
+
+    struct Copy
+    {
+        Texture *texture;
+        uint64_t end;
+        uint32_t offset;
+        uint32_t pitch;
+        bool     mipmaps;
+    };
+
+public:
+    StagingRing(Device *device, AsyncComputeThread *thread, size_t size = DefaultSize);
+
+    ~StagingRing();
+
+    /** @ret An empty allocation if the size is larger than the ring */
+    Allocation Allocate(size_t size, size_t alignment);
+
+    void Upload(Texture *texture, const Allocation &allocation, uint32_t pitch, bool mipmaps);
+
+    size_t GetSize() const
+    {
+        return size;
+    }
+
+protected:
+    bool TryAllocate(size_t size, size_t alignment, Allocation *pAllocation);
+
+    void Retire();
+
+    void Record(uint64_t sync, CommandBuffer *commandBuffer);
+
+protected:
+    AsyncComputeThread *thread;
+
+    Ref<Buffer> buffer;
+
+    uint8_t *mapped;
+
+    size_t size;
+
+    /** Monotonic positions, the physical offset is the position modulo the size */
+    uint64_t head;
+
+    uint64_t tail;
+
+    std::deque<Region> regions;
+
+    std::vector<Copy> copies;
+
+    bool recordingQueued;
+
+    std::mutex mutex;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "Scene.h"
 
 #include "Framework/Timer.h"
+#include "Shared/Instrumentor.h"
 
 #include "Render/Graphics.h"
 #include "Render/Render2D.h"
@@ -346,8 +347,11 @@ void Scene::OnEvent()
 
 void Scene::OnRenderRuntime()
 {
+    SL_PROFILE_FUNCTION();
+
     // Update Script
     {
+        SL_PROFILE_SCOPE("Scripts");
         registry.view<ScriptComponent>().each([=, this](auto object, ScriptComponent &script) {
                 script.Update((int)object, this, Time::DeltaTime);
             });
@@ -380,6 +384,8 @@ void Scene::OnRenderRuntime()
     }
 
     primaryCamera->SetViewportSize(viewportSize);
+
+    SL_PROFILE_SCOPE("Render");
     OnRender(*primaryCamera);
 }
 
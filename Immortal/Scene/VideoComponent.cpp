@@ -72,14 +72,20 @@ public:
     } state;
 };
 
-Vision::Picture AsyncDecode(const Vision::CodedFrame &codedFrame, Vision::Interface::Codec *decoder)
+template <class T>
+void AsyncDecode(const Vision::CodedFrame &codedFrame, Vision::Interface::Codec *decoder, T &&callback)
 {
     if (codedFrame && decoder->Decode(codedFrame) == CodecError::Succeed)
     {
-        return decoder->GetPicture();
+        do
+        {
+            Vision::Picture picture = decoder->GetPicture();
+            if (picture)
+            {
+                callback(picture);
+            }
+        } while (decoder->PopPicture());
     }
-
-    return Vision::Picture{};
 }
 
 VideoPlayerContext::VideoPlayerContext(Ref<Demuxer> demuxer, Ref<VideoCodec> decoder, Ref<VideoCodec> audioDecoder) :
@@ -118,24 +124,20 @@ VideoPlayerContext::VideoPlayerContext(Ref<Demuxer> demuxer, Ref<VideoCodec> dec
             if (audioDecoder && codedFrame.GetType() == MediaType::Audio)
             {
                 audioThreadPool->Enqueue([=, this] () -> void {
-                    Vision::Picture picture = AsyncDecode(codedFrame, audioDecoder);
-                    if (picture)
-                    {
+                    AsyncDecode(codedFrame, audioDecoder, [this] (const Vision::Picture &picture) {
                         std::unique_lock lock{ mutex.audio };
                         audioFrames.push(picture);
-                    }
+                    });
                 });
             }
 
             if (codedFrame.GetType() == MediaType::Video)
             {
                 videoThreadPool->Enqueue([=, this] () -> void {
-                    Vision::Picture picture = AsyncDecode(codedFrame, decoder);
-                    if (picture)
-                    {
+                    AsyncDecode(codedFrame, decoder, [this] (const Vision::Picture &picture) {
                         std::unique_lock lock{ mutex.video };
                         pictures.push(picture);
-                    }
+                    });
                 });
             }
         }
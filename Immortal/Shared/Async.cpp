@@ -5,13 +5,17 @@ namespace Immortal
 
 std::unique_ptr<ThreadPool> Async::threadPool{ nullptr };
 
+static thread_local const ThreadPool *workerOf = nullptr;
+
 ThreadPool::ThreadPool(uint32_t numThreads) :
-    taskRef{0}
+    taskRef{0},
+    tasked{ true }
 {
     threads.reserve(numThreads);
     for (int i = 0; i < numThreads; i++)
     {
         threads.emplace_back([=, this]() -> void {
+            workerOf = this;
             while (true)
             {
                 Task task;
@@ -82,4 +86,9 @@ const std::atomic<uint32_t> &ThreadPool::TaskSize() const
 	return taskRef;
 }
 
+bool ThreadPool::IsWorkerThread() const
+{
+    return workerOf == this;
+}
+
 }
@@ -118,6 +118,9 @@ public:
 
     const std::atomic<uint32_t> &TaskSize() const;
 
+    /** @ret If called from a worker of the pool, which must not block on the tasks queued behind it */
+    bool IsWorkerThread() const;
+
 public:
     template <class T>
     auto Enqueue(T task)->std::future<decltype(task())>
@@ -0,0 +1,584 @@
+#include "Instrumentor.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Immortal
+{
+
+/**
+ * @brief A single producer single consumer ring of the zones completed on one
+ *  thread. The zones are dropped while the ring is full, which only happens
+ *  when the frames are not ended.
+ */
+class ProfileRing
+{
+public:
+    static constexpr size_t Capacity = 8192;
+
+public:
+    ProfileRing(uint32_t thread) :
+        thread{ thread },
+        head{ 0 },
+        tail{ 0 },
+        cachedTail{ 0 },
+        retired{ false }
+    {
+
+    }
+
+    bool Push(const ProfileZone &zone)
+    {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - cachedTail >= Capacity)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position - cachedTail >= Capacity)
+            {
+                return false;
+            }
+        }
+
+        zones[position & (Capacity - 1)] = zone;
+        head.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    void Consume(std::vector<ProfileZone> &output)
+    {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        uint64_t end = head.load(std::memory_order_acquire);
+        for (; position != end; position++)
+        {
+            output.emplace_back(zones[position & (Capacity - 1)]);
+        }
+        tail.store(position, std::memory_order_release);
+    }
+
+public:
+    uint32_t thread;
+
+protected:
+    alignas(64) std::atomic<uint64_t> head;
+
+    alignas(64) std::atomic<uint64_t> tail;
+
+    alignas(64) uint64_t cachedTail;
+
+public:
+    /** Set when the thread exits, the ring is freed once drained */
+    std::atomic<bool> retired;
+
+protected:
+    ProfileZone zones[Capacity];
+};
+
+struct ProfileThread
+{
+    ~ProfileThread();
+
+    ProfileRing *ring = nullptr;
+
+    /** The path of the innermost zone open on the thread */
+    uint64_t path = 0;
+
+    uint32_t depth = 0;
+};
+
+/** The zones kept while capturing at most, about 160 MB */
+static constexpr size_t MaxCapturedZones = 4 * 1024 * 1024;
+
+/** The zones are only recorded while enabled and something drains them */
+enum ProfilerFlags : uint32_t
+{
+    ProfilerEnabled   = BIT(0),
+    ProfilerConsumed  = BIT(1),
+    ProfilerRecording = ProfilerEnabled | ProfilerConsumed,
+};
+
+static struct
+{
+    /** Enabled unless turned off, consumed once a frame is ended or a capture begins */
+    std::atomic<uint32_t> flags{ ProfilerEnabled };
+
+    std::atomic<bool> capturing{ false };
+
+    std::atomic<uint64_t> dropped{ 0 };
+
+    std::atomic<uint32_t> threads{ 0 };
+
+    /** Guards the rings and the thread names, which are registered from any thread */
+    std::mutex mutex;
+
+    std::vector<ProfileRing *> rings;
+
+    std::unordered_map<uint32_t, std::string> threadNames;
+
+    std::unordered_set<std::string> names;
+
+    /** Only accessed by the thread ending the frames */
+    std::deque<ProfileFrame> frames;
+
+    std::vector<ProfileZone> zones;
+
+    uint64_t frameIndex = 0;
+
+    uint64_t frameBegin = 0;
+
+    /** Guards the capture, which is ended from any thread */
+    std::mutex captureMutex;
+
+    uint64_t captureBegin = 0;
+
+    std::vector<ProfileZone> captured;
+
+    std::vector<std::pair<uint64_t, uint64_t>> capturedFrames;
+} profiler;
+
+static inline uint64_t MixPath(uint64_t parent, const char *name)
+{
+    uint64_t hash = (parent ^ uint64_t(uintptr_t(name))) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+static inline bool IsRecording()
+{
+    return (profiler.flags.load(std::memory_order_relaxed) & ProfilerRecording) == ProfilerRecording;
+}
+
+ProfileThread::~ProfileThread()
+{
+    if (!ring)
+    {
+        return;
+    }
+
+    /** Without anything draining the rings the zones left are never read */
+    std::lock_guard lock{ profiler.mutex };
+    if (profiler.flags.load(std::memory_order_relaxed) & ProfilerConsumed)
+    {
+        ring->retired.store(true, std::memory_order_release);
+    }
+    else
+    {
+        std::erase(profiler.rings, ring);
+        delete ring;
+    }
+}
+
+static ProfileThread &AcquireThread()
+{
+    thread_local ProfileThread thread;
+
+    if (!thread.ring)
+    {
+        thread.ring = new ProfileRing{ profiler.threads.fetch_add(1, std::memory_order_relaxed) };
+        std::lock_guard lock{ profiler.mutex };
+        profiler.rings.emplace_back(thread.ring);
+    }
+
+    return thread;
+}
+
+Instrumentor::Zone::Zone(const char *name) :
+    thread{ nullptr },
+    name{ name },
+    begin{ 0 },
+    parent{ 0 }
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+
+    auto &state = AcquireThread();
+    parent = state.path;
+    state.path = MixPath(parent, name);
+    state.depth++;
+    thread = &state;
+
+    begin = Now();
+}
+
+Instrumentor::Zone::~Zone()
+{
+    if (!thread)
+    {
+        return;
+    }
+
+    uint64_t end = Now();
+
+    auto &state = *(ProfileThread *)thread;
+    uint64_t path = state.path;
+    state.path = parent;
+    state.depth--;
+
+    ProfileZone zone{
+        .Name   = name,
+        .Begin  = begin,
+        .End    = end,
+        .Path   = path,
+        .Parent = parent,
+        .Depth  = state.depth,
+        .Thread = state.ring->thread,
+    };
+    if (!state.ring->Push(zone))
+    {
+        profiler.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Instrumentor::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Instrumentor::SetEnabled(bool enabled)
+{
+    if (enabled)
+    {
+        profiler.flags.fetch_or(ProfilerEnabled, std::memory_order_relaxed);
+    }
+    else
+    {
+        profiler.flags.fetch_and(~uint32_t(ProfilerEnabled), std::memory_order_relaxed);
+    }
+}
+
+bool Instrumentor::IsEnabled()
+{
+    return profiler.flags.load(std::memory_order_relaxed) & ProfilerEnabled;
+}
+
+void Instrumentor::SetThreadName(const char *name)
+{
+    uint32_t thread = AcquireThread().ring->thread;
+
+    std::lock_guard lock{ profiler.mutex };
+    profiler.threadNames[thread] = name;
+}
+
+uint64_t Instrumentor::Path(uint64_t parent, const char *name)
+{
+    return MixPath(parent, name);
+}
+
+const char *Instrumentor::Intern(std::string_view name)
+{
+    std::lock_guard lock{ profiler.mutex };
+    return profiler.names.emplace(name).first->c_str();
+}
+
+uint32_t Instrumentor::CreateTrack(const char *name)
+{
+    uint32_t track = profiler.threads.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard lock{ profiler.mutex };
+    profiler.threadNames[track] = name;
+
+    return track;
+}
+
+void Instrumentor::Submit(const ProfileZone *zones, size_t count)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+
+    auto &state = AcquireThread();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!state.ring->Push(zones[i]))
+        {
+            profiler.dropped.fetch_add(count - i, std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+/** Merge the zones by path, then order the nodes depth first with the heaviest children first */
+static void Aggregate(ProfileFrame &frame, const std::vector<ProfileZone> &zones)
+{
+    struct Accumulator
+    {
+        ProfileNode node;
+        double children;
+        std::vector<size_t> childNodes;
+    };
+
+    std::vector<Accumulator> accumulators;
+    std::unordered_map<uint64_t, size_t> indices;
+    indices.reserve(zones.size());
+
+    for (auto &zone : zones)
+    {
+        auto [it, inserted] = indices.try_emplace(zone.Path, accumulators.size());
+        if (inserted)
+        {
+            accumulators.emplace_back(Accumulator{
+                .node = ProfileNode{
+                    .Name   = zone.Name,
+                    .Path   = zone.Path,
+                    .Parent = zone.Parent,
+                    .Depth  = zone.Depth,
+                    .Calls  = 0,
+                    .Total  = 0,
+                    .Self   = 0,
+                    .Max    = 0,
+                },
+                .children = 0,
+            });
+        }
+
+        double duration = (zone.End - zone.Begin) / 1e6;
+        auto &node = accumulators[it->second].node;
+        node.Calls++;
+        node.Total += duration;
+        node.Max = std::max(node.Max, duration);
+    }
+
+    std::vector<size_t> roots;
+    for (size_t i = 0; i < accumulators.size(); i++)
+    {
+        auto &accumulator = accumulators[i];
+        auto parent = indices.find(accumulator.node.Parent);
+        if (accumulator.node.Parent && parent != indices.end())
+        {
+            accumulators[parent->second].children += accumulator.node.Total;
+            accumulators[parent->second].childNodes.emplace_back(i);
+        }
+        else
+        {
+            /** The parent still open at the end of the frame, shown as a root */
+            roots.emplace_back(i);
+        }
+    }
+
+    auto heaviest = [&] (size_t a, size_t b) {
+        return accumulators[a].node.Total > accumulators[b].node.Total;
+    };
+
+    std::vector<std::pair<size_t, uint32_t>> stack;
+    std::sort(roots.begin(), roots.end(), heaviest);
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+    {
+        stack.emplace_back(*it, 0);
+    }
+
+    frame.Nodes.clear();
+    frame.Nodes.reserve(accumulators.size());
+    while (!stack.empty())
+    {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+
+        auto &accumulator = accumulators[index];
+        auto &node = frame.Nodes.emplace_back(accumulator.node);
+        node.Depth = depth;
+        node.Self  = std::max(0.0, node.Total - accumulator.children);
+
+        auto &children = accumulator.childNodes;
+        std::sort(children.begin(), children.end(), heaviest);
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+        {
+            stack.emplace_back(*it, depth + 1);
+        }
+    }
+}
+
+void Instrumentor::EndFrame()
+{
+    profiler.flags.fetch_or(ProfilerConsumed, std::memory_order_relaxed);
+
+    uint64_t now = Now();
+    if (!profiler.frameBegin)
+    {
+        profiler.frameBegin = now;
+    }
+
+    auto &zones = profiler.zones;
+    zones.clear();
+    {
+        std::lock_guard lock{ profiler.mutex };
+        for (auto &ring : profiler.rings)
+        {
+            ring->Consume(zones);
+        }
+
+        std::erase_if(profiler.rings, [] (ProfileRing *ring) {
+            if (ring->retired.load(std::memory_order_acquire) && ring->Empty())
+            {
+                delete ring;
+                return true;
+            }
+            return false;
+        });
+    }
+
+    if (uint64_t count = profiler.dropped.exchange(0, std::memory_order_relaxed))
+    {
+        LOG::WARN("{} profile zones dropped, the frames were not ended in time", count);
+    }
+
+    if (profiler.capturing.load(std::memory_order_acquire))
+    {
+        std::lock_guard lock{ profiler.captureMutex };
+        auto &captured = profiler.captured;
+        size_t count = std::min(zones.size(), MaxCapturedZones - std::min(captured.size(), MaxCapturedZones));
+        captured.insert(captured.end(), zones.begin(), zones.begin() + count);
+        profiler.capturedFrames.emplace_back(profiler.frameIndex, now);
+    }
+
+    auto &frames = profiler.frames;
+    ProfileFrame frame;
+    if (frames.size() >= History)
+    {
+        /** Reuse the nodes of the oldest frame */
+        frame = std::move(frames.front());
+        frames.pop_front();
+    }
+    frame.Index = profiler.frameIndex++;
+    frame.Begin = profiler.frameBegin;
+    frame.End   = now;
+    Aggregate(frame, zones);
+    frames.emplace_back(std::move(frame));
+
+    profiler.frameBegin = now;
+}
+
+const std::deque<ProfileFrame> &Instrumentor::GetFrames()
+{
+    return profiler.frames;
+}
+
+void Instrumentor::BeginCapture()
+{
+    std::lock_guard lock{ profiler.captureMutex };
+    profiler.captured.clear();
+    profiler.capturedFrames.clear();
+    profiler.captureBegin = Now();
+    profiler.capturing.store(true, std::memory_order_release);
+    profiler.flags.fetch_or(ProfilerConsumed, std::memory_order_relaxed);
+}
+
+bool Instrumentor::IsCapturing()
+{
+    return profiler.capturing.load(std::memory_order_acquire);
+}
+
+static void WriteString(std::ostream &stream, const char *string)
+{
+    stream << '"';
+    for (; *string; string++)
+    {
+        char c = *string;
+        if (c == '"' || c == '\\')
+        {
+            stream << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            stream << ' ';
+        }
+        else
+        {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+bool Instrumentor::EndCapture(const std::string &path)
+{
+    std::vector<ProfileZone> captured;
+    std::vector<std::pair<uint64_t, uint64_t>> capturedFrames;
+    uint64_t captureBegin;
+    {
+        std::lock_guard lock{ profiler.captureMutex };
+        if (!profiler.capturing.exchange(false, std::memory_order_acq_rel))
+        {
+            return false;
+        }
+        captured.swap(profiler.captured);
+        capturedFrames.swap(profiler.capturedFrames);
+        captureBegin = profiler.captureBegin;
+    }
+
+    std::unordered_map<uint32_t, std::string> threadNames;
+    {
+        std::lock_guard lock{ profiler.mutex };
+        threadNames = profiler.threadNames;
+    }
+
+    std::ofstream stream{ path, std::ios::binary };
+    if (!stream.is_open())
+    {
+        LOG::ERR("Failed to open {} to write the profile captured", path);
+        return false;
+    }
+
+    /** The Chrome trace event format, the timestamps are in microseconds since the capture began */
+    auto timestamp = [=] (uint64_t time) {
+        return time > captureBegin ? (time - captureBegin) / 1e3 : 0.0;
+    };
+
+    stream.precision(3);
+    stream << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separate = [&] {
+        if (!first)
+        {
+            stream << ",\n";
+        }
+        first = false;
+    };
+
+    for (auto &[thread, name] : threadNames)
+    {
+        separate();
+        stream << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << thread << ",\"args\":{\"name\":";
+        WriteString(stream, name.c_str());
+        stream << "}}";
+    }
+
+    for (auto &[index, time] : capturedFrames)
+    {
+        separate();
+        stream << "{\"ph\":\"i\",\"s\":\"g\",\"name\":\"Frame " << index << "\",\"pid\":0,\"tid\":0,\"ts\":" << timestamp(time) << "}";
+    }
+
+    for (auto &zone : captured)
+    {
+        if (zone.End < captureBegin)
+        {
+            continue;
+        }
+        separate();
+        stream << "{\"ph\":\"X\",\"name\":";
+        WriteString(stream, zone.Name);
+        stream << ",\"pid\":0,\"tid\":" << zone.Thread << ",\"ts\":" << timestamp(zone.Begin) << ",\"dur\":" << (zone.End - zone.Begin) / 1e3 << "}";
+    }
+
+    stream << "]}\n";
+    stream.close();
+
+    LOG::INFO("{} profile zones captured to {}", captured.size(), path);
+
+    return !stream.fail();
+}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Core.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** The zones compile to nothing when the profiler is disabled */
+#ifndef SL_ENABLE_PROFILER
+#define SL_ENABLE_PROFILER 1
+#endif
+
+namespace Immortal
+{
+
+/** A zone completed on a thread, the times are in nanoseconds of the steady clock */
+struct ProfileZone
+{
+    const char *Name;
+    uint64_t    Begin;
+    uint64_t    End;
+
+    /** A hash of the names from the outermost zone, which is the place of the zone in the hierarchy */
+    uint64_t    Path;
+    uint64_t    Parent;
+    uint32_t    Depth;
+    uint32_t    Thread;
+};
+
+/** The zones of a path merged over a frame, the times are in milliseconds */
+struct ProfileNode
+{
+    const char *Name;
+    uint64_t    Path;
+    uint64_t    Parent;
+    uint32_t    Depth;
+    uint32_t    Calls;
+    double      Total;
+    double      Self;
+    double      Max;
+};
+
+struct ProfileFrame
+{
+    uint64_t Index;
+    uint64_t Begin;
+    uint64_t End;
+
+    /** A parent is always followed by its children, the heaviest first */
+    std::vector<ProfileNode> Nodes;
+
+    double Milliseconds() const
+    {
+        return (End - Begin) / 1e6;
+    }
+};
+
+/**
+ * @brief Hierarchical CPU zones. A zone is recorded into a lock-free ring of
+ *  the thread when it ends. The rings are drained once per frame, where the
+ *  zones are merged by their path into the frame history. While capturing,
+ *  the zones are kept as they are and written as a Chrome trace, which also
+ *  opens in Perfetto. Nothing is recorded until the first frame is ended or
+ *  a capture begins, so the tools that never drain the rings don't fill them.
+ */
+class IMMORTAL_API Instrumentor
+{
+public:
+    static constexpr size_t History = 240;
+
+    class IMMORTAL_API Zone
+    {
+    public:
+        Zone(const char *name);
+
+        ~Zone();
+
+        Zone(const Zone &) = delete;
+
+        Zone &operator=(const Zone &) = delete;
+
+    protected:
+        void *thread;
+
+        const char *name;
+
+        uint64_t begin;
+
+        uint64_t parent;
+    };
+
+public:
+    static uint64_t Now();
+
+    static void SetEnabled(bool enabled);
+
+    /** @ret If not turned off, the zones are still only recorded once they are drained */
+    static bool IsEnabled();
+
+    /** The name of the calling thread in the trace */
+    static void SetThreadName(const char *name);
+
+    /** Drain the zones of all threads into a new frame of the history, called once per frame */
+    static void EndFrame();
+
+    /** The frames merged, the latest at the back. Only accessed by the thread ending the frames */
+    static const std::deque<ProfileFrame> &GetFrames();
+
+    static void BeginCapture();
+
+    /** Stop capturing and write the zones captured as a Chrome trace */
+    static bool EndCapture(const std::string &path);
+
+    static bool IsCapturing();
+
+    /** The path of a zone opened in the zone of parent path, 0 for the outermost */
+    static uint64_t Path(uint64_t parent, const char *name);
+
+    /** A copy of the name kept until exit, for the zones named at runtime */
+    static const char *Intern(std::string_view name);
+
+    /** A timeline not backed by a thread, such as a GPU queue. The zones recorded into it are submitted as they are */
+    static uint32_t CreateTrack(const char *name);
+
+    /** Record the zones timed elsewhere, converted to the clock of Now() */
+    static void Submit(const ProfileZone *zones, size_t count);
+};
+
+}
+
+#if SL_ENABLE_PROFILER
+#define SL_PROFILE_CONCAT_(a, b) a##b
+#define SL_PROFILE_CONCAT(a, b)  SL_PROFILE_CONCAT_(a, b)
+#define SL_PROFILE_SCOPE(name)   ::Immortal::Instrumentor::Zone SL_PROFILE_CONCAT(__profileZone, __LINE__){ name }
+#define SL_PROFILE_FUNCTION()    SL_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define SL_PROFILE_SCOPE(name)
+#define SL_PROFILE_FUNCTION()
+#endif
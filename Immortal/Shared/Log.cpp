@@ -1,15 +1,118 @@
 #include "Log.h"
 
-#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
-#include <spdlog/sinks/rotating_file_sink.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace Immortal
 {
 
 std::shared_ptr<spdlog::logger> LOG::logger;
 
+std::atomic<bool> LOG::async{ false };
+
+std::atomic<bool> LOG::rateLimited{ false };
+
+std::atomic<uint64_t> LOG::dropped{ 0 };
+
+struct LogModule
+{
+    std::atomic<uint32_t> limit{ 0 };
+    std::atomic<int64_t>  window{ 0 };
+    std::atomic<uint32_t> count{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+};
+
+struct LogRingHolder
+{
+    ~LogRingHolder();
+
+    LogRing *ring = nullptr;
+
+    uint64_t generation = 0;
+};
+
+/** The rings of all threads, drained by the logging thread */
+static struct
+{
+    std::mutex mutex;
+
+    std::vector<LogRing *> rings;
+
+    /** Never freed, since the threads cache the modules by the file name of the call site */
+    std::unordered_map<std::string, std::unique_ptr<LogModule>> modules;
+
+    /** Increased whenever the rings are freed, so that a thread allocates a new ring after */
+    std::atomic<uint64_t> generation{ 0 };
+
+    std::thread thread;
+
+    std::atomic<bool> running{ false };
+
+    std::mutex wakeMutex;
+
+    std::condition_variable wakeCondition;
+
+    bool wake = false;
+
+    std::atomic<uint64_t> flushRequested{ 0 };
+
+    std::atomic<uint64_t> flushCompleted{ 0 };
+} logging;
+
+LogRingHolder::~LogRingHolder()
+{
+    if (ring && ring->retired.exchange(true, std::memory_order_acq_rel))
+    {
+        delete ring;
+    }
+}
+
+static inline spdlog::level::level_enum Convert(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Debug: return spdlog::level::debug;
+    case LogLevel::Info:  return spdlog::level::info;
+    case LogLevel::Warn:  return spdlog::level::warn;
+    case LogLevel::Error: return spdlog::level::err;
+    default:
+        return spdlog::level::critical;
+    }
+}
+
+static inline int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string GetModuleName(std::string_view file)
+{
+    auto separator = file.find_last_of("/\\");
+    if (separator != std::string_view::npos)
+    {
+        file.remove_prefix(separator + 1);
+    }
+
+    return std::string{ file.substr(0, file.find('.')) };
+}
+
+static LogModule *ResolveModule(const std::string &name)
+{
+    auto &module = logging.modules[name];
+    if (!module)
+    {
+        module = std::make_unique<LogModule>();
+    }
+
+    return module.get();
+}
+
 void LOG::Setup(bool async)
 {
     std::vector<spdlog::sink_ptr> logSinks;
@@ -19,23 +122,266 @@ void LOG::Setup(bool async)
     logSinks[0]->set_pattern("%n: [%^%l%$][%T]: %v");
     logSinks[1]->set_pattern("[%T] [%l] %n: %v");
 
+    logger = std::make_shared<spdlog::logger>("Immortal", logSinks.begin(), logSinks.end());
+    logger->set_level(spdlog::level::trace);
+
     if (async)
     {
-        spdlog::init_thread_pool(8192, 1);
-        logger = std::make_shared<spdlog::async_logger>("Immortal", logSinks.begin(), logSinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::block);
+        /** The logging thread flushes after every batch written */
+        logger->flush_on(spdlog::level::err);
+
+        logging.generation.fetch_add(1, std::memory_order_release);
+        logging.running.store(true, std::memory_order_release);
+        logging.thread = std::thread{ Run };
+        LOG::async.store(true, std::memory_order_release);
     }
     else
     {
-        logger = std::make_shared<spdlog::logger>("Immortal", logSinks.begin(), logSinks.end());
+        logger->flush_on(spdlog::level::trace);
     }
-    
-    logger->set_level(spdlog::level::trace);
-    logger->flush_on(spdlog::level::trace);
 }
 
 void LOG::Release()
 {
+    if (async.exchange(false))
+    {
+        logging.running.store(false, std::memory_order_release);
+        Wake();
+        logging.thread.join();
+
+        /** The threads still alive may be pushing, they free their rings on the next message or on exit */
+        std::lock_guard lock{ logging.mutex };
+        for (auto &ring : logging.rings)
+        {
+            if (ring->retired.exchange(true, std::memory_order_acq_rel))
+            {
+                delete ring;
+            }
+        }
+        logging.rings.clear();
+        logging.generation.fetch_add(1, std::memory_order_release);
+
+        logging.flushCompleted.store(UINT64_MAX, std::memory_order_release);
+        logging.flushCompleted.notify_all();
+    }
+
     logger.reset();
 }
 
+void LOG::Flush()
+{
+    if (!async.load(std::memory_order_acquire))
+    {
+        if (logger)
+        {
+            logger->flush();
+        }
+        return;
+    }
+
+    uint64_t ticket = logging.flushRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+    Wake();
+
+    uint64_t completed;
+    while ((completed = logging.flushCompleted.load(std::memory_order_acquire)) < ticket)
+    {
+        logging.flushCompleted.wait(completed, std::memory_order_acquire);
+    }
+}
+
+void LOG::SetRateLimit(std::string_view module, uint32_t messagesPerSecond)
+{
+    std::lock_guard lock{ logging.mutex };
+    ResolveModule(std::string{ module })->limit.store(messagesPerSecond, std::memory_order_relaxed);
+    rateLimited.store(true, std::memory_order_relaxed);
+}
+
+LogRing *LOG::AcquireRing()
+{
+    thread_local LogRingHolder holder;
+
+    uint64_t generation = logging.generation.load(std::memory_order_acquire);
+    if (holder.ring && holder.generation == generation)
+    {
+        return holder.ring;
+    }
+    if (holder.ring && holder.ring->retired.exchange(true, std::memory_order_acq_rel))
+    {
+        delete holder.ring;
+    }
+
+    auto *ring = new LogRing;
+    {
+        std::lock_guard lock{ logging.mutex };
+        logging.rings.emplace_back(ring);
+    }
+    holder.ring       = ring;
+    holder.generation = generation;
+
+    return ring;
+}
+
+bool LOG::Admit(const char *file, int64_t timestamp)
+{
+    thread_local std::unordered_map<const char *, LogModule *> cache;
+
+    auto &module = cache[file];
+    if (!module)
+    {
+        std::lock_guard lock{ logging.mutex };
+        module = ResolveModule(GetModuleName(file));
+    }
+
+    uint32_t limit = module->limit.load(std::memory_order_relaxed);
+    if (!limit)
+    {
+        return true;
+    }
+
+    /** A window of one second, the threads racing on a new window may let a few more messages through */
+    int64_t second = timestamp / 1000000000;
+    int64_t window = module->window.load(std::memory_order_relaxed);
+    if (window != second && module->window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+    {
+        module->count.store(0, std::memory_order_relaxed);
+    }
+    if (module->count.fetch_add(1, std::memory_order_relaxed) < limit)
+    {
+        return true;
+    }
+
+    module->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void LOG::Write(Level level, int64_t timestamp, std::string_view message)
+{
+    if (!logger)
+    {
+        fprintf(stderr, "%.*s\n", int(message.size()), message.data());
+        return;
+    }
+
+    auto time = spdlog::log_clock::time_point{ std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds{ timestamp }) };
+    logger->log(time, spdlog::source_loc{}, Convert(level), spdlog::string_view_t{ message.data(), message.size() });
+}
+
+void LOG::Wake()
+{
+    {
+        std::lock_guard lock{ logging.wakeMutex };
+        logging.wake = true;
+    }
+    logging.wakeCondition.notify_one();
+}
+
+void LOG::Run()
+{
+    struct Message
+    {
+        int64_t     timestamp;
+        Level       level;
+        std::string text;
+    };
+
+    constexpr auto MinWait = std::chrono::microseconds{ 100 };
+    constexpr auto MaxWait = std::chrono::microseconds{ 2000 };
+
+    std::vector<Message> messages;
+    std::vector<LogRing *> rings;
+    spdlog::memory_buf_t buffer;
+    auto wait = MinWait;
+    int64_t lastReport = Now();
+
+    while (true)
+    {
+        bool stopping = !logging.running.load(std::memory_order_acquire);
+        uint64_t flushRequested = logging.flushRequested.load(std::memory_order_acquire);
+
+        {
+            std::lock_guard lock{ logging.mutex };
+            rings = logging.rings;
+        }
+
+        /** The formatting happens here rather than on the threads logging */
+        for (auto &ring : rings)
+        {
+            ring->Consume([&] (const LogRecord &record) {
+                std::string_view format{ record.format, record.formatSize };
+                buffer.clear();
+                try
+                {
+                    record.formatter(buffer, format, (const uint8_t *)&record + Align(sizeof(LogRecord)));
+                }
+                catch (const std::exception &e)
+                {
+                    buffer.clear();
+                    fmt::format_to(fmt::appender(buffer), "Failed to format \"{}\": {}", format, e.what());
+                }
+                messages.emplace_back(Message{ record.timestamp, record.level, std::string{ buffer.data(), buffer.size() } });
+            });
+        }
+
+        /** The rings of the threads exited are freed once drained, which were retired after their last message */
+        {
+            std::lock_guard lock{ logging.mutex };
+            std::erase_if(logging.rings, [] (LogRing *ring) {
+                if (ring->retired.load(std::memory_order_acquire) && ring->Empty())
+                {
+                    delete ring;
+                    return true;
+                }
+                return false;
+            });
+        }
+
+        std::stable_sort(messages.begin(), messages.end(), [] (const Message &a, const Message &b) {
+            return a.timestamp < b.timestamp;
+        });
+        for (auto &message : messages)
+        {
+            Write(message.level, message.timestamp, message.text);
+        }
+
+        int64_t now = Now();
+        if (uint64_t count = dropped.exchange(0, std::memory_order_relaxed))
+        {
+            Write(Level::Warn, now, fmt::format("{} messages dropped, logged faster than written", count));
+        }
+        if (rateLimited.load(std::memory_order_relaxed) && now - lastReport >= 1000000000)
+        {
+            lastReport = now;
+            std::lock_guard lock{ logging.mutex };
+            for (auto &[name, module] : logging.modules)
+            {
+                if (uint32_t count = module->suppressed.exchange(0, std::memory_order_relaxed))
+                {
+                    Write(Level::Warn, now, fmt::format("{} messages of {} suppressed by the rate limit", count, name));
+                }
+            }
+        }
+
+        bool idle = messages.empty();
+        if (!idle)
+        {
+            logger->flush();
+        }
+        messages.clear();
+
+        logging.flushCompleted.store(flushRequested, std::memory_order_release);
+        logging.flushCompleted.notify_all();
+
+        if (stopping)
+        {
+            break;
+        }
+
+        /** Back off while idle, the threads logging never wake this up except for errors and flushes */
+        std::unique_lock lock{ logging.wakeMutex };
+        logging.wakeCondition.wait_for(lock, idle ? wait : MinWait, [] { return logging.wake; });
+        logging.wake = false;
+        wait = idle ? std::min<std::chrono::microseconds>(wait * 2, MaxWait) : MinWait;
+    }
+}
+
 }
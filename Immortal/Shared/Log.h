@@ -1,7 +1,17 @@
 #pragma once
 
-#include <memory>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ranges>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 
 #pragma warning(push, 0)
 #include <spdlog/spdlog.h>
@@ -10,59 +20,411 @@
 
 #include <time.h>
 
+/** The lowest level compiled in, the calls below are removed: 0 debug, 1 info, 2 warn, 3 error, 4 fatal */
+#ifndef SL_LOG_LEVEL
+#define SL_LOG_LEVEL 0
+#endif
+
 namespace Immortal
 {
 
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Fatal,
+    Padding = 0xff,
+};
+
+/**
+ * @brief The format string checked at compile time as before, which carries
+ *  the call site as well. The module of a message is the source file name.
+ */
+template <class... Args>
+struct LogFormatString
+{
+    template <class S>
+    requires std::is_convertible_v<const S &, std::string_view>
+    consteval LogFormatString(const S &format, std::source_location location = std::source_location::current()) :
+        format{ format },
+        location{ location }
+    {
+
+    }
+
+    spdlog::format_string_t<Args...> format;
+
+    std::source_location location;
+};
+
+/**
+ * @brief A message as recorded by the thread logging it, the arguments are
+ *  stored right after and the strings they reference after the arguments
+ */
+struct LogRecord
+{
+    using Formatter = void (*)(spdlog::memory_buf_t &out, std::string_view format, const void *arguments);
+
+    uint32_t    size;
+    LogLevel    level;
+    uint32_t    formatSize;
+    int64_t     timestamp;
+    Formatter   formatter;
+    const char *format;
+};
+
+/**
+ * @brief A single producer single consumer ring of the records of one thread.
+ *  The records are contiguous, one not fitting the end of the ring starts
+ *  over from the beginning after a padding record.
+ */
+class LogRing
+{
+public:
+    static constexpr size_t Capacity  = 128 * 1024;
+    static constexpr size_t Alignment = 16;
+
+public:
+    LogRing() :
+        head{ 0 },
+        tail{ 0 },
+        cachedTail{ 0 },
+        reserved{ 0 },
+        retired{ false }
+    {
+
+    }
+
+    /** @ret The memory of a record of size bytes, or null if the ring is full */
+    uint8_t *Reserve(size_t size)
+    {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        size_t offset  = position & (Capacity - 1);
+        size_t padding = Capacity - offset < size ? Capacity - offset : 0;
+        if (position + padding + size - cachedTail > Capacity)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position + padding + size - cachedTail > Capacity)
+            {
+                return nullptr;
+            }
+        }
+
+        if (padding)
+        {
+            auto *record = (LogRecord *)&buffer[offset];
+            record->size  = uint32_t(padding);
+            record->level = LogLevel::Padding;
+            offset = 0;
+        }
+        reserved = padding + size;
+
+        return &buffer[offset];
+    }
+
+    void Commit()
+    {
+        head.store(head.load(std::memory_order_relaxed) + reserved, std::memory_order_release);
+    }
+
+    bool Empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /** Only called by the consumer, the records are released after all processed */
+    template <class T>
+    bool Consume(T &&process)
+    {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        uint64_t end = head.load(std::memory_order_acquire);
+        if (position == end)
+        {
+            return false;
+        }
+
+        while (position != end)
+        {
+            auto *record = (const LogRecord *)&buffer[position & (Capacity - 1)];
+            if (record->level != LogLevel::Padding)
+            {
+                process(*record);
+            }
+            position += record->size;
+        }
+        tail.store(position, std::memory_order_release);
+
+        return true;
+    }
+
+protected:
+    alignas(64) std::atomic<uint64_t> head;
+
+    alignas(64) std::atomic<uint64_t> tail;
+
+    alignas(64) uint64_t cachedTail;
+
+    size_t reserved;
+
+public:
+    /** Exchanged by the thread exiting and by the logging released, the one coming
+     *  second frees the ring, so it is never freed under the thread still pushing
+     */
+    std::atomic<bool> retired;
+
+protected:
+    alignas(Alignment) uint8_t buffer[Capacity];
+};
+
+/**
+ * @brief How an argument is kept until the message is formatted on the logging
+ *  thread. Strings are copied into the record, the other trivially copyable
+ *  values are copied as they are. Anything else, views of ranges included, is
+ *  formatted on the calling thread instead.
+ */
+template <class T>
+struct LogArgument
+{
+    using Type = std::decay_t<T>;
+
+    static constexpr bool IsString = std::is_same_v<Type, const char *> || std::is_same_v<Type, char *> ||
+        std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view>;
+
+    static constexpr bool Deferred = IsString || (std::is_trivially_copyable_v<Type> && !std::ranges::range<Type>);
+
+    using Stored = std::conditional_t<IsString, std::string_view, Type>;
+
+    static Stored Capture(const T &value)
+    {
+        if constexpr (std::is_pointer_v<Type> && IsString)
+        {
+            return value ? std::string_view{ value } : std::string_view{ "(null)" };
+        }
+        else
+        {
+            return Stored{ value };
+        }
+    }
+};
+
 class LOG
 {
 public:
-    static void Setup(bool async = false);
+    using Level = LogLevel;
+
+    static constexpr Level CompiledLevel = Level(SL_LOG_LEVEL);
+
+    /** The largest record, a longer message is written on the calling thread */
+    static constexpr size_t MaxRecordSize = LogRing::Capacity / 8;
+
+public:
+    /** Asynchronous logging formats and writes on a background thread, otherwise on the calling thread */
+    static void Setup(bool async = true);
 
     static void Release();
 
-    static void Init(bool async = false)
+    static void Init(bool async = true)
     {
         Setup(async);
     }
 
+    /** Block until every message logged before is written */
+    static void Flush();
+
+    /** Keep at most messagesPerSecond from a module, which is the source file name without extension. 0 for no limit */
+    static void SetRateLimit(std::string_view module, uint32_t messagesPerSecond);
+
     template <bool On = true, class... Args>
-    static inline void WARN(spdlog::format_string_t<Args...> fmt, Args && ... args)
+    static inline void WARN(LogFormatString<std::type_identity_t<Args>...> format, Args && ... args)
     {
-        if constexpr (On)
+        if constexpr (On && CompiledLevel <= Level::Warn)
         {
-            logger->warn(fmt, std::forward<Args>(args)...);
+            Log(Level::Warn, format, args...);
         }
     }
 
     template <class... Args>
-    static inline void INFO(spdlog::format_string_t<Args...> fmt, Args && ... args)
+    static inline void INFO(LogFormatString<std::type_identity_t<Args>...> format, Args && ... args)
     {
-        logger->info(fmt, std::forward<Args>(args)...);
+        if constexpr (CompiledLevel <= Level::Info)
+        {
+            Log(Level::Info, format, args...);
+        }
     }
 
     template <bool On = true, class... Args>
-    static inline void DEBUG(spdlog::format_string_t<Args...> fmt, Args && ... args)
+    static inline void DEBUG(LogFormatString<std::type_identity_t<Args>...> format, Args && ... args)
     {
-        if constexpr (On)
+        if constexpr (On && CompiledLevel <= Level::Debug)
         {
-            logger->debug(fmt, std::forward<Args>(args)...);
+            Log(Level::Debug, format, args...);
         }
     }
 
     template <class... Args>
-    static inline void ERR(spdlog::format_string_t<Args...> fmt, Args && ... args)
+    static inline void ERR(LogFormatString<std::type_identity_t<Args>...> format, Args && ... args)
     {
-        logger->error(fmt, std::forward<Args>(args)...);
+        if constexpr (CompiledLevel <= Level::Error)
+        {
+            Log(Level::Error, format, args...);
+        }
     }
 
     template <class... Args>
-    static inline void FATAL(spdlog::format_string_t<Args...> fmt, Args && ... args)
+    static inline void FATAL(LogFormatString<std::type_identity_t<Args>...> format, Args && ... args)
     {
-        logger->critical(fmt, std::forward<Args>(args)...);
+        Log(Level::Fatal, format, args...);
+        Flush();
     }
 
+private:
+    template <class F, class... Args>
+    static void Log(Level level, const F &format, Args &...args)
+    {
+        int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        if (rateLimited.load(std::memory_order_relaxed) && !Admit(format.location.file_name(), timestamp))
+        {
+            return;
+        }
+
+        spdlog::string_view_t view = format.format;
+        std::string_view formatString{ view.data(), view.size() };
+        if constexpr ((LogArgument<Args>::Deferred && ...))
+        {
+            if (async.load(std::memory_order_relaxed))
+            {
+                Push(level, timestamp, formatString, LogArgument<Args>::Capture(args)...);
+                return;
+            }
+        }
+
+        spdlog::memory_buf_t buffer;
+        fmt::vformat_to(fmt::appender(buffer), view, fmt::make_format_args(args...));
+        std::string_view message{ buffer.data(), buffer.size() };
+        if (async.load(std::memory_order_relaxed))
+        {
+            Push(level, timestamp, "{}", message);
+        }
+        else
+        {
+            Write(level, timestamp, message);
+        }
+    }
+
+    template <class... Stored>
+    static void Push(Level level, int64_t timestamp, std::string_view format, Stored ...arguments)
+    {
+        using Arguments = std::tuple<Stored...>;
+        static_assert(alignof(Arguments) <= LogRing::Alignment, "Over aligned arguments could not be recorded");
+
+        size_t textSize = 0;
+        ((textSize += TextSize(arguments)), ...);
+        size_t size = Align(sizeof(LogRecord)) + Align(sizeof(Arguments)) + Align(textSize);
+
+        uint8_t *memory = nullptr;
+        LogRing *ring = size <= MaxRecordSize ? AcquireRing() : nullptr;
+        if (ring)
+        {
+            memory = ring->Reserve(size);
+            while (!memory && level >= Level::Error && !ring->retired.load(std::memory_order_acquire))
+            {
+                /** Errors are never dropped, wait for the logging thread instead */
+                Wake();
+                std::this_thread::yield();
+                memory = ring->Reserve(size);
+            }
+        }
+        if (!memory)
+        {
+            if (ring)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            /** Too large to be recorded, written here after the messages before */
+            spdlog::memory_buf_t buffer;
+            Arguments stored{ arguments... };
+            Format<Arguments>(buffer, format, &stored);
+            Flush();
+            Write(level, timestamp, std::string_view{ buffer.data(), buffer.size() });
+            return;
+        }
+
+        new (memory) LogRecord{
+            .size       = uint32_t(size),
+            .level      = level,
+            .formatSize = uint32_t(format.size()),
+            .timestamp  = timestamp,
+            .formatter  = &Format<Arguments>,
+            .format     = format.data(),
+        };
+
+        auto *stored = new (memory + Align(sizeof(LogRecord))) Arguments{ arguments... };
+        char *text = (char *)stored + Align(sizeof(Arguments));
+        std::apply([&] (auto &...values) { (Relocate(values, text), ...); }, *stored);
+
+        ring->Commit();
+        if (level >= Level::Error)
+        {
+            Wake();
+        }
+    }
+
+    template <class Arguments>
+    static void Format(spdlog::memory_buf_t &out, std::string_view format, const void *data)
+    {
+        std::apply([&] (const auto &...values) {
+            fmt::vformat_to(fmt::appender(out), fmt::string_view{ format.data(), format.size() }, fmt::make_format_args(values...));
+        }, *(const Arguments *)data);
+    }
+
+    template <class T>
+    static size_t TextSize(const T &value)
+    {
+        if constexpr (std::is_same_v<T, std::string_view>)
+        {
+            return value.size();
+        }
+        return 0;
+    }
+
+    template <class T>
+    static void Relocate(T &value, char *&text)
+    {
+        if constexpr (std::is_same_v<T, std::string_view>)
+        {
+            memcpy(text, value.data(), value.size());
+            value = std::string_view{ text, value.size() };
+            text += value.size();
+        }
+    }
+
+    static constexpr size_t Align(size_t size)
+    {
+        return (size + LogRing::Alignment - 1) & ~(LogRing::Alignment - 1);
+    }
+
+    static LogRing *AcquireRing();
+
+    static bool Admit(const char *file, int64_t timestamp);
+
+    static void Write(Level level, int64_t timestamp, std::string_view message);
+
+    static void Wake();
+
+    static void Run();
+
 private:
     static std::shared_ptr<spdlog::logger> logger;
+
+    static std::atomic<bool> async;
+
+    static std::atomic<bool> rateLimited;
+
+    static std::atomic<uint64_t> dropped;
 };
 
 }
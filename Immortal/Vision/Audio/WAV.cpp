@@ -1,4 +1,5 @@
 #include "WAV.h"
+#include "Shared/Instrumentor.h"
 #include "FileSystem/FileSystem.h"
 
 namespace Immortal
@@ -8,7 +9,8 @@ namespace Vision
 
 CodecError WAVCodec::Decode(const CodedFrame &codedFrame)
 {
-    auto &buffer = codedFrame.GetBuffer();
+    SL_PROFILE_FUNCTION();
+    const auto &buffer = codedFrame.GetBuffer();
 
     memcpy(&header, buffer.data(), sizeof(header));
 
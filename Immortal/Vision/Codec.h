@@ -12,6 +12,24 @@ namespace Immortal
 namespace Vision
 {
 
+/** Decode to a fraction of the coded size, by a power of two */
+enum class DecodeScale : uint32_t
+{
+    Full    = 0,
+    Half    = 1,
+    Quarter = 2,
+    Eighth  = 3,
+};
+
+/**
+ * @brief Options of decoding, the codecs not supporting an option ignore it,
+ *  so the size of the picture should be taken from the picture decoded
+ */
+struct DecodeOptions
+{
+    DecodeScale Scale = DecodeScale::Full;
+};
+
 namespace Interface
 {
 
@@ -19,7 +37,8 @@ class IMMORTAL_API Codec : public IObject
 {
 public:
     Codec() :
-	    picture{}
+	    picture{},
+	    decodeOptions{}
     {
 
     }
@@ -47,13 +66,35 @@ public:
         return picture;
     }
 
+    /**
+     * @brief A coded frame may be decoded to more than one picture. Drop the
+     *  current picture for the next one pending
+     * @ret False if there is no picture left
+     */
+    virtual bool PopPicture()
+    {
+        return false;
+    }
+
     virtual void Flush()
     {
         picture = Picture{};
     }
 
+    void SetDecodeOptions(const DecodeOptions &options)
+    {
+        decodeOptions = options;
+    }
+
+    const DecodeOptions &GetDecodeOptions() const
+    {
+        return decodeOptions;
+    }
+
 protected:
     Picture picture;
+
+    DecodeOptions decodeOptions;
 };
 
 class IMMORTAL_API VideoCodec : public Interface::Codec
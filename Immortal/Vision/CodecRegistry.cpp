@@ -0,0 +1,179 @@
+#include "CodecRegistry.h"
+#include "Image/ImageCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
+
+namespace Immortal
+{
+namespace Vision
+{
+
+static inline bool Match(CodedBuffer buffer, const CodecFormat &format)
+{
+    return format.Offset + format.Magic.size() <= buffer.size() &&
+        !memcmp(buffer.data() + format.Offset, format.Magic.data(), format.Magic.size());
+}
+
+/** The in-tree codec only decodes the baseline scans of YUV 4:2:0 or 4:4:4 */
+static bool ProbeBaselineJpeg(CodedBuffer buffer)
+{
+    const uint8_t *ptr = buffer.data() + 2;
+    const uint8_t *end = buffer.data() + buffer.size();
+    while (ptr + 4 <= end && ptr[0] == 0xff)
+    {
+        uint8_t marker = ptr[1];
+        size_t length = (ptr[2] << 8) | ptr[3];
+        if (marker == JpegCodec::SOF0 || marker == JpegCodec::SOF1)
+        {
+            const uint8_t *sof = ptr + 4;
+            if (sof + 14 > end || sof[0] != 8 || sof[5] != 3)
+            {
+                return false;
+            }
+            uint8_t luma = sof[7];
+            return (luma == 0x11 || luma == 0x22) && sof[10] == 0x11 && sof[13] == 0x11;
+        }
+        if (marker == JpegCodec::SOF2 || marker == JpegCodec::SOS)
+        {
+            return false;
+        }
+        ptr += 2 + length;
+    }
+
+    return false;
+}
+
+template <class T>
+static Interface::Codec *Create()
+{
+    return new T;
+}
+
+CodecRegistry &CodecRegistry::Get()
+{
+    static CodecRegistry registry;
+    return registry;
+}
+
+CodecRegistry::CodecRegistry()
+{
+    static constexpr std::string_view JpegMagic{ "\xff\xd8\xff", 3 };
+    static constexpr std::string_view PngMagic{ "\x89PNG\r\n\x1a\n", 8 };
+    static constexpr std::string_view TiffLittleEndian{ "II*\0", 4 };
+    static constexpr std::string_view TiffBigEndian{ "MM\0*", 4 };
+
+#ifdef SL_HAVE_INTRISIC
+    Register({
+        .Name     = "JpegCodec",
+        .Priority = 0,
+        .Formats  = {
+            { .Magic = JpegMagic, .Capabilities = CodecCapability::Scaling, .Speed = 120 },
+        },
+        .Probe    = ProbeBaselineJpeg,
+        .Create   = Create<JpegCodec>,
+    });
+#endif
+
+    Register({
+        .Name     = "STBCodec",
+        .Priority = 0,
+        .Formats  = {
+            { .Magic = JpegMagic,    .Capabilities = CodecCapability::Progressive,      .Speed = 60 },
+            { .Magic = PngMagic,     .Capabilities = CodecCapability::None,             .Speed = 40 },
+            { .Magic = "#?RADIANCE", .Capabilities = CodecCapability::HighDynamicRange, .Speed = 30 },
+            { .Magic = "#?RGBE",     .Capabilities = CodecCapability::HighDynamicRange, .Speed = 30 },
+        },
+        .Create   = Create<STBCodec>,
+    });
+
+    Register({
+        .Name     = "BMPCodec",
+        .Priority = 0,
+        .Formats  = {
+            { .Magic = "BM", .Speed = 200 },
+        },
+        .Create   = Create<BMPCodec>,
+    });
+
+    Register({
+        .Name     = "PPMCodec",
+        .Priority = 0,
+        .Formats  = {
+            { .Magic = "P3", .Speed = 10 },
+        },
+        .Create   = Create<PPMCodec>,
+    });
+
+    /** The raws of ARW, NEF and CR2 are TIFF containers and CR3 is an ISO media file */
+    Register({
+        .Name     = "RawCodec",
+        .Priority = 0,
+        .Formats  = {
+            { .Magic = TiffLittleEndian, .Speed = 20 },
+            { .Magic = TiffBigEndian,    .Speed = 20 },
+            { .Magic = "ftypcrx ", .Offset = 4, .Speed = 20 },
+        },
+        .Create   = Create<RawCodec>,
+    });
+
+#if HAVE_OPENCV
+    Register({
+        .Name     = "OpenCVCodec",
+        .Priority = -100,
+        .Formats  = {
+            { .Magic = {}, .Capabilities = CodecCapability::Progressive, .Speed = 50 },
+        },
+        .Create   = Create<OpenCVCodec>,
+    });
+#endif
+}
+
+void CodecRegistry::Register(CodecDescription &&description)
+{
+    descriptions.emplace_back(std::move(description));
+}
+
+std::vector<CodecRegistry::Candidate> CodecRegistry::Sniff(CodedBuffer buffer, CodecCapability required) const
+{
+    std::vector<Candidate> candidates;
+    for (auto &description : descriptions)
+    {
+        for (auto &format : description.Formats)
+        {
+            if (Match(buffer, format) && (!description.Probe || description.Probe(buffer)))
+            {
+                candidates.emplace_back(Candidate{ &description, &format });
+                break;
+            }
+        }
+    }
+
+    auto rank = [=] (const Candidate &candidate) {
+        bool capable = (candidate.Format->Capabilities & required) == uint32_t(required);
+        return std::make_tuple(capable, candidate.Description->Priority, candidate.Format->Speed);
+    };
+    std::stable_sort(candidates.begin(), candidates.end(), [&] (const Candidate &lhs, const Candidate &rhs) {
+        return rank(lhs) > rank(rhs);
+    });
+
+    return candidates;
+}
+
+Interface::Codec *CodecRegistry::Acquire(const CodecDescription *description)
+{
+    thread_local std::unordered_map<const CodecDescription *, URef<Interface::Codec>> codecs;
+
+    auto &codec = codecs[description];
+    if (!codec)
+    {
+        codec = description->Create();
+    }
+
+    return codec;
+}
+
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Codec.h"
+
+#include <string_view>
+#include <vector>
+
+namespace Immortal
+{
+namespace Vision
+{
+
+enum class CodecCapability : uint32_t
+{
+    None             = 0,
+    Scaling          = BIT(0),
+    HighDynamicRange = BIT(1),
+    Progressive      = BIT(2),
+};
+SL_ENABLE_BITWISE_OPERATOR(CodecCapability)
+
+/**
+ * @brief A format a codec recognizes by the magic bytes at an offset of the
+ *  coded data, with what the codec is able to do for it and a rough speed
+ *  in megapixels per second, which is only compared between the codecs.
+ */
+struct CodecFormat
+{
+    std::string_view Magic;
+    size_t           Offset       = 0;
+    CodecCapability  Capabilities = CodecCapability::None;
+    uint32_t         Speed        = 0;
+};
+
+struct CodecDescription
+{
+    using Creator = Interface::Codec *(*)();
+
+    using Prober = bool (*)(CodedBuffer buffer);
+
+    const char *Name = nullptr;
+
+    /** Decides before the speed, the fallbacks get a lower one */
+    int32_t Priority = 0;
+
+    /** An empty magic matches anything */
+    std::vector<CodecFormat> Formats;
+
+    /** A deeper check after the magic matched, to reject the streams the codec is unable to decode */
+    Prober Probe = nullptr;
+
+    Creator Create = nullptr;
+};
+
+/**
+ * @brief The codecs of images chosen from the content instead of the file
+ *  extension. The candidates matched are ranked by the capabilities required,
+ *  the priority and then the speed, so the callers could fall back to the
+ *  next one when a codec fails. The instances are kept per thread and reused
+ *  across the decodes. The codecs are only registered while constructing, so
+ *  the descriptions handed out stay where they are for the whole process.
+ */
+class IMMORTAL_API CodecRegistry
+{
+public:
+    struct Candidate
+    {
+        const CodecDescription *Description;
+        const CodecFormat      *Format;
+    };
+
+public:
+    static CodecRegistry &Get();
+
+    /** @ret The candidates ordered from the best one */
+    std::vector<Candidate> Sniff(CodedBuffer buffer, CodecCapability required = CodecCapability::None) const;
+
+    /** @ret The codec instance of this thread for the description */
+    Interface::Codec *Acquire(const CodecDescription *description);
+
+protected:
+    CodecRegistry();
+
+    void Register(CodecDescription &&description);
+
+protected:
+    std::vector<CodecDescription> descriptions;
+};
+
+}
+}
@@ -0,0 +1,29 @@
+#include "CodedFrame.h"
+#include "FileSystem/MappedFile.h"
+
+namespace Immortal
+{
+namespace Vision
+{
+
+CodedFrame CodedFrame::Map(const std::string &path)
+{
+    CodedFrame codedFrame{ std::vector<uint8_t>{} };
+
+    auto mappedFile = new FileSystem::MappedFile{ path };
+    if (!*mappedFile)
+    {
+        delete mappedFile;
+        return codedFrame;
+    }
+
+    codedFrame.Wrap(mappedFile->Data(), mappedFile->Size());
+    codedFrame.SetRelease([mappedFile] (void *) {
+        delete mappedFile;
+    });
+
+    return codedFrame;
+}
+
+}
+}
@@ -5,12 +5,17 @@
 #include <cstdint>
 #include <vector>
 #include <functional>
+#include <span>
+#include <string>
 
 namespace Immortal
 {
 namespace Vision
 {
 
+/** A view of the coded bytes, which are either owned by the frame or wrapped from outside */
+using CodedBuffer = std::span<const uint8_t>;
+
 class CodedFrame;
 class IMMORTAL_API SharedCodedFrameData : public IObject
 {
@@ -19,6 +24,7 @@ public:
 
 public:
 	SharedCodedFrameData() :
+	    storage{},
 	    buffer{},
 	    type{},
 	    release{}
@@ -26,24 +32,38 @@ public:
 
     }
 
+    /** The buffer may point into the storage of its own, which a copy or a move would leave behind */
+    SharedCodedFrameData(const SharedCodedFrameData &) = delete;
+
+    SharedCodedFrameData &operator=(const SharedCodedFrameData &) = delete;
+
     ~SharedCodedFrameData()
     {
         if (release)
         {
-			release(InterpretAs<void>());
+			release(storage.empty() ? (void *)buffer.data() : InterpretAs<void>());
         }
     }
 
     void Assign(std::vector<uint8_t> &&other)
     {
-        buffer = std::move(other);
+        storage = std::move(other);
+        buffer  = storage;
+    }
+
+    /** Reference the memory without a copy, the release hook receives the data when the frame is freed */
+    void Wrap(const uint8_t *data, size_t size)
+    {
+        storage.clear();
+        buffer = CodedBuffer{ data, size };
     }
 
     template <class T>
     void RefTo(const T *ptr)
     {
-        buffer.resize(sizeof(T *));
-        memcpy(buffer.data(), &ptr, sizeof(T *));
+        storage.resize(sizeof(T *));
+        memcpy(storage.data(), &ptr, sizeof(T *));
+        buffer = storage;
     }
 
     template <class T>
@@ -57,7 +77,7 @@ public:
         return !buffer.empty();
     }
 
-    const std::vector<uint8_t> &GetBuffer() const
+    CodedBuffer GetBuffer() const
     {
 		return buffer;
     }
@@ -68,7 +88,9 @@ public:
     }
 
 protected:
-	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> storage;
+
+	CodedBuffer buffer;
 
 	MediaType type;
 
@@ -102,6 +124,9 @@ public:
 
     }
 
+    /** Decode straight from the memory of a file mapped, which is unmapped with the last reference */
+    static CodedFrame Map(const std::string &path);
+
     void SetType(MediaType value)
 	{
 		_shared->type = value;
@@ -117,6 +142,11 @@ public:
 		_shared->Assign(std::move(other));
     }
 
+    void Wrap(const uint8_t *data, size_t size)
+    {
+		_shared->Wrap(data, size);
+    }
+
     template <class T>
     void RefTo(const T *ptr)
     {
@@ -134,7 +164,7 @@ public:
 		return !_shared->GetBuffer().empty();
     }
 
-    const std::vector<uint8_t> &GetBuffer() const
+    CodedBuffer GetBuffer() const
     {
 		return _shared->GetBuffer();
     }
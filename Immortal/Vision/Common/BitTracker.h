@@ -4,53 +4,61 @@
 #define BIT_TRACKER_H__
 
 #include "Core.h"
-#include "Vision/LookupTable/LookupTable.h"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
 
 namespace Immortal
 {
 
-class IMMORTAL_API BitTracker
+static inline uint64_t LoadBigEndian64(const uint8_t *data)
 {
-public:
-    static constexpr size_t BytesMoved  = 8;
-    static constexpr size_t BitsPerByte = 8;
-
-public:
-    BitTracker() :
-        start{ nullptr },
-        end{ nullptr },
-        ptr{ nullptr },
-        bitsLeft{ 0 },
-        word{ 0 }
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    if constexpr (std::endian::native == std::endian::big)
     {
-
+        return value;
     }
+#ifdef _MSC_VER
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
 
-    BitTracker(const uint8_t *data, size_t size) :
-        start{ data },
-        end{ data + size },
-        ptr{ data },
-        bitsLeft{ 0 },
-        word{ 0 }
-    {
-        Move(64);
-    }
+/**
+ * @brief The reading part shared by the bit trackers, the derived one refills
+ *  the word through Refill(), which leaves at least 56 bits available. The bits
+ *  of the word below bitsLeft are either zero or the very next bits of the
+ *  stream, so a refill could always OR the new bytes in.
+ */
+template <class T>
+class BitTrackerBase
+{
+public:
+    static constexpr size_t BitsPerByte = 8;
+
+    /** The most bits guaranteed after a refill, a single read never exceeds it */
+    static constexpr uint32_t MaxBitsPerRead = 56;
 
+public:
     template <size_t bytes>
     uint64_t GetBytes()
     {
-        static_assert(bytes > 4 && "Unsupported bytes number");
+        static_assert(bytes > 0 && bytes <= 8 && "Unsupported bytes number");
         return GetBits(bytes * BitsPerByte);
     }
 
     uint64_t GetBits(uint32_t n)
     {
-        if (n > bitsLeft)
+        if (n > MaxBitsPerRead)
         {
-            Move(n);
+            uint64_t high = GetBits(n - 32);
+            return (high << 32) | GetBits(32);
         }
 
-        uint64_t ret = word >> (64 - n);
+        uint64_t ret = Preview(n);
         bitsLeft -= n;
         word <<= n;
 
@@ -61,122 +69,310 @@ public:
     {
         if (!bitsLeft)
         {
-            Move(64);
+            Refill();
         }
 
-        uint64_t ret = word >> (64 - 1);
+        uint64_t ret = word >> 63;
         bitsLeft--;
         word <<= 1;
 
         return ret;
     }
 
-    void SkipBits(int32_t n)
+    void SkipBits(uint32_t n)
     {
+        while (n > MaxBitsPerRead)
+        {
+            GetBits(MaxBitsPerRead);
+            n -= MaxBitsPerRead;
+        }
         if (n > bitsLeft)
         {
-            n -= bitsLeft;
-            word = bitsLeft = 0;
-            Move(64);
+            Refill();
         }
         bitsLeft -= n;
         word <<= n;
     }
 
+    /** @ret The next n bits, n up to MaxBitsPerRead, without consuming them */
     uint64_t Preview(uint32_t n)
     {
         if (n > bitsLeft)
         {
-            Move(n);
+            Refill();
         }
-        return word >> (64 - n);
+
+        /** Shift twice so that n = 0 is not an undefined 64-bit shift */
+        return (word >> 1) >> (63 - n);
     }
 
     uint64_t UnsignedExpGolomb()
     {
-        auto bits = Preview(32);
-        auto l = 31 - (int32_t)std::log2(bits);
-        SkipBits(l);
+        uint32_t leadingZeros = ExpGolombLength();
+        if (leadingZeros < MaxBitsPerRead / 2)
+        {
+            return GetBits(leadingZeros * 2 + 1) - 1;
+        }
 
-        return GetBits(l + 1) - 1;
+        SkipBits(leadingZeros);
+        return GetBits(leadingZeros + 1) - 1;
     }
 
-    uint64_t SignedExpGolomb()
+    int64_t SignedExpGolomb()
     {
-        auto bits = Preview(32);
-        auto s = 31 - (int32_t)std::log2(bits);
-        SkipBits(s);
+        uint64_t codeNum = UnsignedExpGolomb();
+        int64_t value = int64_t((codeNum + 1) >> 1);
 
-        return LookupTable::ExponentialGolobm[s][GetBits(s + 1) - 1];
+        return (codeNum & 1) ? value : -value;
     }
 
-    bool ByteAligned()
+    bool ByteAligned() const
     {
         return !(bitsLeft & 0x7);
     }
 
-    bool NoMoreData() const
-    {
-#ifdef _DEBUG
-        return eof == EOF;
-#else
-        return !ptr;
-#endif
-    }
-
     uint8_t BitsLeft() const
     {
-		return bitsLeft;
+        return bitsLeft;
     }
 
     uint64_t BytesLeft() const
     {
-		return end - ptr;
+        return end - ptr;
     }
 
     uint64_t BytesRead() const
-	{
-		return ptr - start;
-	}
+    {
+        return ptr - start;
+    }
+
+protected:
+    BitTrackerBase(const uint8_t *data = nullptr, size_t size = 0) :
+        start{ data },
+        end{ data + size },
+        ptr{ data },
+        word{ 0 },
+        bitsLeft{ 0 }
+    {
+
+    }
+
+    void Refill()
+    {
+        static_cast<T *>(this)->Refill();
+    }
+
+    /** The leading zeros of an Exp-Golomb code, longer codes than 32 bits are invalid anyway */
+    uint32_t ExpGolombLength()
+    {
+        return std::countl_zero(uint32_t(Preview(32)) | 1);
+    }
+
+    /** Branchless refill while at least 8 bytes are readable, the bytes not fully taken are loaded again next time */
+    void RefillFast()
+    {
+        word |= LoadBigEndian64(ptr) >> bitsLeft;
+        ptr += (63 - bitsLeft) >> 3;
+        bitsLeft |= 56;
+    }
+
+    void RefillByte(uint64_t byte)
+    {
+        word |= byte << (56 - bitsLeft);
+        bitsLeft += BitsPerByte;
+    }
 
 protected:
-    void Move(uint32_t n)
+    const uint8_t *start;
+    const uint8_t *end;
+    const uint8_t *ptr;
+    uint64_t word;
+    uint8_t bitsLeft;
+};
+
+/**
+ * @brief A MSB-first bit reader over a plain bitstream. The stream reads as
+ *  zeros past the end, and NoMoreData() tells that a read went past it. The
+ *  zeros padded by the refill are counted, so the bits still unread in the
+ *  word are never mistaken for the end.
+ */
+class BitTracker : public BitTrackerBase<BitTracker>
+{
+public:
+    using Super = BitTrackerBase<BitTracker>;
+    friend Super;
+
+public:
+    BitTracker() :
+        Super{},
+        padding{ 0 }
     {
-        uint64_t bits = 0;
-        while (n > bitsLeft)
+
+    }
+
+    BitTracker(const uint8_t *data, size_t size) :
+        Super{ data, size },
+        padding{ 0 }
+    {
+        Refill();
+    }
+
+    /** @ret If more bits have been consumed than the 8 * size of the stream */
+    bool NoMoreData() const
+    {
+        return padding > bitsLeft;
+    }
+
+protected:
+    void Refill()
+    {
+        if (end - ptr >= 8)
+        {
+            RefillFast();
+            return;
+        }
+
+        while (bitsLeft <= 56)
         {
             if (ptr < end)
             {
-                bits <<= 8;
-                bitsLeft += BitsPerByte;
-                bits |= *ptr++;
+                RefillByte(*ptr++);
             }
             else
             {
-#ifdef _DEBUG
-                eof = EOF;
-#else
-                ptr = nullptr;
-#endif
+                /** The padded zeros are the last ones of the word, the stream is exhausted once a read reaches them */
+                uint8_t padded = bitsLeft | 56;
+                padding += padded - bitsLeft;
+                bitsLeft = padded;
                 break;
             }
         }
-        word |= bits << (64 - bitsLeft);
     }
 
 protected:
-    const uint8_t *start;
-    const uint8_t *end;
-    const uint8_t *ptr;
-    uint64_t word;
-    uint8_t bitsLeft;
-#ifdef _DEBUG
-    int32_t eof = 0;
-#endif
-
+    /** The zero bits put into the word past the end of the stream, consumed or not */
+    uint64_t padding;
 };
 
-using SuperBitTracker = BitTracker;
+/**
+ * @brief The bit reader of the JPEG entropy coded segments. The stuffed 0xFF00
+ *  reads as 0xFF, and a marker stops the refill so that the stream reads as
+ *  zeros up to it. The 8 bytes ahead are loaded at once if none of them is
+ *  0xFF, which is the case for most of the segment.
+ */
+class JpegBitTracker : public BitTrackerBase<JpegBitTracker>
+{
+public:
+    using Super = BitTrackerBase<JpegBitTracker>;
+    friend Super;
+
+    static constexpr uint8_t RST0 = 0xD0;
+    static constexpr uint8_t RST7 = 0xD7;
+
+public:
+    JpegBitTracker() :
+        Super{},
+        marker{ 0 }
+    {
+
+    }
+
+    JpegBitTracker(const uint8_t *data, size_t size) :
+        Super{ data, size },
+        marker{ 0 }
+    {
+        Refill();
+    }
+
+    /** @ret The marker the entropy coded segment stopped at, or 0 if not reached yet */
+    uint8_t Marker() const
+    {
+        return marker;
+    }
+
+    /**
+     * @brief Drop the padding bits of the interval and step over the next
+     *  restart marker, the data before it are skipped if the stream is corrupt.
+     * @ret If a restart marker was found
+     */
+    bool Restart()
+    {
+        word     = 0;
+        bitsLeft = 0;
+        while (!marker && ptr < end)
+        {
+            if (ptr[0] == 0xff && ptr + 1 < end && ptr[1] && ptr[1] != 0xff)
+            {
+                marker = ptr[1];
+                break;
+            }
+            ptr++;
+        }
+
+        bool restarted = marker >= RST0 && marker <= RST7;
+        if (restarted)
+        {
+            ptr   += 2;
+            marker = 0;
+        }
+        Refill();
+
+        return restarted;
+    }
+
+protected:
+    static bool HasMarkerByte(uint64_t bytes)
+    {
+        uint64_t inverted = ~bytes;
+        return (inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull;
+    }
+
+    void Refill()
+    {
+        if (!marker && end - ptr >= 8 && !HasMarkerByte(LoadBigEndian64(ptr)))
+        {
+            RefillFast();
+            return;
+        }
+
+        while (bitsLeft <= 56)
+        {
+            uint64_t byte = 0;
+            if (!marker && ptr < end)
+            {
+                byte = *ptr;
+                if (byte != 0xff)
+                {
+                    ptr++;
+                }
+                else if (ptr + 1 >= end)
+                {
+                    byte = 0;
+                    ptr  = end;
+                }
+                else if (ptr[1] == 0x00)
+                {
+                    ptr += 2;
+                }
+                else if (ptr[1] == 0xff)
+                {
+                    /** Fill bytes before a marker */
+                    ptr++;
+                    continue;
+                }
+                else
+                {
+                    byte   = 0;
+                    marker = ptr[1];
+                }
+            }
+            RefillByte(byte);
+        }
+    }
+
+protected:
+    uint8_t marker;
+};
 
 }
 
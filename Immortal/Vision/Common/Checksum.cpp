@@ -1,24 +1,362 @@
 #include "Checksum.h"
+#include "slcpuid.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHECKSUM_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define CHECKSUM_TARGET_PCLMUL __attribute__((target("pclmul,ssse3")))
+#else
+#define CHECKSUM_TARGET_PCLMUL
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CHECKSUM_ARM64 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CHECKSUM_TARGET_CRC
+#else
+#include <arm_acle.h>
+#define CHECKSUM_TARGET_CRC __attribute__((target("+crc")))
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 namespace Checksum
 {
 
+using CRC32Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+/**
+ * Table[0] is the CRC of a byte, Table[k] that of a byte followed by k zero
+ * bytes, so 8 bytes are done with 8 independent lookups.
+ */
+static constexpr CRC32Tables GenerateTables()
+{
+    CRC32Tables tables{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i << 24;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc << 1) ^ ((0 - (crc >> 31)) & CRC32_GENERATOR_POLYNOMIAL);
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); k++)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = tables[k - 1][i];
+            tables[k][i] = (crc << 8) ^ tables[0][crc >> 24];
+        }
+    }
+    return tables;
+}
+
+static constexpr CRC32Tables Tables = GenerateTables();
+
+static inline uint32_t LoadBigEndian32(const uint8_t *data)
+{
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+uint32_t UpdateCyclicRedundancyCheck32Portable(uint32_t crc, const uint8_t *data, size_t size)
+{
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        crc ^= LoadBigEndian32(data);
+        crc = Tables[7][crc >> 24] ^ Tables[6][(crc >> 16) & 0xff] ^ Tables[5][(crc >> 8) & 0xff] ^ Tables[4][crc & 0xff] ^
+              Tables[3][data[4]]   ^ Tables[2][data[5]]           ^ Tables[1][data[6]]          ^ Tables[0][data[7]];
+    }
+
+    for (; size > 0; size--, data++)
+    {
+        crc = (crc << 8) ^ Tables[0][(crc >> 24) ^ *data];
+    }
+
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+/** @ret x^n mod P, the constants of folding a block n bits forward */
+static constexpr uint64_t PowerOfX(uint32_t n)
+{
+    uint32_t remainder = 1;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        remainder = (remainder << 1) ^ ((0 - (remainder >> 31)) & CRC32_GENERATOR_POLYNOMIAL);
+    }
+    return remainder;
+}
+
+/** The constants of folding 512 and 128 bits forward, the high lane is 64 bits further */
+static constexpr uint64_t Fold512Low  = PowerOfX(512);
+static constexpr uint64_t Fold512High = PowerOfX(512 + 64);
+static constexpr uint64_t Fold128Low  = PowerOfX(128);
+static constexpr uint64_t Fold128High = PowerOfX(128 + 64);
+
+CHECKSUM_TARGET_PCLMUL
+static inline __m128i Fold(__m128i value, __m128i constants, __m128i next)
+{
+    __m128i high = _mm_clmulepi64_si128(value, constants, 0x11);
+    __m128i low  = _mm_clmulepi64_si128(value, constants, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+/**
+ * The message is folded 512 bits at a time with carry-less multiplies into
+ * four 128-bit remainders congruent to it modulo the polynomial. Those are
+ * folded into one, which the tables reduce to the CRC with the bytes left.
+ * The blocks are byte reversed so bit 127 of a lane is the first bit of it.
+ */
+CHECKSUM_TARGET_PCLMUL
+static uint32_t UpdateCyclicRedundancyCheck32PCLMUL(uint32_t crc, const uint8_t *data, size_t size)
+{
+    if (size < 64)
+    {
+        return UpdateCyclicRedundancyCheck32Portable(crc, data, size);
+    }
+
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i fold512 = _mm_set_epi64x(Fold512High, Fold512Low);
+    const __m128i fold128 = _mm_set_epi64x(Fold128High, Fold128Low);
+
+    auto load = [&] (const uint8_t *block) CHECKSUM_TARGET_PCLMUL {
+        return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)block), reverse);
+    };
+
+    /** The CRC so far is the same as xoring it into the first 32 bits of the message */
+    __m128i x0 = _mm_xor_si128(load(data), _mm_set_epi32(int(crc), 0, 0, 0));
+    __m128i x1 = load(data + 16);
+    __m128i x2 = load(data + 32);
+    __m128i x3 = load(data + 48);
+    data += 64;
+    size -= 64;
+
+    for (; size >= 64; size -= 64, data += 64)
+    {
+        x0 = Fold(x0, fold512, load(data));
+        x1 = Fold(x1, fold512, load(data + 16));
+        x2 = Fold(x2, fold512, load(data + 32));
+        x3 = Fold(x3, fold512, load(data + 48));
+    }
+
+    x0 = Fold(x0, fold128, x1);
+    x0 = Fold(x0, fold128, x2);
+    x0 = Fold(x0, fold128, x3);
+
+    for (; size >= 16; size -= 16, data += 16)
+    {
+        x0 = Fold(x0, fold128, load(data));
+    }
+
+    alignas(16) uint8_t remainder[16];
+    _mm_store_si128((__m128i *)remainder, _mm_shuffle_epi8(x0, reverse));
+
+    crc = UpdateCyclicRedundancyCheck32Portable(0, remainder, sizeof(remainder));
+    return UpdateCyclicRedundancyCheck32Portable(crc, data, size);
+}
+#endif
+
+#ifdef CHECKSUM_ARM64
+static inline uint32_t ReverseBits32(uint32_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _arm64_rbit(value);
+#else
+    return __rbit(value);
+#endif
+}
+
+/** Reverse the bits in each byte, keeping the order of the bytes */
+static inline uint64_t ReverseBitsOfBytes(uint64_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _byteswap_uint64(_arm64_rbit64(value));
+#else
+    return __revll(__rbitll(value));
+#endif
+}
+
+/**
+ * The CRC instructions are of the reflected CRC-32, which on bit reversed
+ * input and state is the CRC from the most significant bit with the same
+ * polynomial, so both are reversed in and the state reversed out.
+ */
+CHECKSUM_TARGET_CRC
+static uint32_t UpdateCyclicRedundancyCheck32ARMv8(uint32_t crc, const uint8_t *data, size_t size)
+{
+    uint32_t reflected = ReverseBits32(crc);
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        reflected = __crc32d(reflected, ReverseBitsOfBytes(value));
+    }
+
+    return UpdateCyclicRedundancyCheck32Portable(ReverseBits32(reflected), data, size);
+}
+#endif
+
+using CRC32Function = uint32_t (*)(uint32_t, const uint8_t *, size_t);
+
+struct CRC32Implementation
+{
+    CRC32Function function;
+
+    const char *name;
+};
+
+static CRC32Implementation SelectImplementation()
+{
+#ifdef CHECKSUM_X86
+    if (CPU::IsSupported(CPUFlag::PCLMULQDQ) && CPU::IsSupported(CPUFlag::SSSE3))
+    {
+        return { &UpdateCyclicRedundancyCheck32PCLMUL, "PCLMULQDQ" };
+    }
+#endif
+#ifdef CHECKSUM_ARM64
+    if (CPU::IsSupported(CPUFlag::CRC32))
+    {
+        return { &UpdateCyclicRedundancyCheck32ARMv8, "ARMv8 CRC32" };
+    }
+#endif
+    return { &UpdateCyclicRedundancyCheck32Portable, "Slice-by-8" };
+}
+
+static const CRC32Implementation &GetImplementation()
+{
+    static const CRC32Implementation implementation = SelectImplementation();
+    return implementation;
+}
+
+uint32_t UpdateCyclicRedundancyCheck32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    return GetImplementation().function(crc, data, size);
+}
+
+const char *GetCyclicRedundancyCheck32Implementation()
+{
+    return GetImplementation().name;
+}
+
 uint32_t CyclicRedundancyCheck32(const uint8_t *message, uint32_t length)
 {
-    uint32_t CRC = (uint32_t)~0;
+    return UpdateCyclicRedundancyCheck32(CRC32_INITIAL_VALUE, message, length);
+}
+
+static constexpr uint64_t HashSecret[] = {
+    0xa0761d6478bd642full,
+    0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull,
+};
+
+static inline void Multiply128(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = __uint128_t(*a) * *b;
+    *a = uint64_t(product);
+    *b = uint64_t(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = uint32_t(*a), lb = uint32_t(*b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t  = rl + (rm0 << 32);
+    uint64_t c  = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/** The low and the high half of the 128-bit product folded together */
+static inline uint64_t Mix(uint64_t a, uint64_t b)
+{
+    Multiply128(&a, &b);
+    return a ^ b;
+}
 
-    for (int i = 0; i < length; i++)
+static inline uint64_t Load64(const uint8_t *data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Load32(const uint8_t *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/** 1 to 3 bytes, each of which is read at least once */
+static inline uint64_t Load3(const uint8_t *data, size_t size)
+{
+    return (uint64_t(data[0]) << 16) | (uint64_t(data[size >> 1]) << 8) | data[size - 1];
+}
+
+uint64_t Hash64(const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    seed ^= Mix(seed ^ HashSecret[0], HashSecret[1]);
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (size <= 16)
     {
-        CRC ^= (((uint32_t)message[i]) << 24);
-        for (int j = 0; j < 8; j++)
+        if (size >= 4)
+        {
+            /** Two overlapping pairs of 32-bit reads cover 4 to 16 bytes */
+            size_t middle = (size >> 3) << 2;
+            a = (Load32(p) << 32) | Load32(p + middle);
+            b = (Load32(p + size - 4) << 32) | Load32(p + size - 4 - middle);
+        }
+        else if (size > 0)
         {
-            uint32_t MSB = CRC >> 31;
-            CRC <<= 1;
-            CRC ^= (0 - MSB) & CRC32_GENERATOR_POLYNOMIAL;
+            a = Load3(p, size);
         }
     }
-    
-    return CRC;
+    else
+    {
+        size_t i = size;
+        if (i > 48)
+        {
+            /** Three independent lanes keep the multipliers busy */
+            uint64_t seed1 = seed;
+            uint64_t seed2 = seed;
+            do
+            {
+                seed  = Mix(Load64(p)      ^ HashSecret[1], Load64(p +  8) ^ seed);
+                seed1 = Mix(Load64(p + 16) ^ HashSecret[2], Load64(p + 24) ^ seed1);
+                seed2 = Mix(Load64(p + 32) ^ HashSecret[3], Load64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        for (; i > 16; i -= 16, p += 16)
+        {
+            seed = Mix(Load64(p) ^ HashSecret[1], Load64(p + 8) ^ seed);
+        }
+        /** The last 16 bytes, overlapping the block before when unaligned */
+        a = Load64(p + i - 16);
+        b = Load64(p + i - 8);
+    }
+
+    a ^= HashSecret[1];
+    b ^= seed;
+    Multiply128(&a, &b);
+    return Mix(a ^ HashSecret[0] ^ size, b ^ HashSecret[1]);
 }
 
 }
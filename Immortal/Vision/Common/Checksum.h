@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace Checksum
@@ -7,6 +8,63 @@ namespace Checksum
 
 #define CRC32_GENERATOR_POLYNOMIAL 0x04C11DB7
 
+#define CRC32_INITIAL_VALUE 0xFFFFFFFF
+
+/**
+ * @brief The CRC-32 of MPEG-2, processed from the most significant bit with
+ *  no reflection and no final xor, starting from CRC32_INITIAL_VALUE.
+ */
 uint32_t CyclicRedundancyCheck32(const uint8_t *message, uint32_t length);
 
+/**
+ * @brief Continue a CRC-32 from the value returned for the data before. The
+ *  fastest implementation the CPU supports is picked on the first call.
+ */
+uint32_t UpdateCyclicRedundancyCheck32(uint32_t crc, const uint8_t *data, size_t size);
+
+/** The slice-by-8 tables, the fallback of all CPUs */
+uint32_t UpdateCyclicRedundancyCheck32Portable(uint32_t crc, const uint8_t *data, size_t size);
+
+/** @ret The name of the implementation UpdateCyclicRedundancyCheck32 runs */
+const char *GetCyclicRedundancyCheck32Implementation();
+
+/**
+ * @brief The CRC-32 of a stream fed in chunks of any size, equal to the
+ *  CyclicRedundancyCheck32 of all of them at once.
+ */
+class CRC32
+{
+public:
+    CRC32() :
+        crc{ CRC32_INITIAL_VALUE }
+    {
+
+    }
+
+    void Update(const void *data, size_t size)
+    {
+        crc = UpdateCyclicRedundancyCheck32(crc, (const uint8_t *)data, size);
+    }
+
+    uint32_t Value() const
+    {
+        return crc;
+    }
+
+    void Reset()
+    {
+        crc = CRC32_INITIAL_VALUE;
+    }
+
+protected:
+    uint32_t crc;
+};
+
+/**
+ * @brief A fast 64-bit hash for cache keys, in the way of wyhash: 16 bytes
+ *  are mixed by one 64x64 to 128-bit multiply. It is not cryptographic and
+ *  must never be used where the input is chosen by an attacker.
+ */
+uint64_t Hash64(const void *data, size_t size, uint64_t seed = 0);
+
 }
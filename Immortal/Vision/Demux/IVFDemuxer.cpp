@@ -49,6 +49,7 @@ CodecError IVFDemuxer::Open(const String &filepath, VideoCodec *codec, VideoCode
     uint8_t data[32];
     auto animator = codec->GetAddress<Animator>();
 
+    this->filepath = filepath;
     stream.Open(filepath);
     if (!stream.Readable())
     {
@@ -141,5 +142,10 @@ IVFDemuxer::Header IVFDemuxer::ReadHeader()
     return header;
 }
 
+const String &IVFDemuxer::GetSource() const
+{
+    return filepath;
+}
+
 }
 }
@@ -26,11 +26,15 @@ public:
 
     virtual CodecError Read(CodedFrame *codedFrame) override;
 
+    virtual const String &GetSource() const override;
+
 private:
     Header ReadHeader();
 
 protected:
     Stream stream;
+
+    String filepath;
 };
 
 }
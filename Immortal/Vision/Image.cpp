@@ -1,49 +1,205 @@
 #include "Image.h"
-#include "Codec.h"
-#include "Image/ImageCodec.h"
+#include "CodecRegistry.h"
 #include "FileSystem/FileSystem.h"
+#include "Shared/Async.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 
 namespace Immortal
 {
 namespace Vision
 {
 
-static Codec *SelectSuitableCodec(const std::string &path)
+Picture Read(const std::string &path, const DecodeOptions &options)
 {
-    switch (FileSystem::DumpFileId(path))
+    Vision::CodedFrame codedFrame = Vision::CodedFrame::Map(path);
+
+    auto required = options.Scale != DecodeScale::Full ? CodecCapability::Scaling : CodecCapability::None;
+    auto &registry = CodecRegistry::Get();
+    for (auto &candidate : registry.Sniff(codedFrame.GetBuffer(), required))
     {
-    case FileFormat::BMP:
-        return new Vision::BMPCodec;
-
-    case FileFormat::JPG:
-    case FileFormat::JPEG:
-    case FileFormat::JFIF:
-    case FileFormat::HDR:
-    case FileFormat::PNG:
-        return new Vision::STBCodec;
-
-    case FileFormat::PPM:
-        return new Vision::PPMCodec;
-
-    case FileFormat::ARW:
-    case FileFormat::NEF:
-    case FileFormat::CR2:
-        return new Vision::RawCodec;
-
-    default:
-        return new Vision::OpenCVCodec;
-        break;
+        Interface::Codec *codec = registry.Acquire(candidate.Description);
+        codec->SetDecodeOptions(options);
+        try
+        {
+            if (codec->Decode(codedFrame) == CodecError::Succeed)
+            {
+                Picture picture = codec->GetPicture();
+                codec->Flush();
+                return picture;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG::DEBUG("{} failed to decode {}: {}", candidate.Description->Name, path, e.what());
+        }
+        codec->Flush();
     }
+
+    LOG::WARN("No codec is able to decode {}", path);
+    return Picture{};
 }
 
-Picture Read(const std::string &path)
+/**
+ * @brief Keeps the workers of a batch under the bound of the coded bytes in
+ *  flight and the count of the threads. A worker finished schedules the next
+ *  files itself, so neither the caller nor the pool is blocked on the bound.
+ */
+class BatchReader : public std::enable_shared_from_this<BatchReader>
 {
-    Vision::CodedFrame codedFrame{ FileSystem::ReadBinary(path) };
+public:
+    BatchReader(const std::vector<std::string> &paths, ReadCallback &&callback, size_t maxInFlightBytes) :
+        paths{ paths },
+        callback{ std::move(callback) },
+        maxInFlightBytes{ maxInFlightBytes },
+        maxWorkers{ std::max(std::thread::hardware_concurrency(), 1u) }
+    {
+
+    }
+
+    std::future<void> Start()
+    {
+        auto future = promise.get_future();
+        if (paths.empty())
+        {
+            promise.set_value();
+        }
+        else
+        {
+            Schedule();
+        }
+
+        return future;
+    }
+
+protected:
+    void Schedule()
+    {
+        std::vector<std::pair<size_t, size_t>> files;
+        {
+            std::lock_guard lock{ mutex };
+            while (next < paths.size() && running < maxWorkers)
+            {
+                std::error_code error;
+                size_t size = std::filesystem::file_size(paths[next], error);
+                size = error ? 0 : size;
+                if (running > 0 && inFlightBytes + size > maxInFlightBytes)
+                {
+                    break;
+                }
+                inFlightBytes += size;
+                running++;
+                files.emplace_back(next++, size);
+            }
+        }
+
+        for (auto &[index, size] : files)
+        {
+            Async::Execute([self = shared_from_this(), index = index, size = size] {
+                self->Decode(index, size);
+            });
+        }
+    }
+
+    void Decode(size_t index, size_t size)
+    {
+        Picture picture;
+        try
+        {
+            picture = Read(paths[index]);
+        }
+        catch (const std::exception &e)
+        {
+            LOG::WARN("Failed to decode {}: {}", paths[index], e.what());
+        }
+
+        /** A callback throwing must not skip the bookkeeping, or the future would never be ready */
+        std::exception_ptr exception;
+        try
+        {
+            callback(index, std::move(picture));
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        bool finished = false;
+        {
+            std::lock_guard lock{ mutex };
+            inFlightBytes -= size;
+            running--;
+            finished = ++completed == paths.size();
+            if (exception && !error)
+            {
+                error = exception;
+            }
+        }
+
+        if (finished && error)
+        {
+            promise.set_exception(error);
+        }
+        else if (finished)
+        {
+            promise.set_value();
+        }
+        else
+        {
+            Schedule();
+        }
+    }
+
+protected:
+    std::vector<std::string> paths;
+
+    ReadCallback callback;
+
+    size_t maxInFlightBytes;
+
+    uint32_t maxWorkers;
+
+    std::mutex mutex;
+
+    size_t next = 0;
+
+    size_t completed = 0;
+
+    size_t inFlightBytes = 0;
+
+    uint32_t running = 0;
+
+    /** The first exception thrown by the callback, rethrown by the future */
+    std::exception_ptr error;
+
+    std::promise<void> promise;
+};
+
+std::future<void> Read(const std::vector<std::string> &paths, ReadCallback &&callback, size_t maxInFlightBytes)
+{
+    auto reader = std::make_shared<BatchReader>(paths, std::move(callback), maxInFlightBytes);
+    return reader->Start();
+}
+
+std::vector<std::future<Picture>> ReadAsync(const std::vector<std::string> &paths, size_t maxInFlightBytes)
+{
+    auto promises = std::make_shared<std::vector<std::promise<Picture>>>(paths.size());
+
+    std::vector<std::future<Picture>> futures;
+    futures.reserve(paths.size());
+    for (auto &promise : *promises)
+    {
+        futures.emplace_back(promise.get_future());
+    }
 
-    URef<Interface::Codec> codec = SelectSuitableCodec(path);
-    codec->Decode(codedFrame);
+    Read(paths, [promises] (size_t index, Picture &&picture) {
+        (*promises)[index].set_value(std::move(picture));
+    }, maxInFlightBytes);
 
-    return codec->GetPicture();
+    return futures;
 }
 
 }
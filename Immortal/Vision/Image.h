@@ -1,13 +1,36 @@
 #pragma once
 
+#include "Codec.h"
 #include "Picture.h"
 
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
 namespace Immortal
 {
 namespace Vision
 {
 
-Picture Read(const std::string &path);
+/** The coded bytes of a batch mapped at once, a single file larger than it is still decoded alone */
+static constexpr size_t DefaultBatchMemory = 1024ull * 1024 * 1024;
+
+using ReadCallback = std::function<void(size_t index, Picture &&picture)>;
+
+/** The codec is chosen from the content, the next one is tried if it fails */
+Picture Read(const std::string &path, const DecodeOptions &options = {});
+
+/**
+ * @brief Decode the images on the thread pool. Each picture is delivered to
+ *  the callback on the worker decoded it, with its index in the paths. A
+ *  picture failed to decode is delivered empty. The future returned is ready
+ *  after the last callback, and rethrows the first exception thrown by the
+ *  callback, which does not stop the rest of the batch.
+ */
+std::future<void> Read(const std::vector<std::string> &paths, ReadCallback &&callback, size_t maxInFlightBytes = DefaultBatchMemory);
+
+std::vector<std::future<Picture>> ReadAsync(const std::vector<std::string> &paths, size_t maxInFlightBytes = DefaultBatchMemory);
 
 }
 }
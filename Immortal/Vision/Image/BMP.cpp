@@ -1,4 +1,5 @@
 #include "BMP.h"
+#include "Shared/Instrumentor.h"
 
 #include <iostream>
 #include <vector>
@@ -12,6 +13,7 @@ namespace Vision
 
 CodecError BMPCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     const auto &buffer = codedFrame.GetBuffer();
     memcpy(&identifer, buffer.data(), HeaderSize());
 
@@ -1,7 +1,12 @@
 #include "JPEG.h"
+#include "Shared/Instrumentor.h"
 #include "Vision/LookupTable/LookupTable.h"
 #include "Shared/Log.h"
 
+#include <array>
+#include <cmath>
+#include <numbers>
+
 #ifdef SL_HAVE_INTRISIC
 #include "slintrinsic.h"
 #endif
@@ -153,6 +158,80 @@ static void Backward(uint8_t *dst, size_t stride, int16_t *block, int16_t *table
     COPY_64BITS(7);
 }
 
+static inline uint8_t ClampToUint8(int32_t value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/**
+ * The reduced inverse DCT computes the N-point transform over the N x N
+ * lowest frequencies only, with the normalization of the 8-point one, so
+ * each output sample approximates the mean of the pixels it stands for.
+ * The cosine table is indexed by [scale - 1][x][u], with C(u) / 2 folded.
+ */
+static const auto ReducedCosine = [] {
+    std::array<std::array<std::array<float, 4>, 4>, 2> table{};
+    for (size_t scale = 1; scale <= table.size(); scale++)
+    {
+        size_t n = JpegCodec::BLOCK_WIDTH >> scale;
+        for (size_t x = 0; x < n; x++)
+        {
+            for (size_t u = 0; u < n; u++)
+            {
+                double c = u ? 0.5 : 0.5 / std::sqrt(2.0);
+                table[scale - 1][x][u] = float(c * std::cos((2 * x + 1) * u * std::numbers::pi / (2 * n)));
+            }
+        }
+    }
+    return table;
+}();
+
+static void BackwardScaled(uint8_t *dst, size_t stride, const int16_t *block, const int16_t *table, uint32_t scale)
+{
+    if (scale == 3)
+    {
+        /** Only the DC coefficient is needed, which is eight times the mean of the block */
+        int32_t dc = block[0] * table[0];
+        *dst = ClampToUint8(128 + (dc + (dc >= 0 ? 4 : -4)) / 8);
+        return;
+    }
+
+    size_t n = JpegCodec::BLOCK_WIDTH >> scale;
+    auto &cosine = ReducedCosine[scale - 1];
+
+    float rows[4][4];
+    for (size_t v = 0; v < n; v++)
+    {
+        float coefficients[4];
+        for (size_t u = 0; u < n; u++)
+        {
+            coefficients[u] = float(block[v * 8 + u] * table[v * 8 + u]);
+        }
+        for (size_t x = 0; x < n; x++)
+        {
+            float sum = 0;
+            for (size_t u = 0; u < n; u++)
+            {
+                sum += cosine[x][u] * coefficients[u];
+            }
+            rows[v][x] = sum;
+        }
+    }
+
+    for (size_t y = 0; y < n; y++, dst += stride)
+    {
+        for (size_t x = 0; x < n; x++)
+        {
+            float sum = 0;
+            for (size_t v = 0; v < n; v++)
+            {
+                sum += cosine[y][v] * rows[v][x];
+            }
+            dst[x] = ClampToUint8(128 + int32_t(std::lround(sum)));
+        }
+    }
+}
+
 #define HuffReceive(s) bitTracker.GetBits(s)
 static inline int32_t HuffExtend(int32_t r, int32_t s)
 {
@@ -201,15 +280,13 @@ JpegCodec::~JpegCodec()
     {
         allocator.deallocate(buffer, BLOCK_SIZE);
     }
-    if (data.x)
-    {
-        allocator.deallocate(data.x, BLOCK_SIZE);
-    }
 }
 
-void JpegCodec::ParseHeader(const std::vector<uint8_t> &buffer)
+void JpegCodec::ParseHeader(CodedBuffer buffer)
 {
     ThrowIf(buffer[0] != 0xff && buffer[1] != 0xd8, "Not a Jpeg file");
+    isProgressive = false;
+    restartInterval = 0;
 
     auto *end = buffer.data() + buffer.size();
     for (auto ptr = &buffer[2]; ptr < end; )
@@ -279,6 +356,8 @@ void JpegCodec::ParseHeader(const std::vector<uint8_t> &buffer)
 
 CodecError JpegCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
+    scale = uint32_t(decodeOptions.Scale);
     ParseHeader(codedFrame.GetBuffer());
     InitDecodedPlaneBuffer();
     if (!isProgressive)
@@ -368,7 +447,7 @@ inline void JpegCodec::ParseDHT(const uint8_t *data)
 
 inline void JpegCodec::ParseDRI(const uint8_t *data)
 {
-    restartInterval = data[0];
+    restartInterval = Word{ data };
 }
 
 inline void JpegCodec::ParseSOF(const uint8_t *data)
@@ -381,8 +460,6 @@ inline void JpegCodec::ParseSOF(const uint8_t *data)
     bitDepth    = data[0];
 	uint32_t height = Word{ &data[1] };
     uint32_t width  = Word{ &data[3] };
-    picture.SetHeight(height);
-	picture.SetWidth(width);
 
     components.resize(data[5]);
     auto ptr = &data[6];
@@ -401,8 +478,10 @@ inline void JpegCodec::ParseSOF(const uint8_t *data)
         maxSampingFactor.horizontal = std::max(maxSampingFactor.horizontal, components[index].sampingFactor.horizontal);
     }
 
-    picture.SetFormat(SelectFormat(components[0].sampingFactor));
+    uint32_t rounding = (1 << scale) - 1;
+    picture = Picture{ (width + rounding) >> scale, (height + rounding) >> scale, SelectFormat(components[0].sampingFactor) };
 
+    blocksInMCU = 0;
     for (size_t i = 0; i < components.size(); i++)
     {
         auto &component = components[i];
@@ -441,16 +520,27 @@ inline void JpegCodec::ParseSOS(const uint8_t *data)
     }
 }
 
+size_t JpegCodec::PlaneSize(size_t index) const
+{
+    auto &component = components[index];
+    return SLALIGN((component.x >> scale) * (component.y >> scale), BLOCK_SIZE);
+}
+
 void JpegCodec::InitDecodedPlaneBuffer()
 {
     size_t size = 0;
+    size_t blockWidth = BLOCK_WIDTH >> scale;
 
     auto planes = picture.GetFormat().GetComponent();
     std::array<uint32_t, 4> offsets{ 0 };
     for (size_t i = 0; i < planes; i++)
     {
         offsets[i] = size;
-        size += SLALIGN(components[i].x * components[i].y, BLOCK_SIZE);
+        size += PlaneSize(i);
+    }
+    if (buffer)
+    {
+        allocator.deallocate(buffer, BLOCK_SIZE);
     }
     buffer = allocator.allocate(size);
 
@@ -458,16 +548,16 @@ void JpegCodec::InitDecodedPlaneBuffer()
     for (size_t i = 0; i < planes; i++)
     {
         uint32_t offset = offsets[i];
-        uint32_t stride = components[i].x * 8;
+        uint32_t stride = (components[i].x >> scale) * blockWidth;
         for (size_t v = 0; v < components[i].sampingFactor.vertical; v++)
         {
             for (size_t h = 0; h < components[i].sampingFactor.horizontal; h++)
             {
                 auto &block = blocks[blockIndex];
                 block.componentIndex = i;
-                block.offset = components[i].sampingFactor.horizontal * BLOCK_WIDTH;
+                block.offset = components[i].sampingFactor.horizontal * blockWidth;
                 block.stride = stride * components[i].sampingFactor.vertical;
-                block.data = &buffer[offset + h * BLOCK_WIDTH + v * stride];
+                block.data = &buffer[offset + h * blockWidth + v * stride];
                 blockIndex++;
             }
         }
@@ -478,10 +568,21 @@ void JpegCodec::DecodeMCU()
 {
     int32_t SL_ALIGNED(16) pred[4] = { 0 };
     auto dstBlocks = blocks;
+    uint32_t restartsToGo = restartInterval;
     for (size_t y = 0; y < mcu.y; y++)
     {
         for (size_t x = 0; x < mcu.x; x++)
         {
+            if (restartInterval)
+            {
+                if (!restartsToGo)
+                {
+                    bitTracker.Restart();
+                    memset(pred, 0, sizeof(pred));
+                    restartsToGo = restartInterval;
+                }
+                restartsToGo--;
+            }
             for (size_t i = 0; i < blocksInMCU; i++)
             {
                 int16_t blockBuffer[BLOCK_SIZE] = { 0 };
@@ -489,13 +590,14 @@ void JpegCodec::DecodeMCU()
                 auto index = block.componentIndex;
                 auto &component = components[index];
                 DecodeBlock(blockBuffer, dctbl[component.dcIndex], actbl[component.acIndex], &pred[index]);
-                Backward(&block.data[y * block.stride + x * block.offset], component.x, blockBuffer, quantizationTables[component.qtSelector].data());
-            }
-            if (bitTracker.RestartMarker)
-            {
-                memset(pred, 0, sizeof(pred));
-                bitTracker.RestartMarker = false;
-                break;
+                if (scale)
+                {
+                    BackwardScaled(&block.data[y * block.stride + x * block.offset], component.x >> scale, blockBuffer, quantizationTables[component.qtSelector].data(), scale);
+                }
+                else
+                {
+                    Backward(&block.data[y * block.stride + x * block.offset], component.x, blockBuffer, quantizationTables[component.qtSelector].data());
+                }
             }
         }
     }
@@ -545,7 +647,7 @@ int32_t JpegCodec::HuffDecode(HuffTable &huffTable)
     int64_t code = 0;
     for (int32_t i = 1, j = 0; ; )
     {
-        code = (code << 1) + bitTracker.GetBits(1);
+        code = (code << 1) + bitTracker.GetBit();
         if (code > huffTable.MAXCODE[i])
         {
             i++;
@@ -561,30 +663,34 @@ int32_t JpegCodec::HuffDecode(HuffTable &huffTable)
 
 void JpegCodec::ConvertColorSpace()
 {
-	auto &width  = picture.GetWidth();
-	auto &height = picture.GetHeight();
-	auto &format = picture.GetFormat();
+	auto width  = picture.GetWidth();
+	auto height = picture.GetHeight();
+	auto format = picture.GetFormat();
     CVector<uint8_t> yuv;
-    data.x = allocator.allocate(width * Format{ Format::RGBA8 }.ComponentCount());
+
+    Picture output{ width, height, Format::RGBA8, true };
+    CVector<uint8_t> data;
+    data.x = output.GetData();
 
     for (size_t i = 0, offset = 0; i < components.size(); i++)
     {
         yuv[i] = buffer + offset;
-        offset += SLALIGN(components[i].x * components[i].y, BLOCK_SIZE);
+        offset += PlaneSize(i);
     }
 
+    /** The planes are as wide as the MCUs, scaled the same as the picture */
     if (format == Format::YUV444P)
     {
-        yuv.linesize[0] = SLALIGN(width, 8);
+        yuv.linesize[0] = components[0].x >> scale;
         YUV444PToRGBA8(data, yuv, width, height);
     }
     else if (format == Format::YUV420P)
     {
-        yuv.linesize[0] = SLALIGN(width, 8);
-        yuv.linesize[1] = yuv.linesize[0] / 2;
+        yuv.linesize[0] = components[0].x >> scale;
+        yuv.linesize[1] = components[1].x >> scale;
         YUV420PToRGBA8(data, yuv, width, height);
     }
-	picture.SetFormat(Format::RGBA8);
+    picture = output;
 }
 
 static void GenerateHuffSize(const uint8_t *BITS, int32_t *HUFFSIZE, int32_t *lastk)
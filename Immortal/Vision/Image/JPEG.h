@@ -28,76 +28,7 @@ public:
     static constexpr size_t BLOCK_SIZE  = 64;
 
 public:
-    class BitTracker : public SuperBitTracker
-    {
-    public:
-        using Super = SuperBitTracker;
-
-    public:
-        BitTracker() :
-            Super{ }
-        {
-
-        }
-
-        BitTracker(const uint8_t *data, size_t size) :
-            Super{}
-        {
-            Super::start = data;
-            Super::end   = data + size;
-            Super::ptr   = data;
-            Move(64);
-        }
-
-        uint64_t GetBits(uint32_t n)
-        {
-            if (n > bitsLeft)               
-            {                               
-                Move(n + 48);             
-            }                               
-
-            uint64_t ret = word;
-            bitsLeft -= n;                  
-            word <<= n;                     
-
-            return ret >> (64 - n);
-        }
-
-    protected:
-        void Move(uint32_t n)
-        {
-            uint64_t bits = 0;
-            while (n > bitsLeft)
-            {
-                bits <<= BitsPerByte;
-                bitsLeft += BitsPerByte;
-                if (ptr < end)
-                {
-                    uint8_t byte = *ptr++;
-                    bits |= byte;
-                    if (byte == 0xff)
-                    {
-                        byte = *ptr;
-                        if (!byte)
-                        {
-                            ptr++;
-                        }
-                        else if (byte >= RST0 && byte <= RST7)
-                        {
-                            bits &= (((uint64_t)-1) << 8);
-                            bits |= *ptr++;
-                            RestartMarker = true;
-                            continue;
-                        }
-                    }
-                }
-            }
-            word |= bits << (64 - bitsLeft);
-        }
-
-    public:
-        bool RestartMarker = false;
-    };
+    using BitTracker = JpegBitTracker;
 
 public:
     enum MarkerType
@@ -193,7 +124,7 @@ public:
 
     ~JpegCodec();
 
-    void ParseHeader(const std::vector<uint8_t> &buffer);
+    void ParseHeader(CodedBuffer buffer);
 
     virtual CodecError Decode(const CodedFrame &codedFrame) override;
 
@@ -223,11 +154,11 @@ private:
 
     void ConvertColorSpace();
 
+    size_t PlaneSize(size_t index) const;
+
 private:
     AAllocator<uint8_t, BLOCK_SIZE> allocator;
 
-    CVector<uint8_t> data;
-
     std::vector<Component> components;
 
     std::array<Block, 8> blocks;
@@ -242,7 +173,8 @@ private:
     BitTracker bitTracker;
 
     bool isProgressive = false;
-    bool restartInterval = false;
+    /** The MCUs between two restart markers, or 0 without restart markers */
+    uint16_t restartInterval = 0;
 
     struct
     {
@@ -254,6 +186,9 @@ private:
 
     uint8_t bitDepth;
 
+    /** The log2 of the downscaling, which decides the size of a block decoded as 8 >> scale */
+    uint32_t scale = 0;
+
 #ifndef JPEG_CODEC_MINIMAL
     struct {
         std::vector<uint8_t> external;
@@ -1,4 +1,5 @@
 #include "MFXJpegCodec.h"
+#include "Shared/Instrumentor.h"
 #include "Vision/Processing/ColorSpace.h"
 
 #if HAVE_MFX
@@ -26,6 +27,7 @@ MFXJpegCodec::~MFXJpegCodec()
 
 CodecError MFXJpegCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     mfxStatus status;
     mfxFrameSurface1 *pOutSurface{};
 
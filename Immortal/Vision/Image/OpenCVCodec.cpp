@@ -1,4 +1,5 @@
 #include "OpenCVCodec.h"
+#include "Shared/Instrumentor.h"
 
 #if HAVE_OPENCV
 #include <opencv2/opencv.hpp>
@@ -20,10 +21,11 @@ OpenCVCodec::~OpenCVCodec()
 
 CodecError OpenCVCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     cv::Mat mat;
 
     const auto &buf = codedFrame.GetBuffer();
-    cv::Mat	src = cv::imdecode(cv::Mat{ buf }, cv::IMREAD_UNCHANGED);
+    cv::Mat	src = cv::imdecode(cv::Mat{ 1, int(buf.size()), CV_8UC1, (void *)buf.data() }, cv::IMREAD_UNCHANGED);
     if (!src.data)
     {
         return CodecError::CorruptedBitstream;
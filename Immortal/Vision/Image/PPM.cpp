@@ -1,4 +1,5 @@
 #include "PPM.h"
+#include "Shared/Instrumentor.h"
 
 #include <iostream>
 #include <vector>
@@ -23,6 +24,7 @@ PPMCodec::~PPMCodec()
 #define PPM_HEADER "P3\n%d %d\n255\n"
 CodecError PPMCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     int width, height;
     size_t n = sizeof(PPM_HEADER);
 	auto ptr = (const char *)codedFrame.GetBuffer().data();
@@ -1,7 +1,14 @@
 #include "Raw.h"
+#include "Shared/Instrumentor.h"
 #include "libraw/libraw.h"
 
+#include "Vision/CodecRegistry.h"
+
+#include <algorithm>
 #include <concepts>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 namespace Immortal
 {
@@ -11,24 +18,86 @@ namespace Vision
 template <class T>
 concept SampleType = std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>;
 
+/**
+ * The rows of packed RGB are written to the start of the rows of the picture
+ * by LibRaw, and expanded to RGBA in place from the right, where a pixel is
+ * never written before the ones on the left of it have been read.
+ */
 template <SampleType T>
-void ReadPixelsToPicture(T *dst, T *pixels, uint32_t width, uint32_t height, int channels)
+void ExpandRGBToRGBA(T *data, uint32_t width, uint32_t height)
 {
-    for (int i = 0; i < height; i++)
+    for (uint32_t i = 0; i < height; i++)
     {
-        T *src = &pixels[i * width * channels];
-        for (int j = 0; j < width; j++, dst += 4, src += 3)
+        T *row = &data[size_t(i) * width * 4];
+        for (uint32_t j = width; j-- > 0; )
         {
-            dst[0] = src[0];
-            dst[1] = src[1];
-            dst[2] = src[2];
-            dst[3] = T(-1);
+            T r = row[j * 3 + 0];
+            T g = row[j * 3 + 1];
+            T b = row[j * 3 + 2];
+            row[j * 4 + 0] = r;
+            row[j * 4 + 1] = g;
+            row[j * 4 + 2] = b;
+            row[j * 4 + 3] = T(-1);
         }
     }
 }
 
+/**
+ * @brief The processors are expensive to create, and hold the buffers of the
+ *  last decode, so they are recycled and kept for the next one.
+ */
+class RawProcessorPool
+{
+public:
+    static constexpr size_t MaxIdleProcessors = 8;
+
+public:
+    ~RawProcessorPool()
+    {
+        for (auto processor : processors)
+        {
+            delete processor;
+        }
+    }
+
+    LibRaw *Acquire()
+    {
+        {
+            std::lock_guard lock{ mutex };
+            if (!processors.empty())
+            {
+                LibRaw *processor = processors.back();
+                processors.pop_back();
+                return processor;
+            }
+        }
+
+        return new LibRaw;
+    }
+
+    void Release(LibRaw *processor)
+    {
+        processor->recycle();
+
+        std::lock_guard lock{ mutex };
+        if (processors.size() < MaxIdleProcessors)
+        {
+            processors.emplace_back(processor);
+            return;
+        }
+        delete processor;
+    }
+
+protected:
+    std::mutex mutex;
+
+    std::vector<LibRaw *> processors;
+};
+
+static RawProcessorPool processorPool;
+
 RawCodec::RawCodec() :
-    format{ Format::BayerLayerRGBG },
+    mode{ RawDecodeMode::Bayer },
     bitDepth{ RawBitDepth::_16 }
 {
 
@@ -41,49 +110,163 @@ RawCodec::~RawCodec()
 
 CodecError RawCodec::Decode(const CodedFrame &codedFrame)
 {
-    const auto &buffer = codedFrame.GetBuffer();
+    SL_PROFILE_FUNCTION();
+    auto buffer = codedFrame.GetBuffer();
 
-    URef<LibRaw> processor = new LibRaw;
-    processor->open_buffer(buffer.data(), buffer.size());
-    processor->unpack();
+    LibRaw *processor = processorPool.Acquire();
+    CodecError error = CodecError::ExternalFailed;
+    if (processor->open_buffer(buffer.data(), buffer.size()) == LIBRAW_SUCCESS)
+    {
+        if (mode == RawDecodeMode::Preview)
+        {
+            error = DecodePreview(processor);
+        }
+        else if (processor->unpack() == LIBRAW_SUCCESS)
+        {
+            error = mode == RawDecodeMode::Bayer ? DecodeBayer(processor) : DecodeProcessed(processor);
+        }
+    }
+    processorPool.Release(processor);
 
-    if (format == Format::BayerLayerRGBG)
+    return error;
+}
+
+/** The colour of a site by LibRaw, 0 for red, 2 for blue and 1 or 3 for green */
+static BayerPattern GetBayerPattern(LibRaw *processor)
+{
+    int topLeft  = processor->COLOR(0, 0);
+    int topRight = processor->COLOR(0, 1);
+    if (topLeft == 0)
     {
-		auto &rawParams = processor->imgdata.rawdata.iparams;
-		assert(rawParams.cdesc[0] == 'R' && rawParams.cdesc[1] == 'G' && rawParams.cdesc[2] == 'B' && rawParams.cdesc[3] == 'G');
+        return BayerPattern::RGGB;
+    }
+    if (topLeft == 2)
+    {
+        return BayerPattern::BGGR;
+    }
+    return topRight == 0 ? BayerPattern::GRBG : BayerPattern::GBRG;
+}
+
+CodecError RawCodec::DecodeBayer(LibRaw *processor)
+{
+    auto &rawParams = processor->imgdata.rawdata.iparams;
+    auto &sizes = processor->imgdata.rawdata.sizes;
+    auto &color = processor->imgdata.rawdata.color;
 
-		auto width  = processor->imgdata.rawdata.sizes.raw_width;
-		auto height = processor->imgdata.rawdata.sizes.raw_height;
-		picture = Picture{ width, height, Format::BayerLayerRGBG, true };
+    /** Only the RGB mosaics of 2x2 repeated down the sensor, not X-Trans, Foveon or the linear sensors */
+    unsigned filters = rawParams.filters;
+    if (!processor->imgdata.rawdata.raw_image || rawParams.colors != 3 || filters < 1000 || (filters & 0xff) * 0x01010101u != filters)
+    {
+        return CodecError::UnsupportFormat;
+    }
 
-		memcpy(picture.GetData(), processor->imgdata.rawdata.raw_image, processor->imgdata.rawdata.sizes.raw_pitch * processor->imgdata.rawdata.sizes.raw_height);
+    /** The visible area, where the pattern of LibRaw starts */
+    picture = Picture{ sizes.width, sizes.height, Format::BayerLayerRGBG, true };
+    const uint16_t *src = processor->imgdata.rawdata.raw_image + size_t(sizes.top_margin) * (sizes.raw_pitch / 2) + sizes.left_margin;
+    uint16_t *dst = (uint16_t *)picture.GetData();
+    for (size_t y = 0; y < sizes.height; y++)
+    {
+        memcpy(dst + y * sizes.width, src + y * (sizes.raw_pitch / 2), sizes.width * sizeof(uint16_t));
+    }
+
+    unsigned black = *std::min_element(color.cblack, color.cblack + 4);
+    if (size_t patternSize = size_t(color.cblack[4]) * color.cblack[5])
+    {
+        black += *std::min_element(color.cblack + 6, color.cblack + 6 + patternSize);
+    }
+
+    demosaicParams.Pattern    = GetBayerPattern(processor);
+    demosaicParams.BlackLevel = uint16_t(std::min(color.black + black, 0xffffu));
+    demosaicParams.WhiteLevel = uint16_t(std::min(color.maximum, 0xffffu));
+
+    /** The multipliers of the camera as shot, relative to green */
+    bool hasWhiteBalance = color.cam_mul[0] > 0 && color.cam_mul[1] > 0 && color.cam_mul[2] > 0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        demosaicParams.WhiteBalance[i] = hasWhiteBalance ? color.cam_mul[i] / color.cam_mul[1] : 1.0f;
+    }
+
+    return CodecError::Succeed;
+}
+
+CodecError RawCodec::DecodeProcessed(LibRaw *processor)
+{
+    processor->imgdata.params.half_size  = mode == RawDecodeMode::HalfSize || decodeOptions.Scale != DecodeScale::Full;
+    processor->imgdata.params.output_bps = (int)bitDepth;
+    if (processor->dcraw_process() != LIBRAW_SUCCESS)
+    {
+        return CodecError::ExternalFailed;
+    }
+
+    int width, height, colors, bps;
+    processor->get_mem_image_format(&width, &height, &colors, &bps);
+    if (colors != 3)
+    {
+        return CodecError::UnsupportFormat;
+    }
+
+    size_t texelSize = (bitDepth == RawBitDepth::_16 ? sizeof(uint16_t) : sizeof(uint8_t)) * 4;
+    picture = Picture{ width, height, bitDepth == RawBitDepth::_16 ? Format::RGBA16 : Format::RGBA8, true };
+
+    /** Written into the picture straight, instead of a processed image allocated by LibRaw to be copied */
+    if (processor->copy_mem_image(picture.GetData(), int(width * texelSize), 0) != LIBRAW_SUCCESS)
+    {
+        picture = Picture{};
+        return CodecError::ExternalFailed;
+    }
+
+    if (bitDepth == RawBitDepth::_16)
+    {
+        ExpandRGBToRGBA<uint16_t>((uint16_t *)picture.GetData(), width, height);
     }
     else
     {
-		processor->dcraw_process();
-		processor->imgdata.params.output_bps = (int)bitDepth;
+        ExpandRGBToRGBA<uint8_t>(picture.GetData(), width, height);
+    }
+
+    return CodecError::Succeed;
+}
+
+CodecError RawCodec::DecodePreview(LibRaw *processor)
+{
+    if (processor->unpack_thumb() != LIBRAW_SUCCESS)
+    {
+        return CodecError::UnsupportFormat;
+    }
+
+    auto &thumbnail = processor->imgdata.thumbnail;
+    if (thumbnail.tformat == LIBRAW_THUMBNAIL_BITMAP && thumbnail.tcolors == 3)
+    {
+        picture = Picture{ thumbnail.twidth, thumbnail.theight, Format::RGBA8, true };
+        memcpy(picture.GetData(), thumbnail.thumb, size_t(thumbnail.twidth) * thumbnail.theight * 3);
+        ExpandRGBToRGBA<uint8_t>(picture.GetData(), thumbnail.twidth, thumbnail.theight);
+        return CodecError::Succeed;
+    }
+
+    if (thumbnail.tformat != LIBRAW_THUMBNAIL_JPEG)
+    {
+        return CodecError::UnsupportFormat;
+    }
+
+    /** The thumbnail is owned by the processor, which is only recycled after the decoding */
+    CodedFrame codedFrame{ std::vector<uint8_t>{} };
+    codedFrame.Wrap((const uint8_t *)thumbnail.thumb, thumbnail.tlength);
 
-		int err = 0;
-		libraw_processed_image_t *image = processor->dcraw_make_mem_image(&err);
-        if (err)
+    auto &registry = CodecRegistry::Get();
+    for (auto &candidate : registry.Sniff(codedFrame.GetBuffer(), decodeOptions.Scale != DecodeScale::Full ? CodecCapability::Scaling : CodecCapability::None))
+    {
+        Interface::Codec *codec = registry.Acquire(candidate.Description);
+        codec->SetDecodeOptions(decodeOptions);
+        if (codec->Decode(codedFrame) == CodecError::Succeed)
         {
-		    return CodecError::ExternalFailed;
+            picture = codec->GetPicture();
+            codec->Flush();
+            return CodecError::Succeed;
         }
-
-		if (bitDepth == RawBitDepth::_16)
-		{
-		    picture = Picture{ image->width, image->height, Format::RGBA16, true };
-			ReadPixelsToPicture<uint16_t>((uint16_t *)picture.GetData(), (uint16_t *)image->data, image->width, image->height, image->colors);
-		}
-		else
-		{
-			picture = Picture{ image->width, image->height, Format::RGBA8, true };
-			ReadPixelsToPicture<uint8_t>(picture.GetData(), image->data, image->width, image->height, image->colors);
-		}
+        codec->Flush();
     }
 
-    processor->recycle();
-    return CodecError::Succeed;
+    return CodecError::CorruptedBitstream;
 }
 
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Vision/Codec.h"
+#include "Vision/Processing/Demosaic.h"
+
+class LibRaw;
 
 namespace Immortal
 {
@@ -13,6 +16,21 @@ enum class RawBitDepth
     _16 = 16,
 };
 
+enum class RawDecodeMode
+{
+    /** The sensor data as is, to be demosaiced later */
+    Bayer,
+
+    /** Demosaiced at the full resolution */
+    Full,
+
+    /** Demosaiced at the half resolution, every 2x2 Bayer quad becomes one pixel */
+    HalfSize,
+
+    /** The thumbnail embedded by the camera, without touching the raw data */
+    Preview,
+};
+
 class RawCodec : public Interface::Codec
 {
 public:
@@ -31,10 +49,30 @@ public:
         bitDepth = value;
     }
 
+    void SetMode(RawDecodeMode value)
+    {
+        mode = value;
+    }
+
+    /** The pattern, levels and white balance of the camera for the last picture decoded in RawDecodeMode::Bayer */
+    const DemosaicParams &GetDemosaicParams() const
+    {
+        return demosaicParams;
+    }
+
 protected:
-    Format format;
+    CodecError DecodeBayer(LibRaw *processor);
+
+    CodecError DecodePreview(LibRaw *processor);
+
+    CodecError DecodeProcessed(LibRaw *processor);
+
+protected:
+    RawDecodeMode mode;
 
     RawBitDepth bitDepth;
+
+    DemosaicParams demosaicParams;
 };
 
 }
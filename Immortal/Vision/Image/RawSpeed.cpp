@@ -1,4 +1,5 @@
 #include "RawSpeed.h"
+#include "Shared/Instrumentor.h"
 #include "rawspeed_capi.h"
 
 namespace Immortal
@@ -13,6 +14,7 @@ RawSpeedCodec::RawSpeedCodec()
 
 CodecError RawSpeedCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     const auto &buffer = codedFrame.GetBuffer();
 
     auto parser = rawspeed_parser_allocate(buffer.data(), buffer.size());
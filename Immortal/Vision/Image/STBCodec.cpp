@@ -1,4 +1,5 @@
 #include "STBCodec.h"
+#include "Shared/Instrumentor.h"
 
 namespace Immortal
 {
@@ -18,6 +19,7 @@ STBCodec::~STBCodec()
 
 CodecError STBCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     int width, height, depth;
     const auto &buffer = codedFrame.GetBuffer();
 
@@ -1,4 +1,5 @@
 #include "MFXCodec.h"
+#include "Shared/Instrumentor.h"
 
 #if HAVE_MFX
 namespace Immortal
@@ -91,6 +92,7 @@ MFXCodec::~MFXCodec()
 
 CodecError MFXCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
    
     return CodecError::Succeed;
 }
@@ -0,0 +1,386 @@
+#include "Demosaic.h"
+#include "Shared/Async.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <vector>
+
+namespace Immortal
+{
+namespace Vision
+{
+
+enum Channel : uint8_t
+{
+    Red,
+    Green,
+    Blue,
+};
+
+/** The rows and columns mirrored around the edges, which are enough for the widest kernel */
+static constexpr int32_t Padding = 3;
+
+static constexpr int32_t RowsPerBand = 32;
+
+static const Channel Patterns[][4] = {
+    { Red,   Green, Green, Blue  },
+    { Blue,  Green, Green, Red   },
+    { Green, Red,   Blue,  Green },
+    { Green, Blue,  Red,   Green },
+};
+
+/** Mirroring by an even distance keeps the colour of the mosaic */
+static inline int32_t Reflect(int32_t v, int32_t size)
+{
+    if (v < 0)
+    {
+        v = -v;
+    }
+    if (v >= size)
+    {
+        v = 2 * (size - 1) - v;
+    }
+    return std::clamp(v, 0, size - 1);
+}
+
+/**
+ * @brief The working set of a band. The mosaic is normalized into floats with
+ *  the padding around, so the kernels could read the neighbours without any
+ *  bounds check in the inner loops.
+ */
+class DemosaicBand
+{
+public:
+    DemosaicBand(const uint16_t *src, int32_t stride, int32_t width, int32_t height, const DemosaicParams &params) :
+        src{ src },
+        stride{ stride },
+        width{ width },
+        height{ height },
+        pitch{ width + 2 * Padding },
+        params{ params },
+        pattern{ Patterns[size_t(params.Pattern)] }
+    {
+        float range = std::max(float(params.WhiteLevel) - float(params.BlackLevel), 1.0f);
+        for (size_t i = 0; i < 3; i++)
+        {
+            gains[i] = params.WhiteBalance[i] / range;
+        }
+    }
+
+    Channel ChannelAt(int32_t y, int32_t x) const
+    {
+        return pattern[((y & 1) << 1) | (x & 1)];
+    }
+
+    /** Normalize the rows [begin - Padding, end + Padding) */
+    void Load(int32_t begin, int32_t end)
+    {
+        top = begin - Padding;
+        rows = end - begin + 2 * Padding;
+        mosaic.resize(size_t(rows) * pitch);
+
+        float black = float(params.BlackLevel);
+        for (int32_t i = 0; i < rows; i++)
+        {
+            int32_t y = top + i;
+            const uint16_t *line = src + size_t(Reflect(y, height)) * stride;
+            float *dst = &mosaic[size_t(i) * pitch + Padding];
+            float gain[2] = { gains[ChannelAt(y, 0)], gains[ChannelAt(y, 1)] };
+
+            int32_t x = 0;
+            for (; x + 1 < width; x += 2)
+            {
+                dst[x + 0] = (float(line[x + 0]) - black) * gain[0];
+                dst[x + 1] = (float(line[x + 1]) - black) * gain[1];
+            }
+            for (; x < width; x++)
+            {
+                dst[x] = (float(line[x]) - black) * gain[x & 1];
+            }
+            for (int32_t p = 1; p <= Padding; p++)
+            {
+                dst[-p] = dst[Reflect(-p, width)];
+                dst[width - 1 + p] = dst[Reflect(width - 1 + p, width)];
+            }
+        }
+    }
+
+    const float *Row(int32_t y) const
+    {
+        return &mosaic[size_t(y - top) * pitch + Padding];
+    }
+
+    /**
+     * @brief Call the kernel of the row with the colours of its even and odd
+     *  columns, which are the same along a row. The kernels are specialized on
+     *  them so the inner loops have no branch on the colour of each pixel.
+     */
+    template <class F>
+    void DispatchRow(int32_t y, F &&kernel) const
+    {
+        Channel even = ChannelAt(y, 0);
+        Channel odd  = ChannelAt(y, 1);
+        if (even == Red)
+        {
+            kernel.template operator()<Red, Green>();
+        }
+        else if (even == Blue)
+        {
+            kernel.template operator()<Blue, Green>();
+        }
+        else if (odd == Red)
+        {
+            kernel.template operator()<Green, Red>();
+        }
+        else
+        {
+            kernel.template operator()<Green, Blue>();
+        }
+    }
+
+    /** N is the colour other than green in the row, the rows above and below have the opposite one */
+    template <Channel C, Channel N, class T>
+    static void BilinearPixel(T *out, const float *n, const float *c, const float *s, int32_t x)
+    {
+        constexpr Channel O = N == Red ? Blue : Red;
+
+        float rgb[3];
+        if constexpr (C == Green)
+        {
+            rgb[Green] = c[x];
+            rgb[N]     = (c[x - 1] + c[x + 1]) * 0.5f;
+            rgb[O]     = (n[x] + s[x]) * 0.5f;
+        }
+        else
+        {
+            rgb[C]     = c[x];
+            rgb[Green] = (n[x] + s[x] + c[x - 1] + c[x + 1]) * 0.25f;
+            rgb[O]     = (n[x - 1] + n[x + 1] + s[x - 1] + s[x + 1]) * 0.25f;
+        }
+        Store(out, rgb);
+    }
+
+    template <class T>
+    void Bilinear(T *dst, int32_t begin, int32_t end) const
+    {
+        for (int32_t y = begin; y < end; y++)
+        {
+            const float *n = Row(y - 1);
+            const float *c = Row(y);
+            const float *s = Row(y + 1);
+            T *out = dst + size_t(y) * width * 4;
+            DispatchRow(y, [&] <Channel Even, Channel Odd> () {
+                constexpr Channel N = Even == Green ? Odd : Even;
+                int32_t x = 0;
+                for (; x + 1 < width; x += 2)
+                {
+                    BilinearPixel<Even, N>(out + x * 4,       n, c, s, x    );
+                    BilinearPixel<Odd,  N>(out + (x + 1) * 4, n, c, s, x + 1);
+                }
+                if (x < width)
+                {
+                    BilinearPixel<Even, N>(out + x * 4, n, c, s, x);
+                }
+            });
+        }
+    }
+
+    /** The green of a red or blue sample along the smoother direction */
+    static float InterpolateGreen(const float *nn, const float *n, const float *c, const float *s, const float *ss, int32_t x)
+    {
+        float horizontalLaplacian = 2 * c[x] - c[x - 2] - c[x + 2];
+        float verticalLaplacian   = 2 * c[x] - nn[x] - ss[x];
+        float horizontalGradient = std::abs(c[x - 1] - c[x + 1]) + std::abs(horizontalLaplacian);
+        float verticalGradient   = std::abs(n[x] - s[x]) + std::abs(verticalLaplacian);
+        float horizontal = (c[x - 1] + c[x + 1]) * 0.5f + horizontalLaplacian * 0.25f;
+        float vertical   = (n[x] + s[x]) * 0.5f + verticalLaplacian * 0.25f;
+
+        return horizontalGradient < verticalGradient ? horizontal :
+               verticalGradient < horizontalGradient ? vertical : (horizontal + vertical) * 0.5f;
+    }
+
+    template <Channel C, Channel N, class T>
+    static void EdgeAwarePixel(T *out, const float *n, const float *c, const float *s, const float *gn, const float *gc, const float *gs, int32_t x)
+    {
+        constexpr Channel O = N == Red ? Blue : Red;
+
+        float rgb[3];
+        rgb[Green] = gc[x];
+        if constexpr (C == Green)
+        {
+            rgb[N] = gc[x] + ((c[x - 1] - gc[x - 1]) + (c[x + 1] - gc[x + 1])) * 0.5f;
+            rgb[O] = gc[x] + ((n[x] - gn[x]) + (s[x] - gs[x])) * 0.5f;
+        }
+        else
+        {
+            rgb[C] = c[x];
+            rgb[O] = gc[x] + ((n[x - 1] - gn[x - 1]) + (n[x + 1] - gn[x + 1]) +
+                              (s[x - 1] - gs[x - 1]) + (s[x + 1] - gs[x + 1])) * 0.25f;
+        }
+        Store(out, rgb);
+    }
+
+    /** The green of the rows [begin - 1, end + 1) is interpolated first, as the red and blue are derived from it */
+    template <class T>
+    void EdgeAware(T *dst, int32_t begin, int32_t end)
+    {
+        int32_t greenTop = begin - 1;
+        green.resize(size_t(end - begin + 2) * pitch);
+        for (int32_t y = begin - 1; y < end + 1; y++)
+        {
+            const float *nn = Row(y - 2);
+            const float *n  = Row(y - 1);
+            const float *c  = Row(y);
+            const float *s  = Row(y + 1);
+            const float *ss = Row(y + 2);
+            float *g = &green[size_t(y - greenTop) * pitch + Padding];
+
+            /** The columns [-1, width + 1) by parity, green is copied and the others interpolated */
+            int32_t greenColumn = ChannelAt(y, 0) == Green ? 0 : -1;
+            int32_t otherColumn = greenColumn == 0 ? -1 : 0;
+            for (int32_t x = greenColumn; x < width + 1; x += 2)
+            {
+                g[x] = c[x];
+            }
+            for (int32_t x = otherColumn; x < width + 1; x += 2)
+            {
+                g[x] = InterpolateGreen(nn, n, c, s, ss, x);
+            }
+        }
+
+        for (int32_t y = begin; y < end; y++)
+        {
+            const float *n  = Row(y - 1);
+            const float *c  = Row(y);
+            const float *s  = Row(y + 1);
+            const float *gn = &green[size_t(y - 1 - greenTop) * pitch + Padding];
+            const float *gc = &green[size_t(y - greenTop) * pitch + Padding];
+            const float *gs = &green[size_t(y + 1 - greenTop) * pitch + Padding];
+            T *out = dst + size_t(y) * width * 4;
+            DispatchRow(y, [&] <Channel Even, Channel Odd> () {
+                constexpr Channel N = Even == Green ? Odd : Even;
+                int32_t x = 0;
+                for (; x + 1 < width; x += 2)
+                {
+                    EdgeAwarePixel<Even, N>(out + x * 4,       n, c, s, gn, gc, gs, x    );
+                    EdgeAwarePixel<Odd,  N>(out + (x + 1) * 4, n, c, s, gn, gc, gs, x + 1);
+                }
+                if (x < width)
+                {
+                    EdgeAwarePixel<Even, N>(out + x * 4, n, c, s, gn, gc, gs, x);
+                }
+            });
+        }
+    }
+
+protected:
+    template <class T>
+    static void Store(T *out, const float *rgb)
+    {
+        constexpr float scale = float(T(-1));
+        out[0] = T(std::clamp(rgb[Red],   0.0f, 1.0f) * scale + 0.5f);
+        out[1] = T(std::clamp(rgb[Green], 0.0f, 1.0f) * scale + 0.5f);
+        out[2] = T(std::clamp(rgb[Blue],  0.0f, 1.0f) * scale + 0.5f);
+        out[3] = T(-1);
+    }
+
+protected:
+    const uint16_t *src;
+
+    int32_t stride;
+
+    int32_t width;
+
+    int32_t height;
+
+    int32_t pitch;
+
+    int32_t top = 0;
+
+    int32_t rows = 0;
+
+    const DemosaicParams &params;
+
+    const Channel *pattern;
+
+    float gains[3];
+
+    std::vector<float> mosaic;
+
+    std::vector<float> green;
+};
+
+template <class T>
+static void DemosaicTo(T *dst, const uint16_t *src, int32_t stride, int32_t width, int32_t height, const DemosaicParams &params)
+{
+    auto process = [=, &params] (int32_t begin, int32_t end) {
+        DemosaicBand band{ src, stride, width, height, params };
+        for (int32_t y = begin; y < end; y += RowsPerBand)
+        {
+            int32_t bandEnd = std::min(y + RowsPerBand, end);
+            band.Load(y, bandEnd);
+            if (params.Method == DemosaicMethod::EdgeAware)
+            {
+                band.EdgeAware(dst, y, bandEnd);
+            }
+            else
+            {
+                band.Bilinear(dst, y, bandEnd);
+            }
+        }
+    };
+
+    int32_t bands = (height + RowsPerBand - 1) / RowsPerBand;
+    int32_t taskCount = std::min<int32_t>(bands, std::thread::hardware_concurrency());
+    /** A decode already on a worker, e.g. from the batch reader, would wait on bands queued behind itself */
+    if (taskCount < 2 || !Async::threadPool || Async::threadPool->IsWorkerThread())
+    {
+        process(0, height);
+        return;
+    }
+
+    int32_t rowsPerTask = (bands + taskCount - 1) / taskCount * RowsPerBand;
+    std::vector<std::future<void>> futures;
+    futures.reserve(taskCount - 1);
+    for (int32_t begin = rowsPerTask; begin < height; begin += rowsPerTask)
+    {
+        futures.emplace_back(Async::Execute([=] { process(begin, std::min(begin + rowsPerTask, height)); }));
+    }
+
+    process(0, std::min(rowsPerTask, height));
+    for (auto &future : futures)
+    {
+        future.wait();
+    }
+}
+
+Picture Demosaic(const Picture &bayer, const DemosaicParams &params)
+{
+    if (!bayer || bayer.GetFormat() != Format::BayerLayerRGBG)
+    {
+        LOG::WARN("Only the pictures of BayerLayerRGBG are able to be demosaiced");
+        return Picture{};
+    }
+
+    int32_t width  = int32_t(bayer.GetWidth());
+    int32_t height = int32_t(bayer.GetHeight());
+    int32_t stride = bayer.GetStride(0) ? int32_t(bayer.GetStride(0)) : width;
+    const uint16_t *src = (const uint16_t *)bayer.GetData();
+
+    bool is8Bits = params.Output == Format::RGBA8;
+    Picture picture{ width, height, is8Bits ? Format::RGBA8 : Format::RGBA16, true };
+    if (is8Bits)
+    {
+        DemosaicTo<uint8_t>(picture.GetData(), src, stride, width, height, params);
+    }
+    else
+    {
+        DemosaicTo<uint16_t>((uint16_t *)picture.GetData(), src, stride, width, height, params);
+    }
+
+    return picture;
+}
+
+}
+}
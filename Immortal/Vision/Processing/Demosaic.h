@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Core.h"
+#include "Vision/Picture.h"
+
+namespace Immortal
+{
+namespace Vision
+{
+
+enum class DemosaicMethod
+{
+    /** The missing colours averaged from the nearest samples */
+    Bilinear,
+
+    /** Green interpolated along the smoother direction, red and blue from the colour differences */
+    EdgeAware,
+};
+
+/** The colours of the top left 2x2 quad of the mosaic, row by row */
+enum class BayerPattern
+{
+    RGGB,
+    BGGR,
+    GRBG,
+    GBRG,
+};
+
+struct DemosaicParams
+{
+    DemosaicMethod Method = DemosaicMethod::Bilinear;
+
+    BayerPattern Pattern = BayerPattern::RGGB;
+
+    /** The raw values of black and saturation, which are mapped to 0 and 1 before the white balance */
+    uint16_t BlackLevel = 0;
+
+    uint16_t WhiteLevel = 0xffff;
+
+    /** The multipliers of red, green and blue */
+    float WhiteBalance[3] = { 1.0f, 1.0f, 1.0f };
+
+    /** RGBA16 or RGBA8, both linear */
+    Format Output = Format::RGBA16;
+};
+
+/**
+ * @brief Demosaic a picture of Format::BayerLayerRGBG with 16-bit samples on
+ *  the thread pool, band by band of rows. The black level and white balance
+ *  are applied to the mosaic before the interpolation. The params of a raw
+ *  image are given by RawCodec::GetDemosaicParams after decoding its mosaic.
+ */
+Picture Demosaic(const Picture &bayer, const DemosaicParams &params = {});
+
+}
+}
@@ -1,4 +1,5 @@
 #include "HEVCCodec.h"
+#include "Shared/Instrumentor.h"
 #include "Render/Graphics.h"
 
 #if HAVE_FFMPEG
@@ -53,6 +54,7 @@ int find_next_start_code(const uint8_t *buf, const uint8_t *next_avc)
 
 CodecError HEVCCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
 	SideData sizeData;
 
 	auto packet = codedFrame.InterpretAs<AVPacket>();
@@ -1,39 +1,49 @@
 #include "DAV1DCodec.h"
+#include "Shared/Instrumentor.h"
 
 #if HAVE_DAV1D
 #include <dav1d/dav1d.h>
 #include <dav1d/version.h>
 
 #include "Vision/Processing/ColorSpace.h"
-#include "Vision/Image/MFXJpegCodec.h"
+#include "Shared/Log.h"
+
+#include <cstring>
 
 namespace Immortal
 {
 namespace Vision
 {
 
-static inline Format SelectFormat(Dav1dPixelLayout layout)
+static inline Format SelectFormat(Dav1dPixelLayout layout, int bitDepth)
 {
     switch (layout)
     {
-    case DAV1D_PIXEL_LAYOUT_I420: return Format::YUV420P;
-    case DAV1D_PIXEL_LAYOUT_I422: return Format::YUV422P;
-    case DAV1D_PIXEL_LAYOUT_I444: return Format::YUV444P;
+    case DAV1D_PIXEL_LAYOUT_I420:
+        return bitDepth == 8 ? Format::YUV420P : bitDepth == 10 ? Format::YUV420P10 : Format::YUV420P12;
+    case DAV1D_PIXEL_LAYOUT_I422:
+        return bitDepth == 8 ? Format::YUV422P : bitDepth == 10 ? Format::YUV422P10 : Format::YUV422P12;
+    case DAV1D_PIXEL_LAYOUT_I444:
+        return bitDepth == 8 ? Format::YUV444P : bitDepth == 10 ? Format::YUV444P10 : Format::YUV444P12;
     default:
         return Format::None;
     }
 }
 
-DAV1DCodec::DAV1DCodec() :
+DAV1DCodec::DAV1DCodec(const Settings &settings) :
     handle{ nullptr },
+    settings{ settings },
+    pictures{},
     version{ nullptr }
 {
     CheckVersion();
 
-    Dav1dSettings settings;
-    dav1d_default_settings(&settings);
-    
-    if (dav1d_open(&handle, &settings))
+    Dav1dSettings dav1dSettings;
+    dav1d_default_settings(&dav1dSettings);
+    dav1dSettings.n_threads       = settings.Threads;
+    dav1dSettings.max_frame_delay = settings.MaxFrameDelay;
+
+    if (dav1d_open(&handle, &dav1dSettings))
     {
         throw RuntimeException("Failed to open dav1d context");
     }
@@ -41,6 +51,8 @@ DAV1DCodec::DAV1DCodec() :
 
 DAV1DCodec::~DAV1DCodec()
 {
+    pictures = std::queue<Picture>{};
+    picture  = Picture{};
     if (handle)
     {
         dav1d_close(&handle);
@@ -54,66 +66,146 @@ void DAV1DCodec::CheckVersion()
 
 CodecError DAV1DCodec::Decode(const CodedFrame &codedFrame)
 {
-    int res = 0;
-    Dav1dData dav1dData{};
-    Dav1dPicture dav1dPicture{};
+    SL_PROFILE_FUNCTION();
+    /** Pictures left from the last coded frame are not consumed anymore */
+    pictures = std::queue<Picture>{};
 
-    auto ptr = dav1d_data_create(&dav1dData, codedFrame.buffer.size());
+    auto buffer = codedFrame._shared ? codedFrame.GetBuffer() : CodedBuffer{};
+    if (buffer.empty())
+    {
+        CodecError error = ReceivePictures();
+        if (error != CodecError::Succeed)
+        {
+            return error;
+        }
+        if (pictures.empty())
+        {
+            return CodecError::EndOfFile;
+        }
 
-    memcpy(ptr, codedFrame.buffer.data(), codedFrame.buffer.size());
-    dav1dData.m.timestamp = codedFrame.timestamp;
-    dav1dData.m.offset    = codedFrame.offset;
+        picture = pictures.front();
+        return CodecError::Succeed;
+    }
+
+    /** dav1d reads the coded frame in place, so the frame is referenced until dav1d releases the data */
+    Dav1dData dav1dData{};
+    auto *reference = new CodedFrame{ codedFrame };
+    int res = dav1d_data_wrap(&dav1dData, buffer.data(), buffer.size(), [] (const uint8_t *, void *cookie) {
+        delete (CodedFrame *)cookie;
+    }, reference);
+    if (res < 0)
+    {
+        delete reference;
+        return CodecError::OutOfMemory;
+    }
 
     do {
-        if ((res = dav1d_send_data(handle, &dav1dData)) < 0)
+        if ((res = dav1d_send_data(handle, &dav1dData)) < 0 && res != DAV1D_ERR(EAGAIN))
         {
-            if (res != DAV1D_ERR(EAGAIN))
-            {
-                dav1d_data_unref(&dav1dData);
-                LOG::ERR("Error on decoding frame: {}", strerror(DAV1D_ERR(res)));
-                return CodecError::CorruptedBitstream;
-            }
+            dav1d_data_unref(&dav1dData);
+            LOG::ERR("Error on decoding frame: {}", strerror(DAV1D_ERR(res)));
+            return CodecError::CorruptedBitstream;
         }
 
-        memset(&dav1dPicture, 0, sizeof(Dav1dPicture));
-        if ((res = dav1d_get_picture(handle, &dav1dPicture)) < 0)
+        CodecError error = ReceivePictures();
+        if (error != CodecError::Succeed)
         {
-            if (res != DAV1D_ERR(EAGAIN))
-            {
-                LOG::ERR("Error on decoding frame: {}", strerror(DAV1D_ERR(res)));
-            }
-            if (dav1dData.sz == 0)
-            {
-                return CodecError::Repeat;
-            }
+            dav1d_data_unref(&dav1dData);
+            return error;
         }
-        else
-        {
-            picture = Picture{ dav1dPicture.p.w, dav1dPicture.p.h, Format::RGBA8 };
+    } while (dav1dData.sz > 0);
 
-            CVector<uint8_t> dst{};
-            dst.x = picture.Data();
+    if (pictures.empty())
+    {
+        return CodecError::Again;
+    }
 
-            CVector<uint8_t> src{};
-            src.x = (uint8_t *)dav1dPicture.data[0];
-            src.y = (uint8_t *)dav1dPicture.data[1];
-            src.z = (uint8_t *)dav1dPicture.data[2];
-            src.linesize[0] = dav1dPicture.stride[0];
-            src.linesize[1] = dav1dPicture.stride[1];
+    picture = pictures.front();
 
-            YUV420PToRGBA8(dst, src, picture.desc.width, picture.desc.height);
+    return CodecError::Succeed;
+}
 
-            dav1d_picture_unref(&dav1dPicture);
-        }      
-    } while (dav1dData.sz > 0);
+CodecError DAV1DCodec::ReceivePictures()
+{
+    while (true)
+    {
+        Dav1dPicture dav1dPicture{};
+        int res = dav1d_get_picture(handle, &dav1dPicture);
+        if (res == DAV1D_ERR(EAGAIN))
+        {
+            return CodecError::Succeed;
+        }
+        if (res < 0)
+        {
+            LOG::ERR("Error on decoding frame: {}", strerror(DAV1D_ERR(res)));
+            return CodecError::CorruptedBitstream;
+        }
 
-    dav1d_data_unref(&dav1dData);
-    return CodecError::Succeed;
+        Picture output = ConvertPicture(dav1dPicture);
+        if (!output)
+        {
+            return CodecError::UnsupportFormat;
+        }
+        pictures.push(output);
+    }
 }
 
-uint8_t * DAV1DCodec::Data() const
+Picture DAV1DCodec::ConvertPicture(Dav1dPicture &dav1dPicture)
 {
-    return picture.Data();
+    Format format = SelectFormat(dav1dPicture.p.layout, dav1dPicture.p.bpc);
+    if (format == Format::None)
+    {
+        LOG::ERR("Unsupported dav1d pixel layout: {}", int(dav1dPicture.p.layout));
+        dav1d_picture_unref(&dav1dPicture);
+        return Picture{};
+    }
+
+    bool convertible = format == Format::YUV420P || format == Format::YUV444P;
+    if (settings.Output == OutputMode::RGBA8 && convertible)
+    {
+        Picture output{ dav1dPicture.p.w, dav1dPicture.p.h, Format::RGBA8, true };
+
+        CVector<uint8_t> dst{};
+        dst.x = output.GetData();
+
+        CVector<uint8_t> src{};
+        src.x = (uint8_t *)dav1dPicture.data[0];
+        src.y = (uint8_t *)dav1dPicture.data[1];
+        src.z = (uint8_t *)dav1dPicture.data[2];
+        src.linesize[0] = dav1dPicture.stride[0];
+        src.linesize[1] = dav1dPicture.stride[1];
+
+        if (format == Format::YUV420P)
+        {
+            YUV420PToRGBA8(dst, src, output.GetWidth(), output.GetHeight());
+        }
+        else
+        {
+            YUV444PToRGBA8(dst, src, output.GetWidth(), output.GetHeight());
+        }
+
+        dav1d_picture_unref(&dav1dPicture);
+        return output;
+    }
+
+    /** The planes stay in the pool of dav1d until the last reference to the picture is gone */
+    auto *ref = new Dav1dPicture{};
+    dav1d_picture_move_ref(ref, &dav1dPicture);
+
+    Picture output{ ref->p.w, ref->p.h, format };
+    output.SetMemoryType(PictureMemoryType::System);
+    output[0] = (uint8_t *)ref->data[0];
+    output[1] = (uint8_t *)ref->data[1];
+    output[2] = (uint8_t *)ref->data[2];
+    output.SetStride(0, uint32_t(ref->stride[0]));
+    output.SetStride(1, uint32_t(ref->stride[1]));
+    output.SetStride(2, uint32_t(ref->stride[1]));
+    output.SetRelease([ref] (void *) {
+        dav1d_picture_unref(ref);
+        delete ref;
+    });
+
+    return output;
 }
 
 Picture DAV1DCodec::GetPicture() const
@@ -121,6 +213,28 @@ Picture DAV1DCodec::GetPicture() const
     return picture;
 }
 
+bool DAV1DCodec::PopPicture()
+{
+    if (!pictures.empty())
+    {
+        pictures.pop();
+    }
+    if (pictures.empty())
+    {
+        return false;
+    }
+
+    picture = pictures.front();
+    return true;
+}
+
+void DAV1DCodec::Flush()
+{
+    picture  = Picture{};
+    pictures = std::queue<Picture>{};
+    dav1d_flush(handle);
+}
+
 }
 }
 
@@ -5,7 +5,10 @@
 #include "Vision/Codec.h"
 #include "Vision/Common/Animator.h"
 
+#include <queue>
+
 struct Dav1dContext;
+struct Dav1dPicture;
 namespace Immortal
 {
 namespace Vision
@@ -13,25 +16,56 @@ namespace Vision
 
 class IMMORTAL_API DAV1DCodec : public VideoCodec
 {
+public:
+    enum class OutputMode
+    {
+        /** Converted on the CPU, for the 8-bit 4:2:0 and 4:4:4 layouts. The others are output natively */
+        RGBA8,
+
+        /** The planar YUV of the layout and bit depth coded, referencing the dav1d picture without a copy */
+        Native,
+    };
+
+    struct Settings
+    {
+        /** The worker threads of dav1d, 0 for one per logical core */
+        int Threads = 0;
+
+        /** The frames decoded ahead of the output, 1 for the lowest latency, 0 to derive it from the threads */
+        int MaxFrameDelay = 0;
+
+        OutputMode Output = OutputMode::RGBA8;
+    };
+
 #if HAVE_DAV1D
 public:
-    DAV1DCodec();
+    DAV1DCodec(const Settings &settings = {});
 
     virtual ~DAV1DCodec();
 
-    virtual CodecError Decode(const CodedFrame &codedFrame);
+    /** An empty coded frame drains the frames delayed at the end of the stream */
+    virtual CodecError Decode(const CodedFrame &codedFrame) override;
+
+    virtual Picture GetPicture() const override;
 
-    virtual uint8_t *Data() const;
+    virtual bool PopPicture() override;
 
-    virtual Picture GetPicture() const;
+    virtual void Flush() override;
 
 private:
     void CheckVersion();
 
+    CodecError ReceivePictures();
+
+    Picture ConvertPicture(Dav1dPicture &dav1dPicture);
+
 protected:
     Dav1dContext *handle;
 
-    Picture picture;
+    Settings settings;
+
+    /** All pictures decoded from the last coded frame, the front is the current one */
+    std::queue<Picture> pictures;
 
     const char *version;
 #endif
@@ -1,11 +1,14 @@
 #include "FFCodec.h"
+#include "Shared/Instrumentor.h"
 #include "Vision/Demux/FFDemuxer.h"
 #include "Vision/Processing/ColorSpace.h"
 #include "Render/Graphics.h"
 #include "Audio/Device.h"
 #include "Shared/Log.h"
 
+#include <array>
 #include <list>
+#include <mutex>
 
 #if HAVE_FFMPEG
 extern "C" {
@@ -99,16 +102,79 @@ static inline Format CAST(AVPixelFormat v)
     }
 }
 
+/**
+ * @brief Buffers for the resampled audio, bucketed by the power of two size.
+ *  Pictures hold a reference to the pool, so it outlives the codec while they
+ *  are still queued for playback.
+ */
+class AudioBufferPool : public IObject
+{
+public:
+    static constexpr size_t MinBucket = 12;
+
+    static constexpr size_t BucketCount = 20;
+
+public:
+    ~AudioBufferPool()
+    {
+        for (auto &freeList : freeLists)
+        {
+            for (auto &ptr : freeList)
+            {
+                av_free(ptr);
+            }
+        }
+    }
+
+    uint8_t *Allocate(size_t size, size_t *pBucket)
+    {
+        size_t bucket = 0;
+        while ((size_t(1) << (bucket + MinBucket)) < size)
+        {
+            bucket++;
+        }
+        SLASSERT(bucket < BucketCount && "Audio buffer is too large to be pooled!");
+        *pBucket = bucket;
+
+        {
+            std::lock_guard lock{ mutex };
+            auto &freeList = freeLists[bucket];
+            if (!freeList.empty())
+            {
+                uint8_t *ptr = freeList.back();
+                freeList.pop_back();
+                return ptr;
+            }
+        }
+
+        return (uint8_t *)av_malloc(size_t(1) << (bucket + MinBucket));
+    }
+
+    void Release(void *ptr, size_t bucket)
+    {
+        std::lock_guard lock{ mutex };
+        freeLists[bucket].emplace_back((uint8_t *)ptr);
+    }
+
+protected:
+    std::array<std::vector<uint8_t *>, BucketCount> freeLists;
+
+    std::mutex mutex;
+};
+
 FFCodec::FFCodec() :
     handle{},
     device{},
     type{ PictureMemoryType::System },
-    startTimestamp{}
+    startTimestamp{},
+    swrContext{},
+    resamplerInput{}
 {
     frame = av_frame_alloc();
 	ThrowIf(!frame, "FFCodec::Failed to allocated memory for frame!")
 
 	memoryResource = new MemoryResource(sizeof(SharedPictureData));
+    audioBufferPool = new AudioBufferPool;
 }
 
 FFCodec::~FFCodec()
@@ -133,6 +199,7 @@ FFCodec::~FFCodec()
 
 CodecError FFCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
     int ret = 0;
     auto packet = codedFrame.InterpretAs<AVPacket>();
 
@@ -146,149 +213,212 @@ CodecError FFCodec::Decode(const CodedFrame &codedFrame)
         }
     }
 
-    ret = avcodec_receive_frame(handle, frame);
-    if (ret < 0)
+    /** Pictures left from the last coded frame are not consumed anymore */
+    pictures = std::queue<Picture>{};
+
+    /** A packet could carry more than one frame, so drain until the decoder asks for more */
+    while (true)
     {
-        if (ret == AVERROR(EAGAIN))
+        ret = avcodec_receive_frame(handle, frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         {
-            return CodecError::Again;
+            break;
+        }
+        if (ret < 0)
+        {
+            return CodecError::ExternalFailed;
         }
-        return CodecError::ExternalFailed;
-    }
 
-    if (handle->codec_type == AVMEDIA_TYPE_VIDEO)
-    {
-        AVFrame *ref = NULL;
-	    if (device && type == PictureMemoryType::System)
+        Picture output;
+        CodecError error = handle->codec_type == AVMEDIA_TYPE_AUDIO ? ResampleAudioFrame(output) : ConvertVideoFrame(output);
+        if (error != CodecError::Succeed)
         {
-            ref = av_frame_alloc();
-            if (!ref)
+            av_frame_unref(frame);
+            return error;
+        }
+
+        if (output)
+        {
+            output.SetTimestamp(NAN);
+            if (frame->pts != AV_NOPTS_VALUE)
             {
-                return CodecError::OutOfMemory;
+                output.SetTimestamp((frame->best_effort_timestamp - startTimestamp) * av_q2d(timeBase) * animator.FramesPerSecond);
             }
-            if (av_hwframe_transfer_data(ref, frame, 0) < 0)
-            {
-                LOG::ERR("Failed to download frame to system memory!");
-                av_frame_free(&ref);
-                av_frame_unref(frame);
+            pictures.push(output);
+        }
 
-                return CodecError::ExternalFailed;
-            }
+        av_frame_unref(frame);
+    }
+
+    if (pictures.empty())
+    {
+        return CodecError::Again;
+    }
+
+    picture = pictures.front();
+
+    return CodecError::Succeed;
+}
+
+CodecError FFCodec::ConvertVideoFrame(Picture &output)
+{
+    AVFrame *ref = NULL;
+    if (device && type == PictureMemoryType::System)
+    {
+        ref = av_frame_alloc();
+        if (!ref)
+        {
+            return CodecError::OutOfMemory;
         }
-        else
+        if (av_hwframe_transfer_data(ref, frame, 0) < 0)
         {
-            ref = av_frame_clone(frame);
+            LOG::ERR("Failed to download frame to system memory!");
+            av_frame_free(&ref);
+
+            return CodecError::ExternalFailed;
         }
+    }
+    else
+    {
+        ref = av_frame_clone(frame);
+    }
 
-        if (format == Format::None)
-        {
-		    enum AVPixelFormat pixelFormat = handle->sw_pix_fmt;
-		    if (type == PictureMemoryType::Device && handle->pix_fmt != AV_PIX_FMT_YUV422P10)
+    if (format == Format::None)
+    {
+	    enum AVPixelFormat pixelFormat = handle->sw_pix_fmt;
+	    if (type == PictureMemoryType::Device && handle->pix_fmt != AV_PIX_FMT_YUV422P10)
+	    {
+		    switch (pixelFormat)
 		    {
-			    switch (pixelFormat)
-			    {
-				    case AV_PIX_FMT_YUV444P10:
-				    case AV_PIX_FMT_YUV422P10:
-				    case AV_PIX_FMT_YUV420P10:
-					    pixelFormat = AV_PIX_FMT_P010;
-					    break;
-
-                    case AV_PIX_FMT_YUV444P:
-                    case AV_PIX_FMT_YUV422P:
-				    case AV_PIX_FMT_YUV420P:
-				    default:
-					    pixelFormat = AV_PIX_FMT_NV12;
-			    }
+			    case AV_PIX_FMT_YUV444P10:
+			    case AV_PIX_FMT_YUV422P10:
+			    case AV_PIX_FMT_YUV420P10:
+				    pixelFormat = AV_PIX_FMT_P010;
+				    break;
+
+                case AV_PIX_FMT_YUV444P:
+                case AV_PIX_FMT_YUV422P:
+			    case AV_PIX_FMT_YUV420P:
+			    default:
+				    pixelFormat = AV_PIX_FMT_NV12;
 		    }
-		    format = CAST(pixelFormat);
-        }
+	    }
+	    format = CAST(pixelFormat);
+    }
 
-        picture = Picture{ref->width, ref->height, format };
-		picture.SetStride(0, ref->linesize[0]);
-		picture.SetStride(1, ref->linesize[1]);
-		picture.SetStride(2, ref->linesize[2]);
+    output = Picture{ref->width, ref->height, format };
+	output.SetStride(0, ref->linesize[0]);
+	output.SetStride(1, ref->linesize[1]);
+	output.SetStride(2, ref->linesize[2]);
 
 #ifdef _WIN32
-        if (handle->pix_fmt == AV_PIX_FMT_D3D12 && Graphics::GetDevice()->GetBackendAPI() == BackendAPI::D3D12)
-        {
-            auto &[texture, syncCtx] = *(AVD3D12VAFrame *)frame->data[0];
-			picture.SetMemoryType(PictureMemoryType::Device);
-            picture[0] = (uint8_t *)texture;
-            picture[1] = (uint8_t *)syncCtx.fence;
-            picture[2] = (uint8_t *)syncCtx.fence_value;
-        }
-        else
+    if (handle->pix_fmt == AV_PIX_FMT_D3D12 && Graphics::GetDevice()->GetBackendAPI() == BackendAPI::D3D12)
+    {
+        auto &[texture, syncCtx] = *(AVD3D12VAFrame *)frame->data[0];
+		output.SetMemoryType(PictureMemoryType::Device);
+        output[0] = (uint8_t *)texture;
+        output[1] = (uint8_t *)syncCtx.fence;
+        output[2] = (uint8_t *)syncCtx.fence_value;
+    }
+    else
 #endif
-        {
-			picture.SetMemoryType(PictureMemoryType::System);
+    {
+		output.SetMemoryType(PictureMemoryType::System);
 
-			picture[0] = (uint8_t *) ref->data[0];
-			picture[1] = (uint8_t *) ref->data[1];
-			picture[2] = (uint8_t *) ref->data[2];
-        }
+		output[0] = (uint8_t *) ref->data[0];
+		output[1] = (uint8_t *) ref->data[1];
+		output[2] = (uint8_t *) ref->data[2];
+    }
 
-        picture.SetRelease([ref] (void *) {
-            Async::Execute([ref] {
-                av_frame_unref(ref);
-                av_frame_free((AVFrame **)&ref);
-                });
+    output.SetRelease([ref] (void *) {
+        Async::Execute([ref] {
+            av_frame_unref(ref);
+            av_frame_free((AVFrame **)&ref);
             });
+        });
+
+    return CodecError::Succeed;
+}
+
+CodecError FFCodec::ConfigureResampler()
+{
+    uint64_t channelLayout = frame->channel_layout ? frame->channel_layout : AV_CH_LAYOUT_STEREO;
+    if (swrContext &&
+        resamplerInput.sampleFormat  == frame->format      &&
+        resamplerInput.sampleRate    == frame->sample_rate &&
+        resamplerInput.channelLayout == channelLayout)
+    {
+        return CodecError::Succeed;
     }
-    else if (handle->codec_type == AVMEDIA_TYPE_AUDIO)
+
+    swr_free(&swrContext);
+    swrContext = swr_alloc_set_opts(
+        nullptr,
+        AV_CH_LAYOUT_STEREO,
+        AV_SAMPLE_FMT_FLT,
+        AudioDevice::GetSampleRate(),
+        channelLayout,
+        AVSampleFormat(frame->format),
+        frame->sample_rate,
+        0,
+        nullptr
+    );
+
+    if (!swrContext || swr_init(swrContext) < 0)
     {
-        AVRational tb{ 1, frame->sample_rate };
-        if (frame->pts != AV_NOPTS_VALUE)
-        {
-            frame->pts = av_rescale_q(frame->pts - startTimestamp, timeBase, tb);
-        }
+        LOG::ERR("Failed to initialize the audio resampler!");
+        swr_free(&swrContext);
+        return CodecError::ExternalFailed;
+    }
 
-        SwrContext *swrContext = swr_alloc_set_opts(
-            nullptr,
-            AV_CH_LAYOUT_STEREO,
-            AV_SAMPLE_FMT_FLT,
-            AudioDevice::GetSampleRate(),
-            !handle->channel_layout ? AV_CH_LAYOUT_STEREO : handle->channel_layout,
-            handle->sample_fmt,
-            handle->sample_rate,
-            0,
-            nullptr
-        );
-
-        swr_init(swrContext);
-
-        int samples = av_rescale_rnd(
-            swr_get_delay(swrContext, handle->sample_rate) + frame->nb_samples,
-            AudioDevice::GetSampleRate(),
-            handle->sample_rate,
-            AV_ROUND_UP
-        );
-
-        Format format = Format::VECTOR2;
-        picture = Picture{ uint32_t(samples), 1,  format, true };
-		picture.SetTimestamp(frame->pts / frame->nb_samples);
-
-        int outSamples = swr_convert(swrContext, &picture.GetData(), samples, (const uint8_t **)&frame->data[0], frame->nb_samples);
-        if (outSamples < 0)
-        {
-            LOG::ERR("Failed to rescale audio frame format!");
-        }
+    resamplerInput.sampleFormat  = frame->format;
+    resamplerInput.sampleRate    = frame->sample_rate;
+    resamplerInput.channelLayout = channelLayout;
 
-        uint8_t *ptr = picture.GetData() + outSamples * 2 * sizeof(float);
-        if (swr_get_out_samples(swrContext, 0) > 0)
-        {
-            outSamples = swr_convert(swrContext, &ptr, samples - outSamples, nullptr, 0);
-        }
+    return CodecError::Succeed;
+}
 
-        swr_free(&swrContext);
+CodecError FFCodec::ResampleAudioFrame(Picture &output)
+{
+    CodecError error = ConfigureResampler();
+    if (error != CodecError::Succeed)
+    {
+        return error;
     }
 
-    picture.SetTimestamp(NAN);
-    if (frame->pts != AV_NOPTS_VALUE)
+    int samples = av_rescale_rnd(
+        swr_get_delay(swrContext, frame->sample_rate) + frame->nb_samples,
+        AudioDevice::GetSampleRate(),
+        frame->sample_rate,
+        AV_ROUND_UP
+    );
+
+    size_t bucket = 0;
+    uint8_t *data = audioBufferPool->Allocate(samples * 2 * sizeof(float), &bucket);
+    if (!data)
     {
-        picture.SetTimestamp((frame->best_effort_timestamp - startTimestamp) * av_q2d(timeBase) * animator.FramesPerSecond);
+        return CodecError::OutOfMemory;
     }
 
-    av_frame_unref(frame);
+    /** The samples held back by the filter are left in the context for the next frame */
+    int outSamples = swr_convert(swrContext, &data, samples, (const uint8_t **)&frame->data[0], frame->nb_samples);
+    if (outSamples <= 0)
+    {
+        audioBufferPool->Release(data, bucket);
+        if (outSamples < 0)
+        {
+            LOG::ERR("Failed to rescale audio frame format!");
+            return CodecError::ExternalFailed;
+        }
+        return CodecError::Succeed;
+    }
+
+    output = Picture{ uint32_t(outSamples), 1, Format::VECTOR2 };
+    output.SetMemoryType(PictureMemoryType::System);
+    output.SetData(data);
+    output.SetRelease([pool = audioBufferPool, bucket] (void *ptr) {
+        pool->Release(ptr, bucket);
+        });
 
     return CodecError::Succeed;
 }
@@ -298,9 +428,28 @@ Picture FFCodec::GetPicture() const
     return picture;
 }
 
+bool FFCodec::PopPicture()
+{
+    if (!pictures.empty())
+    {
+        pictures.pop();
+    }
+    if (pictures.empty())
+    {
+        return false;
+    }
+
+    picture = pictures.front();
+    return true;
+}
+
 void FFCodec::Flush()
 {
     picture = Picture{};
+    pictures = std::queue<Picture>{};
+
+    /** Drop the filter history, the resampler is configured again by the next frame */
+    swr_free(&swrContext);
 }
 
 AVHWDeviceType GetDeviceType(const std::string &name)
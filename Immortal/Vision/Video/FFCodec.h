@@ -7,16 +7,20 @@
 #include "Memory/MemoryResource.h"
 #include "Graphics/LightGraphics.h"
 
+#include <queue>
+
 struct AVFrame;
 struct AVCodec;
 struct AVBufferRef;
 struct AVCodecContext;
 struct AVCodecParameters;
+struct SwrContext;
 namespace Immortal
 {
 namespace Vision
 {
 
+class AudioBufferPool;
 class IMMORTAL_API FFCodec : public VideoCodec
 {
 #if HAVE_FFMPEG
@@ -29,11 +33,20 @@ public:
 
     virtual Picture GetPicture() const override;
 
+    virtual bool PopPicture() override;
+
     virtual void Flush() override;
 
 public:
 	virtual CodecError SetCodecContext(Anonymous anonymous) override;
 
+protected:
+    CodecError ConvertVideoFrame(Picture &output);
+
+    CodecError ResampleAudioFrame(Picture &output);
+
+    CodecError ConfigureResampler();
+
 protected:
     AVCodecContext *handle;
 
@@ -48,6 +61,21 @@ protected:
     PictureMemoryType type;
 
     URef<MemoryResource> memoryResource;
+
+    /** All pictures decoded from the last coded frame, the front is the current one */
+    std::queue<Picture> pictures;
+
+    /** Kept across packets, so the filter history is never lost between them */
+    SwrContext *swrContext;
+
+    struct
+    {
+        int      sampleFormat;
+        int      sampleRate;
+        uint64_t channelLayout;
+    } resamplerInput;
+
+    Ref<AudioBufferPool> audioBufferPool;
 #endif // HAVE_FFMPEG
 };
 
@@ -1,4 +1,5 @@
 #include "HEVC.h"
+#include "Shared/Instrumentor.h"
 #include "Shared/Log.h"
 
 namespace Immortal
@@ -75,6 +76,7 @@ static inline Format SelectFormat(int32_t bitDepth, int32_t chromaFormatIDC)
 
 CodecError HEVCCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
 	const auto &rbsp = codedFrame.GetBuffer();
 
     std::vector<uint8_t> buffer;
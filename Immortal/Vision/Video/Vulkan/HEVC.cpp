@@ -1,4 +1,5 @@
 #include "HEVC.h"
+#include "Shared/Instrumentor.h"
 #include "Render/Graphics.h"
 
 namespace Immortal
@@ -47,6 +48,7 @@ static inline VkVideoChromaSubsamplingFlagBitsKHR SelectChromaSampling(Format fo
 
 CodecError HEVCCodec::Decode(const CodedFrame &codedFrame)
 {
+    SL_PROFILE_FUNCTION();
 	Super::Decode(codedFrame);
 
     auto device = (Immortal::Vulkan::Device *)(Graphics::GetDevice());
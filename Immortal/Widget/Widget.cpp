@@ -4,8 +4,39 @@
 namespace Immortal
 {
 
-std::unordered_map<std::string, Widget *> Widget::Identify2WidgetTracker;
-std::unordered_map<Widget *, std::string> Widget::Widget2IdentifyTracker;
+std::vector<Widget *> Widget::IdentifiedWidgets{ nullptr };
+std::vector<std::string> Widget::IdentifierNames{ std::string{} };
+std::unordered_map<std::string, WidgetId> Widget::IdentifierTable;
+
+WidgetId Widget::Intern(const std::string &name)
+{
+    auto [it, inserted] = IdentifierTable.try_emplace(name, WidgetId(IdentifierNames.size()));
+    if (inserted)
+    {
+        IdentifierNames.emplace_back(name);
+        IdentifiedWidgets.emplace_back(nullptr);
+    }
+
+    return it->second;
+}
+
+const std::string &Widget::NameOf(WidgetId id)
+{
+    return id < IdentifierNames.size() ? IdentifierNames[id] : IdentifierNames[WInvalidId];
+}
+
+void Widget::Track(Widget *widget, WidgetId id)
+{
+    if (widget->widgetId != WInvalidId && IdentifiedWidgets[widget->widgetId] == widget)
+    {
+        IdentifiedWidgets[widget->widgetId] = nullptr;
+    }
+    widget->widgetId = id < IdentifiedWidgets.size() ? id : WInvalidId;
+    if (widget->widgetId != WInvalidId)
+    {
+        IdentifiedWidgets[id] = widget;
+    }
+}
 
 WWindow::WWindow()
 {
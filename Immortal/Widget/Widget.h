@@ -143,6 +143,11 @@ SL_ENABLE_BITWISE_OPERATOR(WAlignMode)
 
 class Widget;
 
+/** A name interned once, so that looking a widget up is indexing rather than hashing a string */
+using WidgetId = uint32_t;
+
+static constexpr WidgetId WInvalidId = 0;
+
 struct WidgetState
 {
     bool isHovered;
@@ -187,6 +192,23 @@ public:                              \
 		return L;                    \
 	}
 
+#define WIDGET_SET_LAYOUT_PROPERTY_FUNC(U, L, T) \
+public:                                    \
+	WidgetType *U(T _##L)                  \
+	{                                      \
+		if (L != _##L)                     \
+		{                                  \
+			L = _##L;                      \
+			Invalidate();                  \
+		}                                  \
+		return this;                       \
+	}                                      \
+                                           \
+	T U() const                            \
+	{                                      \
+		return L;                          \
+	}
+
 #define WIDGET_SET_PROPERTY(U, L, T)          \
 public:                                       \
     WIDGET_SET_PROPERTY_FUNC(U, L, const T &) \
@@ -198,32 +220,37 @@ protected:                                    \
 
 #define WIDGET_SET_PROPERTIES(W) \
     using WidgetType = W;        \
-    WIDGET_SET_PROPERTY_FUNC(Width,        width,        float) \
-    WIDGET_SET_PROPERTY_FUNC(Height,       height,       float) \
+    WIDGET_SET_LAYOUT_PROPERTY_FUNC(Width,   width,   float) \
+    WIDGET_SET_LAYOUT_PROPERTY_FUNC(Height,  height,  float) \
+    WIDGET_SET_LAYOUT_PROPERTY_FUNC(Visible, visible, bool ) \
     WIDGET_SET_PROPERTY_FUNC(RenderWidth,  renderWidth,  float) \
     WIDGET_SET_PROPERTY_FUNC(RenderHeight, renderHeight, float) \
                                                          \
     WidgetType *PaddingLeft(float left)                  \
     {                                                    \
         padding.left = left;                             \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
     WidgetType *PaddingRight(float right)                \
     {                                                    \
         padding.right = right;                           \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
     WidgetType *PaddingTop(float top)                    \
     {                                                    \
         padding.top = top;                               \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
     WidgetType *PaddingBottom(float bottom)              \
     {                                                    \
         padding.bottom = bottom;                         \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
@@ -233,25 +260,24 @@ protected:                                    \
         padding.right  = _padding.y;                     \
         padding.bottom = _padding.z;                     \
         padding.left   = _padding.w;                     \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
-    WidgetType *Id(const std::string &id)                \
+    WidgetType *Id(const std::string &name)              \
+    {                                                    \
+        return Id(Widget::Intern(name));                 \
+    }                                                    \
+                                                         \
+    WidgetType *Id(WidgetId _id)                         \
     {                                                    \
-        Identify2WidgetTracker[id]   = this;             \
-        Widget2IdentifyTracker[this] = id;               \
+        Widget::Track(this, _id);                        \
         return this;                                     \
     }                                                    \
                                                          \
-    const std::string &Id()                              \
+    const std::string &Id() const                        \
 	{                                                    \
-        static std::string nullRef;                      \
-        auto result = Widget2IdentifyTracker.find(this); \
-        if (result != Widget2IdentifyTracker.end())      \
-        {                                                \
-            return result->second;                       \
-        }                                                \
-        return nullRef;                                  \
+        return Widget::NameOf(widgetId);                 \
 	}                                                    \
                                                          \
     WidgetType *Anchors(const Widget *widget)            \
@@ -262,6 +288,7 @@ protected:                                    \
         anchors.bottom = widget;                         \
         anchors.left   = widget;                         \
         anchors.right  = widget;                         \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
@@ -269,6 +296,7 @@ protected:                                    \
     {                                                    \
         anchored = true;                                 \
         anchors.top = widget;                            \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
@@ -276,6 +304,7 @@ protected:                                    \
     {                                                    \
         anchored = true;                                 \
         anchors.bottom = widget;                         \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
@@ -283,6 +312,7 @@ protected:                                    \
 	{                                                    \
 		anchored = true;                                 \
 		anchors.left = widget;                           \
+		Invalidate();                                    \
 		return this;                                     \
 	}                                                    \
                                                          \
@@ -290,6 +320,7 @@ protected:                                    \
     {                                                    \
         anchored = true;                                 \
         anchors.right = widget;                          \
+        Invalidate();                                    \
         return this;                                     \
     }                                                    \
                                                          \
@@ -297,6 +328,7 @@ protected:                                    \
     {                                                    \
         width  = size.x;                                 \
         height = size.y;                                 \
+        Invalidate();                                    \
         return this;                                     \
     }
 
@@ -354,6 +386,23 @@ public:                                           \
 protected:                                        \
 	WAlignMode align = WAlignMode::None;
 
+/** The layout a parent computed for its children, reused until any input of it changes */
+struct WLayout
+{
+    ImVec2 origin = { 0, 0 };
+
+    float width   = 0;
+
+    float height  = 0;
+
+    /** The results of a child, restored as rendering may have changed them */
+    ImVec2 position    = { 0, 0 };
+
+    float renderWidth  = 0;
+
+    float renderHeight = 0;
+};
+
 struct WAnchors
 {
     const Widget *fill   = nullptr;
@@ -368,9 +417,18 @@ class IMMORTAL_API Widget : public IObject
 public:
     WIDGET_SET_PROPERTIES(Widget)
 
-    static std::unordered_map<std::string, Widget *> Identify2WidgetTracker;
-	static std::unordered_map<Widget *, std::string> Widget2IdentifyTracker;
+    /** Indexed by the identifiers, the name of each is at the same index */
+    static std::vector<Widget *> IdentifiedWidgets;
+
+    static std::vector<std::string> IdentifierNames;
+
+    static std::unordered_map<std::string, WidgetId> IdentifierTable;
+
+    static WidgetId Intern(const std::string &name);
 
+    static const std::string &NameOf(WidgetId id);
+
+    static void Track(Widget *widget, WidgetId id);
 
 public:
     Widget(Widget *parent = nullptr) :
@@ -380,11 +438,22 @@ public:
         Connect([&]() {
             for (auto &child : children)
             {
-                child->RealRender();
+                if (child->visible)
+                {
+                    child->RealRender();
+                }
             }
             });
     }
 
+    virtual ~Widget()
+    {
+        if (widgetId != WInvalidId && IdentifiedWidgets[widgetId] == this)
+        {
+            IdentifiedWidgets[widgetId] = nullptr;
+        }
+    }
+
     Widget *AddParent(Widget *other)
     {
         if (other)
@@ -401,6 +470,7 @@ public:
         {
             child->parent = this;
             children.emplace_back(child);
+            Invalidate();
         }
 
         return child;
@@ -456,17 +526,43 @@ public:
 
     template <class T>
     requires std::is_base_of_v<Widget, T>
-    T *Query(const std::string &id)
+    T *Query(WidgetId id)
     {
-        auto widget = Identify2WidgetTracker.find(id);
-        if (widget != Identify2WidgetTracker.end())
+        if (id != WInvalidId && id < IdentifiedWidgets.size())
         {
-			return dynamic_cast<T *>(widget->second);
+			return dynamic_cast<T *>(IdentifiedWidgets[id]);
         }
 
 		return nullptr;
     }
 
+    template <class T>
+    requires std::is_base_of_v<Widget, T>
+    T *Query(const std::string &name)
+    {
+        auto id = IdentifierTable.find(name);
+        if (id != IdentifierTable.end())
+        {
+			return Query<T>(id->second);
+        }
+
+		return nullptr;
+    }
+
+    /** The layout of this widget changed, and so did that of each widget containing it */
+    void Invalidate()
+    {
+        for (Widget *widget = this; widget; widget = widget->parent)
+        {
+            widget->dirty = true;
+        }
+    }
+
+    bool IsDirty() const
+    {
+        return dirty;
+    }
+
     void __PreCalculateSize()
     {
         float x = width;
@@ -560,7 +656,10 @@ public:
         auto relative = position;
         for (auto &child : children)
         {
-            child->RealRender();
+            if (child->visible)
+            {
+                child->RealRender();
+            }
         }
     }
 
@@ -569,31 +668,105 @@ public:
     void __RelativeTrampoline()
     {
         position += ImVec2{ padding.left, padding.top };
-        auto relative = position;
-        for (auto &child : children)
+        if (__IsLayoutCached())
         {
-            child->RelativeTo(relative);
-            child->__PreCalculateSize();
-            auto size = child->padding.left + child->padding.right + child->renderWidth;
-            if ((relative.x - position.x + size) < renderWidth)
+            for (auto &child : children)
             {
-                relative.x += size;
+                child->__RestoreLayout();
             }
-            else
+        }
+        else
+        {
+            bool cacheable = true;
+            auto relative = position;
+            for (auto &child : children)
             {
-                relative.y += child->padding.top + child->padding.bottom + child->renderHeight;
+                if (!child->visible)
+                {
+                    continue;
+                }
+                child->RelativeTo(relative);
+                child->__PreCalculateSize();
+                child->__SaveLayout();
+                cacheable &= !child->anchored;
+                auto size = child->padding.left + child->padding.right + child->renderWidth;
+                if ((relative.x - position.x + size) < renderWidth)
+                {
+                    relative.x += size;
+                }
+                else
+                {
+                    relative.y += child->padding.top + child->padding.bottom + child->renderHeight;
+                }
             }
+            __CacheLayout(cacheable);
         }
 
         PUSH_WINDOW_POS(position)
         for (auto &child : children)
         {
+            if (!child->visible || child->__IsCulled(window))
+            {
+                continue;
+            }
             window->DC.CursorPos = child->position;
             child->render();
         }
         POP_WINDOW_POS
     }
 
+    bool __IsLayoutCached() const
+    {
+        return !dirty &&
+            layout.origin.x == position.x && layout.origin.y == position.y &&
+            layout.width == renderWidth && layout.height == renderHeight;
+    }
+
+    /** The anchors depend on the cursor of the window and the siblings, so those children are laid out every frame */
+    void __CacheLayout(bool cacheable)
+    {
+        layout.origin = position;
+        layout.width  = renderWidth;
+        layout.height = renderHeight;
+        dirty = !cacheable;
+    }
+
+    void __SaveLayout()
+    {
+        layout.position     = position;
+        layout.renderWidth  = renderWidth;
+        layout.renderHeight = renderHeight;
+    }
+
+    void __RestoreLayout()
+    {
+        position     = layout.position;
+        renderWidth  = layout.renderWidth;
+        renderHeight = layout.renderHeight;
+    }
+
+    /**
+     * Entirely out of the clip rect of the window, the subtree is not rendered.
+     * The content of the window still covers it so that the scrolling is kept.
+     */
+    bool __IsCulled(ImGuiWindow *window) const
+    {
+        if (!cullable || renderWidth <= 0 || renderHeight <= 0)
+        {
+            return false;
+        }
+
+        ImVec2 max = position + ImVec2{ padding.left + renderWidth + padding.right, padding.top + renderHeight + padding.bottom };
+        const ImRect &clip = window->ClipRect;
+        if (max.x < clip.Min.x || max.y < clip.Min.y || position.x > clip.Max.x || position.y > clip.Max.y)
+        {
+            window->DC.CursorMaxPos = ImMax(window->DC.CursorMaxPos, max);
+            return true;
+        }
+
+        return false;
+    }
+
     void __EndRender()
     {
 
@@ -626,6 +799,18 @@ public:
     WAnchors anchors;
 
     bool anchored = false;
+
+    WidgetId widgetId = WInvalidId;
+
+    WLayout layout;
+
+    /** Hidden widgets take no space, and neither they nor their children are rendered */
+    bool visible = true;
+
+    bool dirty = true;
+
+    /** Widgets drawn out of the bounds laid out, like popups, must never be culled */
+    bool cullable = true;
 };
 
 class IMMORTAL_API WWindow : public Widget
@@ -882,6 +1067,7 @@ public:
     WPopup(Widget *parent = nullptr) :
         Widget{ parent }
     {
+        cullable = false;
         Connect([&] {
             if (isOpen)
             {
@@ -954,6 +1140,10 @@ public:
             auto relative = pos;
             for (auto &child : children)
             {
+                if (!child->visible)
+                {
+                    continue;
+                }
                 child->RelativeTo(relative);
                 child->__PreCalculateSize();
                 relative.x += child->padding.left + child->renderWidth + child->padding.right;
@@ -978,6 +1168,10 @@ public:
             PUSH_WINDOW_POS(position)
             for (auto &child : children)
             {
+                if (!child->visible || child->__IsCulled(window))
+                {
+                    continue;
+                }
                 window->DC.CursorPos = child->position;
                 child->render();
             }
@@ -1014,24 +1208,26 @@ public:
         Widget{parent}
     {
         Connect([&] {
+            /** Aligned within the space laid out, leaving the layout itself as it is */
+            WPadding textPadding = padding;
             if (align & WAlignMode::VCenter)
             {
-                renderHeight += padding.top + padding.bottom;
-                padding.top = padding.bottom = (renderHeight - fontSize) * 0.5f;
+                float totalHeight = renderHeight + padding.top + padding.bottom;
+                textPadding.top = textPadding.bottom = (totalHeight - fontSize) * 0.5f;
             }
             if (align & WAlignMode::HCenter)
             {
-                renderWidth += padding.left + padding.right;
+                float totalWidth = renderWidth + padding.left + padding.right;
                 auto [x, y] = ImGui::CalcTextSize(text.c_str());
-                padding.left = padding.right = (renderWidth - x) * 0.5f;
+                textPadding.left = textPadding.right = (totalWidth - x) * 0.5f;
             }
 
             auto fontScale = fontSize / ImGui::GetFontSize();
             ImGui::SetWindowFontScale(fontScale);
             ImGui::PushStyleColor(ImGuiCol_Text, color);
-            ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2{padding.right, padding.bottom});
+            ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2{textPadding.right, textPadding.bottom});
             ImGuiWindow *window = ImGui::GetCurrentWindow();
-            window->DC.CursorPos = window->DC.CursorPos + ImVec2{padding.left, padding.top};
+            window->DC.CursorPos = window->DC.CursorPos + ImVec2{textPadding.left, textPadding.top};
             ImGui::Text("%s", text.c_str());
             ImGui::PopStyleVar();
             ImGui::PopStyleColor();
@@ -1057,6 +1253,7 @@ public:
     {
         width = 0;
         height = 0;
+        cullable = false;
         Connect([&] {
             if (ImGui::BeginDragDropTarget())
             {
@@ -42,7 +42,8 @@ inline T *aligned_malloc(size_t size)
 #ifdef _WIN32
     auto ptr = _aligned_malloc(size * sizeof(T), align);
 #else
-    auto ptr = std::aligned_alloc(size * sizeof(T), align);
+    /** The alignment comes first, and the size has to be a multiple of it */
+    auto ptr = std::aligned_alloc(align, (size * sizeof(T) + align - 1) & ~(align - 1));
 #endif
 #else
     auto ptr = ::_aligned_malloc(size * sizeof(T), align);
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
 #ifdef _MSC_VER
 #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
 #endif
 
 enum class CPUFlag : uint32_t
@@ -22,6 +30,7 @@ enum class CPUFlag : uint32_t
     AVX512    = 1 << 10,
     F16C      = 1 << 11,
     NEON      = 1 << 12,
+    CRC32     = 1 << 13,
 };
 
 template <class T>
@@ -53,15 +62,19 @@ private:
 
     static void invoke_cpuid(DataRegisters *registers, int function_id)
     {
-#ifdef _MSC_VER
-        __cpuid((int *)registers, function_id);
-#endif
+        invoke_cpuidex(registers, function_id, 0);
     }
 
     static void invoke_cpuidex(DataRegisters *registers, int function_id,int subfunction_id)
     {
-#ifdef _MSC_VER
-        __cpuidex((int *)registers, function_id, subfunction_id);
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int values[4];
+        __cpuidex(values, function_id, subfunction_id);
+        *registers = { uint32_t(values[0]), uint32_t(values[1]), uint32_t(values[2]), uint32_t(values[3]) };
+#elif defined(__x86_64__) || defined(__i386__)
+        __cpuid_count(function_id, subfunction_id, registers->eax, registers->ebx, registers->ecx, registers->edx);
+#else
+        *registers = {};
 #endif
     }
 
@@ -124,18 +137,32 @@ private:
         DataRegisters registers;
 
         invoke_cpuid(&registers, 0);
+        uint32_t max_function_id = registers.eax;
 
-        if (registers.eax >= 1U)
+        if (max_function_id >= 1U)
         {
             invoke_cpuid(&registers, 1);
             extract_info2(registers.ecx, registers.edx);
         }
 
-        if (registers.eax >= 7U)
+        if (max_function_id >= 7U)
         {
             invoke_cpuidex(&registers, 7, 0);
             extract_info1(registers.ebx);
         }
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+        cpu_flags |= CPUFlag::NEON;
+#if defined(__linux__)
+        if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        {
+            cpu_flags |= CPUFlag::CRC32;
+        }
+#else
+        /** Optional in ARMv8.0 only, every Apple and Windows ARM64 device has it */
+        cpu_flags |= CPUFlag::CRC32;
+#endif
+#endif
     }
 
 public:
@@ -0,0 +1,1399 @@
+#include "Benchmark.h"
+#include "JpegWriter.h"
+#include "Algorithm/LightVector.h"
+#include "Memory/MemoryResource.h"
+#include "Vision/Common/BitTracker.h"
+#include "Vision/Common/Checksum.h"
+#include "Vision/Image/JPEG.h"
+#include "Vision/LookupTable/LookupTable.h"
+#include "Vision/Processing/ColorSpace.h"
+#include "Vision/Processing/Demosaic.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <numbers>
+#include <random>
+#include <thread>
+
+#if HAVE_FFMPEG
+#include "Audio/Device.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+#endif
+
+class Render2DBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t SpriteCount  = 200000;
+    static constexpr size_t TextureCount = 64;
+
+public:
+    Render2DBenchmark() :
+        Benchmark{ "Render2D" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        Render2D::SetupBatch();
+
+        std::vector<Ref<Texture>> textures;
+        for (size_t i = 0; i < TextureCount; i++)
+        {
+            textures.emplace_back(new Texture{});
+        }
+
+        std::mt19937 random{ 0 };
+        std::uniform_real_distribution<float> distribution{ -100.0f, 100.0f };
+
+        std::vector<Render2D::Sprite> sprites{ SpriteCount };
+        for (size_t i = 0; i < sprites.size(); i++)
+        {
+            auto &sprite = sprites[i];
+            sprite.Transform = Vector::Translate({ distribution(random), distribution(random), 0.0f }) *
+                Vector::Rotate(distribution(random), { 0.0f, 0.0f, 1.0f }) *
+                Vector::Scale({ 2.0f, 2.0f, 1.0f });
+            sprite.pTexture = textures[i % 8 + (i / 16384) % (TextureCount - 8)];
+            sprite.Object   = (int)i;
+        }
+
+        for (auto mode : { Render2D::Mode::Vertex, Render2D::Mode::Instanced })
+        {
+            const char *suffix = mode == Render2D::Mode::Instanced ? "Instanced" : "";
+            Render2D::SetMode(mode);
+            Render2D::ResetStats();
+
+            Report(Measure(std::string{ "DrawRect" } + suffix, "sprites/ms", 1, [&] {
+                Render2D::StartBatch();
+                for (auto &sprite : sprites)
+                {
+                    Render2D::DrawRect(sprite.Transform, Ref<Texture>{ sprite.pTexture }, sprite.TilingFactor, sprite.Color, sprite.Object);
+                }
+                Render2D::Flush();
+                return SpriteCount;
+            }));
+
+            Report(Measure(std::string{ "DrawSprites" } + suffix, "sprites/ms", 1, [&] {
+                Render2D::StartBatch();
+                Render2D::DrawSprites(sprites);
+                Render2D::Flush();
+                return SpriteCount;
+            }));
+        }
+        Render2D::SetMode(Render2D::Mode::Vertex);
+
+        Render2D::Release();
+    }
+
+    void Report(Result &result)
+    {
+        auto stats = Render2D::Stats();
+        result.Counters["bytes/sprite"] = double(stats.UploadedBytes) / stats.RectCount;
+        Render2D::ResetStats();
+    }
+};
+
+class BitTrackerBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t StreamSize = 16 * 1024 * 1024;
+
+public:
+    BitTrackerBenchmark() :
+        Benchmark{ "BitTracker" },
+        sink{ 0 }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        std::mt19937_64 random{ 0 };
+        std::vector<uint8_t> stream(StreamSize);
+        for (auto &byte : stream)
+        {
+            byte = uint8_t(random());
+        }
+
+        Measure("GetBits", "bits/ns", 1e-6, [&] {
+            BitTracker bitTracker{ stream.data(), stream.size() };
+            uint64_t bits = 0;
+            for (uint32_t n = 1; bitTracker.BytesLeft() > 8; n = n % 24 + 1)
+            {
+                sink += bitTracker.GetBits(n);
+                bits += n;
+            }
+            return bits;
+        });
+
+        /** Codes of every length up to 2 * 12 + 1 bits, as the parameter sets have mostly */
+        std::vector<uint8_t> golomb = EncodeExpGolomb(random);
+        Measure("ExpGolomb", "bits/ns", 1e-6, [&] {
+            BitTracker bitTracker{ golomb.data(), golomb.size() };
+            uint64_t bits = golomb.size() * 8;
+            while (bitTracker.BytesLeft() > 8)
+            {
+                sink += bitTracker.UnsignedExpGolomb();
+            }
+            return bits - bitTracker.BytesLeft() * 8;
+        });
+
+        /** Table driven code lengths of 1 to 16 bits looked up by the leading 8 bits */
+        std::array<uint8_t, 256> lengths;
+        for (size_t i = 0; i < lengths.size(); i++)
+        {
+            lengths[i] = uint8_t(std::countl_zero(uint8_t(i)) * 2 + 1);
+        }
+        Measure("Huffman", "bits/ns", 1e-6, [&] {
+            BitTracker bitTracker{ stream.data(), stream.size() };
+            uint64_t bits = 0;
+            while (bitTracker.BytesLeft() > 8)
+            {
+                auto code = bitTracker.Preview(16);
+                auto length = lengths[code >> 8];
+                sink += code >> (16 - length);
+                bitTracker.SkipBits(length);
+                bits += length;
+            }
+            return bits;
+        });
+
+        /** The entropy coded segment of JPEG, with 0xFF stuffed as 0xFF00 */
+        std::vector<uint8_t> stuffed;
+        stuffed.reserve(StreamSize + StreamSize / 128);
+        for (auto byte : stream)
+        {
+            stuffed.emplace_back(byte);
+            if (byte == 0xff)
+            {
+                stuffed.emplace_back(0x00);
+            }
+        }
+        Measure("Huffman(Jpeg)", "bits/ns", 1e-6, [&] {
+            JpegBitTracker bitTracker{ stuffed.data(), stuffed.size() };
+            uint64_t bits = 0;
+            while (bitTracker.BytesLeft() > 8)
+            {
+                auto code = bitTracker.Preview(16);
+                auto length = lengths[code >> 8];
+                sink += code >> (16 - length);
+                bitTracker.SkipBits(length);
+                bits += length;
+            }
+            return bits;
+        });
+    }
+
+    static std::vector<uint8_t> EncodeExpGolomb(std::mt19937_64 &random)
+    {
+        std::vector<uint8_t> buffer;
+        buffer.reserve(StreamSize + 8);
+
+        uint64_t word = 0;
+        uint32_t bits = 0;
+        while (buffer.size() < StreamSize)
+        {
+            uint64_t value = (random() & ((1ull << (random() % 12)) - 1)) + 1;
+            uint32_t length = 64 - std::countl_zero(value);
+            uint32_t codeLength = length * 2 - 1;
+            word = (word << codeLength) | value;
+            bits += codeLength;
+            while (bits >= 8)
+            {
+                bits -= 8;
+                buffer.emplace_back(uint8_t(word >> bits));
+            }
+        }
+
+        return buffer;
+    }
+
+public:
+    uint64_t sink;
+};
+
+class ChecksumBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t BufferSize = 16 * 1024 * 1024;
+
+    /** The bitwise reference is too slow for the whole buffer */
+    static constexpr size_t BitwiseSize = 1024 * 1024;
+
+    /** The size of a key of the pipeline or the sampler caches */
+    static constexpr size_t KeySize = 64;
+
+public:
+    ChecksumBenchmark() :
+        Benchmark{ "Checksum" },
+        sink{ 0 }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        std::mt19937_64 random{ 0 };
+        std::vector<uint8_t> buffer(BufferSize);
+        for (auto &byte : buffer)
+        {
+            byte = uint8_t(random());
+        }
+
+        Measure("CRC32(Bitwise)", "GB/s", 1e-6, [&] {
+            uint32_t crc = CRC32_INITIAL_VALUE;
+            for (size_t i = 0; i < BitwiseSize; i++)
+            {
+                crc ^= uint32_t(buffer[i]) << 24;
+                for (int j = 0; j < 8; j++)
+                {
+                    crc = (crc << 1) ^ ((0 - (crc >> 31)) & CRC32_GENERATOR_POLYNOMIAL);
+                }
+            }
+            sink += crc;
+            return BitwiseSize;
+        });
+
+        Measure("CRC32(Slice-by-8)", "GB/s", 1e-6, [&] {
+            sink += Checksum::UpdateCyclicRedundancyCheck32Portable(CRC32_INITIAL_VALUE, buffer.data(), buffer.size());
+            return buffer.size();
+        });
+
+        std::string method = std::string{ "CRC32(" } + Checksum::GetCyclicRedundancyCheck32Implementation() + ")";
+        Measure(method, "GB/s", 1e-6, [&] {
+            sink += Checksum::CyclicRedundancyCheck32(buffer.data(), uint32_t(buffer.size()));
+            return buffer.size();
+        });
+
+        Measure("Hash64", "GB/s", 1e-6, [&] {
+            sink += Checksum::Hash64(buffer.data(), buffer.size());
+            return buffer.size();
+        });
+
+        Measure("Hash64(Keys)", "GB/s", 1e-6, [&] {
+            uint64_t hash = 0;
+            for (size_t offset = 0; offset + KeySize <= buffer.size(); offset += KeySize)
+            {
+                hash ^= Checksum::Hash64(buffer.data() + offset, KeySize, hash);
+            }
+            sink += hash;
+            return buffer.size();
+        });
+    }
+
+public:
+    uint64_t sink;
+};
+
+class JpegBenchmark : public Benchmark
+{
+public:
+    static constexpr uint32_t Width  = 1920;
+    static constexpr uint32_t Height = 1080;
+
+    static constexpr int Quality = 85;
+
+public:
+    JpegBenchmark() :
+        Benchmark{ "Jpeg" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        /** A smooth pattern with noise, for the density of the AC coefficients of a photo */
+        std::mt19937 random{ 0 };
+        uint32_t chromaWidth  = Width  / 2;
+        uint32_t chromaHeight = Height / 2;
+        std::vector<uint8_t> y(size_t(Width) * Height);
+        std::vector<uint8_t> u(size_t(chromaWidth) * chromaHeight);
+        std::vector<uint8_t> v(size_t(chromaWidth) * chromaHeight);
+        for (uint32_t i = 0; i < Height; i++)
+        {
+            for (uint32_t j = 0; j < Width; j++)
+            {
+                double luma = 128 + 60 * std::sin(j / 37.0) * std::cos(i / 23.0) + int(random() % 25) - 12;
+                y[size_t(i) * Width + j] = uint8_t(std::clamp(luma, 0.0, 255.0));
+            }
+        }
+        for (uint32_t i = 0; i < chromaHeight; i++)
+        {
+            for (uint32_t j = 0; j < chromaWidth; j++)
+            {
+                u[size_t(i) * chromaWidth + j] = uint8_t(128 + 40 * std::sin((i + j) / 97.0));
+                v[size_t(i) * chromaWidth + j] = uint8_t(128 + 40 * std::cos((double(j) - i) / 131.0));
+            }
+        }
+
+        JpegWriter writer{ Quality };
+        Vision::CodedFrame codedFrame{ writer.Write(y.data(), u.data(), v.data(), Width, Height) };
+        double bitsPerPixel = codedFrame.GetBuffer().size() * 8.0 / (size_t(Width) * Height);
+
+        /**
+         * The IDCT of the eighth scale keeps the DC coefficient only, which leaves the
+         * Huffman decoding. The gap to the full scale is the IDCT and the color conversion.
+         */
+        Ref<Vision::JpegCodec> codec = new Vision::JpegCodec;
+        std::pair<const char *, Vision::DecodeScale> scales[] = {
+            { "Decode",         Vision::DecodeScale::Full   },
+            { "Decode(Half)",   Vision::DecodeScale::Half   },
+            { "Decode(Eighth)", Vision::DecodeScale::Eighth },
+        };
+        for (auto &[method, scale] : scales)
+        {
+            codec->SetDecodeOptions({ .Scale = scale });
+            auto &result = Measure(method, "MPixels/s", 1e-3, [&] {
+                codec->Decode(codedFrame);
+                return size_t(Width) * Height;
+            });
+            result.Counters["bits/pixel"] = bitsPerPixel;
+        }
+    }
+};
+
+class ColorSpaceBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t Width  = 1920;
+    static constexpr size_t Height = 1080;
+
+public:
+    ColorSpaceBenchmark() :
+        Benchmark{ "ColorSpace" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        std::mt19937_64 random{ 0 };
+        auto generate = [&] (size_t size) {
+            std::vector<uint8_t> plane(size);
+            for (auto &byte : plane)
+            {
+                byte = uint8_t(random());
+            }
+            return plane;
+        };
+
+        auto y  = generate(Width * Height);
+        auto u  = generate(Width * Height);
+        auto v  = generate(Width * Height);
+        auto uv = generate(Width * Height / 2);
+        std::vector<uint8_t> rgba(Width * Height * 4);
+        std::vector<uint8_t> yuva(Width * Height * 4);
+
+        Vision::CVector<uint8_t> dst{};
+        dst.x = rgba.data();
+
+        Vision::CVector<uint8_t> src{};
+        src.x = y.data();
+        src.y = u.data();
+        src.z = v.data();
+        src.linesize[0] = int(Width);
+        src.linesize[1] = int(Width / 2);
+        Measure("YUV420PToRGBA8", "MPixels/s", 1e-3, [&] {
+            Vision::YUV420PToRGBA8(dst, src, Width, Height);
+            return Width * Height;
+        });
+
+        src.linesize[1] = int(Width);
+        Measure("YUV444PToRGBA8", "MPixels/s", 1e-3, [&] {
+            Vision::YUV444PToRGBA8(dst, src, Width, Height);
+            return Width * Height;
+        });
+
+        src.y = uv.data();
+        Measure("NV12ToRGBA8", "MPixels/s", 1e-3, [&] {
+            Vision::NV12ToRGBA8(dst, src, Width, Height);
+            return Width * Height;
+        });
+
+        Measure("RGBA8ToYUVA4444", "MPixels/s", 1e-3, [&] {
+            Vision::RGBA8ToYUVA4444(yuva.data(), rgba.data(), rgba.size());
+            return Width * Height;
+        });
+    }
+};
+
+class DemosaicBenchmark : public Benchmark
+{
+public:
+    /** A sensor of 12 megapixels with 12-bit samples */
+    static constexpr uint32_t Width  = 4032;
+    static constexpr uint32_t Height = 3024;
+
+public:
+    DemosaicBenchmark() :
+        Benchmark{ "Demosaic" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        std::mt19937 random{ 0 };
+        Picture bayer{ Width, Height, Format::BayerLayerRGBG, true };
+        uint16_t *samples = (uint16_t *)bayer.GetData();
+        for (size_t i = 0; i < size_t(Width) * Height; i++)
+        {
+            samples[i] = uint16_t(random() & 0xfff);
+        }
+
+        Vision::DemosaicParams params{
+            .Pattern      = Vision::BayerPattern::RGGB,
+            .BlackLevel   = 256,
+            .WhiteLevel   = 4095,
+            .WhiteBalance = { 2.0f, 1.0f, 1.5f },
+        };
+        for (auto [method, name] : { std::pair{ Vision::DemosaicMethod::Bilinear, "Bilinear" }, std::pair{ Vision::DemosaicMethod::EdgeAware, "EdgeAware" } })
+        {
+            params.Method = method;
+            Measure(name, "MPixels/s", 1e-3, [&] {
+                Picture picture = Vision::Demosaic(bayer, params);
+                return size_t(Width) * Height;
+            });
+        }
+    }
+};
+
+class MemoryResourceBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t BlockSize = 256;
+
+    /** Spread over 256 buffers of the resource */
+    static constexpr size_t Blocks = 16384;
+
+public:
+    MemoryResourceBenchmark() :
+        Benchmark{ "MemoryResource" },
+        sink{ 0 }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        /** The blocks are released in a random order, as the frames referencing them are */
+        std::mt19937 random{ 0 };
+        std::vector<size_t> order(Blocks);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), random);
+
+        std::vector<void *> blocks(Blocks);
+        auto measure = [&] (const char *method, auto &&allocate, auto &&release) {
+            Measure(method, "Mops/s", 1e-3, [&] {
+                for (size_t i = 0; i < Blocks; i++)
+                {
+                    blocks[i] = allocate();
+                    *(uint8_t *)blocks[i] = uint8_t(i);
+                }
+                for (auto i : order)
+                {
+                    sink += *(uint8_t *)blocks[i];
+                    release(blocks[i]);
+                }
+                return Blocks * 2;
+            });
+        };
+
+        MemoryResource memoryResource{ BlockSize };
+        measure("MemoryResource",
+            [&] { return memoryResource.Allocate(); },
+            [&] (void *ptr) { memoryResource.Release(ptr); });
+
+        measure("Heap",
+            [&] { return ::operator new(BlockSize); },
+            [&] (void *ptr) { ::operator delete(ptr); });
+
+        std::pmr::unsynchronized_pool_resource poolResource;
+        measure("std::pmr",
+            [&] { return poolResource.allocate(BlockSize); },
+            [&] (void *ptr) { poolResource.deallocate(ptr, BlockSize); });
+    }
+
+public:
+    uint64_t sink;
+};
+
+class ThreadPoolBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t Tasks = 16384;
+
+    static constexpr size_t DataSize = 64 * 1024 * 1024;
+
+    static constexpr size_t Chunks = 256;
+
+public:
+    ThreadPoolBenchmark() :
+        Benchmark{ "ThreadPool" },
+        sink{ 0 }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        /** The overhead of a task, with nothing to do */
+        std::vector<std::future<void>> futures;
+        futures.reserve(Tasks);
+        Measure("Enqueue", "tasks/ms", 1, [&] {
+            futures.clear();
+            for (size_t i = 0; i < Tasks; i++)
+            {
+                futures.emplace_back(Async::Execute([] {}));
+            }
+            for (auto &future : futures)
+            {
+                future.get();
+            }
+            return Tasks;
+        });
+
+        std::vector<uint32_t> data(DataSize / sizeof(uint32_t));
+        std::iota(data.begin(), data.end(), 0);
+
+        auto sum = [&] (size_t begin, size_t end) {
+            uint64_t value = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                value += data[i] ^ (data[i] >> 3);
+            }
+            return value;
+        };
+
+        Measure("Sum(Serial)", "GB/s", 1e-6, [&] {
+            sink += sum(0, data.size());
+            return DataSize;
+        });
+
+        std::vector<std::future<uint64_t>> partials;
+        partials.reserve(Chunks);
+        Measure("Sum(Parallel)", "GB/s", 1e-6, [&] {
+            partials.clear();
+            size_t chunkSize = data.size() / Chunks;
+            for (size_t i = 0; i < Chunks; i++)
+            {
+                partials.emplace_back(Async::Execute([&sum, i, chunkSize] {
+                    return sum(i * chunkSize, (i + 1) * chunkSize);
+                }));
+            }
+            for (auto &partial : partials)
+            {
+                sink += partial.get();
+            }
+            return DataSize;
+        });
+    }
+
+public:
+    uint64_t sink;
+};
+
+class LightVectorBenchmark : public Benchmark
+{
+public:
+    /** As many as the nodes of a large skeleton, each with a few children */
+    static constexpr size_t Vectors  = 65536;
+    static constexpr size_t Elements = 8;
+
+    static constexpr size_t DataSize = 64 * 1024 * 1024;
+
+public:
+    LightVectorBenchmark() :
+        Benchmark{ "LightVector" },
+        sink{ 0 }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        Measure("Build", "vectors/ms", 1, [&] {
+            std::vector<LightVector<uint32_t>> vectors(Vectors);
+            for (auto &vector : vectors)
+            {
+                vector.Resize(Elements);
+                for (size_t i = 0; i < Elements; i++)
+                {
+                    vector[i] = uint32_t(i);
+                }
+                for (auto element : vector)
+                {
+                    sink += element;
+                }
+            }
+            return Vectors;
+        });
+
+        Measure("Build(std::vector)", "vectors/ms", 1, [&] {
+            std::vector<std::vector<uint32_t>> vectors(Vectors);
+            for (auto &vector : vectors)
+            {
+                vector.resize(Elements);
+                for (size_t i = 0; i < Elements; i++)
+                {
+                    vector[i] = uint32_t(i);
+                }
+                for (auto element : vector)
+                {
+                    sink += element;
+                }
+            }
+            return Vectors;
+        });
+
+        LightVector<uint32_t> lightVector;
+        lightVector.Resize(DataSize / sizeof(uint32_t));
+        std::iota(lightVector.Data(), lightVector.Data() + lightVector.Size(), 0);
+        Measure("Iterate", "GB/s", 1e-6, [&] {
+            for (auto element : lightVector)
+            {
+                sink += element;
+            }
+            return DataSize;
+        });
+
+        std::vector<uint32_t> vector(lightVector.Data(), lightVector.Data() + lightVector.Size());
+        Measure("Iterate(std::vector)", "GB/s", 1e-6, [&] {
+            for (auto element : vector)
+            {
+                sink += element;
+            }
+            return DataSize;
+        });
+    }
+
+public:
+    uint64_t sink;
+};
+
+class WidgetBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t Sections = 100;
+
+    /** The rows of each section, 10k widgets in total with the sections and the root */
+    static constexpr size_t Rows = 99;
+
+    static constexpr float RowHeight = 16.0f;
+
+    /** The frames of a sample */
+    static constexpr size_t Frames = 60;
+
+public:
+    WidgetBenchmark() :
+        Benchmark{ "Widget" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        ImGuiContext *context = ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO();
+        io.DisplaySize = ImVec2{ 1920.0f, 1080.0f };
+        io.DeltaTime   = 1.0f / 60.0f;
+
+        unsigned char *pixels = nullptr;
+        int width = 0, height = 0;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+        Widget root;
+        root.Connect([&] {
+            ImGui::SetNextWindowPos(ImVec2{ 0.0f, 0.0f });
+            ImGui::SetNextWindowSize(io.DisplaySize);
+            if (ImGui::Begin("Widgets"))
+            {
+                auto [x, y] = ImGui::GetContentRegionAvail();
+                root.RenderWidth(x);
+                root.RenderHeight(y);
+                ImGui::BeginChild("###");
+                root.position = ImGui::GetCurrentWindow()->DC.CursorStartPos;
+                root.__RelativeTrampoline();
+                ImGui::EndChild();
+            }
+            ImGui::End();
+        });
+
+        std::vector<std::unique_ptr<Widget>> widgets;
+        std::vector<Widget *> sections;
+        for (size_t i = 0; i < Sections; i++)
+        {
+            auto section = new WVBox{ &root };
+            section->Height(Rows * RowHeight);
+            section->Id("Section" + std::to_string(i));
+            widgets.emplace_back(section);
+            sections.emplace_back(section);
+            for (size_t j = 0; j < Rows; j++)
+            {
+                auto rect = new WRect{ section };
+                rect->Height(RowHeight);
+                rect->Color(ImVec4{ float(j % 2), 0.5f, 0.5f, 1.0f });
+                widgets.emplace_back(rect);
+            }
+        }
+        LOG::INFO("{}: {} widgets", name, widgets.size() + 1);
+
+        Measure("Cached", root, [] {});
+
+        Measure("Relayout", root, [&] {
+            for (auto &section : sections)
+            {
+                section->Invalidate();
+            }
+        });
+
+        for (auto &section : sections)
+        {
+            section->cullable = false;
+        }
+        Measure("Unculled", root, [] {});
+
+        for (size_t i = 0; i < sections.size(); i++)
+        {
+            sections[i]->cullable = true;
+            sections[i]->Visible(i % 2 == 0);
+        }
+        Measure("HalfHidden", root, [] {});
+
+        Measure("Query", root, [&] {
+            for (size_t i = 0; i < Sections; i++)
+            {
+                root.Query<WVBox>(sections[i]->widgetId)->Visible(true);
+            }
+        });
+
+        ImGui::DestroyContext(context);
+    }
+
+    template <class T>
+    void Measure(const char *method, Widget &root, T &&update)
+    {
+        Benchmark::Measure(method, "frames/s", 1000, [&] {
+            for (size_t n = 0; n < Frames; n++)
+            {
+                update();
+                ImGui::NewFrame();
+                root.Render();
+                ImGui::Render();
+            }
+            return Frames;
+        });
+    }
+};
+
+#if HAVE_FFMPEG
+/**
+ * @brief The audio path of FFCodec before the resampler was kept across the
+ *  packets, for comparing against it: one frame taken from each packet, and
+ *  a resampler built and freed for each frame into a newly allocated picture.
+ */
+class PerPacketResamplerCodec : public VideoCodec
+{
+public:
+    PerPacketResamplerCodec() :
+        handle{},
+        frame{ av_frame_alloc() }
+    {
+
+    }
+
+    virtual ~PerPacketResamplerCodec() override
+    {
+        avcodec_free_context(&handle);
+        av_frame_free(&frame);
+    }
+
+    virtual CodecError SetCodecContext(Anonymous anonymous) override
+    {
+        const AVStream *stream = ((Vision::FFDemuxer::Params *)anonymous)->stream;
+        const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!codec)
+        {
+            return CodecError::NotImplement;
+        }
+
+        handle = avcodec_alloc_context3(codec);
+        if (!handle || avcodec_parameters_to_context(handle, stream->codecpar) < 0 || avcodec_open2(handle, codec, nullptr) < 0)
+        {
+            return CodecError::ExternalFailed;
+        }
+
+        return CodecError::Succeed;
+    }
+
+    virtual CodecError Decode(const Vision::CodedFrame &codedFrame) override
+    {
+        int ret = avcodec_send_packet(handle, codedFrame.InterpretAs<AVPacket>());
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR(EOF))
+        {
+            return CodecError::ExternalFailed;
+        }
+
+        ret = avcodec_receive_frame(handle, frame);
+        if (ret < 0)
+        {
+            return ret == AVERROR(EAGAIN) ? CodecError::Again : CodecError::ExternalFailed;
+        }
+
+        SwrContext *swrContext = swr_alloc_set_opts(
+            nullptr,
+            AV_CH_LAYOUT_STEREO,
+            AV_SAMPLE_FMT_FLT,
+            AudioDevice::GetSampleRate(),
+            !handle->channel_layout ? AV_CH_LAYOUT_STEREO : handle->channel_layout,
+            handle->sample_fmt,
+            handle->sample_rate,
+            0,
+            nullptr
+        );
+        swr_init(swrContext);
+
+        int samples = int(av_rescale_rnd(
+            swr_get_delay(swrContext, handle->sample_rate) + frame->nb_samples,
+            AudioDevice::GetSampleRate(),
+            handle->sample_rate,
+            AV_ROUND_UP
+        ));
+
+        picture = Picture{ uint32_t(samples), 1, Format::VECTOR2, true };
+        int outSamples = swr_convert(swrContext, &picture.GetData(), samples, (const uint8_t **)&frame->data[0], frame->nb_samples);
+        if (outSamples >= 0 && swr_get_out_samples(swrContext, 0) > 0)
+        {
+            uint8_t *ptr = picture.GetData() + outSamples * 2 * sizeof(float);
+            swr_convert(swrContext, &ptr, samples - outSamples, nullptr, 0);
+        }
+        swr_free(&swrContext);
+        av_frame_unref(frame);
+
+        return CodecError::Succeed;
+    }
+
+    virtual Picture GetPicture() const override
+    {
+        return picture;
+    }
+
+protected:
+    AVCodecContext *handle;
+
+    AVFrame *frame;
+
+    Picture picture;
+};
+
+class AudioDecodeBenchmark : public Benchmark
+{
+public:
+    AudioDecodeBenchmark(const std::string &filepath) :
+        Benchmark{ "AudioDecode" },
+        filepath{ filepath }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        if (filepath.empty())
+        {
+            LOG::WARN("{}: no media file given, run with `Benchmark --filter=AudioDecode --media=<path>`", name);
+            return;
+        }
+
+        /** Demux everything up front so that only the decoding is measured */
+        std::vector<Vision::CodedFrame> codedFrames;
+        {
+            Ref<Vision::FFDemuxer> demuxer = new Vision::FFDemuxer;
+            Ref<Vision::FFCodec> videoCodec = new Vision::FFCodec;
+            Ref<Vision::FFCodec> audioCodec = new Vision::FFCodec;
+            demuxer->Open(filepath, videoCodec, audioCodec);
+
+            while (true)
+            {
+                Vision::CodedFrame codedFrame;
+                CodecError error = demuxer->Read(&codedFrame);
+                if (error == CodecError::EndOfFile)
+                {
+                    break;
+                }
+                if (error == CodecError::Succeed && codedFrame.GetType() == MediaType::Audio)
+                {
+                    codedFrames.emplace_back(codedFrame);
+                }
+            }
+        }
+
+        Decode<Vision::FFCodec>("Decode", codedFrames);
+        Decode<PerPacketResamplerCodec>("Decode(PerPacketResampler)", codedFrames);
+    }
+
+protected:
+    template <class T>
+    void Decode(const std::string &method, std::vector<Vision::CodedFrame> &codedFrames)
+    {
+        double cpuTime  = 0;
+        size_t samples  = 0;
+        size_t pictures = 0;
+        std::vector<double> wallTimes;
+        for (size_t n = 0; n < settings.Warmups + settings.Samples; n++)
+        {
+            Ref<Vision::FFDemuxer> demuxer = new Vision::FFDemuxer;
+            Ref<Vision::FFCodec> videoCodec = new Vision::FFCodec;
+            Ref<T> audioCodec = new T;
+            demuxer->Open(filepath, videoCodec, audioCodec);
+
+            size_t decodedSamples  = 0;
+            size_t decodedPictures = 0;
+            Timer timer;
+            timer.Start();
+            std::clock_t clock = std::clock();
+            for (auto &codedFrame : codedFrames)
+            {
+                if (audioCodec->Decode(codedFrame) != CodecError::Succeed)
+                {
+                    continue;
+                }
+                do
+                {
+                    decodedSamples += audioCodec->GetPicture().GetWidth();
+                    decodedPictures++;
+                } while (audioCodec->PopPicture());
+            }
+            double clockTime = double(std::clock() - clock) * 1000.0 / CLOCKS_PER_SEC;
+            double wallTime  = timer.Stop();
+
+            if (n >= settings.Warmups)
+            {
+                cpuTime  += clockTime;
+                samples  += decodedSamples;
+                pictures += decodedPictures;
+                wallTimes.emplace_back(wallTime);
+            }
+        }
+
+        auto &result = Record(method, "samples/ms", double(samples) / settings.Samples, std::move(wallTimes));
+        result.Counters["packets"]  = double(codedFrames.size());
+        result.Counters["pictures"] = double(pictures) / settings.Samples;
+        result.Counters["cpu ms"]   = cpuTime / settings.Samples;
+    }
+
+public:
+    std::string filepath;
+};
+#endif
+
+class CorpusBenchmark : public Benchmark
+{
+public:
+    CorpusBenchmark(const std::string &directory) :
+        Benchmark{ "Corpus" },
+        directory{ directory }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        if (directory.empty())
+        {
+            LOG::WARN("{}: no corpus given, run with `Benchmark --filter=Corpus --corpus=<directory>`", name);
+            return;
+        }
+
+        /** Sorted, so the order of the decoding is the same on every run */
+        std::vector<std::string> images;
+        std::vector<std::string> videos;
+        for (auto &entry : std::filesystem::recursive_directory_iterator{ directory })
+        {
+            if (!entry.is_regular_file())
+            {
+                continue;
+            }
+            auto extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [] (char c) { return char(std::tolower(c)); });
+            if (extension == ".jpg" || extension == ".jpeg")
+            {
+                images.emplace_back(entry.path().string());
+            }
+            else if (extension == ".ivf")
+            {
+                videos.emplace_back(entry.path().string());
+            }
+        }
+        std::sort(images.begin(), images.end());
+        std::sort(videos.begin(), videos.end());
+        LOG::INFO("{}: {} images, {} videos", name, images.size(), videos.size());
+
+        if (!images.empty())
+        {
+            auto &result = Measure("Jpeg", "MPixels/s", 1e-3, [&] {
+                size_t pixels = 0;
+                for (auto &path : images)
+                {
+                    Picture picture = Vision::Read(path);
+                    pixels += size_t(picture.GetWidth()) * picture.GetHeight();
+                }
+                return pixels;
+            });
+            result.Counters["files"] = double(images.size());
+
+            auto &batchResult = Measure("Jpeg(Batch)", "MPixels/s", 1e-3, [&] {
+                std::atomic<size_t> pixels = 0;
+                Vision::Read(images, [&] (size_t, Picture &&picture) {
+                    pixels += size_t(picture.GetWidth()) * picture.GetHeight();
+                }).wait();
+                return pixels.load();
+            });
+            batchResult.Counters["files"] = double(images.size());
+        }
+
+#if HAVE_DAV1D
+        if (!videos.empty())
+        {
+            /** Demux everything up front so that only the decoding is measured */
+            std::vector<std::vector<Vision::CodedFrame>> streams;
+            for (auto &path : videos)
+            {
+                Ref<Vision::DAV1DCodec> codec = new Vision::DAV1DCodec;
+                Ref<Vision::IVFDemuxer> demuxer = new Vision::IVFDemuxer;
+                if (demuxer->Open(path, codec) != CodecError::Succeed)
+                {
+                    continue;
+                }
+                auto &codedFrames = streams.emplace_back();
+                Vision::CodedFrame codedFrame;
+                while (demuxer->Read(&codedFrame) == CodecError::Succeed)
+                {
+                    codedFrames.emplace_back(codedFrame);
+                }
+            }
+
+            /** The pictures are kept in the planes of dav1d, the color conversion is measured by ColorSpace */
+            auto &result = Measure("AV1", "frames/s", 1000, [&] {
+                size_t frames = 0;
+                for (auto &codedFrames : streams)
+                {
+                    Ref<Vision::DAV1DCodec> codec = new Vision::DAV1DCodec{ { .Output = Vision::DAV1DCodec::OutputMode::Native } };
+                    auto receive = [&] (const Vision::CodedFrame &codedFrame) {
+                        CodecError error = codec->Decode(codedFrame);
+                        if (error == CodecError::Succeed)
+                        {
+                            do
+                            {
+                                frames++;
+                            } while (codec->PopPicture());
+                        }
+                        return error;
+                    };
+                    for (auto &codedFrame : codedFrames)
+                    {
+                        receive(codedFrame);
+                    }
+                    while (receive(Vision::CodedFrame{}) == CodecError::Succeed)
+                    {
+
+                    }
+                }
+                return frames;
+            });
+            result.Counters["files"] = double(streams.size());
+        }
+#else
+        if (!videos.empty())
+        {
+            LOG::WARN("{}: the videos are skipped without dav1d", name);
+        }
+#endif
+    }
+
+public:
+    std::string directory;
+};
+
+class SceneBenchmark : public Benchmark
+{
+public:
+    static constexpr size_t Objects = 10000;
+
+public:
+    SceneBenchmark() :
+        Benchmark{ "Scene" }
+    {
+
+    }
+
+    virtual void Run() override
+    {
+        /** The components without any asset, so neither a device nor a file beside the scene is needed */
+        std::string path = (std::filesystem::temp_directory_path() / "ImmortalBenchmark.scene").string();
+        {
+            Scene scene{ "Benchmark", false };
+            std::mt19937 random{ 0 };
+            std::uniform_real_distribution<float> distribution{ -100.0f, 100.0f };
+            for (size_t i = 0; i < Objects; i++)
+            {
+                Object object = scene.CreateObject("Object" + std::to_string(i));
+                auto &transform = object.GetComponent<TransformComponent>();
+                transform.Position = Vector3{ distribution(random), distribution(random), distribution(random) };
+                transform.Rotation = Vector3{ 0.0f, 0.0f, distribution(random) };
+                if (i % 8 == 0)
+                {
+                    auto &light = object.AddComponent<LightComponent>();
+                    light.Radiance = Vector4{ 1.0f, 0.5f, 0.25f, 1.0f };
+                }
+            }
+            Object camera = scene.CreateObject("Camera");
+            camera.AddComponent<CameraComponent>().Primary = true;
+
+            Measure("Serialize", "objects/ms", 1, [&] {
+                SceneSerializer{}.Serialize(&scene, path);
+                return Objects;
+            });
+        }
+
+        auto &result = Measure("Deserialize", "objects/ms", 1, [&] {
+            Scene scene{ "Benchmark", false };
+            SceneSerializer{}.Deserialize(&scene, path);
+            return Objects;
+        });
+        result.Counters["bytes"] = double(std::filesystem::file_size(path));
+
+        std::filesystem::remove(path);
+    }
+};
+
+static std::string GetCompiler()
+{
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+static std::string GetProcessor()
+{
+#ifdef __linux__
+    std::ifstream cpuinfo{ "/proc/cpuinfo" };
+    for (std::string line; std::getline(cpuinfo, line); )
+    {
+        if (line.starts_with("model name"))
+        {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+#endif
+    return "unknown";
+}
+
+/**
+ * @brief The results with where they are measured, so the runs of two releases
+ *  are only compared on the same machine and build.
+ */
+static void WriteReport(const std::string &path, const std::vector<std::unique_ptr<Benchmark>> &benchmarks)
+{
+    JSON::SuperJSON report;
+    report["context"] = {
+        { "time",      std::time(nullptr)                  },
+        { "compiler",  GetCompiler()                       },
+#ifdef NDEBUG
+        { "build",     "Release"                           },
+#else
+        { "build",     "Debug"                             },
+#endif
+        { "processor", GetProcessor()                      },
+        { "threads",   std::thread::hardware_concurrency() },
+        { "warmups",   Benchmark::settings.Warmups         },
+        { "samples",   Benchmark::settings.Samples         },
+    };
+
+    auto &results = report["results"] = JSON::SuperJSON::array();
+    for (auto &benchmark : benchmarks)
+    {
+        for (auto &result : benchmark->results)
+        {
+            auto &time = result.Time;
+            results.push_back({
+                { "name",       result.Name         },
+                { "unit",       result.Unit         },
+                { "throughput", result.Throughput() },
+                { "time", {
+                    { "samples", time.Samples },
+                    { "min",     time.Min     },
+                    { "max",     time.Max     },
+                    { "mean",    time.Mean    },
+                    { "median",  time.Median  },
+                    { "stddev",  time.StdDev  },
+                    { "p95",     time.P95     },
+                }},
+                { "counters", result.Counters },
+            });
+        }
+    }
+
+    std::ofstream file{ path };
+    if (!file.is_open())
+    {
+        LOG::ERR("Failed to write the results to {}", path);
+        return;
+    }
+    file << report.dump(4);
+    LOG::INFO("Wrote the results to {}", path);
+}
+
+/**
+ * @brief A result regresses if its median time grows beyond both the threshold
+ *  and twice the variation of the samples of either run. The tolerance is the
+ *  larger of the two, so the noisy ones on the shared machines are not reported
+ *  for nothing.
+ * @ret The count of the regressions
+ */
+static size_t Compare(const std::string &path, double threshold, const std::vector<std::unique_ptr<Benchmark>> &benchmarks)
+{
+    auto baseline = JSON::Parse(path);
+    if (baseline.is_null())
+    {
+        LOG::ERR("Failed to read the baseline {}", path);
+        return 1;
+    }
+
+    std::map<std::string, Statistics> previous;
+    for (auto &result : baseline["results"])
+    {
+        auto &time = result["time"];
+        auto &statistics = previous[result["name"].get<std::string>()];
+        statistics.Samples = time["samples"].get<size_t>();
+        statistics.Mean    = time["mean"].get<double>();
+        statistics.Median  = time["median"].get<double>();
+        statistics.StdDev  = time["stddev"].get<double>();
+    }
+
+    size_t regressions = 0;
+    for (auto &benchmark : benchmarks)
+    {
+        for (auto &result : benchmark->results)
+        {
+            auto it = previous.find(result.Name);
+            if (it == previous.end() || it->second.Median <= 0)
+            {
+                continue;
+            }
+
+            double change    = result.Time.Median / it->second.Median - 1;
+            double tolerance = std::max(threshold, 2 * std::max(result.Time.Variation(), it->second.Variation()));
+            if (change > tolerance)
+            {
+                LOG::ERR("{}: {:+.1f}% of the time of the baseline, beyond {:.1f}%", result.Name, change * 100, tolerance * 100);
+                regressions++;
+            }
+            else if (change < -tolerance)
+            {
+                LOG::INFO("{}: {:+.1f}% of the time of the baseline", result.Name, change * 100);
+            }
+        }
+    }
+
+    return regressions;
+}
+
+/** @ret If the whole of the value is a number, which is left untouched otherwise */
+template <class T>
+static bool Parse(const std::string &text, T &value)
+{
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} && end == text.data() + text.size();
+}
+
+static const char *Usage = "Usage: Benchmark [--filter=<name>] [--samples=<count>] [--warmups=<count>] [--json=<path>] "
+                           "[--baseline=<path>] [--threshold=<fraction>] [--corpus=<directory>] [--media=<path>]";
+
+int main(int argc, char **argv)
+{
+    LOG::Init();
+
+    Arguments args{ argc, argv };
+    double threshold = 0.05;
+    if (!args["warmups"].empty() && !Parse(args["warmups"], Benchmark::settings.Warmups))
+    {
+        LOG::ERR("--warmups expects a count, not {}\n{}", args["warmups"], Usage);
+        LOG::Release();
+        return 2;
+    }
+    if (!args["samples"].empty() && (!Parse(args["samples"], Benchmark::settings.Samples) || Benchmark::settings.Samples == 0))
+    {
+        LOG::ERR("--samples expects a count of at least 1, not {}\n{}", args["samples"], Usage);
+        LOG::Release();
+        return 2;
+    }
+    if (!args["threshold"].empty() && (!Parse(args["threshold"], threshold) || !std::isfinite(threshold) || threshold < 0))
+    {
+        LOG::ERR("--threshold expects a fraction of the time, such as 0.05, not {}\n{}", args["threshold"], Usage);
+        LOG::Release();
+        return 2;
+    }
+
+    Async::Init();
+
+    std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    benchmarks.emplace_back(new BitTrackerBenchmark);
+    benchmarks.emplace_back(new JpegBenchmark);
+    benchmarks.emplace_back(new ColorSpaceBenchmark);
+    benchmarks.emplace_back(new DemosaicBenchmark);
+    benchmarks.emplace_back(new MemoryResourceBenchmark);
+    benchmarks.emplace_back(new ThreadPoolBenchmark);
+    benchmarks.emplace_back(new LightVectorBenchmark);
+    benchmarks.emplace_back(new ChecksumBenchmark);
+    benchmarks.emplace_back(new WidgetBenchmark);
+    benchmarks.emplace_back(new Render2DBenchmark);
+    benchmarks.emplace_back(new SceneBenchmark);
+    benchmarks.emplace_back(new CorpusBenchmark{ args["corpus"] });
+#if HAVE_FFMPEG
+    benchmarks.emplace_back(new AudioDecodeBenchmark{ args["media"] });
+#endif
+
+    auto &filter = args["filter"];
+    for (auto &benchmark : benchmarks)
+    {
+        if (!filter.empty() && benchmark->name != filter)
+        {
+            continue;
+        }
+        benchmark->Run();
+    }
+
+    if (!args["json"].empty())
+    {
+        WriteReport(args["json"], benchmarks);
+    }
+
+    size_t regressions = 0;
+    if (!args["baseline"].empty())
+    {
+        regressions = Compare(args["baseline"], threshold, benchmarks);
+    }
+
+    Async::Release();
+    LOG::Release();
+
+    return regressions ? 1 : 0;
+}
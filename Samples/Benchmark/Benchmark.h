@@ -0,0 +1,163 @@
+#pragma once
+
+#include <Immortal.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace Immortal;
+
+/**
+ * @brief The summary of the time of the samples of a measurement, in milliseconds
+ */
+struct Statistics
+{
+    Statistics() = default;
+
+    Statistics(std::vector<double> samples)
+    {
+        if (samples.empty())
+        {
+            return;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        Samples = samples.size();
+        Min     = samples.front();
+        Max     = samples.back();
+        Mean    = std::accumulate(samples.begin(), samples.end(), 0.0) / Samples;
+        Median  = Percentile(samples, 0.5);
+        P95     = Percentile(samples, 0.95);
+
+        double variance = 0;
+        for (auto sample : samples)
+        {
+            variance += (sample - Mean) * (sample - Mean);
+        }
+        StdDev = Samples > 1 ? std::sqrt(variance / (Samples - 1)) : 0;
+    }
+
+    /** Interpolated between the closest ranks of the sorted samples */
+    static double Percentile(const std::vector<double> &sorted, double p)
+    {
+        double rank  = p * (sorted.size() - 1);
+        size_t lower = size_t(rank);
+        size_t upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+    }
+
+    /** The coefficient of variation, which tells how noisy the samples are */
+    double Variation() const
+    {
+        return Mean > 0 ? StdDev / Mean : 0;
+    }
+
+    size_t Samples = 0;
+    double Min     = 0;
+    double Max     = 0;
+    double Mean    = 0;
+    double Median  = 0;
+    double StdDev  = 0;
+    double P95     = 0;
+};
+
+struct Result
+{
+    std::string Name;
+
+    /** The unit of the throughput, like GB/s */
+    std::string Unit;
+
+    /** The work of a sample in the unit times milliseconds, so the throughput is the work over the time */
+    double Work;
+
+    Statistics Time;
+
+    /** The figures other than the time, which are reported as they are */
+    std::map<std::string, double> Counters;
+
+    double Throughput() const
+    {
+        return Time.Median > 0 ? Work / Time.Median : 0;
+    }
+};
+
+class Benchmark
+{
+public:
+    struct Settings
+    {
+        /** The runs discarded before the samples, to warm up the caches and the allocators */
+        size_t Warmups = 1;
+
+        size_t Samples = 10;
+    };
+
+public:
+    Benchmark(const std::string &name) :
+        name{ name },
+        results{}
+    {
+
+    }
+
+    virtual ~Benchmark() = default;
+
+    virtual void Run() = 0;
+
+    /**
+     * @brief Time every run of the process as a sample, after the warmups.
+     * @param scale Converts the work the process returns into the unit per millisecond
+     */
+    template <class T>
+    Result &Measure(const std::string &method, const char *unit, double scale, T &&process)
+    {
+        for (size_t n = 0; n < settings.Warmups; n++)
+        {
+            process();
+        }
+
+        double work = 0;
+        std::vector<double> samples;
+        samples.reserve(settings.Samples);
+        for (size_t n = 0; n < settings.Samples; n++)
+        {
+            Timer timer;
+            timer.Start();
+            work += double(process());
+            samples.emplace_back(timer.Stop());
+        }
+
+        return Record(method, unit, work * scale / settings.Samples, std::move(samples));
+    }
+
+    /** @brief For the benchmarks timing the samples themselves, with the work of a sample already scaled */
+    Result &Record(const std::string &method, const char *unit, double work, std::vector<double> &&samples)
+    {
+        auto &result = results.emplace_back(Result{
+            .Name     = name + "::" + method,
+            .Unit     = unit,
+            .Work     = work,
+            .Time     = Statistics{ std::move(samples) },
+            .Counters = {},
+        });
+
+        LOG::INFO("{}: {:.3f} {}, {:.3f} ms median, {:.3f} ms min, {:.1f}% stddev", result.Name,
+            result.Throughput(), result.Unit, result.Time.Median, result.Time.Min, result.Time.Variation() * 100);
+
+        return result;
+    }
+
+public:
+    std::string name;
+
+    std::vector<Result> results;
+
+    static Settings settings;
+};
+
+inline Benchmark::Settings Benchmark::settings;
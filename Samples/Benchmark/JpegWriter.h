@@ -0,0 +1,285 @@
+#pragma once
+
+#include "Vision/Image/JPEG.h"
+#include "Vision/LookupTable/LookupTable.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+/**
+ * @brief Writes the baseline 4:2:0 Jpeg, with the luminance tables of Annex K
+ *  for all the components, so the decoder is measured on the layout the
+ *  cameras produce without shipping a picture with the benchmark
+ */
+class JpegWriter
+{
+public:
+    static constexpr uint8_t Quantization[64] = {
+        16, 11, 10, 16,  24,  40,  51,  61,
+        12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,
+        14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,
+        24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103,  99,
+    };
+
+    static constexpr uint8_t DCBits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+
+    static constexpr uint8_t DCValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    static constexpr uint8_t ACBits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+
+    static constexpr uint8_t ACValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa,
+    };
+
+    struct Code
+    {
+        uint16_t code;
+        uint8_t  length;
+    };
+
+public:
+    /** @param quality From 1 to 100, scaling the quantization the way libjpeg does */
+    JpegWriter(int quality) :
+        quantization{},
+        cosine{},
+        dcCodes{},
+        acCodes{},
+        buffer{},
+        word{},
+        bits{}
+    {
+        int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        for (size_t i = 0; i < 64; i++)
+        {
+            quantization[i] = uint8_t(std::clamp((Quantization[i] * scale + 50) / 100, 1, 255));
+        }
+
+        for (size_t x = 0; x < 8; x++)
+        {
+            for (size_t u = 0; u < 8; u++)
+            {
+                double c = u ? 0.5 : 0.5 / std::sqrt(2.0);
+                cosine[x][u] = float(c * std::cos((2 * x + 1) * u * std::numbers::pi / 16));
+            }
+        }
+
+        BuildCodes(dcCodes.data(), DCBits, DCValues);
+        BuildCodes(acCodes.data(), ACBits, ACValues);
+    }
+
+    /** @brief The chroma planes are subsampled already, and the sizes not multiples of the MCU are padded with the edges */
+    std::vector<uint8_t> Write(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t width, uint32_t height)
+    {
+        buffer.clear();
+        word = 0;
+        bits = 0;
+
+        PutWord(0xff00 | Immortal::Vision::JpegCodec::SOI);
+
+        std::vector<uint8_t> payload{ 0x00 };
+        for (size_t k = 0; k < 64; k++)
+        {
+            payload.emplace_back(quantization[Immortal::LookupTable::ZigZagToNaturalOrder[k]]);
+        }
+        PutMarker(Immortal::Vision::JpegCodec::DQT, payload);
+
+        PutMarker(Immortal::Vision::JpegCodec::SOF0, {
+            8,
+            uint8_t(height >> 8), uint8_t(height),
+            uint8_t(width >> 8), uint8_t(width),
+            3,
+            1, 0x22, 0,
+            2, 0x11, 0,
+            3, 0x11, 0,
+        });
+
+        payload = { 0x00 };
+        payload.insert(payload.end(), std::begin(DCBits), std::end(DCBits));
+        payload.insert(payload.end(), std::begin(DCValues), std::end(DCValues));
+        PutMarker(Immortal::Vision::JpegCodec::DHT, payload);
+
+        payload = { 0x10 };
+        payload.insert(payload.end(), std::begin(ACBits), std::end(ACBits));
+        payload.insert(payload.end(), std::begin(ACValues), std::end(ACValues));
+        PutMarker(Immortal::Vision::JpegCodec::DHT, payload);
+
+        PutMarker(Immortal::Vision::JpegCodec::SOS, { 3, 1, 0x00, 2, 0x00, 3, 0x00, 0, 63, 0 });
+
+        uint32_t chromaWidth  = (width  + 1) / 2;
+        uint32_t chromaHeight = (height + 1) / 2;
+        int32_t pred[3] = {};
+        for (uint32_t my = 0; my < height; my += 16)
+        {
+            for (uint32_t mx = 0; mx < width; mx += 16)
+            {
+                EncodeBlock(y, width, height, mx,     my,     &pred[0]);
+                EncodeBlock(y, width, height, mx + 8, my,     &pred[0]);
+                EncodeBlock(y, width, height, mx,     my + 8, &pred[0]);
+                EncodeBlock(y, width, height, mx + 8, my + 8, &pred[0]);
+                EncodeBlock(u, chromaWidth, chromaHeight, mx / 2, my / 2, &pred[1]);
+                EncodeBlock(v, chromaWidth, chromaHeight, mx / 2, my / 2, &pred[2]);
+            }
+        }
+
+        /** Pad the last byte with ones */
+        PutBits(0x7f, 7);
+        PutWord(0xff00 | Immortal::Vision::JpegCodec::EOI);
+
+        return std::move(buffer);
+    }
+
+protected:
+    static void BuildCodes(Code *codes, const uint8_t *counts, const uint8_t *values)
+    {
+        uint16_t code = 0;
+        for (uint8_t length = 1, k = 0; length <= 16; length++, code <<= 1)
+        {
+            for (size_t i = 0; i < counts[length - 1]; i++, k++, code++)
+            {
+                codes[values[k]] = Code{ code, length };
+            }
+        }
+    }
+
+    void EncodeBlock(const uint8_t *plane, uint32_t width, uint32_t height, uint32_t left, uint32_t top, int32_t *pred)
+    {
+        float block[8][8];
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            const uint8_t *row = plane + size_t(std::min(top + i, height - 1)) * width;
+            for (uint32_t j = 0; j < 8; j++)
+            {
+                block[i][j] = row[std::min(left + j, width - 1)] - 128.0f;
+            }
+        }
+
+        float rows[8][8];
+        for (size_t i = 0; i < 8; i++)
+        {
+            for (size_t u = 0; u < 8; u++)
+            {
+                float sum = 0;
+                for (size_t x = 0; x < 8; x++)
+                {
+                    sum += cosine[x][u] * block[i][x];
+                }
+                rows[i][u] = sum;
+            }
+        }
+
+        int32_t coefficients[64];
+        for (size_t v = 0; v < 8; v++)
+        {
+            for (size_t u = 0; u < 8; u++)
+            {
+                float sum = 0;
+                for (size_t y = 0; y < 8; y++)
+                {
+                    sum += cosine[y][v] * rows[y][u];
+                }
+                coefficients[v * 8 + u] = int32_t(std::lround(sum / quantization[v * 8 + u]));
+            }
+        }
+
+        int32_t dc = coefficients[0];
+        PutCoefficient(dcCodes, 0, dc - *pred);
+        *pred = dc;
+
+        uint32_t run = 0;
+        for (size_t k = 1; k < 64; k++)
+        {
+            int32_t coefficient = coefficients[Immortal::LookupTable::ZigZagToNaturalOrder[k]];
+            if (!coefficient)
+            {
+                run++;
+                continue;
+            }
+            for (; run > 15; run -= 16)
+            {
+                PutBits(acCodes[0xf0].code, acCodes[0xf0].length);
+            }
+            PutCoefficient(acCodes, run, coefficient);
+            run = 0;
+        }
+        if (run)
+        {
+            PutBits(acCodes[0x00].code, acCodes[0x00].length);
+        }
+    }
+
+    /** The category of the magnitude is coded, followed by the bits of the value, the negative ones minus one */
+    void PutCoefficient(const std::array<Code, 256> &codes, uint32_t run, int32_t value)
+    {
+        uint32_t magnitude = uint32_t(value < 0 ? -value : value);
+        uint32_t category = 32 - std::countl_zero(magnitude);
+        auto &code = codes[(run << 4) | category];
+        PutBits(code.code, code.length);
+        if (category)
+        {
+            PutBits(uint32_t(value < 0 ? value - 1 : value) & ((1u << category) - 1), category);
+        }
+    }
+
+    void PutBits(uint32_t value, uint32_t length)
+    {
+        word = (word << length) | value;
+        bits += length;
+        while (bits >= 8)
+        {
+            bits -= 8;
+            uint8_t byte = uint8_t(word >> bits);
+            buffer.emplace_back(byte);
+            if (byte == 0xff)
+            {
+                buffer.emplace_back(0x00);
+            }
+        }
+    }
+
+    void PutWord(uint16_t value)
+    {
+        buffer.emplace_back(uint8_t(value >> 8));
+        buffer.emplace_back(uint8_t(value));
+    }
+
+    void PutMarker(uint8_t type, const std::vector<uint8_t> &payload)
+    {
+        PutWord(0xff00 | type);
+        PutWord(uint16_t(payload.size() + 2));
+        buffer.insert(buffer.end(), payload.begin(), payload.end());
+    }
+
+protected:
+    std::array<uint8_t, 64> quantization;
+
+    std::array<std::array<float, 8>, 8> cosine;
+
+    std::array<Code, 256> dcCodes;
+
+    std::array<Code, 256> acCodes;
+
+    std::vector<uint8_t> buffer;
+
+    uint64_t word;
+
+    uint32_t bits;
+};
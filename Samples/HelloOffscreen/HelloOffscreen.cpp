@@ -0,0 +1,266 @@
+#include "Graphics/LightGraphics.h"
+#include "Graphics/Vulkan/Device.h"
+#include "Render/OffscreenRenderer.h"
+#include "Framework/Timer.h"
+#include "Shared/Log.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace Immortal;
+
+const char *shaderSource = R"(
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+};
+
+PSInput VSMain(float4 position : POSITION, float4 color : COLOR)
+{
+    PSInput result;
+
+    result.position = position;
+    result.color = color;
+
+    return result;
+}
+
+[[vk::binding(0, 0)]] cbuffer Tint : register(b0)
+{
+    float4 tint;
+};
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    return input.color * tint;
+}
+)";
+
+struct Vertex
+{
+	float position[3];
+	float color[4];
+};
+
+static constexpr uint32_t FrameCount = 240;
+
+// Write a picture read back as a binary PPM, dropping the alpha channel
+static void WritePPM(const std::string &path, const Picture &picture)
+{
+    std::ofstream file{ path, std::ios::binary };
+    file << "P6\n" << picture.GetWidth() << " " << picture.GetHeight() << "\n255\n";
+
+    std::vector<uint8_t> row(picture.GetWidth() * 3);
+    for (uint32_t y = 0; y < picture.GetHeight(); y++)
+    {
+        const uint8_t *src = picture.GetData() + size_t(y) * picture.GetStride(0);
+        for (uint32_t x = 0; x < picture.GetWidth(); x++)
+        {
+            memcpy(&row[x * 3], &src[x * 4], 3);
+        }
+        file.write((const char *)row.data(), row.size());
+    }
+}
+
+int main(int argc, char **argv)
+{
+	LOG::Init();
+
+    // Vulkan renders without any window, lavapipe is enough on the machines without a GPU
+    // OpenGL still needs a context, which is taken from a window never shown
+	BackendAPI backendAPI = argc > 1 && std::string{ argv[1] } == "OpenGL" ? BackendAPI::OpenGL : BackendAPI::Vulkan;
+	std::string output = argc > 2 ? argv[2] : "";
+
+	uint32_t width  = 1280;
+	uint32_t height = 720;
+
+	URef<Window> window;
+	if (backendAPI == BackendAPI::OpenGL)
+	{
+		window = Window::CreateInstance("Immortal Graphics HelloOffscreen Example", width, height, WindowType::GLFW);
+	}
+
+	URef<Instance> instance = Instance::CreateInstance(backendAPI, window ? window->GetType() : Window::Type::Headless);
+	URef<Device> device = instance->CreateDevice(0);
+	URef<Queue> queue = device->CreateQueue(Queue::Type::Graphics);
+
+	URef<Swapchain> swapchain;
+	if (window)
+	{
+		swapchain = device->CreateSwapchain(queue, window, Format::BGRA8, 2, SwapchainMode::None);
+	}
+
+    // Each of the frames in flight has its own render target and slot of the readback buffer
+	URef<OffscreenRenderer> renderer = new OffscreenRenderer{ device, queue, width, height, Format::RGBA8 };
+
+	URef<Shader> vertexShader = device->CreateShader("Vertex", ShaderStage::Vertex, shaderSource, "VSMain");
+	URef<Shader> pixelShader = device->CreateShader("Pixel", ShaderStage::Pixel, shaderSource, "PSMain");
+
+	Shader *shaders[] = { vertexShader, pixelShader };
+	URef<GraphicsPipeline> pipeline = device->CreateGraphicsPipeline();
+	pipeline->Construct(
+        shaders, 2,
+        {
+            { Format::VECTOR3, "POSITION" },
+            { Format::VECTOR4, "COLOR"    }
+        },
+	    {{ Format::RGBA8 }});
+
+    vertexShader.Reset();
+	pixelShader.Reset();
+
+    float aspectRatio = float(width) / float(height);
+    Vertex triangleVertices[] =
+    {
+        { {   0.0f,  0.25f * aspectRatio, 0.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } },
+        { {  0.25f, -0.25f * aspectRatio, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+        { { -0.25f, -0.25f * aspectRatio, 0.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } }
+    };
+    uint32_t triangleIndices[] = { 0, 1, 2 };
+
+    URef<Buffer> vertexBuffer = device->CreateBuffer(sizeof(triangleVertices), BufferType::Vertex);
+    URef<Buffer> indexBuffer = device->CreateBuffer(sizeof(triangleIndices), BufferType::Index);
+
+	void *data = nullptr;
+	vertexBuffer->Map(&data, sizeof(triangleVertices), 0);
+    memcpy(data, triangleVertices, sizeof(triangleVertices));
+	vertexBuffer->Unmap();
+
+	indexBuffer->Map(&data, sizeof(triangleIndices), 0);
+    memcpy(data, triangleIndices, sizeof(triangleIndices));
+	indexBuffer->Unmap();
+
+    // The tints are white, so every draw gives the same picture through a different binding
+    const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    URef<Buffer> tintBuffers[2];
+    for (auto &tintBuffer : tintBuffers)
+    {
+        tintBuffer = device->CreateBuffer(sizeof(white), BufferType::ConstantBuffer);
+        tintBuffer->Map(&data, sizeof(white), 0);
+        memcpy(data, white, sizeof(white));
+        tintBuffer->Unmap();
+    }
+
+    // One set keeps its binding and is resolved from the cache, the other is
+    // rebound between the draws of a frame and allocated from the pools of the frame
+    URef<DescriptorSet> descriptorSet = device->CreateDescriptorSet(pipeline);
+    URef<DescriptorSet> frameDescriptorSet = device->CreateDescriptorSet(pipeline);
+    descriptorSet->Set(0, tintBuffers[0]);
+
+    // Descriptor churn stops once the frames in flight are recycled, which is
+    // counted by the Vulkan device from the middle of the run
+    Vulkan::Device *vulkanDevice = dynamic_cast<Vulkan::Device *>((Device *)device);
+    Vulkan::DescriptorStatistics warmedUp{};
+
+    uint32_t received = 0;
+    uint32_t mismatches = 0;
+    Picture last;
+    auto receive = [&] (Picture &picture) {
+        // The center of the target is inside the triangle, and never the clear color
+        const uint8_t *center = picture.GetData() + size_t(height / 2) * picture.GetStride(0) + (width / 2) * 4;
+        if (center[3] != 255 || (center[0] | center[1] | center[2]) == 0)
+        {
+            mismatches++;
+        }
+        if (uint32_t(picture.GetTimestamp()) != received)
+        {
+            LOG::ERR("Frame {} was read back out of order as {}", received, picture.GetTimestamp());
+            mismatches++;
+        }
+        received++;
+        last = std::move(picture);
+    };
+
+    Timer timer;
+    timer.Start();
+    for (uint32_t i = 0; i < FrameCount; i++)
+    {
+        CommandBuffer *commandBuffer = renderer->BeginFrame();
+
+        const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		commandBuffer->BeginRenderTarget(renderer->GetRenderTarget(), clearColor);
+
+        commandBuffer->SetPipeline(pipeline);
+		Buffer *vertexBuffers[] = { vertexBuffer };
+		commandBuffer->SetVertexBuffers(0, 1, vertexBuffers, sizeof(Vertex));
+		commandBuffer->SetIndexBuffer(indexBuffer, Format::UINT32);
+        commandBuffer->SetDescriptorSet(descriptorSet);
+		commandBuffer->DrawIndexedInstance(3, 1, 0, 0, 0);
+
+        for (auto &tintBuffer : tintBuffers)
+        {
+            frameDescriptorSet->Set(0, tintBuffer);
+            commandBuffer->SetDescriptorSet(frameDescriptorSet);
+            commandBuffer->DrawIndexedInstance(3, 1, 0, 0, 0);
+        }
+
+        commandBuffer->EndRenderTarget();
+
+        // Submitted without waiting, the picture is taken once the GPU is done with it
+        renderer->EndFrame(float(i));
+
+        Picture picture;
+        while (renderer->Readback(&picture))
+        {
+            receive(picture);
+        }
+
+        if (vulkanDevice && i == FrameCount / 2)
+        {
+            warmedUp = vulkanDevice->GetDescriptorStatistics();
+        }
+    }
+
+    renderer->Flush();
+    Picture picture;
+    while (renderer->Readback(&picture))
+    {
+        receive(picture);
+    }
+    double milliseconds = timer.Stop();
+
+    LOG::INFO("Rendered and read back {} frames of {}x{} in {:.2f} ms, {:.1f} fps", received, width, height, milliseconds, received * 1000.0 / milliseconds);
+
+    bool churned = false;
+    if (vulkanDevice)
+    {
+        auto statistics = vulkanDevice->GetDescriptorStatistics();
+        uint64_t allocations = statistics.Allocations - warmedUp.Allocations;
+        uint64_t pools       = statistics.Pools - warmedUp.Pools;
+        LOG::INFO("Descriptor sets: {} allocated and {} pools created after warming up, {} per-frame sets in {} pool resets",
+            allocations, pools, statistics.TransientAllocations - warmedUp.TransientAllocations, statistics.Resets);
+        churned = allocations || pools || !statistics.Resets;
+    }
+    if (!output.empty() && last)
+    {
+        WritePPM(output, last);
+    }
+
+    last = Picture{};
+    descriptorSet.Reset();
+    frameDescriptorSet.Reset();
+    for (auto &tintBuffer : tintBuffers)
+    {
+        tintBuffer.Reset();
+    }
+	vertexBuffer.Reset();
+	indexBuffer.Reset();
+	pipeline.Reset();
+	renderer.Reset();
+	swapchain.Reset();
+	queue.Reset();
+	device.Reset();
+	instance.Reset();
+	window.Reset();
+
+    bool passed = received == FrameCount && !mismatches && !churned;
+    if (!passed)
+    {
+        LOG::ERR("{} of {} frames read back, {} mismatched{}", received, FrameCount, mismatches, churned ? ", descriptor sets still churning" : "");
+    }
+
+	LOG::Release();
+
+    return passed ? 0 : 1;
+}
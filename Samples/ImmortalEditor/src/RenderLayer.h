@@ -317,7 +317,7 @@ public:
             if (FileSystem::Is3DModel(filepath))
             {
                 auto &mesh = object.Add<MeshComponent>();
-                mesh.Mesh = std::shared_ptr<Mesh>{ new Mesh{ res.value() } };
+                mesh.Mesh = std::shared_ptr<Mesh>{ new Mesh{ res.value(), MeshOptimization::Default } };
 
                 auto &material = object.Add<MaterialComponent>();
                 material.References.resize(mesh.Mesh->NodeList().size());
@@ -5,10 +5,15 @@
  */
 
 #include "Immortal.h"
+#include "Vision/Image.h"
 #include "Vision/Image/Raw.h"
 #include "RawExtractor.h"
 #include "FileSystem/FileSystem.h"
 
+#include <atomic>
+#include <chrono>
+#include <future>
+
 using namespace Immortal;
 
 void ReadAllFiles(const std::string &path, std::vector<std::string> &raws)
@@ -26,23 +31,79 @@ void ReadAllFiles(const std::string &path, std::vector<std::string> &raws)
     }
 }
 
+/**
+ * Decode every raw with each mode on all the cores, the codecs are created
+ * per task while the LibRaw processors are reused by the pool of RawCodec.
+ */
+void BenchmarkModes(const std::vector<std::string> &raws)
+{
+    static const std::pair<Vision::RawDecodeMode, const char *> modes[] = {
+        { Vision::RawDecodeMode::Preview,  "Preview"  },
+        { Vision::RawDecodeMode::HalfSize, "HalfSize" },
+        { Vision::RawDecodeMode::Bayer,    "Bayer"    },
+        { Vision::RawDecodeMode::Full,     "Full"     },
+    };
+
+    for (auto &[mode, name] : modes)
+    {
+        std::atomic<size_t> decoded = 0;
+        std::vector<std::future<void>> futures;
+        futures.reserve(raws.size());
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto &raw : raws)
+        {
+            futures.emplace_back(Async::Execute([&, mode = mode] {
+                Vision::CodedFrame codedFrame = Vision::CodedFrame::Map(raw);
+                Vision::RawCodec codec;
+                codec.SetMode(mode);
+                codec.SetBits(Vision::RawBitDepth::_8);
+                if (codec.Decode(codedFrame) == CodecError::Succeed)
+                {
+                    decoded++;
+                }
+            }));
+        }
+        for (auto &future : futures)
+        {
+            future.wait();
+        }
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG::INFO("{:>8}: {}/{} raws in {:.3f}s, {:.2f} images/s", name, decoded.load(), raws.size(), seconds, decoded.load() / seconds);
+    }
+}
+
 int main(int argc, char **argv)
 {
     LOG::Setup();
+    Async::Init();
 
     std::vector<std::string> allFiles;
     ReadAllFiles(argv[1], allFiles);
 
-    std::vector<uint8_t> buffer;
-    Stream stream{ Stream::Mode::Read };
-    stream.Open(allFiles[1]);
-    stream.Read(buffer);
+    if (argc > 2 && std::string{ argv[2] } == "--benchmark")
+    {
+        BenchmarkModes(allFiles);
+    }
+    else
+    {
+        std::atomic<size_t> decoded = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto future = Vision::Read(allFiles, [&] (size_t index, Vision::Picture &&picture) {
+            if (picture)
+            {
+                decoded++;
+            }
+            LOG::INFO("Decoded {}", allFiles[index]);
+        });
+        future.wait();
 
-    Vision::CodedFrame codedFrame = { std::move(buffer) };
-    Vision::RawCodec rawCodec;
-    rawCodec.SetBits(Vision::RawBitDepth::_8);
-    rawCodec.Decode(codedFrame);
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG::INFO("Decoded {}/{} raws in {:.3f}s", decoded.load(), allFiles.size(), seconds);
+    }
 
+    Async::Release();
     LOG::Release();
 
     return 0;
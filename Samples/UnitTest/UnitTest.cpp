@@ -1,7 +1,26 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <Immortal.h>
+#include "Render/MeshOptimizer.h"
+#include "Vision/Common/BitTracker.h"
+#include "Vision/Common/Checksum.h"
+#include "Vision/CodecRegistry.h"
+#include "Vision/Image/JPEG.h"
+#include "Vision/Image/STBCodec.h"
+#include "Vision/Processing/Demosaic.h"
+#include "JpegWriter.h"
 
 class UnitTest
 {
@@ -14,6 +33,8 @@ public:
 
     }
 
+    virtual ~UnitTest() = default;
+
     virtual bool Conformance() const
     {
         return true;
@@ -26,6 +47,12 @@ public:
 class RefUnitTest : public UnitTest
 {
 public:
+    RefUnitTest() :
+        UnitTest{ "Ref" }
+    {
+
+    }
+
     virtual bool Conformance() const
     {
         using namespace Immortal;
@@ -60,9 +87,744 @@ public:
     }
 };
 
+class MeshOptimizerUnitTest : public UnitTest
+{
+public:
+    MeshOptimizerUnitTest() :
+        UnitTest{ "MeshOptimizer" }
+    {
+
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal;
+
+        constexpr uint32_t size = 64;
+        std::vector<SkeletonVertex> vertices((size + 1) * (size + 1));
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                auto &vertex = vertices[y * (size + 1) + x];
+                vertex.Position   = Vector3{ x, y, 0 };
+                vertex.Normal     = Vector3{ 0, 0, 1 };
+                vertex.Tangent    = Vector3{ 1, 0, 0 };
+                vertex.Texcoord   = Vector2{ (float)x / size, (float)y / size };
+                vertex.BoneIds[0] = x % 255;
+                vertex.Weights[0] = 1.0f;
+            }
+        }
+
+        /* Emit the grid column by column to defeat the vertex cache */
+        std::vector<uint32_t> indices;
+        for (uint32_t x = 0; x < size; x++)
+        {
+            for (uint32_t y = 0; y < size; y++)
+            {
+                uint32_t v = y * (size + 1) + x;
+                indices.insert(indices.end(), { v, v + size + 1, v + 1, v + 1, v + size + 1, v + size + 2 });
+            }
+        }
+
+        float before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+        float after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+        if (after > before)
+        {
+            return false;
+        }
+
+        size_t referenced = MeshOptimizer::OptimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.size());
+        if (referenced != vertices.size() || indices[0] != 0)
+        {
+            return false;
+        }
+
+        std::vector<QuantizedSkeletonVertex> quantized(vertices.size());
+        MeshOptimizer::Quantize(quantized.data(), vertices.data(), vertices.size());
+
+        return MeshOptimizer::Validate(vertices.data(), quantized.data(), vertices.size()).Passed();
+    }
+};
+
+class ChecksumUnitTest : public UnitTest
+{
+public:
+    ChecksumUnitTest() :
+        UnitTest{ std::string{ "Checksum (" } + Checksum::GetCyclicRedundancyCheck32Implementation() + ")" }
+    {
+
+    }
+
+    /** One bit at a time, the reference of the tables and the instructions */
+    static uint32_t Bitwise(uint32_t crc, const uint8_t *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            crc ^= uint32_t(data[i]) << 24;
+            for (int j = 0; j < 8; j++)
+            {
+                crc = (crc << 1) ^ ((crc >> 31) ? CRC32_GENERATOR_POLYNOMIAL : 0);
+            }
+        }
+
+        return crc;
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Checksum;
+
+        std::vector<uint8_t> buffer(4096 + 16);
+        uint32_t seed = 0x12345678;
+        for (auto &byte : buffer)
+        {
+            seed = seed * 1664525 + 1013904223;
+            byte = uint8_t(seed >> 24);
+        }
+
+        /* Every offset within 16 bytes, and every length around the 64-byte blocks the instructions fold */
+        for (size_t offset = 0; offset < 16; offset++)
+        {
+            const uint8_t *data = buffer.data() + offset;
+            for (size_t size = 0; size <= 4096; size += size < 272 ? 1 : 61)
+            {
+                uint32_t expected = Bitwise(CRC32_INITIAL_VALUE, data, size);
+                if (UpdateCyclicRedundancyCheck32Portable(CRC32_INITIAL_VALUE, data, size) != expected ||
+                    UpdateCyclicRedundancyCheck32(CRC32_INITIAL_VALUE, data, size) != expected)
+                {
+                    return false;
+                }
+            }
+        }
+
+        /* Fed in chunks of uneven sizes */
+        CRC32 crc;
+        for (size_t offset = 0, chunk = 1; offset < buffer.size(); offset += chunk, chunk = chunk * 3 + 1)
+        {
+            crc.Update(buffer.data() + offset, std::min(chunk, buffer.size() - offset));
+        }
+
+        return crc.Value() == Bitwise(CRC32_INITIAL_VALUE, buffer.data(), buffer.size());
+    }
+};
+
+class DemosaicUnitTest : public UnitTest
+{
+public:
+    /** Odd in both directions for the last column and row of the pairs, and taller than a band */
+    static constexpr uint32_t Width  = 67;
+    static constexpr uint32_t Height = 75;
+
+public:
+    DemosaicUnitTest() :
+        UnitTest{ "Demosaic" }
+    {
+
+    }
+
+    /** The mosaic of a scene of one colour, with the levels and white balance undone */
+    static Immortal::Picture Mosaic(const float *color, const Immortal::Vision::DemosaicParams &params)
+    {
+        using namespace Immortal;
+
+        static const int channels[][4] = {
+            { 0, 1, 1, 2 },
+            { 2, 1, 1, 0 },
+            { 1, 0, 2, 1 },
+            { 1, 2, 0, 1 },
+        };
+
+        Picture bayer{ Width, Height, Format::BayerLayerRGBG, true };
+        uint16_t *samples = (uint16_t *)bayer.GetData();
+        float range = float(params.WhiteLevel - params.BlackLevel);
+        for (uint32_t y = 0; y < Height; y++)
+        {
+            for (uint32_t x = 0; x < Width; x++)
+            {
+                int channel = channels[size_t(params.Pattern)][((y & 1) << 1) | (x & 1)];
+                float value = color[channel] / params.WhiteBalance[channel] * range + params.BlackLevel;
+                samples[y * Width + x] = uint16_t(value + 0.5f);
+            }
+        }
+
+        return bayer;
+    }
+
+    /** Every pixel within 1/1024 of the colour, which leaves room for the rounding of the samples */
+    static bool Reconstructs(const Immortal::Picture &picture, const float *color)
+    {
+        const uint16_t *pixels = (const uint16_t *)picture.GetData();
+        for (size_t i = 0; i < size_t(Width) * Height; i++)
+        {
+            for (size_t c = 0; c < 3; c++)
+            {
+                if (std::abs(pixels[i * 4 + c] - color[c] * 65535.0f) > 65535.0f / 1024.0f)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal::Vision;
+
+        const float gray[3]  = { 0.5f, 0.5f, 0.5f };
+        const float color[3] = { 0.2f, 0.45f, 0.7f };
+        for (auto method : { DemosaicMethod::Bilinear, DemosaicMethod::EdgeAware })
+        {
+            for (auto pattern : { BayerPattern::RGGB, BayerPattern::BGGR, BayerPattern::GRBG, BayerPattern::GBRG })
+            {
+                /* A flat field comes out flat */
+                DemosaicParams params{
+                    .Method     = method,
+                    .Pattern    = pattern,
+                    .BlackLevel = 256,
+                    .WhiteLevel = 4095,
+                };
+                if (!Reconstructs(Demosaic(Mosaic(gray, params), params), gray))
+                {
+                    return false;
+                }
+
+                /* The colour of the scene is recovered from the mosaic of the pattern, through the white balance */
+                params.WhiteBalance[0] = 2.0f;
+                params.WhiteBalance[2] = 1.5f;
+                if (!Reconstructs(Demosaic(Mosaic(color, params), params), color))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+class CodecRegistryUnitTest : public UnitTest
+{
+public:
+    CodecRegistryUnitTest() :
+        UnitTest{ "CodecRegistry" }
+    {
+
+    }
+
+    static std::string_view Best(const std::vector<uint8_t> &buffer, Immortal::Vision::CodecCapability required = Immortal::Vision::CodecCapability::None)
+    {
+        auto candidates = Immortal::Vision::CodecRegistry::Get().Sniff(buffer, required);
+        return candidates.empty() ? "" : candidates.front().Description->Name;
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal::Vision;
+
+        /* SOI, an empty APP0 and the frame header of a baseline YUV 4:2:0 scan */
+        std::vector<uint8_t> baseline = {
+            0xff, 0xd8,
+            0xff, 0xe0, 0x00, 0x02,
+            0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x10, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01,
+        };
+        std::vector<uint8_t> progressive = baseline;
+        progressive[7] = 0xc2;
+
+#ifdef SL_HAVE_INTRISIC
+        std::string_view baselineCodec = "JpegCodec";
+#else
+        std::string_view baselineCodec = "STBCodec";
+#endif
+        std::string_view png{ "\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR", 16 };
+        std::string_view cr3{ "\0\0\0\x18" "ftypcrx \0\0\0\x01", 16 };
+        std::string_view radiance{ "#?RADIANCE\n" };
+        struct {
+            std::vector<uint8_t> buffer;
+            CodecCapability required;
+            std::string_view expected;
+        } cases[] = {
+            { baseline,                          CodecCapability::None,             baselineCodec },
+            { baseline,                          CodecCapability::Progressive,      "STBCodec"    },
+            { progressive,                       CodecCapability::None,             "STBCodec"    },
+            { { png.begin(), png.end() },        CodecCapability::None,             "STBCodec"    },
+            { { radiance.begin(), radiance.end() }, CodecCapability::HighDynamicRange, "STBCodec" },
+            { { 'B', 'M', 0, 0, 0, 0 },          CodecCapability::None,             "BMPCodec"    },
+            { { 'P', '3', '\n' },                CodecCapability::None,             "PPMCodec"    },
+            { { 'I', 'I', '*', 0, 8, 0, 0, 0 },  CodecCapability::None,             "RawCodec"    },
+            { { 'M', 'M', 0, '*', 0, 0, 0, 8 },  CodecCapability::None,             "RawCodec"    },
+            { { cr3.begin(), cr3.end() },        CodecCapability::None,             "RawCodec"    },
+        };
+        for (auto &[buffer, required, expected] : cases)
+        {
+            if (Best(buffer, required) != expected)
+            {
+                return false;
+            }
+        }
+
+        /* Too short for any magic, only the catch-all fallback may take it */
+        auto shortest = Best({ 0xff, 0xd8 });
+        if (!shortest.empty() && shortest != "OpenCVCodec")
+        {
+            return false;
+        }
+
+        /* One instance per thread, the same one for every decode */
+        auto &registry = CodecRegistry::Get();
+        auto codec = registry.Acquire(registry.Sniff(baseline).front().Description);
+        return codec && codec == registry.Acquire(registry.Sniff(baseline).front().Description);
+    }
+};
+
+class BitTrackerUnitTest : public UnitTest
+{
+public:
+    BitTrackerUnitTest() :
+        UnitTest{ "BitTracker" }
+    {
+
+    }
+
+    /** The byte at a time reader the bit trackers replaced, the stuffed 0xFF00 reads as 0xFF for JPEG */
+    class ReferenceReader
+    {
+    public:
+        ReferenceReader(const uint8_t *data, size_t size, bool destuff = false)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                bytes.push_back(data[i]);
+                if (destuff && data[i] == 0xff && i + 1 < size && data[i + 1] == 0x00)
+                {
+                    i++;
+                }
+            }
+        }
+
+        uint64_t GetBits(uint32_t n)
+        {
+            uint64_t value = 0;
+            for (uint32_t i = 0; i < n; i++, position++)
+            {
+                size_t byte = position >> 3;
+                uint64_t bit = byte < bytes.size() ? (bytes[byte] >> (7 - (position & 7))) & 1 : 0;
+                value = (value << 1) | bit;
+            }
+
+            return value;
+        }
+
+        uint64_t Preview(uint32_t n)
+        {
+            uint64_t saved = position;
+            uint64_t value = GetBits(n);
+            position = saved;
+
+            return value;
+        }
+
+        bool NoMoreData() const
+        {
+            return position > bytes.size() * 8;
+        }
+
+    public:
+        std::vector<uint8_t> bytes;
+
+        uint64_t position = 0;
+    };
+
+    /** Random reads and skips of any width, across the 8-byte refills and past the end */
+    template <class T>
+    static bool Compare(T &tracker, ReferenceReader &reference, std::mt19937 &random, size_t operations, bool checkEnd)
+    {
+        for (size_t i = 0; i < operations; i++)
+        {
+            uint32_t n = random() % 65;
+            bool equal = true;
+            switch (random() % 4)
+            {
+            case 0:
+                equal = tracker.GetBits(n) == reference.GetBits(n);
+                break;
+
+            case 1:
+                equal = tracker.GetBit() == reference.GetBits(1);
+                break;
+
+            case 2:
+                n = random() % 200;
+                tracker.SkipBits(n);
+                reference.GetBits(n);
+                break;
+
+            default:
+                n = std::min<uint32_t>(n, Immortal::BitTracker::MaxBitsPerRead);
+                equal = tracker.Preview(n) == reference.Preview(n);
+                break;
+            }
+
+            if constexpr (requires { tracker.NoMoreData(); })
+            {
+                equal = equal && (!checkEnd || tracker.NoMoreData() == reference.NoMoreData());
+            }
+            if (!equal)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal;
+
+        std::mt19937 random{ 1 };
+        auto generate = [&] (size_t size, uint32_t markerChance) {
+            std::vector<uint8_t> bytes(size);
+            for (auto &byte : bytes)
+            {
+                byte = random() % markerChance ? uint8_t(random()) : 0xff;
+            }
+            return bytes;
+        };
+
+        /* Plain streams, the short ones never take the 64-bit refill */
+        for (size_t size : { 0, 1, 3, 7, 8, 9, 15, 16, 17, 63, 1000 })
+        {
+            for (int round = 0; round < 16; round++)
+            {
+                auto bytes = generate(size, 256);
+                BitTracker tracker{ bytes.data(), bytes.size() };
+                ReferenceReader reference{ bytes.data(), bytes.size() };
+                if (tracker.NoMoreData() || !Compare(tracker, reference, random, size / 2 + 32, true))
+                {
+                    return false;
+                }
+            }
+        }
+
+        /* Exp-Golomb codes of every length up to 31 leading zeros */
+        std::vector<int64_t> values;
+        std::vector<uint8_t> stream;
+        uint64_t position = 0;
+        auto put = [&] (uint64_t code, uint32_t bits) {
+            for (uint32_t i = bits; i-- > 0; position++)
+            {
+                if ((position >> 3) >= stream.size())
+                {
+                    stream.push_back(0);
+                }
+                stream[position >> 3] |= uint8_t(((code >> i) & 1) << (7 - (position & 7)));
+            }
+        };
+        for (int i = 0; i < 4096; i++)
+        {
+            uint64_t codeNum = (uint64_t(random()) >> (random() % 32)) % ((1ull << 31) - 1);
+            values.push_back(int64_t(codeNum));
+            put(codeNum + 1, 2 * std::bit_width(codeNum + 1) - 1);
+        }
+        BitTracker tracker{ stream.data(), stream.size() };
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            int64_t value = i & 1 ? tracker.SignedExpGolomb() : int64_t(tracker.UnsignedExpGolomb());
+            int64_t expected = i & 1 ? ((values[i] & 1) ? (values[i] + 1) >> 1 : -(values[i] >> 1)) : values[i];
+            if (value != expected)
+            {
+                return false;
+            }
+        }
+
+        /* JPEG entropy coded segments with 0xFF00 stuffed, which stop at the EOI marker */
+        for (size_t size : { 1, 7, 8, 9, 64, 4096 })
+        {
+            for (int round = 0; round < 16; round++)
+            {
+                auto bytes = generate(size, 16);
+                std::vector<uint8_t> stuffed;
+                for (auto byte : bytes)
+                {
+                    stuffed.push_back(byte);
+                    if (byte == 0xff)
+                    {
+                        stuffed.push_back(0x00);
+                    }
+                }
+                stuffed.insert(stuffed.end(), { 0xff, 0xd9 });
+
+                JpegBitTracker tracker{ stuffed.data(), stuffed.size() };
+                ReferenceReader reference{ stuffed.data(), stuffed.size() - 2, true };
+                if (!Compare(tracker, reference, random, size / 2 + 32, false))
+                {
+                    return false;
+                }
+                tracker.SkipBits(uint32_t(bytes.size() * 8 + 64));
+                if (tracker.Marker() != 0xd9)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+class JpegUnitTest : public UnitTest
+{
+public:
+    static constexpr uint32_t Width  = 256;
+    static constexpr uint32_t Height = 160;
+
+    /** The mean and the largest difference allowed per channel, the chroma is upsampled differently */
+    static constexpr double  MeanTolerance = 3.0;
+    static constexpr int32_t MaxTolerance  = 16;
+
+public:
+    JpegUnitTest() :
+        UnitTest{ "Jpeg" }
+    {
+
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal;
+        using namespace Immortal::Vision;
+
+        /* A smooth pattern with mild noise, most of it in the lowest frequencies like a photo */
+        std::mt19937 random{ 0 };
+        std::vector<uint8_t> y(size_t(Width) * Height);
+        std::vector<uint8_t> u(size_t(Width / 2) * (Height / 2));
+        std::vector<uint8_t> v(u.size());
+        for (uint32_t i = 0; i < Height; i++)
+        {
+            for (uint32_t j = 0; j < Width; j++)
+            {
+                double luma = 128 + 60 * std::sin(j / 17.0) * std::cos(i / 11.0) + int(random() % 9) - 4;
+                y[size_t(i) * Width + j] = uint8_t(std::clamp(luma, 0.0, 255.0));
+            }
+        }
+        for (uint32_t i = 0; i < Height / 2; i++)
+        {
+            for (uint32_t j = 0; j < Width / 2; j++)
+            {
+                u[size_t(i) * (Width / 2) + j] = uint8_t(128 + 40 * std::sin((i + j) / 29.0));
+                v[size_t(i) * (Width / 2) + j] = uint8_t(128 + 40 * std::cos((double(j) - i) / 37.0));
+            }
+        }
+
+        JpegWriter writer{ 90 };
+        CodedFrame codedFrame{ writer.Write(y.data(), u.data(), v.data(), Width, Height) };
+
+        /* The full decode of another decoder, so the reference doesn't share the code tested */
+        STBCodec reference;
+        if (reference.Decode(codedFrame) != CodecError::Succeed)
+        {
+            return false;
+        }
+        Picture full = reference.GetPicture();
+        const uint8_t *expected = full.GetData();
+
+        JpegCodec codec;
+        for (auto scale : { DecodeScale::Half, DecodeScale::Quarter, DecodeScale::Eighth })
+        {
+            codec.SetDecodeOptions({ .Scale = scale });
+            if (codec.Decode(codedFrame) != CodecError::Succeed)
+            {
+                return false;
+            }
+
+            Picture picture = codec.GetPicture();
+            uint32_t factor = 1u << uint32_t(scale);
+            uint32_t width  = Width / factor;
+            uint32_t height = Height / factor;
+            if (picture.GetWidth() != width || picture.GetHeight() != height)
+            {
+                return false;
+            }
+
+            /* Each sample against the mean of the pixels of the full decode it stands for */
+            const uint8_t *decoded = picture.GetData();
+            uint32_t area = factor * factor;
+            double error = 0;
+            int32_t maxError = 0;
+            for (uint32_t i = 0; i < height; i++)
+            {
+                for (uint32_t j = 0; j < width; j++)
+                {
+                    for (uint32_t c = 0; c < 3; c++)
+                    {
+                        uint32_t sum = 0;
+                        for (uint32_t dy = 0; dy < factor; dy++)
+                        {
+                            for (uint32_t dx = 0; dx < factor; dx++)
+                            {
+                                sum += expected[((size_t(i) * factor + dy) * Width + j * factor + dx) * 4 + c];
+                            }
+                        }
+                        int32_t difference = std::abs(int32_t(decoded[(size_t(i) * width + j) * 4 + c]) - int32_t((sum + area / 2) / area));
+                        error += difference;
+                        maxError = std::max(maxError, difference);
+                    }
+                }
+            }
+            error /= double(width) * height * 3;
+            if (error > MeanTolerance || maxError > MaxTolerance)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+class BatchReaderUnitTest : public UnitTest
+{
+public:
+    static constexpr size_t FileCount = 24;
+
+    static constexpr size_t MaxInFlightBytes = 6 * 1024;
+
+public:
+    BatchReaderUnitTest() :
+        UnitTest{ "BatchReader" }
+    {
+
+    }
+
+    struct Observer
+    {
+        std::mutex mutex;
+
+        std::vector<uint32_t> calls;
+
+        uint32_t running = 0;
+
+        uint32_t maxRunning = 0;
+
+        size_t inFlightBytes = 0;
+
+        bool exceeded = false;
+    };
+
+    /** @brief Counts the callbacks of every file, and which of them overlap, through a batch that stalls in the callback */
+    static bool Run(const std::vector<std::string> &paths, const std::vector<size_t> &sizes, size_t failing)
+    {
+        using namespace Immortal;
+
+        Observer observer;
+        observer.calls.resize(paths.size());
+        auto future = Vision::Read(paths, [&] (size_t index, Picture &&) {
+            {
+                std::lock_guard lock{ observer.mutex };
+                observer.calls[index]++;
+                observer.running++;
+                observer.inFlightBytes += sizes[index];
+                observer.maxRunning = std::max(observer.maxRunning, observer.running);
+                /* A file over the bound is only ever decoded alone */
+                observer.exceeded |= observer.running > 1 && observer.inFlightBytes > MaxInFlightBytes;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+
+            {
+                std::lock_guard lock{ observer.mutex };
+                observer.running--;
+                observer.inFlightBytes -= sizes[index];
+            }
+
+            if (index == failing)
+            {
+                throw std::runtime_error{ "Callback failed" };
+            }
+        }, MaxInFlightBytes);
+
+        bool rethrown = false;
+        try
+        {
+            future.get();
+        }
+        catch (const std::runtime_error &)
+        {
+            rethrown = true;
+        }
+
+        if (rethrown != (failing < paths.size()) || observer.exceeded || observer.maxRunning > std::max(std::thread::hardware_concurrency(), 1u))
+        {
+            return false;
+        }
+
+        return std::all_of(observer.calls.begin(), observer.calls.end(), [] (uint32_t count) { return count == 1; });
+    }
+
+    virtual bool Conformance() const
+    {
+        using namespace Immortal;
+
+        bool initialized = !!Async::threadPool;
+        if (!initialized)
+        {
+            Async::Init();
+        }
+
+        /* Files of no format, delivered empty, and one larger than the bound of the bytes in flight */
+        auto directory = std::filesystem::temp_directory_path() / "ImmortalBatchReaderUnitTest";
+        std::filesystem::create_directories(directory);
+
+        std::vector<std::string> paths;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < FileCount; i++)
+        {
+            size_t size = i == FileCount / 2 ? MaxInFlightBytes * 2 : 1024 * (1 + i % 4);
+            auto path = directory / ("File" + std::to_string(i) + ".bin");
+            std::ofstream file{ path, std::ios::binary };
+            std::vector<char> bytes(size, char(i));
+            file.write(bytes.data(), bytes.size());
+            paths.emplace_back(path.string());
+            sizes.emplace_back(size);
+        }
+
+        bool passed = Run(paths, sizes, FileCount) && Run(paths, sizes, 3);
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+        if (!initialized)
+        {
+            Async::Release();
+        }
+
+        return passed;
+    }
+};
+
 int main()
 {
-    RefUnitTest{}.Conformance();
+    std::unique_ptr<UnitTest> unitTests[] = {
+        std::make_unique<RefUnitTest>(),
+        std::make_unique<MeshOptimizerUnitTest>(),
+        std::make_unique<ChecksumUnitTest>(),
+        std::make_unique<DemosaicUnitTest>(),
+        std::make_unique<BitTrackerUnitTest>(),
+        std::make_unique<CodecRegistryUnitTest>(),
+        std::make_unique<JpegUnitTest>(),
+        std::make_unique<BatchReaderUnitTest>(),
+    };
+
+    int failures = 0;
+    for (auto &unitTest : unitTests)
+    {
+        bool passed = unitTest->Conformance();
+        std::cout << unitTest->desc << ": " << (passed ? "Passed" : "Failed") << std::endl;
+        failures += !passed;
+    }
 
-    return 0;
+    return failures ? 1 : 0;
 }